@@ -6,11 +6,21 @@ layout(location = 1) in vec3 fragNormal;
 layout(location = 2) in vec2 fragTexCoord;
 
 
-layout(location = 0) out vec3 outPosition;
-layout(location = 1) out vec3 outNormal;
+// The position is reconstructed from depth by the lighting subpass
+layout(location = 0) out vec2 outNormal;
+// Albedo in rgb, roughness in alpha
+layout(location = 1) out vec4 outAlbedoRoughness;
 
+// Projects the normal onto an octahedron and unfolds its lower half over the corners, see lighting_pass.frag for the inverse
+vec2 encode_normal(vec3 n) {
+	// Interpolation can leave a near zero normal between opposite vertex normals
+	n /= max(abs(n.x) + abs(n.y) + abs(n.z), 1e-6);
+	if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return n.xy;
+}
 
 void main() {
-	outPosition = fragPosition;
-	outNormal = fragNormal;
+	outNormal = encode_normal(fragNormal);
+	// There are no materials yet, surfaces are white and fully rough
+	outAlbedoRoughness = vec4(1.0, 1.0, 1.0, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,49 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Same as geometry_pass.vert for meshes stored as PackedVertex
+
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragPosition;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec2 fragTexCoord;
+
+
+out gl_PerVertex {
+	vec4 gl_Position;
+};
+
+layout(set = 0, binding = 0) uniform MVPBuffer {
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+} mvp;
+
+// Bounds the positions were quantized in
+layout(push_constant) uniform PackedBounds {
+	vec4 min;
+	vec4 extent;
+} bounds;
+
+vec3 octahedral_decode(vec2 encoded) {
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-normal.z, 0.0);
+	normal.x += normal.x >= 0.0 ? -fold : fold;
+	normal.y += normal.y >= 0.0 ? -fold : fold;
+
+	return normalize(normal);
+}
+
+void main() {
+	vec3 position = bounds.min.xyz + inPosition.xyz * bounds.extent.xyz;
+	vec3 normal = octahedral_decode(inNormal);
+
+	gl_Position = mvp.projection * mvp.view * mvp.model * vec4(position, 1.0);
+
+	fragPosition = (mvp.model * vec4(position, 1.0)).xyz;
+	fragNormal = mat3(transpose(inverse(mvp.model))) * normal;
+	fragTexCoord = inTexCoord;
+}
\ No newline at end of file
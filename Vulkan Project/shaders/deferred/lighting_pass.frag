@@ -7,8 +7,19 @@ layout(location = 2) in vec2 fragTexCoord;
 
 layout(location = 0) out vec4 outColor;
 
-layout(set = 0, binding = 0) uniform sampler2D gPosition;
-layout(set = 0, binding = 1) uniform sampler2D gNormal;
+// Written by the geometry subpass of the same render pass, only the texel of this fragment can be read
+layout(input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput gDepth;
+// Octahedral encoded, see geometry_pass.frag
+layout(input_attachment_index = 1, set = 0, binding = 1) uniform subpassInput gNormal;
+// Albedo in rgb, roughness in alpha
+layout(input_attachment_index = 2, set = 0, binding = 2) uniform subpassInput gAlbedoRoughness;
+
+layout(push_constant) uniform Reconstruction {
+	mat4 inverseViewProjection;
+	vec3 cameraPosition;
+	// Scales the specular light of the environment, 0 until it is resident
+	float specularIntensity;
+} reconstruction;
 
 struct PointLight {
 	vec3 position;
@@ -20,14 +31,70 @@ layout(set = 1, binding = 0) uniform Lights {
 	uint pointLightCount;
 } lights;
 
+// Diffuse light of the environment as spherical harmonics, see Core/Render/SphericalHarmonics.h
+layout(set = 1, binding = 1) uniform Irradiance {
+	vec4 coefficients[9];
+} irradiance;
+
+// The environment convolved with the GGX lobe, level i for a roughness of i / (levels - 1). See Core/Render/EnvironmentLighting.h
+layout(set = 1, binding = 2) uniform samplerCube specularEnvironment;
+// Scale and bias of F0 for the split sum, by n dot v in x and roughness in y
+layout(set = 1, binding = 3) uniform sampler2D brdfLut;
+
+// Reflectance at normal incidence of dielectrics
+const vec3 F0 = vec3(0.04);
+
+vec3 ambient_light(vec3 n) {
+	return irradiance.coefficients[0].rgb
+		+ irradiance.coefficients[1].rgb * n.y
+		+ irradiance.coefficients[2].rgb * n.z
+		+ irradiance.coefficients[3].rgb * n.x
+		+ irradiance.coefficients[4].rgb * n.x * n.y
+		+ irradiance.coefficients[5].rgb * n.y * n.z
+		+ irradiance.coefficients[6].rgb * (3.0 * n.z * n.z - 1.0)
+		+ irradiance.coefficients[7].rgb * n.x * n.z
+		+ irradiance.coefficients[8].rgb * (n.x * n.x - n.y * n.y);
+}
+
+vec3 specular_light(vec3 n, vec3 v, float roughness) {
+	float nDotV = max(dot(n, v), 0.0);
+	vec3 r = reflect(-v, n);
+
+	float maxLod = float(textureQueryLevels(specularEnvironment) - 1);
+	vec3 prefiltered = textureLod(specularEnvironment, r, roughness * maxLod).rgb;
+	vec2 scaleBias = texture(brdfLut, vec2(nDotV, roughness)).rg;
+
+	return prefiltered * (F0 * scaleBias.x + scaleBias.y) * reconstruction.specularIntensity;
+}
+
+vec3 decode_normal(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
 void main() {
-	vec2 screenSpaceUv = vec2(gl_FragCoord.x / 1280, gl_FragCoord.y / 720);
-	vec3 N = texture(gNormal, screenSpaceUv).rgb;
-	vec3 fragPos = texture(gPosition, screenSpaceUv).rgb;
+	float depth = subpassLoad(gDepth).r;
+
+	// The background is left to the skybox
+	if (depth >= 1.0) {
+		outColor = vec4(0.0, 0.0, 0.0, 1.0);
+		return;
+	}
+
+	// The screen quad covers clip space, so its position is the clip space position of the fragment
+	vec4 worldPosition = reconstruction.inverseViewProjection * vec4(fragPosition.xy, depth, 1.0);
+	vec3 fragPos = worldPosition.xyz / worldPosition.w;
+	vec3 N = decode_normal(subpassLoad(gNormal).xy);
+	vec4 albedoRoughness = subpassLoad(gAlbedoRoughness);
+	vec3 albedo = albedoRoughness.rgb;
+	vec3 V = normalize(reconstruction.cameraPosition - fragPos);
 
-	vec3 finalColor = vec3(0);
+	vec3 finalColor = max(ambient_light(N), 0.0);
 
-	for(int i = 0; i < lights.pointLightCount; i++) {
+	for (uint i = 0; i < lights.pointLightCount; i++) {
 		PointLight light = lights.pointLights[i];
 		vec3 L = normalize(light.position - fragPos);
 		float distance = distance(fragPos, light.position);
@@ -35,5 +102,5 @@ void main() {
 		finalColor += max(dot(N, L), 0.0) * light.intensity * attenuation;
 	}
 
-	outColor = vec4(finalColor, 1.0);
+	outColor = vec4(finalColor * albedo + specular_light(N, V, albedoRoughness.a), 1.0);
 }
\ No newline at end of file
@@ -5,7 +5,7 @@ layout(location = 0) in vec3 fragPosition;
 
 layout(location = 0) out vec4 outColor;
 
-layout(set = 1, binding = 0) uniform sampler3D skybox;
+layout(set = 1, binding = 0) uniform samplerCube skybox;
 
 void main() {
 	vec3 sampleVector = normalize(fragPosition);
@@ -1,12 +1,30 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_multiview : enable
 
-layout(location = 0) in vec3 inPosition;
+layout(location = 0) in vec2 facePosition;
 
 layout (location = 0) out vec4 outColor;
 
 layout(set = 0, binding = 0) uniform sampler2D rectMap;
 
+layout(push_constant) uniform PushConstants {
+	// Level of the source matching the size of a texel of the level being baked
+	float sourceLod;
+} bake;
+
+// Direction through a point of a face, in the order and orientation of Vulkan cubemaps. Every view renders one face
+vec3 cubeDirection(uint face, vec2 p) {
+	switch (face) {
+	case 0: return vec3(1.0, -p.y, -p.x);
+	case 1: return vec3(-1.0, -p.y, p.x);
+	case 2: return vec3(p.x, 1.0, p.y);
+	case 3: return vec3(p.x, -1.0, -p.y);
+	case 4: return vec3(p.x, -p.y, 1.0);
+	default: return vec3(-p.x, -p.y, -1.0);
+	}
+}
+
 const vec2 invAtan = vec2(0.1591, 0.3183);
 vec2 SampleSphericalMap(vec3 v) {
     vec2 uv = vec2(atan(v.z, v.x), asin(v.y));
@@ -16,8 +34,9 @@ vec2 SampleSphericalMap(vec3 v) {
 }
 
 void main() {
-	vec2 uv = SampleSphericalMap(normalize(inPosition));
-	vec3 color = texture(rectMap, uv).rgb;
+	vec2 uv = SampleSphericalMap(normalize(cubeDirection(gl_ViewIndex, facePosition)));
+	// An explicit level, derivatives are meaningless across the seam of the equirectangular map
+	vec3 color = textureLod(rectMap, uv, bake.sourceLod).rgb;
 
 	outColor = vec4(color, 1.0);
 }
\ No newline at end of file
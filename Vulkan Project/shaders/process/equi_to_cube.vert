@@ -1,23 +1,17 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in vec2 inTexCoord;
-
-layout(location = 0) out vec3 localPosition;
+// Point on the face in [-1, 1], with y pointing down the face like the framebuffer
+layout(location = 0) out vec2 facePosition;
 
 out gl_PerVertex {
     vec4 gl_Position;
 };
 
-layout(push_constant) uniform PushConstants {
-	mat4 view;
-	mat4 projection;
-} vp;
-
-
 void main() {
-    gl_Position = vp.projection * vp.view * vec4(inPosition, 1.0);
-	localPosition = inPosition;
+	// A single triangle covering the whole face
+	vec2 position = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2) * 2.0 - 1.0;
+
+	facePosition = position;
+	gl_Position = vec4(position, 0.0, 1.0);
 }
\ No newline at end of file
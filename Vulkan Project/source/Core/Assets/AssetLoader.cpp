@@ -0,0 +1,467 @@
+#include "AssetLoader.h"
+
+#include <Core/Vulkan/VkUtil.h>
+
+#include <chrono>
+#include <cstring>
+
+namespace {
+	// Copies out of the staging buffer start on this alignment, which covers the texel size of every format uploaded
+	constexpr vk::DeviceSize STAGING_ALIGNMENT = 16;
+
+	vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+void UploadCommands::finishBuffer(vk::Buffer buffer, vk::PipelineStageFlags stages, vk::AccessFlags access) {
+	vk::BufferMemoryBarrier barrier;
+	barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	barrier.dstAccessMask = access;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = buffer;
+	barrier.size = VK_WHOLE_SIZE;
+
+	if (!acquire) {
+		transfer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, stages, vk::DependencyFlags(), 0, nullptr, 1, &barrier, 0, nullptr);
+		return;
+	}
+
+	// The release makes the writes available, the acquire makes them visible. Neither half uses the access mask of the other queue
+	barrier.srcQueueFamilyIndex = transferFamily;
+	barrier.dstQueueFamilyIndex = graphicsFamily;
+	barrier.dstAccessMask = vk::AccessFlags();
+	transfer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags(), 0, nullptr, 1, &barrier, 0, nullptr);
+
+	// The acquire waits for the semaphore, which blocks the transfer stage
+	barrier.srcAccessMask = vk::AccessFlags();
+	barrier.dstAccessMask = access;
+	acquire.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, stages, vk::DependencyFlags(), 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void UploadCommands::finishSharedBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size, vk::PipelineStageFlags stages, vk::AccessFlags access) {
+	vk::BufferMemoryBarrier barrier;
+	barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	barrier.dstAccessMask = access;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = buffer;
+	barrier.offset = offset;
+	barrier.size = size;
+
+	// With a dedicated transfer queue the semaphore makes the writes available, the graphics queue only has to wait for it
+	if (!acquire) transfer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, stages, vk::DependencyFlags(), 0, nullptr, 1, &barrier, 0, nullptr);
+	else acquire.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, stages, vk::DependencyFlags(), 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void UploadCommands::finishImage(vk::Image image) {
+	vk::ImageMemoryBarrier barrier;
+	barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+	barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+	barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+	barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+	barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+	if (!acquire) {
+		transfer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &barrier);
+		return;
+	}
+
+	// Both halves name the same layouts, the transition happens once between them
+	barrier.srcQueueFamilyIndex = transferFamily;
+	barrier.dstQueueFamilyIndex = graphicsFamily;
+	barrier.dstAccessMask = vk::AccessFlags();
+	transfer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &barrier);
+
+	barrier.srcAccessMask = vk::AccessFlags();
+	barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+	acquire.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+MeshAsset::~MeshAsset() {
+	if (!vulkan) return;
+
+	arena->free(geometry);
+}
+
+vk::DeviceSize MeshAsset::uploadSize() const {
+	return align_up(mesh.vertexDataSize(), STAGING_ALIGNMENT) + mesh.indexDataSize();
+}
+
+void MeshAsset::recordUpload(VulkanInstance& t_vulkan, UploadCommands& commands, vk::Buffer stagingBuffer, vk::DeviceSize stagingOffset, uint8* staging) {
+	geometry = arena->allocate(mesh.vertexCount, mesh.vertexStride, mesh.indexCount, mesh.indexSize);
+	vulkan = &t_vulkan;
+
+	vk::DeviceSize indexOffset = align_up(mesh.vertexDataSize(), STAGING_ALIGNMENT);
+	memcpy(staging, mesh.vertices, mesh.vertexDataSize());
+	memcpy(staging + indexOffset, mesh.indices, mesh.indexDataSize());
+
+	commands.transfer.copyBuffer(stagingBuffer, arena->vertexBuffer, vk::BufferCopy(stagingOffset, geometry.vertexDataOffset, mesh.vertexDataSize()));
+	commands.transfer.copyBuffer(stagingBuffer, arena->indexBuffer, vk::BufferCopy(stagingOffset + indexOffset, geometry.indexDataOffset, mesh.indexDataSize()));
+	commands.finishSharedBuffer(arena->vertexBuffer, geometry.vertexDataOffset, mesh.vertexDataSize(), vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eVertexAttributeRead);
+	commands.finishSharedBuffer(arena->indexBuffer, geometry.indexDataOffset, mesh.indexDataSize(), vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eIndexRead);
+}
+
+TextureAsset::~TextureAsset() {
+	if (!vulkan) return;
+
+	vulkan->device.destroySampler(sampler);
+	vulkan->device.destroyImageView(view);
+	VkUtil::destroyImage(*vulkan, image, memory);
+}
+
+vk::DeviceSize TextureAsset::uploadSize() const {
+	return texture.dataSize;
+}
+
+void TextureAsset::recordUpload(VulkanInstance& t_vulkan, UploadCommands& commands, vk::Buffer stagingBuffer, vk::DeviceSize stagingOffset, uint8* staging) {
+	vulkan = &t_vulkan;
+
+	VkUtil::createImage(t_vulkan, image, memory, extent, format, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal, mipLevels);
+	view = VkUtil::createImageView(t_vulkan, image, format, vk::ImageAspectFlagBits::eColor, mipLevels);
+	sampler = VkUtil::createSampler(t_vulkan, mipLevels);
+
+	memcpy(staging, texture.data, texture.dataSize);
+	auto regions = TextureUtil::mip_copy_regions(texture.levels.data(), texture.levelCount(), stagingOffset);
+
+	VkUtil::recordImageLayoutTransition(commands.transfer, image, format, vk::ImageLayout::ePreinitialized, vk::ImageLayout::eTransferDstOptimal);
+	commands.transfer.copyBufferToImage(stagingBuffer, image, vk::ImageLayout::eTransferDstOptimal, (uint32)regions.size(), regions.data());
+	commands.finishImage(image);
+}
+
+void TextureAsset::releasePayload() {
+	// Keep the description and statistics of the texture, only the texels are released
+	texture.file = FUtil::MappedFile();
+	texture.memory = std::vector<uint8>();
+	texture.data = nullptr;
+}
+
+EnvironmentAsset::~EnvironmentAsset() {
+	if (!vulkan) return;
+
+	vulkan->device.destroySampler(specularSampler);
+	vulkan->device.destroyImageView(specularView);
+	VkUtil::destroyImage(*vulkan, specularImage, specularMemory);
+	vulkan->device.destroySampler(brdfLutSampler);
+	vulkan->device.destroyImageView(brdfLutView);
+	VkUtil::destroyImage(*vulkan, brdfLutImage, brdfLutMemory);
+}
+
+vk::DeviceSize EnvironmentAsset::uploadSize() const {
+	return align_up(environment.specularDataSize, STAGING_ALIGNMENT) + environment.brdfLutDataSize;
+}
+
+void EnvironmentAsset::recordUpload(VulkanInstance& t_vulkan, UploadCommands& commands, vk::Buffer stagingBuffer, vk::DeviceSize stagingOffset, uint8* staging) {
+	vulkan = &t_vulkan;
+
+	uint32 levelCount = environment.specularLevelCount();
+	vk::Extent2D faceExtent = { environment.faceSize, environment.faceSize };
+	vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+
+	VkUtil::createImage(t_vulkan, specularImage, specularMemory, faceExtent, environment.specularFormat, vk::ImageTiling::eOptimal, usage, vk::MemoryPropertyFlagBits::eDeviceLocal, levelCount, 6, vk::ImageCreateFlagBits::eCubeCompatible);
+	specularView = VkUtil::createImageView(t_vulkan, specularImage, environment.specularFormat, vk::ImageAspectFlagBits::eColor, levelCount, vk::ImageViewType::eCube, 6);
+	specularSampler = VkUtil::createSampler(t_vulkan, levelCount, vk::SamplerAddressMode::eClampToEdge);
+
+	VkUtil::createImage(t_vulkan, brdfLutImage, brdfLutMemory, environment.brdfLutExtent, environment.brdfLutFormat, vk::ImageTiling::eOptimal, usage, vk::MemoryPropertyFlagBits::eDeviceLocal);
+	brdfLutView = VkUtil::createImageView(t_vulkan, brdfLutImage, environment.brdfLutFormat, vk::ImageAspectFlagBits::eColor);
+	brdfLutSampler = VkUtil::createSampler(t_vulkan, 1, vk::SamplerAddressMode::eClampToEdge);
+
+	vk::DeviceSize brdfLutOffset = align_up(environment.specularDataSize, STAGING_ALIGNMENT);
+	memcpy(staging, environment.specularData, environment.specularDataSize);
+	memcpy(staging + brdfLutOffset, environment.brdfLutData, environment.brdfLutDataSize);
+
+	// Every level holds its six faces back to back, which is the layout a copy of six layers expects
+	auto regions = TextureUtil::mip_copy_regions(environment.specularLevels.data(), levelCount, stagingOffset, 6);
+
+	TextureUtil::MipLevel brdfLutLevel;
+	brdfLutLevel.extent = environment.brdfLutExtent;
+	brdfLutLevel.size = environment.brdfLutDataSize;
+	auto brdfLutRegions = TextureUtil::mip_copy_regions(&brdfLutLevel, 1, stagingOffset + brdfLutOffset);
+
+	VkUtil::recordImageLayoutTransition(commands.transfer, specularImage, environment.specularFormat, vk::ImageLayout::ePreinitialized, vk::ImageLayout::eTransferDstOptimal);
+	VkUtil::recordImageLayoutTransition(commands.transfer, brdfLutImage, environment.brdfLutFormat, vk::ImageLayout::ePreinitialized, vk::ImageLayout::eTransferDstOptimal);
+	commands.transfer.copyBufferToImage(stagingBuffer, specularImage, vk::ImageLayout::eTransferDstOptimal, (uint32)regions.size(), regions.data());
+	commands.transfer.copyBufferToImage(stagingBuffer, brdfLutImage, vk::ImageLayout::eTransferDstOptimal, (uint32)brdfLutRegions.size(), brdfLutRegions.data());
+	commands.finishImage(specularImage);
+	commands.finishImage(brdfLutImage);
+}
+
+void EnvironmentAsset::releasePayload() {
+	environment.file = FUtil::MappedFile();
+	environment.specularData = nullptr;
+	environment.brdfLutData = nullptr;
+}
+
+AssetLoader::AssetLoader(VulkanInstance& t_vulkan, GeometryArena& t_geometry) : vulkan(t_vulkan), geometry(t_geometry) {
+
+}
+
+AssetLoader::~AssetLoader() {
+	// Running jobs push to `finished`, queued ones are skipped
+	{
+		std::unique_lock<std::mutex> lock(decodeJobs->mutex);
+		decodeJobs->stopped = true;
+		decodeJobs->jobFinished.wait(lock, [&]() { return decodeJobs->running == 0; });
+	}
+
+	// Staging memory can only be freed once the gpu is done copying from it
+	for (auto& batch : batches) {
+		vulkan.device.waitForFences(1, &batch.fence, true, std::numeric_limits<uint64>::max());
+		destroyBatch(batch);
+	}
+}
+
+template<class Decode>
+void AssetLoader::decodeInBackground(std::shared_ptr<Asset> asset, Decode decode) {
+	pending++;
+
+	WorkerPool::shared().submit([this, jobs = decodeJobs, asset, decode]() {
+		{
+			std::lock_guard<std::mutex> lock(jobs->mutex);
+			if (jobs->stopped) return;
+			jobs->running++;
+		}
+
+		try {
+			decode();
+		}
+		catch (std::exception& error) {
+			asset->error = error.what();
+		}
+		catch (...) {
+			asset->error = "Unknown error";
+		}
+
+		// The queue publishes the payload and error to the render thread
+		if (asset->error.empty()) asset->currentState.store(AssetState::Decoded, std::memory_order_release);
+		finished.push(asset);
+
+		{
+			std::lock_guard<std::mutex> lock(jobs->mutex);
+			jobs->running--;
+		}
+		jobs->jobFinished.notify_all();
+	});
+}
+
+std::shared_ptr<MeshAsset> AssetLoader::loadMesh(const std::filesystem::path& path, const MeshUtil::MeshProcessingOptions& options) {
+	auto asset = std::make_shared<MeshAsset>();
+	asset->path = path;
+	asset->arena = &geometry;
+
+	decodeInBackground(asset, [asset, options]() {
+		asset->mesh = MeshLoaders::load_cached_mesh(asset->path, options);
+		if (asset->mesh.indexCount == 0) throw std::runtime_error("The mesh has no triangles.");
+	});
+
+	return asset;
+}
+
+std::shared_ptr<TextureAsset> AssetLoader::loadTexture(const std::filesystem::path& path, const TextureLoaders::TextureImportOptions& options) {
+	auto asset = std::make_shared<TextureAsset>();
+	asset->path = path;
+
+	// Block compressed formats can only be sampled with the device feature enabled
+	TextureLoaders::TextureImportOptions importOptions = options;
+	importOptions.compress = options.compress && vulkan.textureCompressionBC;
+
+	decodeInBackground(asset, [asset, importOptions]() {
+		asset->texture = TextureLoaders::load_cached_texture(asset->path, importOptions);
+		asset->format = asset->texture.format;
+		asset->extent = asset->texture.extent;
+		asset->mipLevels = asset->texture.levelCount();
+	});
+
+	return asset;
+}
+
+std::shared_ptr<EnvironmentAsset> AssetLoader::loadEnvironment(const std::filesystem::path& path, const TextureLoaders::EnvironmentBakeOptions& options) {
+	auto asset = std::make_shared<EnvironmentAsset>();
+	asset->path = path;
+
+	decodeInBackground(asset, [asset, options]() {
+		asset->environment = TextureLoaders::load_cached_environment(asset->path, options);
+
+		// The bake reads the source through the texture cache as uncompressed half floats, that entry is only mapped again
+		TextureLoaders::TextureImportOptions sourceOptions;
+		sourceOptions.compress = false;
+		TextureLoaders::CachedTexture source = TextureLoaders::load_cached_texture(asset->path, sourceOptions);
+		if (source.format != vk::Format::eR16G16B16A16Sfloat) throw std::runtime_error("Environments have to be OpenEXR or Radiance images.");
+
+		// Nine coefficients only need a coarse map, a small level projects in a fraction of a millisecond
+		uint32 level = 0;
+		while (level + 1 < source.levelCount() && source.levels[level].extent.width > 256) level++;
+
+		auto& mip = source.levels[level];
+		asset->irradiance = TextureUtil::irradiance_uniforms(TextureUtil::project_equirect_sh((const uint16*)(source.data + mip.offset), mip.extent));
+	});
+
+	return asset;
+}
+
+std::shared_ptr<TextureAsset> AssetLoader::createTexture(vk::Extent2D extent, const uint8* rgbaPixels) {
+	auto asset = std::make_shared<TextureAsset>();
+	TextureLoaders::TextureImportOptions options;
+	options.compress = false;
+
+	asset->texture = TextureLoaders::create_texture(rgbaPixels, extent, options);
+	asset->format = asset->texture.format;
+	asset->extent = extent;
+	asset->mipLevels = asset->texture.levelCount();
+	asset->currentState.store(AssetState::Decoded, std::memory_order_release);
+
+	pending++;
+	finished.push(asset);
+	return asset;
+}
+
+uint32 AssetLoader::update() {
+	uint32 settledCount = 0;
+
+	// Batches complete in the order they were submitted in, so the first one still running ends the search
+	while (!batches.empty() && vulkan.device.getFenceStatus(batches.front().fence) == vk::Result::eSuccess) {
+		for (auto& asset : batches.front().assets) {
+			asset->releasePayload();
+			settle(*asset, AssetState::Resident);
+			settledCount++;
+		}
+
+		destroyBatch(batches.front());
+		batches.erase(batches.begin());
+	}
+
+	std::vector<std::shared_ptr<Asset>> decoded;
+	finished.drain([&](std::shared_ptr<Asset>& asset) {
+		if (asset->error.empty()) {
+			decoded.push_back(std::move(asset));
+			return;
+		}
+
+		std::cout << "Failed to load " << asset->path.string() << ": " << asset->error << "\n";
+		settle(*asset, AssetState::Failed);
+		settledCount++;
+	});
+
+	if (!decoded.empty()) settledCount += submitDecoded(decoded);
+	return settledCount;
+}
+
+void AssetLoader::waitFor(const Asset& asset) {
+	while (!asset.settled()) {
+		update();
+		if (!asset.settled()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+uint32 AssetLoader::submitDecoded(std::vector<std::shared_ptr<Asset>>& assets) {
+	UploadBatch batch;
+	uint32 failedCount = 0;
+
+	std::vector<vk::DeviceSize> stagingOffsets;
+	vk::DeviceSize stagingSize = 0;
+	for (auto& asset : assets) {
+		stagingSize = align_up(stagingSize, STAGING_ALIGNMENT);
+		stagingOffsets.push_back(stagingSize);
+		stagingSize += asset->uploadSize();
+	}
+
+	VkUtil::createBuffer(vulkan, stagingSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, batch.stagingBuffer, batch.stagingMemory);
+	uint8* staging = batch.stagingMemory.mapped;
+
+	vk::CommandBufferAllocateInfo allocInfo = {};
+	allocInfo.commandPool = vulkan.transferPool;
+	allocInfo.level = vk::CommandBufferLevel::ePrimary;
+	allocInfo.commandBufferCount = 1;
+	batch.commandBuffer = vulkan.device.allocateCommandBuffers(allocInfo)[0];
+	batch.commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+
+	if (vulkan.hasDedicatedTransferQueue()) {
+		allocInfo.commandPool = vulkan.utilityPool;
+		batch.acquireCommandBuffer = vulkan.device.allocateCommandBuffers(allocInfo)[0];
+		batch.acquireCommandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+	}
+
+	UploadCommands commands;
+	commands.transfer = batch.commandBuffer;
+	commands.acquire = batch.acquireCommandBuffer;
+	commands.transferFamily = vulkan.transferFamily;
+	commands.graphicsFamily = vulkan.graphicsFamily;
+
+	for (size_t i = 0; i < assets.size(); i++) {
+		// A full geometry arena or failing image creation only fails this asset, the rest of the batch is still uploaded
+		try {
+			assets[i]->recordUpload(vulkan, commands, batch.stagingBuffer, stagingOffsets[i], staging + stagingOffsets[i]);
+		}
+		catch (std::exception& error) {
+			assets[i]->error = error.what();
+		}
+
+		if (!assets[i]->error.empty()) {
+			std::cout << "Failed to upload " << assets[i]->path.string() << ": " << assets[i]->error << "\n";
+			settle(*assets[i], AssetState::Failed);
+			failedCount++;
+			continue;
+		}
+
+		assets[i]->currentState.store(AssetState::Uploading, std::memory_order_release);
+		batch.assets.push_back(std::move(assets[i]));
+	}
+
+	batch.commandBuffer.end();
+	if (batch.acquireCommandBuffer) batch.acquireCommandBuffer.end();
+
+	// Nothing was recorded, there is no reason to submit the batch
+	if (batch.assets.empty()) {
+		destroyBatch(batch);
+		return failedCount;
+	}
+
+	batch.fence = vulkan.device.createFence({});
+
+	vk::SubmitInfo submitInfo = {};
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+	if (!batch.acquireCommandBuffer) {
+		vulkan.graphicsQueue.submit(1, &submitInfo, batch.fence);
+	}
+	else {
+		// The copies run next to rendering, only the acquires are executed on the graphics queue
+		batch.transferFinished = vulkan.device.createSemaphore({});
+
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &batch.transferFinished;
+		vulkan.transferQueue.submit(1, &submitInfo, nullptr);
+
+		vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eTransfer;
+		vk::SubmitInfo acquireInfo = {};
+		acquireInfo.waitSemaphoreCount = 1;
+		acquireInfo.pWaitSemaphores = &batch.transferFinished;
+		acquireInfo.pWaitDstStageMask = &waitStage;
+		acquireInfo.commandBufferCount = 1;
+		acquireInfo.pCommandBuffers = &batch.acquireCommandBuffer;
+		vulkan.graphicsQueue.submit(1, &acquireInfo, batch.fence);
+	}
+
+	batches.push_back(std::move(batch));
+	return failedCount;
+}
+
+void AssetLoader::destroyBatch(UploadBatch& batch) {
+	vulkan.device.freeCommandBuffers(vulkan.transferPool, 1, &batch.commandBuffer);
+	if (batch.acquireCommandBuffer) vulkan.device.freeCommandBuffers(vulkan.utilityPool, 1, &batch.acquireCommandBuffer);
+	if (batch.transferFinished) vulkan.device.destroySemaphore(batch.transferFinished);
+	if (batch.fence) vulkan.device.destroyFence(batch.fence);
+	VkUtil::destroyBuffer(vulkan, batch.stagingBuffer, batch.stagingMemory);
+}
+
+void AssetLoader::settle(Asset& asset, AssetState state) {
+	asset.currentState.store(state, std::memory_order_release);
+	pending--;
+}
\ No newline at end of file
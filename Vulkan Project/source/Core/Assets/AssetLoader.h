@@ -0,0 +1,228 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <Core/MeshLoaders/MeshCache.h>
+#include <Core/Render/SphericalHarmonics.h>
+#include <Core/TextureLoaders/EnvironmentCache.h>
+#include <Core/TextureLoaders/TextureCache.h>
+#include <Core/Util/LockFreeQueue.h>
+#include <Core/Util/WorkerPool.h>
+#include <Core/Vulkan/GeometryArena.h>
+#include <Core/Vulkan/VulkanInstance.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace std {
+	namespace filesystem = experimental::filesystem;
+}
+
+/*
+	Loads meshes, textures and environments in the background and uploads them to the gpu in batches.
+
+	Requests return a handle right away. Threads of the shared WorkerPool read and decode the files, then hand the finished cpu side
+	payloads to the render thread through a lock-free queue. Once per frame AssetLoader::update creates the gpu resources
+	of everything that finished, records all copies into one command buffer and submits it with a fence instead of
+	waiting for the queue. Assets become resident once a later update sees that fence signalled, until then the
+	renderer keeps using placeholders.
+	Copies run on the dedicated transfer queue if the device has one, next to rendering. Their resources are then released
+	to the graphics family and acquired by a second command buffer on the graphics queue, which waits for the copies with
+	a semaphore and signals the fence.
+*/
+
+enum class AssetState : uint32 {
+	// Waiting for or being decoded by a worker
+	Loading,
+	// Decoded, waiting for the render thread to upload it
+	Decoded,
+	// Copies are submitted, the resources exist but may not be used by the gpu yet
+	Uploading,
+	// Resources can be used
+	Resident,
+	// Loading failed, see Asset::error
+	Failed
+};
+
+// Command buffers of one upload batch
+struct UploadCommands {
+	// Runs on the transfer queue, which may be the graphics queue
+	vk::CommandBuffer transfer;
+	// Runs on the graphics queue after `transfer`, only used with a dedicated transfer queue
+	vk::CommandBuffer acquire;
+	uint32 transferFamily = 0;
+	uint32 graphicsFamily = 0;
+
+	// Makes a buffer written by copies in `transfer` available to reads with `access` in `stages` on the graphics queue
+	void finishBuffer(vk::Buffer buffer, vk::PipelineStageFlags stages, vk::AccessFlags access);
+	// Same as finishBuffer for the range of a buffer created shared between both families, which has no ownership to move
+	void finishSharedBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size, vk::PipelineStageFlags stages, vk::AccessFlags access);
+	// Moves an image written by copies in `transfer` to eShaderReadOnlyOptimal for sampling on the graphics queue
+	void finishImage(vk::Image image);
+};
+
+class Asset {
+public:
+	virtual ~Asset() = default;
+
+	AssetState state() const { return currentState.load(std::memory_order_acquire); }
+	bool resident() const { return state() == AssetState::Resident; }
+	// Whether the asset reached a state it will not leave anymore
+	bool settled() const { return state() == AssetState::Resident || state() == AssetState::Failed; }
+
+	std::filesystem::path path;
+	// Why loading failed, only set in the Failed state
+	std::string error;
+
+protected:
+	friend class AssetLoader;
+
+	// Bytes of staging memory needed for the upload
+	virtual vk::DeviceSize uploadSize() const = 0;
+	// Creates the gpu resources, copies the payload to `staging` and records the copies from `stagingBuffer` at `stagingOffset`.
+	// Every resource written has to be finished through `commands`. Anything that can throw has to happen before the first
+	// command is recorded, the asset is then dropped from the batch with nothing of it left in the command buffers
+	virtual void recordUpload(VulkanInstance& vulkan, UploadCommands& commands, vk::Buffer stagingBuffer, vk::DeviceSize stagingOffset, uint8* staging) = 0;
+	// Frees cpu memory that is not needed once the asset is resident
+	virtual void releasePayload() { }
+
+	std::atomic<AssetState> currentState { AssetState::Loading };
+	// Set once gpu resources were created, so they are destroyed with the asset
+	VulkanInstance* vulkan = nullptr;
+};
+
+class MeshAsset : public Asset {
+public:
+	~MeshAsset();
+
+	// The mapped cache file, holding counts, formats, bounds and levels of detail of the mesh
+	MeshLoaders::CachedMesh mesh;
+
+	// Where the vertices and indices live in the arena. Levels of detail are drawn with their firstIndex added to geometry.firstIndex
+	GeometryRange geometry;
+	GeometryArena* arena = nullptr;
+
+protected:
+	vk::DeviceSize uploadSize() const override;
+	void recordUpload(VulkanInstance& vulkan, UploadCommands& commands, vk::Buffer stagingBuffer, vk::DeviceSize stagingOffset, uint8* staging) override;
+};
+
+class TextureAsset : public Asset {
+public:
+	~TextureAsset();
+
+	vk::Format format = vk::Format::eUndefined;
+	vk::Extent2D extent;
+	uint32 mipLevels = 1;
+	// Every level as it is uploaded, mapped from the texture cache while decoding. The texels are released once the texture is resident
+	TextureLoaders::CachedTexture texture;
+
+	vk::Image image;
+	MemoryAllocation memory;
+	vk::ImageView view;
+	// Samples the full mip chain
+	vk::Sampler sampler;
+
+protected:
+	vk::DeviceSize uploadSize() const override;
+	void recordUpload(VulkanInstance& vulkan, UploadCommands& commands, vk::Buffer stagingBuffer, vk::DeviceSize stagingOffset, uint8* staging) override;
+	void releasePayload() override;
+};
+
+// Image based lighting of an environment, the prefiltered specular cubemap and the BRDF lookup table it is used with
+class EnvironmentAsset : public Asset {
+public:
+	~EnvironmentAsset();
+
+	// Counts, formats and bake statistics. Only the texels are released once the environment is resident
+	TextureLoaders::CachedEnvironment environment;
+	// Diffuse light of the environment, projected on the worker that decoded it
+	TextureUtil::SHIrradianceUniforms irradiance;
+
+	vk::Image specularImage;
+	MemoryAllocation specularMemory;
+	// Cube view of every level, level i holds the roughness TextureUtil::prefiltered_roughness(i, levelCount)
+	vk::ImageView specularView;
+	vk::Sampler specularSampler;
+
+	vk::Image brdfLutImage;
+	MemoryAllocation brdfLutMemory;
+	vk::ImageView brdfLutView;
+	// Clamps to the edge, the table does not wrap
+	vk::Sampler brdfLutSampler;
+
+protected:
+	vk::DeviceSize uploadSize() const override;
+	void recordUpload(VulkanInstance& vulkan, UploadCommands& commands, vk::Buffer stagingBuffer, vk::DeviceSize stagingOffset, uint8* staging) override;
+	void releasePayload() override;
+};
+
+class AssetLoader {
+public:
+	// Files are decoded on the shared WorkerPool. Meshes are uploaded into `geometry`, which has to outlive them
+	AssetLoader(VulkanInstance& vulkan, GeometryArena& geometry);
+	~AssetLoader();
+
+	std::shared_ptr<MeshAsset> loadMesh(const std::filesystem::path& path, const MeshUtil::MeshProcessingOptions& options = {});
+	// Loads any image format stb_image reads through the texture cache, with a full mip chain and block compressed
+	// unless the options ask otherwise
+	std::shared_ptr<TextureAsset> loadTexture(const std::filesystem::path& path, const TextureLoaders::TextureImportOptions& options = {});
+	// Bakes the image based lighting of an OpenEXR or Radiance environment, or loads it from its cache
+	std::shared_ptr<EnvironmentAsset> loadEnvironment(const std::filesystem::path& path, const TextureLoaders::EnvironmentBakeOptions& options = {});
+	// Creates an uncompressed texture from pixels in memory, for placeholders. Uploaded with the next batch like any other asset
+	std::shared_ptr<TextureAsset> createTexture(vk::Extent2D extent, const uint8* rgbaPixels);
+
+	// Render thread only. Makes assets whose upload finished resident, then uploads everything decoded since the last
+	// call in a single batch. Never waits for the gpu.
+	// Returns the number of assets that became resident or failed during this call
+	uint32 update();
+	// Render thread only. Runs update until `asset` is resident or failed, for assets the first frame can not do without
+	void waitFor(const Asset& asset);
+
+	// Number of requested assets that are not resident or failed yet
+	uint32 pendingCount() const { return pending.load(std::memory_order_acquire); }
+
+private:
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	// Assets uploaded by one command buffer, alive until its fence signals
+	struct UploadBatch {
+		vk::CommandBuffer commandBuffer;
+		// Ownership acquires on the graphics queue and the semaphore they wait on, only used with a dedicated transfer queue
+		vk::CommandBuffer acquireCommandBuffer;
+		vk::Semaphore transferFinished;
+		vk::Fence fence;
+		vk::Buffer stagingBuffer;
+		MemoryAllocation stagingMemory;
+		std::vector<std::shared_ptr<Asset>> assets;
+	};
+
+	// Runs `decode` on a worker and queues the asset for upload, or as failed if `decode` threw
+	template<class Decode>
+	void decodeInBackground(std::shared_ptr<Asset> asset, Decode decode);
+	// Records and submits the uploads of `assets`, returns the number of assets that failed to record
+	uint32 submitDecoded(std::vector<std::shared_ptr<Asset>>& assets);
+	void destroyBatch(UploadBatch& batch);
+	void settle(Asset& asset, AssetState state);
+
+	VulkanInstance& vulkan;
+	GeometryArena& geometry;
+	// Decoded or failed assets, pushed by workers and drained by update
+	LockFreeQueue<std::shared_ptr<Asset>> finished;
+	std::vector<UploadBatch> batches;
+	std::atomic<uint32> pending { 0 };
+
+	// Decode jobs may still be queued on the shared pool when the loader is destroyed. Jobs hold on to this and skip
+	// decoding once `stopped` is set, the destructor waits for those already running
+	struct DecodeJobs {
+		std::mutex mutex;
+		std::condition_variable jobFinished;
+		uint32 running = 0;
+		bool stopped = false;
+	};
+	std::shared_ptr<DecodeJobs> decodeJobs = std::make_shared<DecodeJobs>();
+};
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "MeshCache.h"
+
+#include <Core/Render/MeshProcessing.h>
+#include <Core/Util/CacheFile.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace MeshLoaders {
+
+	namespace {
+		constexpr char CACHE_MAGIC[4] = { 'V', 'M', 'S', 'H' };
+		// Bump whenever the layout of the file or the processing applied to cached meshes changes
+		constexpr uint32 CACHE_VERSION = 5;
+		// Blobs start on this alignment so they can be copied with wide loads straight out of the mapping
+		constexpr uint64 BLOB_ALIGNMENT = 16;
+
+		// Processing options as stored in the cache. Options that have no effect are zeroed, so they compare and hash equal
+		struct CacheOptions {
+			float weldEpsilon;
+			uint32 optimizeOverdraw;
+			float overdrawThreshold;
+			uint32 allowPackedVertices;
+			float maxTexCoordError;
+			uint32 buildLods;
+			uint32 maxLods;
+			float lodReduction;
+			float maxLodError;
+		};
+
+		struct CacheHeader {
+			FUtil::CacheFileHeader file;
+
+			CacheOptions options;
+
+			uint32 vertexCount;
+			VertexFormat vertexFormat;
+			uint32 vertexStride;
+			uint32 indexCount;
+			uint32 indexSize;
+
+			float boundsMin[3];
+			float boundsMax[3];
+
+			// Offsets of the blobs from the start of the file
+			uint64 vertexOffset;
+			uint64 indexOffset;
+
+			// MeshUtil::MeshLod table of the levels of detail
+			uint32 lodCount;
+			uint64 lodOffset;
+		};
+
+		uint64 align_up(uint64 value, uint64 alignment) {
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		CacheOptions make_cache_options(const MeshUtil::MeshProcessingOptions& options) {
+			CacheOptions cacheOptions = {};
+			cacheOptions.weldEpsilon = options.weldEpsilon;
+			cacheOptions.optimizeOverdraw = options.optimizeOverdraw;
+			cacheOptions.overdrawThreshold = options.optimizeOverdraw ? options.overdrawThreshold : 0.0f;
+			cacheOptions.allowPackedVertices = options.allowPackedVertices;
+			cacheOptions.maxTexCoordError = options.allowPackedVertices ? options.maxTexCoordError : 0.0f;
+			cacheOptions.buildLods = options.buildLods;
+			cacheOptions.maxLods = options.buildLods ? options.lodChain.maxLods : 0;
+			cacheOptions.lodReduction = options.buildLods ? options.lodChain.reduction : 0.0f;
+			cacheOptions.maxLodError = options.buildLods ? options.lodChain.maxRelativeError : 0.0f;
+			return cacheOptions;
+		}
+
+		uint32 vertex_stride(VertexFormat format) {
+			return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+		}
+
+		// Loads and processes the source mesh
+		Mesh build_mesh(const std::filesystem::path& sourcePath, const MeshUtil::MeshProcessingOptions& options, CachedMesh& cachedMesh) {
+			Mesh mesh = load_ply(sourcePath, cachedMesh.sourceStatistics);
+			cachedMesh.processingStatistics = MeshUtil::process_mesh(mesh, options);
+
+			return mesh;
+		}
+
+		FUtil::MappedFile write_cache(const std::filesystem::path& cachePath, FUtil::CacheSource& cacheSource, const FUtil::CacheValidator& isValid, const Mesh& mesh, const std::vector<MeshUtil::MeshLod>& lods, CacheHeader header) {
+			auto bounds = mesh.computeBounds();
+
+			header.vertexCount = (uint32)mesh.vertices.size();
+			header.vertexFormat = header.options.allowPackedVertices ? MeshUtil::choose_vertex_format(mesh, header.options.maxTexCoordError) : VertexFormat::Full;
+			header.vertexStride = vertex_stride(header.vertexFormat);
+			header.indexCount = (uint32)mesh.indices.size();
+			header.indexSize = MeshUtil::index_size_for(header.vertexCount);
+			memcpy(header.boundsMin, &bounds.min, sizeof(header.boundsMin));
+			memcpy(header.boundsMax, &bounds.max, sizeof(header.boundsMax));
+			header.vertexOffset = align_up(sizeof(CacheHeader), BLOB_ALIGNMENT);
+			header.indexOffset = align_up(header.vertexOffset + (uint64)header.vertexCount * header.vertexStride, BLOB_ALIGNMENT);
+			header.lodCount = (uint32)lods.size();
+			header.lodOffset = align_up(header.indexOffset + (uint64)header.indexCount * header.indexSize, BLOB_ALIGNMENT);
+
+			return FUtil::write_cache_file(cachePath, cacheSource, CACHE_MAGIC, CACHE_VERSION, isValid, [&](std::ostream& file) {
+				const char padding[BLOB_ALIGNMENT] = {};
+
+				file.write((const char*)&header, sizeof(header));
+				file.write(padding, header.vertexOffset - sizeof(header));
+				if (header.vertexFormat == VertexFormat::Packed) {
+					auto vertices = MeshUtil::pack_vertices(mesh, bounds);
+					file.write((const char*)vertices.data(), vertices.size() * sizeof(PackedVertex));
+				}
+				else {
+					file.write((const char*)mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+				}
+				file.write(padding, header.indexOffset - (header.vertexOffset + (uint64)header.vertexCount * header.vertexStride));
+				auto indices = MeshUtil::pack_indices(mesh.indices, header.indexSize);
+				file.write((const char*)indices.data(), indices.size());
+				file.write(padding, header.lodOffset - (header.indexOffset + indices.size()));
+				file.write((const char*)lods.data(), lods.size() * sizeof(MeshUtil::MeshLod));
+			});
+		}
+
+		// Checks the header against the file it was read from, so a truncated or foreign file is never trusted
+		bool header_is_valid(const CacheHeader& header, size_t fileSize) {
+			if (header.vertexFormat != VertexFormat::Full && header.vertexFormat != VertexFormat::Packed) return false;
+			if (header.vertexStride != vertex_stride(header.vertexFormat)) return false;
+			if (header.indexSize != sizeof(uint16) && header.indexSize != sizeof(uint32)) return false;
+			if (header.vertexOffset % BLOB_ALIGNMENT != 0 || header.indexOffset % BLOB_ALIGNMENT != 0 || header.lodOffset % BLOB_ALIGNMENT != 0) return false;
+			if (header.vertexOffset + (uint64)header.vertexCount * header.vertexStride > fileSize) return false;
+			if (header.indexOffset + (uint64)header.indexCount * header.indexSize > fileSize) return false;
+			if (header.lodCount == 0 || header.lodOffset + (uint64)header.lodCount * sizeof(MeshUtil::MeshLod) > fileSize) return false;
+
+			return true;
+		}
+
+		// Points the mesh into its mapped cache file
+		void bind_mapping(CachedMesh& mesh) {
+			CacheHeader header;
+			memcpy(&header, mesh.file.data(), sizeof(header));
+
+			mesh.vertices = mesh.file.data() + header.vertexOffset;
+			mesh.vertexCount = header.vertexCount;
+			mesh.vertexFormat = header.vertexFormat;
+			mesh.vertexStride = header.vertexStride;
+			mesh.indices = mesh.file.data() + header.indexOffset;
+			mesh.indexCount = header.indexCount;
+			mesh.indexSize = header.indexSize;
+			mesh.lods = (const MeshUtil::MeshLod*)(mesh.file.data() + header.lodOffset);
+			mesh.lodCount = header.lodCount;
+			memcpy(&mesh.bounds.min, header.boundsMin, sizeof(header.boundsMin));
+			memcpy(&mesh.bounds.max, header.boundsMax, sizeof(header.boundsMax));
+		}
+	}
+
+	CachedMesh load_cached_mesh(const std::filesystem::path& sourcePath, const MeshUtil::MeshProcessingOptions& options) {
+		auto startTime = std::chrono::high_resolution_clock::now();
+		auto cacheOptions = make_cache_options(options);
+		auto cachePath = FUtil::cache_path_for(sourcePath, &cacheOptions, sizeof(cacheOptions), ".vmesh");
+
+		CachedMesh mesh;
+
+		FUtil::CacheValidator isValid = [&](const FUtil::MappedFile& file) {
+			CacheHeader header;
+			if (file.size() < sizeof(header)) return false;
+			memcpy(&header, file.data(), sizeof(header));
+			return header_is_valid(header, file.size()) && memcmp(&header.options, &cacheOptions, sizeof(cacheOptions)) == 0;
+		};
+
+		FUtil::CacheSource cacheSource(sourcePath);
+		mesh.file = FUtil::open_cache_file(cachePath, cacheSource, CACHE_MAGIC, CACHE_VERSION, isValid);
+
+		if (mesh.file.data()) {
+			bind_mapping(mesh);
+			mesh.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+			return mesh;
+		}
+
+		Mesh sourceMesh = build_mesh(sourcePath, options, mesh);
+
+		CacheHeader header = {};
+		header.file = cacheSource.header(CACHE_MAGIC, CACHE_VERSION);
+		header.options = cacheOptions;
+		mesh.file = write_cache(cachePath, cacheSource, isValid, sourceMesh, mesh.processingStatistics.lods, header);
+		mesh.rebuilt = true;
+		bind_mapping(mesh);
+
+		mesh.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+		return mesh;
+	}
+
+}
\ No newline at end of file
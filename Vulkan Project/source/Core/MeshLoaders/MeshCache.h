@@ -0,0 +1,57 @@
+#pragma once
+#include <Core/Render/Mesh.h>
+#include <Core/Render/MeshProcessing.h>
+#include <Core/MeshLoaders/Ply.h>
+#include <Core/Util/FileUtil.h>
+
+namespace std {
+	namespace filesystem = experimental::filesystem;
+}
+
+/*
+	Binary cache for processed meshes, stored next to the source file as "<source>.<options hash>.vmesh".
+
+	The cache holds the vertex and index data exactly as they are uploaded to the gpu plus the bounds of the mesh.
+	Meshes go through MeshUtil::process_mesh before they are cached and their indices are stored as uint16 whenever
+	the vertex count allows.
+	It is keyed by the size, modification time and content hash of the source file and rebuilt whenever those change,
+	the processing options differ or the cache format version is bumped. Simplified levels of detail are stored behind the
+	full mesh in the same index buffer, with a table of their index ranges. Loading a valid cache only maps the file, the vertex and index pointers
+	point straight into the mapping and can be handed to DeviceLocalBuffer::fill without any parsing.
+*/
+
+namespace MeshLoaders {
+	struct CachedMesh {
+		FUtil::MappedFile file;
+
+		// Vertex or PackedVertex values, see vertexFormat
+		const void* vertices = nullptr;
+		uint32 vertexCount = 0;
+		VertexFormat vertexFormat = VertexFormat::Full;
+		uint32 vertexStride = sizeof(Vertex);
+		// Either uint16 or uint32 values, see indexSize
+		const void* indices = nullptr;
+		uint32 indexCount = 0;
+		uint32 indexSize = sizeof(uint32);
+		// Levels of detail as ranges of the index buffer, level 0 is the full mesh
+		const MeshUtil::MeshLod* lods = nullptr;
+		uint32 lodCount = 0;
+		BoundingBox bounds;
+
+		// Whether the cache had to be (re)built from the source file on this load
+		bool rebuilt = false;
+		// Statistics of parsing the source file, only valid if the cache was rebuilt
+		PlyLoadStatistics sourceStatistics;
+		// Results of processing the source mesh, only valid if the cache was rebuilt
+		MeshUtil::MeshProcessingStatistics processingStatistics;
+		// Time spent in load_cached_mesh, including a rebuild
+		double seconds = 0;
+
+		uint32 vertexDataSize() const { return vertexCount * vertexStride; }
+		uint32 indexDataSize() const { return indexCount * indexSize; }
+		vk::IndexType indexType() const { return indexSize == sizeof(uint16) ? vk::IndexType::eUint16 : vk::IndexType::eUint32; }
+	};
+
+	// Loads the mesh at `sourcePath` through its cache, building the cache first if it is missing or stale
+	extern CachedMesh load_cached_mesh(const std::filesystem::path& sourcePath, const MeshUtil::MeshProcessingOptions& options = {});
+}
\ No newline at end of file
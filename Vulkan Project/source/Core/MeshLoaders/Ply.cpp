@@ -1,94 +1,364 @@
 #include "Ply.h"
+#include "PlySchema.h"
 #include <Core/Util/FileUtil.h>
-#include <Core/Util/StringUtil.h>
+
+#include <cstring>
+#include <chrono>
 
 namespace MeshLoaders {
-	
+
 	namespace {
-		struct PlyHeader {
-			uint32 vertexCount = 0;
+		using namespace Ply;
+
+		/* Binary property readers */
+
+		bool host_is_little_endian() {
+			const uint16 probe = 1;
+			return *(const uint8*)&probe == 1;
+		}
+
+		template<class T, bool Swap>
+		T read_scalar(const uint8* source) {
+			T value;
+			if (Swap) {
+				uint8 bytes[sizeof(T)];
+				for (int i = 0; i < sizeof(T); i++) bytes[i] = source[sizeof(T) - 1 - i];
+				memcpy(&value, bytes, sizeof(T));
+			}
+			else {
+				memcpy(&value, source, sizeof(T));
+			}
+
+			return value;
+		}
+
+		template<class T, bool Swap>
+		float read_as_float(const uint8* source) { return (float)read_scalar<T, Swap>(source); }
+
+		template<class T, bool Swap>
+		uint32 read_as_uint(const uint8* source) { return (uint32)read_scalar<T, Swap>(source); }
+
+		using FloatReader = float(*)(const uint8*);
+		using UIntReader = uint32(*)(const uint8*);
+
+		template<bool Swap>
+		FloatReader select_float_reader(Type type) {
+			switch (type) {
+			case Type::Int8: return &read_as_float<int8, Swap>;
+			case Type::UInt8: return &read_as_float<uint8, Swap>;
+			case Type::Int16: return &read_as_float<int16, Swap>;
+			case Type::UInt16: return &read_as_float<uint16, Swap>;
+			case Type::Int32: return &read_as_float<int32, Swap>;
+			case Type::UInt32: return &read_as_float<uint32, Swap>;
+			case Type::Float32: return &read_as_float<float, Swap>;
+			case Type::Float64: return &read_as_float<double, Swap>;
+			}
+
+			return nullptr;
+		}
+
+		template<bool Swap>
+		UIntReader select_uint_reader(Type type) {
+			switch (type) {
+			case Type::Int8: return &read_as_uint<int8, Swap>;
+			case Type::UInt8: return &read_as_uint<uint8, Swap>;
+			case Type::Int16: return &read_as_uint<int16, Swap>;
+			case Type::UInt16: return &read_as_uint<uint16, Swap>;
+			case Type::Int32: return &read_as_uint<int32, Swap>;
+			case Type::UInt32: return &read_as_uint<uint32, Swap>;
+			case Type::Float32: return &read_as_uint<float, Swap>;
+			case Type::Float64: return &read_as_uint<double, Swap>;
+			}
+
+			return nullptr;
+		}
+
+		// Skips a single property of an element instance and returns the position after it
+		const uint8* skip_property(const uint8* cursor, const uint8* end, const Property& property, UIntReader countReader) {
+			if (!property.isList) return cursor + type_size(property.type);
+
+			if (cursor + type_size(property.countType) > end) throw std::runtime_error("Loading .ply file failed. Unexpected end of file.");
+			uint32 count = countReader(cursor);
+			return cursor + type_size(property.countType) + (size_t)count * type_size(property.type);
+		}
+
+		// Skips an entire element and returns the position after its last instance
+		template<bool Swap>
+		const uint8* skip_element(const uint8* cursor, const uint8* end, const Element& element) {
+			if (!element.hasListProperty()) return cursor + (size_t)element.count * element.stride();
+
+			std::vector<UIntReader> countReaders;
+			for (auto& property : element.properties) countReaders.push_back(select_uint_reader<Swap>(property.countType));
+
+			for (uint32 i = 0; i < element.count; i++) {
+				for (int p = 0; p < element.properties.size(); p++) {
+					cursor = skip_property(cursor, end, element.properties[p], countReaders[p]);
+				}
+			}
+
+			return cursor;
+		}
+
+		/* Binary vertex decoding */
+
+		// Where each vertex component lives inside one binary vertex record
+		struct VertexLayout {
+			uint32 stride = 0;
+			uint32 componentCount = 0;
+			// Only the first componentCount entries are valid, components the file does not provide stay zero
+			std::array<uint32, VertexComponentCount> components;
+			std::array<uint32, VertexComponentCount> offsets;
+			std::array<FloatReader, VertexComponentCount> readers;
 		};
 
-		// Loads the header section of a .ply file
-		// Warning: If whatever is in the stream is not a file header this function will read throughout the entire stream
-		// never hitting the end_header token, so if you are unsure you should double check
-		PlyHeader load_ply_header(std::stringstream& stream) {
-			PlyHeader header;
-			std::string line;
-
-			while (std::getline(stream, line)) {
-				auto tokens = StrUtil::string_split(line, ' ');
-				
-				if (tokens[0] == "element") {
-					if (tokens[1] == "vertex") {
-						header.vertexCount = std::stoul(tokens[2]);
-					}
+		using VertexDecoder = void(*)(const uint8* source, const VertexLayout& layout, uint32 count, Vertex* out);
+
+		static_assert(sizeof(Vertex) == sizeof(float) * VertexComponentCount, "Vertex is expected to be tightly packed.");
+
+		// The file stores exactly what a Vertex looks like in memory
+		void decode_vertices_verbatim(const uint8* source, const VertexLayout& layout, uint32 count, Vertex* out) {
+			memcpy(out, source, (size_t)count * sizeof(Vertex));
+		}
+
+		// Every component present in the file has the same type, so the reads can be inlined
+		template<class T, bool Swap>
+		void decode_vertices_uniform(const uint8* source, const VertexLayout& layout, uint32 count, Vertex* out) {
+			for (uint32 i = 0; i < count; i++, source += layout.stride) {
+				float* components = (float*)&out[i];
+
+				for (uint32 c = 0; c < layout.componentCount; c++) {
+					components[layout.components[c]] = (float)read_scalar<T, Swap>(source + layout.offsets[c]);
 				}
-				else if (tokens[0] == "end_header") {
-					return header;
+			}
+		}
+
+		// Components are of differing types, each one is read through the reader selected for it
+		void decode_vertices_mixed(const uint8* source, const VertexLayout& layout, uint32 count, Vertex* out) {
+			for (uint32 i = 0; i < count; i++, source += layout.stride) {
+				float* components = (float*)&out[i];
+
+				for (uint32 c = 0; c < layout.componentCount; c++) {
+					components[layout.components[c]] = layout.readers[c](source + layout.offsets[c]);
+				}
+			}
+		}
+
+		template<bool Swap>
+		VertexDecoder select_uniform_vertex_decoder(Type type) {
+			switch (type) {
+			case Type::Int8: return &decode_vertices_uniform<int8, Swap>;
+			case Type::UInt8: return &decode_vertices_uniform<uint8, Swap>;
+			case Type::Int16: return &decode_vertices_uniform<int16, Swap>;
+			case Type::UInt16: return &decode_vertices_uniform<uint16, Swap>;
+			case Type::Int32: return &decode_vertices_uniform<int32, Swap>;
+			case Type::UInt32: return &decode_vertices_uniform<uint32, Swap>;
+			case Type::Float32: return &decode_vertices_uniform<float, Swap>;
+			case Type::Float64: return &decode_vertices_uniform<double, Swap>;
+			}
+
+			return nullptr;
+		}
+
+		// Builds the vertex layout and picks the most specialized decoder able to handle it
+		template<bool Swap>
+		VertexDecoder select_vertex_decoder(const Element& element, VertexLayout& layout) {
+			if (element.hasListProperty()) throw std::runtime_error("Loading .ply file failed. List properties on vertices are not supported.");
+
+			std::vector<uint32> propertyOffsets;
+			for (auto& property : element.properties) {
+				propertyOffsets.push_back(layout.stride);
+				layout.stride += type_size(property.type);
+			}
+
+			auto mapping = map_vertex_components(element);
+			bool uniformType = true;
+			bool verbatim = !Swap && layout.stride == sizeof(Vertex);
+			Type firstType = Type::Float32;
+
+			for (int component = 0; component < VertexComponentCount; component++) {
+				if (mapping[component] < 0) {
+					verbatim = false;
+					continue;
 				}
+
+				auto& property = element.properties[mapping[component]];
+				if (layout.componentCount == 0) firstType = property.type;
+
+				uint32 c = layout.componentCount++;
+				layout.components[c] = component;
+				layout.offsets[c] = propertyOffsets[mapping[component]];
+				layout.readers[c] = select_float_reader<Swap>(property.type);
+
+				uniformType = uniformType && property.type == firstType;
+				verbatim = verbatim && property.type == Type::Float32 && layout.offsets[c] == component * sizeof(float);
 			}
+
+			if (layout.componentCount == 0) throw std::runtime_error("Loading .ply file failed. Vertices don't contain any known properties.");
+
+			if (verbatim) return &decode_vertices_verbatim;
+			if (uniformType) return select_uniform_vertex_decoder<Swap>(firstType);
+			return &decode_vertices_mixed;
 		}
 
-		// Loads the vertex section of a .ply file
-		void load_ply_vertices(std::stringstream& stream, uint32 vertexCount, std::vector<Vertex>& verticesOut) {
-			uint32 vertexIndex = 0;
-			std::string line;
+		/* Binary face decoding */
+
+		// Where the index list lives inside one binary face record
+		struct FaceLayout {
+			// Size of the scalar properties before the index list
+			uint32 prefixSize = 0;
+			// Properties after the index list, these have to be walked for every face
+			std::vector<Property> suffix;
+			std::vector<UIntReader> suffixCountReaders;
+		};
+
+		using FaceDecoder = const uint8*(*)(const uint8* source, const uint8* end, const FaceLayout& layout, uint32 count, std::vector<uint32>& indices);
 
-			while (vertexIndex < vertexCount && std::getline(stream, line)) {
-				auto tokens = StrUtil::string_split(line, ' ');
+		// Decodes polygons and triangulates them as a fan while streaming them into the index list
+		template<class CountT, class IndexT, bool Swap>
+		const uint8* decode_faces(const uint8* source, const uint8* end, const FaceLayout& layout, uint32 count, std::vector<uint32>& indices) {
+			for (uint32 i = 0; i < count; i++) {
+				source += layout.prefixSize;
+				if (source + sizeof(CountT) > end) throw std::runtime_error("Loading .ply file failed. Unexpected end of file.");
 
-				std::vector<float> values(tokens.size());
-				for (int i = 0; i < tokens.size(); i++) {
-					values[i] = std::stof(tokens[i]);
+				uint32 vertexCount = (uint32)read_scalar<CountT, Swap>(source);
+				source += sizeof(CountT);
+				if (source + (size_t)vertexCount * sizeof(IndexT) > end) throw std::runtime_error("Loading .ply file failed. Unexpected end of file.");
+
+				if (vertexCount >= 3) {
+					uint32 first = (uint32)read_scalar<IndexT, Swap>(source);
+					uint32 previous = (uint32)read_scalar<IndexT, Swap>(source + sizeof(IndexT));
+
+					for (uint32 v = 2; v < vertexCount; v++) {
+						uint32 current = (uint32)read_scalar<IndexT, Swap>(source + v * sizeof(IndexT));
+						indices.insert(indices.end(), { first, previous, current });
+						previous = current;
+					}
 				}
+				source += (size_t)vertexCount * sizeof(IndexT);
 
-				auto position = glm::vec3(values[0], values[1], values[2]);
-				auto normal = glm::vec3(values[3], values[4], values[5]);
-				auto uv = glm::vec2(values[6], values[7]);
+				for (int p = 0; p < layout.suffix.size(); p++) {
+					source = skip_property(source, end, layout.suffix[p], layout.suffixCountReaders[p]);
+				}
+			}
 
-				verticesOut[vertexIndex] = { position, normal, uv };
-				vertexIndex++;
+			return source;
+		}
+
+		template<class CountT, bool Swap>
+		FaceDecoder select_face_decoder_for_index(Type indexType) {
+			switch (indexType) {
+			case Type::Int8: return &decode_faces<CountT, int8, Swap>;
+			case Type::UInt8: return &decode_faces<CountT, uint8, Swap>;
+			case Type::Int16: return &decode_faces<CountT, int16, Swap>;
+			case Type::UInt16: return &decode_faces<CountT, uint16, Swap>;
+			case Type::Int32: return &decode_faces<CountT, int32, Swap>;
+			case Type::UInt32: return &decode_faces<CountT, uint32, Swap>;
+			default: throw std::runtime_error("Loading .ply file failed. Face indices must be integers.");
+			}
+		}
+
+		// Builds the face layout and picks the decoder matching the count and index types
+		template<bool Swap>
+		FaceDecoder select_face_decoder(const Element& element, FaceLayout& layout) {
+			int32 listIndex = find_face_index_list(element);
+
+			for (int32 p = 0; p < element.properties.size(); p++) {
+				auto& property = element.properties[p];
+
+				if (p < listIndex) {
+					layout.prefixSize += type_size(property.type);
+				}
+				else if (p > listIndex) {
+					layout.suffix.push_back(property);
+					layout.suffixCountReaders.push_back(select_uint_reader<Swap>(property.countType));
+				}
+			}
+
+			auto& list = element.properties[listIndex];
+			switch (list.countType) {
+			case Type::Int8: return select_face_decoder_for_index<int8, Swap>(list.type);
+			case Type::UInt8: return select_face_decoder_for_index<uint8, Swap>(list.type);
+			case Type::Int16: return select_face_decoder_for_index<int16, Swap>(list.type);
+			case Type::UInt16: return select_face_decoder_for_index<uint16, Swap>(list.type);
+			case Type::Int32: return select_face_decoder_for_index<int32, Swap>(list.type);
+			case Type::UInt32: return select_face_decoder_for_index<uint32, Swap>(list.type);
+			default: throw std::runtime_error("Loading .ply file failed. List counts must be integers.");
 			}
 		}
 
-		// Loads the face section of a .ply file
-		void load_ply_faces(std::stringstream& stream, std::vector<uint32>& indices) {
-			uint32 faceIndex = 0;
-			std::string line;
+		// Loads the body of a binary .ply file, walking the elements in the order they are declared
+		template<bool Swap>
+		void load_ply_binary(const Header& header, const uint8* data, size_t size, Mesh& mesh) {
+			const uint8* cursor = data + header.dataOffset;
+			const uint8* end = data + size;
 
-			while (std::getline(stream, line)) {
-				auto tokens = StrUtil::string_split(line, ' ');
+			for (auto& element : header.elements) {
+				if (element.name == "vertex") {
+					VertexLayout layout;
+					auto decode = select_vertex_decoder<Swap>(element, layout);
 
-				std::vector<uint32> values(tokens.size());
-				for (int i = 0; i < tokens.size(); i++) {
-					values[i] = std::stoul(tokens[i]);
+					if ((size_t)(end - cursor) < (size_t)element.count * layout.stride) throw std::runtime_error("Loading .ply file failed. Unexpected end of file.");
+
+					if (layout.componentCount < VertexComponentCount) mesh.vertices.assign(element.count, { glm::vec3(0), glm::vec3(0), glm::vec2(0) });
+					else mesh.vertices.resize(element.count);
+					decode(cursor, layout, element.count, mesh.vertices.data());
+					cursor += (size_t)element.count * layout.stride;
 				}
+				else if (element.name == "face") {
+					FaceLayout layout;
+					auto decode = select_face_decoder<Swap>(element, layout);
 
-				switch (values[0]) {
-				case 3:
-					indices.insert(indices.end(), { values[1], values[2], values[3] });
-					break;
-				default:
-					throw std::runtime_error("Loading .ply file failed. Can't load faces with " + std::to_string(values[0]) + " vertices.");
+					mesh.indices.reserve((size_t)element.count * 3);
+					cursor = decode(cursor, end, layout, element.count, mesh.indices);
+				}
+				else {
+					cursor = skip_element<Swap>(cursor, end, element);
 				}
+
+				if (cursor > end) throw std::runtime_error("Loading .ply file failed. Unexpected end of file.");
 			}
 		}
 	}
 
 	Mesh load_ply(std::filesystem::path path) {
-		auto stream = FUtil::file_read_stringstream(path);
+		PlyLoadStatistics statistics;
+		return load_ply(path, statistics);
+	}
+
+	Mesh load_ply(std::filesystem::path path, PlyLoadStatistics& statistics) {
+		auto startTime = std::chrono::high_resolution_clock::now();
+		FUtil::MappedFile file(path);
+
+		auto header = load_ply_header(file.data(), file.size());
+		auto vertexElement = header.findElement("vertex");
+		if (!vertexElement || vertexElement->count == 0) throw std::runtime_error("Failed to load mesh: " + path.string() + "\nHeader did not contain a vertex count. Are you sure it's a .ply file?");
 
-		auto header = load_ply_header(stream);
-		if (header.vertexCount == 0) throw std::runtime_error("Failed to load mesh: " + path.string() + "\nHeader did not contain a vertex count. Are you sure it's a .ply file?");
-	
-		std::vector<Vertex> vertices(header.vertexCount);
-		std::vector<uint32_t> indices;
+		Mesh mesh;
+
+		try {
+			switch (header.format) {
+			case Format::Ascii:
+				load_ply_ascii(header, file.data(), file.size(), mesh);
+				break;
+			case Format::BinaryLittleEndian:
+			case Format::BinaryBigEndian: {
+				bool swap = (header.format == Format::BinaryLittleEndian) != host_is_little_endian();
+				if (swap) load_ply_binary<true>(header, file.data(), file.size(), mesh);
+				else load_ply_binary<false>(header, file.data(), file.size(), mesh);
+				break;
+			}
+			}
+		}
+		catch (std::exception& error) {
+			throw std::runtime_error("Failed to load mesh: " + path.string() + "\n" + error.what());
+		}
 
-		load_ply_vertices(stream, header.vertexCount, vertices);
-		load_ply_faces(stream, indices);
+		statistics.fileSize = file.size();
+		statistics.vertexCount = mesh.vertices.size();
+		statistics.triangleCount = mesh.indices.size() / 3;
+		statistics.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
 
-		return Mesh { vertices, indices };
+		return mesh;
 	}
 
 }
\ No newline at end of file
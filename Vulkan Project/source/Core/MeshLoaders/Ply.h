@@ -7,5 +7,17 @@ namespace std {
 }
 
 namespace MeshLoaders {
+	/* Throughput of a single load_ply call */
+	struct PlyLoadStatistics {
+		size_t fileSize = 0;
+		size_t vertexCount = 0;
+		size_t triangleCount = 0;
+		double seconds = 0;
+
+		double megabytesPerSecond() const { return seconds > 0 ? fileSize / (1024.0 * 1024.0) / seconds : 0; }
+		double verticesPerSecond() const { return seconds > 0 ? vertexCount / seconds : 0; }
+	};
+
 	extern Mesh load_ply(std::filesystem::path path);
+	extern Mesh load_ply(std::filesystem::path path, PlyLoadStatistics& statistics);
 }
\ No newline at end of file
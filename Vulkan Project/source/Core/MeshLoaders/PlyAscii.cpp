@@ -0,0 +1,258 @@
+#include "PlySchema.h"
+#include <Core/Util/WorkerPool.h>
+
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+
+namespace MeshLoaders {
+	namespace Ply {
+		namespace {
+			// Bodies smaller than this are parsed on the calling thread, spinning up workers would cost more than it saves
+			constexpr size_t MIN_BYTES_PER_CHUNK = 1 << 20;
+
+			bool is_blank(char c) {
+				return c == ' ' || c == '\t' || c == '\r';
+			}
+
+			/*
+				Walks the whitespace separated tokens of a single line without copying them.
+				Numbers are converted with std::from_chars, which rounds exactly like the std::stof/std::stoul calls it replaces.
+			*/
+			class LineScanner {
+			public:
+				LineScanner(std::string_view t_line, uint64 t_lineNumber) : line(t_line), lineNumber(t_lineNumber) { }
+
+				std::string_view next() {
+					while (position < line.size() && is_blank(line[position])) position++;
+
+					size_t start = position;
+					while (position < line.size() && !is_blank(line[position])) position++;
+
+					if (start == position) fail("is missing values");
+					return line.substr(start, position - start);
+				}
+
+				void skip(uint32 count) {
+					for (uint32 i = 0; i < count; i++) next();
+				}
+
+				float nextFloat() {
+					auto token = next();
+					// std::stof accepts an explicit plus sign, std::from_chars does not
+					if (token[0] == '+') token.remove_prefix(1);
+
+					float value;
+					auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+					if (result.ec != std::errc()) fail("contains an invalid number");
+
+					return value;
+				}
+
+				uint32 nextUInt() {
+					auto token = next();
+					if (token[0] == '+') token.remove_prefix(1);
+
+					uint32 value;
+					auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+					if (result.ec != std::errc()) fail("contains an invalid index");
+
+					return value;
+				}
+
+			private:
+				[[noreturn]] void fail(const char* reason) const {
+					throw std::runtime_error("Loading .ply file failed. Line " + std::to_string(lineNumber) + " of the body " + reason + ".");
+				}
+
+				std::string_view line;
+				uint64 lineNumber;
+				size_t position = 0;
+			};
+
+			// How a vertex line maps onto the components of a Vertex
+			struct VertexColumns {
+				uint32 count = 0;
+				// Index of the Vertex component and number of tokens to skip before it, in line order
+				std::array<uint32, VertexComponentCount> components;
+				std::array<uint32, VertexComponentCount> skips;
+			};
+
+			VertexColumns map_vertex_columns(const Element& element) {
+				if (element.hasListProperty()) throw std::runtime_error("Loading .ply file failed. List properties on vertices are not supported.");
+
+				auto mapping = map_vertex_components(element);
+				std::array<int32, VertexComponentCount> order;
+				for (int c = 0; c < VertexComponentCount; c++) order[c] = c;
+				std::sort(order.begin(), order.end(), [&](int32 a, int32 b) { return mapping[a] < mapping[b]; });
+
+				VertexColumns columns;
+				int32 column = 0;
+				for (auto component : order) {
+					if (mapping[component] < 0) continue;
+
+					columns.components[columns.count] = component;
+					columns.skips[columns.count] = mapping[component] - column;
+					columns.count++;
+					column = mapping[component] + 1;
+				}
+
+				return columns;
+			}
+
+			// A line aligned slice of the body, parsed by a single thread
+			struct Chunk {
+				const char* begin;
+				const char* end;
+
+				// Global index of the first line in the chunk
+				uint64 firstLine = 0;
+				uint64 lineCount = 0;
+
+				std::vector<uint32> indices;
+			};
+
+			uint64 count_lines(const char* begin, const char* end) {
+				uint64 lines = std::count(begin, end, '\n');
+				if (begin != end && end[-1] != '\n') lines++;
+				return lines;
+			}
+
+			// Runs `job` for every chunk on the shared worker pool
+			template<class Job>
+			void for_each_chunk(std::vector<Chunk>& chunks, Job job) {
+				parallel_for_each((uint32)chunks.size(), 1, [&](uint32 chunk) {
+					job(chunks[chunk]);
+				});
+			}
+
+			std::vector<Chunk> split_into_chunks(const char* begin, const char* end) {
+				size_t size = end - begin;
+				size_t chunkCount = std::max<size_t>(1, std::min<size_t>(WorkerPool::shared().threadCount() + 1, size / MIN_BYTES_PER_CHUNK));
+
+				std::vector<Chunk> chunks;
+				const char* chunkBegin = begin;
+
+				for (size_t i = 1; i <= chunkCount && chunkBegin < end; i++) {
+					const char* chunkEnd = i == chunkCount ? end : std::max(chunkBegin, begin + size * i / chunkCount);
+
+					// Move the split point past the end of the line it falls into
+					if (chunkEnd < end) {
+						chunkEnd = std::find(chunkEnd, end, '\n');
+						if (chunkEnd < end) chunkEnd++;
+					}
+
+					chunks.push_back({ chunkBegin, chunkEnd, 0, 0, {} });
+					chunkBegin = chunkEnd;
+				}
+
+				if (chunks.empty()) chunks.push_back({ begin, end, 0, 0, {} });
+				return chunks;
+			}
+		}
+
+		void load_ply_ascii(const Header& header, const uint8* data, size_t size, Mesh& mesh) {
+			const char* bodyBegin = (const char*)data + header.dataOffset;
+			const char* bodyEnd = (const char*)data + size;
+
+			// Every element instance is on its own line, so the element a line belongs to follows from its index
+			struct ElementLines {
+				const Element* element;
+				uint64 firstLine;
+			};
+
+			std::vector<ElementLines> elementLines;
+			uint64 totalLines = 0;
+			for (auto& element : header.elements) {
+				elementLines.push_back({ &element, totalLines });
+				totalLines += element.count;
+			}
+
+			const Element* vertexElement = header.findElement("vertex");
+			const Element* faceElement = header.findElement("face");
+
+			VertexColumns vertexColumns;
+			if (vertexElement) {
+				vertexColumns = map_vertex_columns(*vertexElement);
+				mesh.vertices.assign(vertexElement->count, { glm::vec3(0), glm::vec3(0), glm::vec2(0) });
+			}
+
+			uint32 faceListIndex = faceElement ? find_face_index_list(*faceElement) : 0;
+
+			auto chunks = split_into_chunks(bodyBegin, bodyEnd);
+
+			// Pass 1: Count lines, so every chunk knows the global index of its first line
+			for_each_chunk(chunks, [](Chunk& chunk) {
+				chunk.lineCount = count_lines(chunk.begin, chunk.end);
+			});
+
+			uint64 lineIndex = 0;
+			for (auto& chunk : chunks) {
+				chunk.firstLine = lineIndex;
+				lineIndex += chunk.lineCount;
+			}
+
+			if (lineIndex < totalLines) throw std::runtime_error("Loading .ply file failed. The body has fewer lines than the header declares.");
+
+			// Pass 2: Parse the lines of every chunk
+			for_each_chunk(chunks, [&](Chunk& chunk) {
+				uint64 line = chunk.firstLine;
+				size_t currentElement = 0;
+				const char* cursor = chunk.begin;
+
+				if (faceElement) {
+					// Reserve room for one triangle per face line inside this chunk
+					uint64 faceBegin = 0;
+					for (auto& lines : elementLines) if (lines.element == faceElement) faceBegin = lines.firstLine;
+
+					uint64 overlapBegin = std::max(faceBegin, chunk.firstLine);
+					uint64 overlapEnd = std::min(faceBegin + faceElement->count, chunk.firstLine + chunk.lineCount);
+					if (overlapEnd > overlapBegin) chunk.indices.reserve((overlapEnd - overlapBegin) * 3);
+				}
+
+				for (; cursor < chunk.end && line < totalLines; line++) {
+					const char* lineEnd = std::find(cursor, chunk.end, '\n');
+					LineScanner scanner(std::string_view(cursor, lineEnd - cursor), line);
+					cursor = lineEnd < chunk.end ? lineEnd + 1 : lineEnd;
+
+					while (currentElement + 1 < elementLines.size() && line >= elementLines[currentElement + 1].firstLine) currentElement++;
+					auto& element = *elementLines[currentElement].element;
+					uint64 instance = line - elementLines[currentElement].firstLine;
+
+					if (&element == vertexElement) {
+						float* components = (float*)&mesh.vertices[instance];
+
+						for (uint32 c = 0; c < vertexColumns.count; c++) {
+							scanner.skip(vertexColumns.skips[c]);
+							components[vertexColumns.components[c]] = scanner.nextFloat();
+						}
+					}
+					else if (&element == faceElement) {
+						scanner.skip(faceListIndex);
+						uint32 vertexCount = scanner.nextUInt();
+
+						if (vertexCount < 3) {
+							scanner.skip(vertexCount);
+							continue;
+						}
+
+						uint32 first = scanner.nextUInt();
+						uint32 previous = scanner.nextUInt();
+
+						for (uint32 v = 2; v < vertexCount; v++) {
+							uint32 current = scanner.nextUInt();
+							chunk.indices.insert(chunk.indices.end(), { first, previous, current });
+							previous = current;
+						}
+					}
+				}
+			});
+
+			size_t indexCount = 0;
+			for (auto& chunk : chunks) indexCount += chunk.indices.size();
+
+			mesh.indices.reserve(indexCount);
+			for (auto& chunk : chunks) mesh.indices.insert(mesh.indices.end(), chunk.indices.begin(), chunk.indices.end());
+		}
+	}
+}
\ No newline at end of file
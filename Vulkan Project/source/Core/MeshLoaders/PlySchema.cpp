@@ -0,0 +1,167 @@
+#include "PlySchema.h"
+#include <Core/Util/StringUtil.h>
+
+#include <cstring>
+
+namespace MeshLoaders {
+	namespace Ply {
+		namespace {
+			Type parse_type(const std::string& name) {
+				if (name == "char" || name == "int8") return Type::Int8;
+				if (name == "uchar" || name == "uint8") return Type::UInt8;
+				if (name == "short" || name == "int16") return Type::Int16;
+				if (name == "ushort" || name == "uint16") return Type::UInt16;
+				if (name == "int" || name == "int32") return Type::Int32;
+				if (name == "uint" || name == "uint32") return Type::UInt32;
+				if (name == "float" || name == "float32") return Type::Float32;
+				if (name == "double" || name == "float64") return Type::Float64;
+
+				throw std::runtime_error("Loading .ply file failed. Unknown property type: " + name);
+			}
+		}
+
+		int32 Element::findProperty(const std::string& name) const {
+			for (size_t i = 0; i < properties.size(); i++) {
+				if (properties[i].name == name) return (int32)i;
+			}
+
+			return -1;
+		}
+
+		bool Element::hasListProperty() const {
+			for (auto& property : properties) {
+				if (property.isList) return true;
+			}
+
+			return false;
+		}
+
+		uint32 Element::stride() const {
+			uint32 size = 0;
+			for (auto& property : properties) {
+				size += type_size(property.type);
+			}
+
+			return size;
+		}
+
+		const Element* Header::findElement(const std::string& name) const {
+			for (auto& element : elements) {
+				if (element.name == name) return &element;
+			}
+
+			return nullptr;
+		}
+
+		uint32 type_size(Type type) {
+			switch (type) {
+			case Type::Int8: case Type::UInt8: return 1;
+			case Type::Int16: case Type::UInt16: return 2;
+			case Type::Int32: case Type::UInt32: case Type::Float32: return 4;
+			case Type::Float64: return 8;
+			}
+
+			return 0;
+		}
+
+		std::array<int32, VertexComponentCount> map_vertex_components(const Element& vertexElement) {
+			// Exporters disagree on how texture coordinates are called, the first match wins
+			static const std::array<std::vector<std::string>, VertexComponentCount> componentNames = { {
+				{ "x" }, { "y" }, { "z" },
+				{ "nx" }, { "ny" }, { "nz" },
+				{ "s", "u", "texture_u", "texture_s" },
+				{ "t", "v", "texture_v", "texture_t" }
+			} };
+
+			std::array<int32, VertexComponentCount> mapping;
+			for (int i = 0; i < VertexComponentCount; i++) {
+				mapping[i] = -1;
+
+				for (auto& name : componentNames[i]) {
+					mapping[i] = vertexElement.findProperty(name);
+					if (mapping[i] >= 0) break;
+				}
+			}
+
+			return mapping;
+		}
+
+		int32 find_face_index_list(const Element& faceElement) {
+			int32 listIndex = faceElement.findProperty("vertex_indices");
+			if (listIndex < 0) listIndex = faceElement.findProperty("vertex_index");
+			if (listIndex < 0 || !faceElement.properties[listIndex].isList) throw std::runtime_error("Loading .ply file failed. Faces don't contain a vertex index list.");
+
+			for (int32 p = 0; p < listIndex; p++) {
+				if (faceElement.properties[p].isList) throw std::runtime_error("Loading .ply file failed. List properties before the face indices are not supported.");
+			}
+
+			if (faceElement.properties[listIndex].type == Type::Float32 || faceElement.properties[listIndex].type == Type::Float64)
+				throw std::runtime_error("Loading .ply file failed. Face indices must be integers.");
+
+			return listIndex;
+		}
+
+		Header load_ply_header(const uint8* data, size_t size) {
+			Header header;
+			size_t lineStart = 0;
+			bool isFirstLine = true;
+
+			while (lineStart < size) {
+				auto lineEnd = (const uint8*)memchr(data + lineStart, '\n', size - lineStart);
+				size_t lineLength = (lineEnd ? lineEnd - data : size) - lineStart;
+
+				std::string line((const char*)data + lineStart, lineLength);
+				lineStart += lineLength + 1;
+
+				auto tokens = StrUtil::string_split(line, { ' ', '\r' });
+				if (tokens.empty()) continue;
+
+				if (isFirstLine) {
+					if (tokens[0] != "ply") throw std::runtime_error("Loading .ply file failed. The file does not start with the ply magic number.");
+					isFirstLine = false;
+				}
+				else if (tokens[0] == "format" && tokens.size() >= 2) {
+					if (tokens[1] == "ascii") header.format = Format::Ascii;
+					else if (tokens[1] == "binary_little_endian") header.format = Format::BinaryLittleEndian;
+					else if (tokens[1] == "binary_big_endian") header.format = Format::BinaryBigEndian;
+					else throw std::runtime_error("Loading .ply file failed. Unknown format: " + tokens[1]);
+				}
+				else if (tokens[0] == "element" && tokens.size() >= 3) {
+					Element element;
+					element.name = tokens[1];
+					element.count = std::stoul(tokens[2]);
+					header.elements.push_back(element);
+				}
+				else if (tokens[0] == "property") {
+					if (header.elements.empty()) throw std::runtime_error("Loading .ply file failed. Property declared outside of an element.");
+
+					Property property;
+					if (tokens.size() >= 5 && tokens[1] == "list") {
+						property.isList = true;
+						property.countType = parse_type(tokens[2]);
+						property.type = parse_type(tokens[3]);
+						property.name = tokens[4];
+
+						if (property.countType == Type::Float32 || property.countType == Type::Float64)
+							throw std::runtime_error("Loading .ply file failed. List counts must be integers.");
+					}
+					else if (tokens.size() >= 3) {
+						property.type = parse_type(tokens[1]);
+						property.name = tokens[2];
+					}
+					else {
+						throw std::runtime_error("Loading .ply file failed. Malformed property: " + line);
+					}
+
+					header.elements.back().properties.push_back(property);
+				}
+				else if (tokens[0] == "end_header") {
+					header.dataOffset = lineStart;
+					return header;
+				}
+			}
+
+			throw std::runtime_error("Loading .ply file failed. The header is missing its end_header token.");
+		}
+	}
+}
\ No newline at end of file
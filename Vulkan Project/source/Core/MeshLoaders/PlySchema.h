@@ -0,0 +1,88 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <Core/Render/Mesh.h>
+#include <array>
+#include <string>
+#include <vector>
+
+/*
+	Description of the elements and properties declared in the header of a .ply file.
+	The loaders use it to pick a decoder once per file instead of inspecting types per element.
+*/
+
+namespace MeshLoaders {
+	namespace Ply {
+		enum class Format {
+			Ascii,
+			BinaryLittleEndian,
+			BinaryBigEndian
+		};
+
+		enum class Type {
+			Int8,
+			UInt8,
+			Int16,
+			UInt16,
+			Int32,
+			UInt32,
+			Float32,
+			Float64
+		};
+
+		struct Property {
+			std::string name;
+			Type type = Type::Float32;
+
+			// List properties store a count of type `countType` followed by that many values of type `type`
+			bool isList = false;
+			Type countType = Type::UInt8;
+		};
+
+		struct Element {
+			std::string name;
+			uint32 count = 0;
+			std::vector<Property> properties;
+
+			// Returns the index of the property called `name` or -1 if the element does not have one
+			int32 findProperty(const std::string& name) const;
+			bool hasListProperty() const;
+			// Size of one instance in a binary file. Only meaningful if the element has no list properties
+			uint32 stride() const;
+		};
+
+		struct Header {
+			Format format = Format::Ascii;
+			std::vector<Element> elements;
+
+			// Offset of the first byte after the end_header line
+			size_t dataOffset = 0;
+
+			const Element* findElement(const std::string& name) const;
+		};
+
+		// Components of a Vertex in memory order
+		enum VertexComponent {
+			PositionX, PositionY, PositionZ,
+			NormalX, NormalY, NormalZ,
+			TexCoordS, TexCoordT,
+			VertexComponentCount
+		};
+
+		// Size in bytes of a single value of the given type
+		uint32 type_size(Type type);
+
+		// Maps every vertex component to the index of the property providing it, -1 if the file does not contain it
+		std::array<int32, VertexComponentCount> map_vertex_components(const Element& vertexElement);
+
+		// Returns the index of the vertex index list of a face element
+		// Throws if there is none or if it is preceded by other list properties
+		int32 find_face_index_list(const Element& faceElement);
+
+		// Parses the header section of a .ply file
+		// Throws if the data does not start with a valid header
+		Header load_ply_header(const uint8* data, size_t size);
+
+		// Decodes the body of an ascii .ply file into `mesh`, splitting the work across all cores for large files
+		void load_ply_ascii(const Header& header, const uint8* data, size_t size, Mesh& mesh);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,284 @@
+#include "EnvironmentLighting.h"
+#include "HalfFloat.h"
+#include <Core/Util/WorkerPool.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace TextureUtil {
+	namespace {
+		constexpr float PI = 3.14159265358979f;
+		// Keeps threads from starting for small levels
+		constexpr uint32 MIN_ROWS_PER_THREAD = 16;
+		constexpr size_t HALF_RGBA_SIZE = 4 * sizeof(uint16);
+
+		// Van der Corput sequence in base 2, the second coordinate of the Hammersley points
+		float radical_inverse(uint32 bits) {
+			bits = (bits << 16) | (bits >> 16);
+			bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+			bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+			bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+			bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+			return bits * 2.3283064365386963e-10f;
+		}
+
+		// Half vector around +Z for the point (u, v) of the unit square, distributed proportional to D(h) * cos(theta_h)
+		glm::vec3 sample_ggx(float u, float v, float alpha) {
+			float phi = 2.0f * PI * u;
+			float cosTheta = std::sqrt((1.0f - v) / (1.0f + (alpha * alpha - 1.0f) * v));
+			float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+			return glm::vec3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+		}
+
+		float ggx_distribution(float cosTheta, float alpha) {
+			float alpha2 = alpha * alpha;
+			float denominator = cosTheta * cosTheta * (alpha2 - 1.0f) + 1.0f;
+			return alpha2 / (PI * denominator * denominator);
+		}
+
+		// Schlick's approximation of the Smith masking term, with k chosen for image based lighting
+		float smith_visibility(float cosTheta, float k) {
+			return cosTheta / (cosTheta * (1.0f - k) + k);
+		}
+
+		// Direction through the point (u, v) of a face, both in [-1, 1] with v pointing down the face
+		glm::vec3 cube_direction(uint32 face, float u, float v) {
+			switch (face) {
+			case 0: return glm::vec3(1.0f, -v, -u);
+			case 1: return glm::vec3(-1.0f, -v, u);
+			case 2: return glm::vec3(u, 1.0f, v);
+			case 3: return glm::vec3(u, -1.0f, -v);
+			case 4: return glm::vec3(u, -v, 1.0f);
+			default: return glm::vec3(-u, -v, -1.0f);
+			}
+		}
+
+		// The source chain widened to floats once, so samples are plain loads
+		class EquirectSource {
+		public:
+			EquirectSource(const uint8* data, const MipLevel* levels, uint32 levelCount) {
+				for (uint32 i = 0; i < levelCount; i++) {
+					Level level;
+					level.extent = levels[i].extent;
+					level.texels.resize((size_t)level.extent.width * level.extent.height * 4);
+					half_to_float((const uint16*)(data + levels[i].offset), level.texels.data(), level.texels.size());
+					this->levels.push_back(std::move(level));
+				}
+			}
+
+			// Trilinear sample, the level of detail is clamped to the chain
+			glm::vec3 sample(glm::vec3 direction, float lod) const {
+				float u = std::atan2(direction.z, direction.x) * (0.5f / PI) + 0.5f;
+				float v = std::asin(std::max(-1.0f, std::min(1.0f, direction.y))) * (1.0f / PI) + 0.5f;
+
+				lod = std::max(0.0f, std::min(lod, (float)(levels.size() - 1)));
+				uint32 lower = (uint32)lod;
+				float blend = lod - lower;
+
+				glm::vec3 color = bilinear(levels[lower], u, v);
+				if (blend > 0.0f) color = glm::mix(color, bilinear(levels[lower + 1], u, v), blend);
+				return color;
+			}
+
+			// Average solid angle of a texel of the top level
+			float texelSolidAngle() const {
+				return 4.0f * PI / ((float)levels[0].extent.width * levels[0].extent.height);
+			}
+
+		private:
+			struct Level {
+				vk::Extent2D extent;
+				std::vector<float> texels;
+			};
+
+			// Wraps around horizontally and clamps at the poles
+			static glm::vec3 bilinear(const Level& level, float u, float v) {
+				float x = u * level.extent.width - 0.5f;
+				float y = std::max(0.0f, std::min(v * level.extent.height - 0.5f, level.extent.height - 1.0f));
+
+				float x0 = std::floor(x);
+				float y0 = std::floor(y);
+				float fx = x - x0;
+				float fy = y - y0;
+
+				uint32 left = (uint32)(((int64)x0 % level.extent.width + level.extent.width) % level.extent.width);
+				uint32 right = left + 1 == level.extent.width ? 0 : left + 1;
+				uint32 top = (uint32)y0;
+				uint32 bottom = std::min(top + 1, level.extent.height - 1);
+
+				auto texel = [&](uint32 tx, uint32 ty) {
+					const float* rgba = level.texels.data() + ((size_t)ty * level.extent.width + tx) * 4;
+					return glm::vec3(rgba[0], rgba[1], rgba[2]);
+				};
+
+				return glm::mix(glm::mix(texel(left, top), texel(right, top), fx), glm::mix(texel(left, bottom), texel(right, bottom), fx), fy);
+			}
+
+			std::vector<Level> levels;
+		};
+
+		// Sample of the GGX lobe around the reflection direction, in the tangent space of the normal
+		struct LobeSample {
+			glm::vec3 direction;
+			float weight;
+			float lod;
+		};
+
+		// With normal, view and reflection direction assumed equal the samples only depend on roughness, so every texel of a level shares them
+		std::vector<LobeSample> lobe_samples(float roughness, uint32 sampleCount, float sourceTexelSolidAngle) {
+			float alpha = roughness * roughness;
+			std::vector<LobeSample> samples;
+
+			for (uint32 i = 0; i < sampleCount; i++) {
+				glm::vec3 half = sample_ggx((float)i / sampleCount, radical_inverse(i), alpha);
+				glm::vec3 light = half * (2.0f * half.z) - glm::vec3(0.0f, 0.0f, 1.0f);
+				if (light.z <= 0.0f) continue;
+
+				// Samples where the lobe is thin stand for a small solid angle and read finer levels of the source
+				float pdf = ggx_distribution(half.z, alpha) * 0.25f;
+				float sampleSolidAngle = 1.0f / (sampleCount * pdf);
+				float lod = std::max(0.0f, 0.5f * std::log2(sampleSolidAngle / sourceTexelSolidAngle) + 1.0f);
+
+				samples.push_back({ light, light.z, lod });
+			}
+
+			return samples;
+		}
+
+		// Runs `job(row, floats)` for every row on the shared worker pool. Every worker has its own row of floats
+		template<class Job>
+		void for_each_row(uint32 rowCount, size_t rowFloats, Job job) {
+			parallel_for(rowCount, MIN_ROWS_PER_THREAD, [&](ParallelRange& rows) {
+				std::vector<float> floats(rowFloats);
+				for (uint32 row; rows.next(row);) job(row, floats.data());
+			});
+		}
+	}
+
+	float prefiltered_roughness(uint32 level, uint32 levelCount) {
+		return levelCount > 1 ? (float)level / (levelCount - 1) : 0.0f;
+	}
+
+	MipChain prefilter_specular(const uint8* data, const MipLevel* levels, uint32 levelCount, const SpecularPrefilterOptions& options) {
+		if (levelCount == 0 || options.faceSize == 0) throw std::invalid_argument("Can not prefilter an empty environment.");
+		if (options.sampleCount == 0) throw std::invalid_argument("Prefiltering needs at least one sample per texel.");
+
+		EquirectSource source(data, levels, levelCount);
+
+		MipChain chain;
+		chain.format = vk::Format::eR16G16B16A16Sfloat;
+
+		uint32 outputLevelCount = std::max(1u, std::min(options.levelCount, mip_level_count({ options.faceSize, options.faceSize })));
+		size_t offset = 0;
+		for (uint32 i = 0; i < outputLevelCount; i++) {
+			uint32 faceSize = std::max(1u, options.faceSize >> i);
+
+			MipLevel level;
+			level.extent = { faceSize, faceSize };
+			level.offset = offset;
+			level.size = 6 * (size_t)faceSize * faceSize * HALF_RGBA_SIZE;
+			chain.levels.push_back(level);
+			offset += level.size;
+		}
+		chain.data.resize(offset);
+
+		for (uint32 i = 0; i < outputLevelCount; i++) {
+			auto& level = chain.levels[i];
+			uint32 faceSize = level.extent.width;
+			float roughness = prefiltered_roughness(i, outputLevelCount);
+
+			// A mirror keeps the environment as is, read from the source level closest to the size of a face texel
+			std::vector<LobeSample> samples;
+			if (roughness == 0.0f) {
+				float cubeTexelSolidAngle = 4.0f * PI / (6.0f * faceSize * faceSize);
+				samples.push_back({ glm::vec3(0.0f, 0.0f, 1.0f), 1.0f, std::max(0.0f, 0.5f * std::log2(cubeTexelSolidAngle / source.texelSolidAngle())) });
+			}
+			else {
+				samples = lobe_samples(roughness, options.sampleCount, source.texelSolidAngle());
+			}
+
+			float totalWeight = 0.0f;
+			for (auto& sample : samples) totalWeight += sample.weight;
+
+			uint16* texels = (uint16*)(chain.data.data() + level.offset);
+			for_each_row(6 * faceSize, (size_t)faceSize * 4, [&](uint32 row, float* rgba) {
+				uint32 face = row / faceSize;
+				uint32 y = row % faceSize;
+				float v = 2.0f * (y + 0.5f) / faceSize - 1.0f;
+
+				for (uint32 x = 0; x < faceSize; x++) {
+					glm::vec3 normal = glm::normalize(cube_direction(face, 2.0f * (x + 0.5f) / faceSize - 1.0f, v));
+					glm::vec3 up = std::abs(normal.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+					glm::vec3 tangent = glm::normalize(glm::cross(up, normal));
+					glm::vec3 bitangent = glm::cross(normal, tangent);
+
+					glm::vec3 color(0.0f);
+					for (auto& sample : samples) {
+						glm::vec3 direction = tangent * sample.direction.x + bitangent * sample.direction.y + normal * sample.direction.z;
+						color += source.sample(direction, sample.lod) * sample.weight;
+					}
+					color = color * (1.0f / totalWeight);
+
+					rgba[x * 4 + 0] = color.x;
+					rgba[x * 4 + 1] = color.y;
+					rgba[x * 4 + 2] = color.z;
+					rgba[x * 4 + 3] = 1.0f;
+				}
+
+				float_to_half(rgba, texels + (size_t)row * faceSize * 4, (size_t)faceSize * 4);
+			});
+		}
+
+		return chain;
+	}
+
+	MipChain generate_brdf_lut(const BrdfLutOptions& options) {
+		if (options.size == 0 || options.sampleCount == 0) throw std::invalid_argument("Invalid BRDF lookup table size or sample count.");
+
+		MipChain chain;
+		chain.format = vk::Format::eR16G16Sfloat;
+
+		MipLevel level;
+		level.extent = { options.size, options.size };
+		level.size = (size_t)options.size * options.size * 2 * sizeof(uint16);
+		chain.levels.push_back(level);
+		chain.data.resize(level.size);
+
+		uint16* texels = (uint16*)chain.data.data();
+		for_each_row(options.size, (size_t)options.size * 2, [&](uint32 y, float* scaleBias) {
+			float roughness = (y + 0.5f) / options.size;
+			float alpha = roughness * roughness;
+			float k = alpha * 0.5f;
+
+			for (uint32 x = 0; x < options.size; x++) {
+				float cosView = (x + 0.5f) / options.size;
+				glm::vec3 view(std::sqrt(1.0f - cosView * cosView), 0.0f, cosView);
+
+				float scale = 0.0f;
+				float bias = 0.0f;
+				for (uint32 i = 0; i < options.sampleCount; i++) {
+					glm::vec3 half = sample_ggx((float)i / options.sampleCount, radical_inverse(i), alpha);
+					float viewDotHalf = glm::dot(view, half);
+					glm::vec3 light = half * (2.0f * viewDotHalf) - view;
+					if (light.z <= 0.0f) continue;
+
+					// The sample density cancels D, leaving G * dot(v, h) / (dot(n, h) * dot(n, v))
+					float visibility = smith_visibility(cosView, k) * smith_visibility(light.z, k) * std::max(viewDotHalf, 0.0f) / (half.z * cosView);
+					float fresnel = std::pow(1.0f - std::max(viewDotHalf, 0.0f), 5.0f);
+					scale += (1.0f - fresnel) * visibility;
+					bias += fresnel * visibility;
+				}
+
+				scaleBias[x * 2 + 0] = scale / options.sampleCount;
+				scaleBias[x * 2 + 1] = bias / options.sampleCount;
+			}
+
+			float_to_half(scaleBias, texels + (size_t)y * options.size * 2, (size_t)options.size * 2);
+		});
+
+		return chain;
+	}
+}
\ No newline at end of file
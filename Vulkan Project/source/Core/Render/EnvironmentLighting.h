@@ -0,0 +1,40 @@
+#pragma once
+#include <Core/Render/TextureProcessing.h>
+
+/*
+	Precomputation for the split sum approximation of image based specular lighting.
+
+	The radiance of the environment is convolved with the GGX lobe for increasing roughness, one mip level of a cubemap per
+	roughness, and the part of the integral that only depends on the view angle and roughness goes into a small 2D lookup table.
+	Both integrals are estimated by importance sampling the GGX distribution along a Hammersley sequence. Prefiltering reads
+	coarser levels of the source for samples covering a larger solid angle, which keeps low sample counts free of fireflies.
+	Directions follow the conventions of SphericalHarmonics.h.
+*/
+
+namespace TextureUtil {
+	struct SpecularPrefilterOptions {
+		// Size of the faces of the top level, which holds the unfiltered environment
+		uint32 faceSize = 128;
+		// Clamped to the full chain of `faceSize`. Level i is filtered for a roughness of i / (levelCount - 1)
+		uint32 levelCount = 6;
+		// Samples per texel, the top level takes a single one
+		uint32 sampleCount = 256;
+	};
+
+	struct BrdfLutOptions {
+		uint32 size = 128;
+		uint32 sampleCount = 512;
+	};
+
+	// Roughness the level of a prefiltered chain was filtered for
+	float prefiltered_roughness(uint32 level, uint32 levelCount);
+
+	// Prefilters an equirectangular environment given as the rgba half float mip chain `levels`, with the texels of every level
+	// starting at `data` + MipLevel::offset. Returns a cube chain of rgba half floats, every level holds its six faces back to
+	// back in the Vulkan order +X, -X, +Y, -Y, +Z, -Z. Rows are spread over all cores
+	MipChain prefilter_specular(const uint8* data, const MipLevel* levels, uint32 levelCount, const SpecularPrefilterOptions& options = {});
+
+	// Scale and bias applied to F0 by the split sum, as r16g16 half floats. Columns are indexed by the cosine between normal and view
+	// direction, rows by roughness, both sampled at texel centers
+	MipChain generate_brdf_lut(const BrdfLutOptions& options = {});
+}
\ No newline at end of file
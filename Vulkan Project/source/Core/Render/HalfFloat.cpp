@@ -0,0 +1,99 @@
+#include "HalfFloat.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define F16C_FUNCTION
+#else
+#include <cpuid.h>
+// Only functions marked with this may use the F16C intrinsics, everything else is compiled for the baseline instruction set
+#define F16C_FUNCTION __attribute__((target("avx,f16c")))
+#endif
+
+namespace TextureUtil {
+	namespace {
+		constexpr uint32 CPUID_OSXSAVE = 1 << 27;
+		constexpr uint32 CPUID_AVX = 1 << 28;
+		constexpr uint32 CPUID_F16C = 1 << 29;
+		// Bits of XCR0 that are set once the os saves the sse and avx registers across context switches
+		constexpr uint64 XCR0_SSE_AVX = 0x6;
+
+		uint64 read_xcr0() {
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			uint32 low, high;
+			__asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+			return ((uint64)high << 32) | low;
+#endif
+		}
+
+		bool detect_f16c() {
+			uint32 ecx;
+#if defined(_MSC_VER)
+			int registers[4];
+			__cpuid(registers, 1);
+			ecx = (uint32)registers[2];
+#else
+			uint32 eax, ebx, edx;
+			if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+#endif
+			uint32 required = CPUID_OSXSAVE | CPUID_AVX | CPUID_F16C;
+			if ((ecx & required) != required) return false;
+
+			// The eight wide conversions use ymm registers, which the os has to have enabled
+			return (read_xcr0() & XCR0_SSE_AVX) == XCR0_SSE_AVX;
+		}
+
+		F16C_FUNCTION void half_to_float_f16c(const uint16* halves, float* floats, size_t count) {
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				_mm256_storeu_ps(floats + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(halves + i))));
+			}
+
+			for (; i < count; i++) floats[i] = glm::unpackHalf1x16(halves[i]);
+		}
+
+		F16C_FUNCTION void float_to_half_f16c(const float* floats, uint16* halves, size_t count) {
+			const __m256 lowest = _mm256_set1_ps(-MAX_HALF_FLOAT);
+			const __m256 highest = _mm256_set1_ps(MAX_HALF_FLOAT);
+
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				// The limit goes first, so NaN passes through like it does in the scalar path
+				__m256 values = _mm256_min_ps(highest, _mm256_max_ps(lowest, _mm256_loadu_ps(floats + i)));
+				_mm_storeu_si128((__m128i*)(halves + i), _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT));
+			}
+
+			for (; i < count; i++) halves[i] = glm::packHalf1x16(std::min(std::max(floats[i], -MAX_HALF_FLOAT), MAX_HALF_FLOAT));
+		}
+	}
+
+	bool half_float_conversion_is_accelerated() {
+		static const bool accelerated = detect_f16c();
+		return accelerated;
+	}
+
+	void half_to_float(const uint16* halves, float* floats, size_t count) {
+		if (half_float_conversion_is_accelerated()) {
+			half_to_float_f16c(halves, floats, count);
+			return;
+		}
+
+		for (size_t i = 0; i < count; i++) floats[i] = glm::unpackHalf1x16(halves[i]);
+	}
+
+	void float_to_half(const float* floats, uint16* halves, size_t count) {
+		if (half_float_conversion_is_accelerated()) {
+			float_to_half_f16c(floats, halves, count);
+			return;
+		}
+
+		for (size_t i = 0; i < count; i++) halves[i] = glm::packHalf1x16(std::min(std::max(floats[i], -MAX_HALF_FLOAT), MAX_HALF_FLOAT));
+	}
+}
\ No newline at end of file
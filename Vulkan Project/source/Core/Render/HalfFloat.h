@@ -0,0 +1,21 @@
+#pragma once
+#include <Core/Definitions.h>
+
+#include <cstddef>
+
+/*
+	Bulk conversion between 32 bit and 16 bit floats, for texels stored as half floats.
+	Uses the F16C instructions when the cpu has them, which convert eight values per instruction.
+*/
+
+namespace TextureUtil {
+	// Largest finite half float
+	constexpr float MAX_HALF_FLOAT = 65504.0f;
+
+	// Whether the F16C path is taken on this machine
+	bool half_float_conversion_is_accelerated();
+
+	void half_to_float(const uint16* halves, float* floats, size_t count);
+	// Rounds to the nearest half. Values beyond the range of half floats saturate instead of becoming infinite
+	void float_to_half(const float* floats, uint16* halves, size_t count);
+}
\ No newline at end of file
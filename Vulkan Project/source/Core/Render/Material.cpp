@@ -0,0 +1,31 @@
+#include "Material.h"
+
+#include <Core/TextureLoaders/TextureCache.h>
+#include <Core/Vulkan/UploadContext.h>
+
+Sampler loadSampler(std::filesystem::path path, VulkanInstance& instance, bool srgb) {
+	TextureLoaders::TextureImportOptions options;
+	options.usage = srgb ? TextureLoaders::TextureUsage::Color : TextureLoaders::TextureUsage::Linear;
+	options.compress = instance.textureCompressionBC;
+
+	TextureLoaders::CachedTexture texture = TextureLoaders::load_cached_texture(path, options);
+
+	Sampler sampler;
+	sampler.format = texture.format;
+	sampler.extent = texture.extent;
+	sampler.mipLevels = texture.levelCount();
+	sampler.imageSize = texture.dataSize;
+
+	VkUtil::createImage(instance, sampler.image, sampler.deviceMemory, sampler.extent, sampler.format, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal, sampler.mipLevels);
+
+	UploadContext upload(instance);
+	upload.transitionImageLayout(sampler.image, sampler.format, vk::ImageLayout::ePreinitialized, vk::ImageLayout::eTransferDstOptimal);
+	upload.uploadImage(texture.data, texture.dataSize, sampler.image, TextureUtil::mip_copy_regions(texture.levels.data(), texture.levelCount()));
+	upload.transitionImageLayout(sampler.image, sampler.format, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+	upload.wait();
+
+	sampler.imageView = VkUtil::createImageView(instance, sampler.image, sampler.format, vk::ImageAspectFlagBits::eColor, sampler.mipLevels);
+	sampler.sampler = VkUtil::createSampler(instance, sampler.mipLevels);
+
+	return sampler;
+}
\ No newline at end of file
@@ -4,7 +4,6 @@
 #include <Core/Vulkan/VkUtil.h>
 
 #include <filesystem>
-#include <stb/image.h>
 
 namespace std {
 	namespace filesystem = experimental::filesystem;
@@ -18,30 +17,17 @@ struct Sampler {
 	vk::Sampler sampler;
 	vk::Image image;
 	vk::ImageView imageView;
-	vk::DeviceMemory deviceMemory;
+	MemoryAllocation deviceMemory;
+	// Size of all mip levels together
 	vk::DeviceSize imageSize;
 	vk::Extent2D extent;
+	uint32 mipLevels = 1;
 
 };
 
-Sampler loadSampler(std::filesystem::path path, VulkanInstance& instance) {
-	int texWidth, texHeight, texChannels;
-	uint8* pixels = stbi_load(path.string().c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-
-	if (!pixels) throw std::runtime_error("Failed to load texture: " + path.string());
-
-	Sampler sampler;
-	sampler.imageSize = texWidth * texHeight * 4;
-	sampler.extent = { (uint32)texWidth, (uint32)texHeight };
-
-	vk::Buffer stagingBuffer;
-	vk::DeviceMemory stagingBufferMemory;
-
-	
-	VkUtil::createBuffer(instance, sampler.imageSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory);
-
-	return sampler;
-}
+// Loads an image with a full chain of mip levels, which are uploaded with a single copy. Color textures are `srgb`,
+// data like normals or roughness is not and is filtered as is
+Sampler loadSampler(std::filesystem::path path, VulkanInstance& instance, bool srgb = true);
 
 class Material {
 public:
@@ -2,7 +2,25 @@
 #include <Core/Definitions.h>
 #include <Core/Render/Vertex.h>
 
+struct BoundingBox {
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
 struct Mesh {
 	std::vector<Vertex> vertices;
 	std::vector<uint32> indices;
+
+	BoundingBox computeBounds() const {
+		BoundingBox bounds = { glm::vec3(0), glm::vec3(0) };
+		if (vertices.empty()) return bounds;
+
+		bounds.min = bounds.max = vertices[0].position;
+		for (auto& vertex : vertices) {
+			bounds.min = glm::min(bounds.min, vertex.position);
+			bounds.max = glm::max(bounds.max, vertex.position);
+		}
+
+		return bounds;
+	}
 };
\ No newline at end of file
@@ -0,0 +1,521 @@
+#include "MeshProcessing.h"
+
+#include <Core/Util/FileUtil.h>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace MeshUtil {
+	namespace {
+		constexpr uint32 COMPONENTS_PER_VERTEX = sizeof(Vertex) / sizeof(float);
+		static_assert(sizeof(Vertex) == COMPONENTS_PER_VERTEX * sizeof(float), "Vertex must be tightly packed floats");
+
+		using VertexKey = std::array<int64, COMPONENTS_PER_VERTEX>;
+
+		struct VertexKeyHash {
+			size_t operator()(const VertexKey& key) const {
+				return (size_t)FUtil::hash_bytes(key.data(), sizeof(key));
+			}
+		};
+
+		VertexKey make_key(const Vertex& vertex, float epsilon) {
+			const float* components = (const float*)&vertex;
+			VertexKey key;
+
+			for (uint32 c = 0; c < COMPONENTS_PER_VERTEX; c++) {
+				if (epsilon > 0.0f) {
+					key[c] = (int64)std::floor((double)components[c] / epsilon + 0.5);
+				}
+				else {
+					// Compare bit patterns, except that both zeros are the same value
+					uint32 bits = 0;
+					if (components[c] != 0.0f) memcpy(&bits, &components[c], sizeof(bits));
+					key[c] = bits;
+				}
+			}
+
+			return key;
+		}
+
+		// Tuning constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+		constexpr uint32 FORSYTH_CACHE_SIZE = 32;
+		constexpr float CACHE_DECAY_POWER = 1.5f;
+		constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+		constexpr float VALENCE_BOOST_SCALE = 2.0f;
+		constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+		float forsyth_vertex_score(int32 cachePosition, uint32 remainingTriangles) {
+			// Vertices without triangles left to draw can never add to the score of a triangle
+			if (remainingTriangles == 0) return -1.0f;
+
+			float score = 0.0f;
+			if (cachePosition >= 0) {
+				// The vertices of the last triangle get a fixed score, so the next triangle does not simply reuse its edge
+				if (cachePosition < 3) {
+					score = LAST_TRIANGLE_SCORE;
+				}
+				else {
+					float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+					score = std::pow(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+				}
+			}
+
+			// Prefer vertices with few triangles left, so they are finished and do not become expensive lone triangles later
+			score += VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+			return score;
+		}
+
+		/*
+			Fifo post-transform cache as implemented by most hardware.
+			A vertex is cached if fewer than `size` misses happened since it was last transformed.
+		*/
+		class FifoCacheSimulation {
+		public:
+			FifoCacheSimulation(uint32 vertexCount, uint32 t_size) : timestamps(vertexCount, 0), size(t_size), time(t_size + 1) { }
+
+			// Returns whether the vertex had to be transformed
+			bool access(uint32 vertex) {
+				if (time - timestamps[vertex] <= size) return false;
+
+				timestamps[vertex] = time++;
+				return true;
+			}
+
+			void reset() {
+				time += size + 1;
+			}
+
+		private:
+			std::vector<uint32> timestamps;
+			uint32 size;
+			uint32 time;
+		};
+
+		float sign_not_zero(float value) {
+			return value >= 0.0f ? 1.0f : -1.0f;
+		}
+
+		// Maps a unit vector onto the octahedron and unfolds it into the [-1, 1] square
+		glm::vec2 octahedral_encode(const glm::vec3& normal) {
+			glm::vec3 n = normal / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+			glm::vec2 encoded(n.x, n.y);
+
+			if (n.z < 0.0f) {
+				encoded.x = (1.0f - std::abs(n.y)) * sign_not_zero(n.x);
+				encoded.y = (1.0f - std::abs(n.x)) * sign_not_zero(n.y);
+			}
+
+			return encoded;
+		}
+
+		// Checks that there are whole triangles only and that every index refers to a vertex
+		void validate_triangles(const std::vector<uint32>& indices, uint32 vertexCount, const char* step) {
+			if (indices.size() % 3 != 0) throw std::runtime_error(std::string(step) + " failed. The index count is not a multiple of 3.");
+			for (auto index : indices) {
+				if (index >= vertexCount) throw std::runtime_error(std::string(step) + " failed. Index " + std::to_string(index) + " is out of range.");
+			}
+		}
+	}
+
+	uint32 weld_vertices(Mesh& mesh, float epsilon) {
+		// Without indices there is nothing to remap and every vertex would count as unreferenced
+		if (mesh.indices.empty()) return 0;
+
+		uint32 vertexCount = (uint32)mesh.vertices.size();
+		for (auto index : mesh.indices) {
+			if (index >= vertexCount) throw std::runtime_error("Welding mesh failed. Index " + std::to_string(index) + " is out of range.");
+		}
+
+		// Map every vertex onto the first vertex with the same key
+		std::vector<uint32> representative(vertexCount);
+		std::unordered_map<VertexKey, uint32, VertexKeyHash> firstWithKey;
+		firstWithKey.reserve(vertexCount);
+
+		for (uint32 v = 0; v < vertexCount; v++) {
+			auto inserted = firstWithKey.emplace(make_key(mesh.vertices[v], epsilon), v);
+			representative[v] = inserted.first->second;
+		}
+
+		// Keep representatives that are referenced, in their original order
+		std::vector<bool> referenced(vertexCount, false);
+		for (auto index : mesh.indices) referenced[representative[index]] = true;
+
+		std::vector<uint32> remap(vertexCount);
+		uint32 keptCount = 0;
+		for (uint32 v = 0; v < vertexCount; v++) {
+			if (referenced[v]) {
+				mesh.vertices[keptCount] = mesh.vertices[v];
+				remap[v] = keptCount++;
+			}
+		}
+
+		for (auto& index : mesh.indices) index = remap[representative[index]];
+		mesh.vertices.resize(keptCount);
+
+		return vertexCount - keptCount;
+	}
+
+	void optimize_vertex_cache(std::vector<uint32>& indices, uint32 vertexCount) {
+		validate_triangles(indices, vertexCount, "Optimizing vertex cache");
+
+		uint32 triangleCount = (uint32)indices.size() / 3;
+		if (triangleCount == 0) return;
+
+		// Triangles using each vertex, as ranges of one shared array. The first `remainingTriangles[v]` entries of a range
+		// are the triangles not emitted yet
+		std::vector<uint32> adjacencyOffsets(vertexCount + 1, 0);
+		for (auto index : indices) adjacencyOffsets[index + 1]++;
+		for (uint32 v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+		std::vector<uint32> remainingTriangles(vertexCount, 0);
+		std::vector<uint32> adjacentTriangles(indices.size());
+		for (uint32 t = 0; t < triangleCount; t++) {
+			for (uint32 k = 0; k < 3; k++) {
+				uint32 vertex = indices[t * 3 + k];
+				adjacentTriangles[adjacencyOffsets[vertex] + remainingTriangles[vertex]++] = t;
+			}
+		}
+
+		std::vector<int32> cachePositions(vertexCount, -1);
+		std::vector<float> vertexScores(vertexCount);
+		for (uint32 v = 0; v < vertexCount; v++) vertexScores[v] = forsyth_vertex_score(-1, remainingTriangles[v]);
+
+		std::vector<float> triangleScores(triangleCount);
+		std::vector<bool> emitted(triangleCount, false);
+		int64 bestTriangle = 0;
+		for (uint32 t = 0; t < triangleCount; t++) {
+			const uint32* triangle = &indices[t * 3];
+			triangleScores[t] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+			if (triangleScores[t] > triangleScores[bestTriangle]) bestTriangle = t;
+		}
+
+		std::vector<uint32> cache;
+		std::vector<uint32> nextCache;
+		cache.reserve(FORSYTH_CACHE_SIZE + 3);
+		nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+		std::vector<uint32> optimizedIndices;
+		optimizedIndices.reserve(indices.size());
+		uint32 nextInputTriangle = 0;
+
+		while (optimizedIndices.size() < indices.size()) {
+			if (bestTriangle < 0) {
+				// Dead end, no cached vertex has triangles left. Continue with the next triangle in input order
+				while (emitted[nextInputTriangle]) nextInputTriangle++;
+				bestTriangle = nextInputTriangle;
+			}
+
+			const uint32* triangle = &indices[bestTriangle * 3];
+			optimizedIndices.insert(optimizedIndices.end(), triangle, triangle + 3);
+			emitted[bestTriangle] = true;
+
+			// Remove the triangle from the active ranges of its vertices
+			for (uint32 k = 0; k < 3; k++) {
+				uint32 vertex = triangle[k];
+				uint32* begin = &adjacentTriangles[adjacencyOffsets[vertex]];
+				uint32* end = begin + remainingTriangles[vertex];
+
+				std::iter_swap(std::find(begin, end, (uint32)bestTriangle), end - 1);
+				remainingTriangles[vertex]--;
+			}
+
+			// Move the vertices of the triangle to the front of the lru cache
+			nextCache.assign(triangle, triangle + 3);
+			for (auto vertex : cache) {
+				if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) nextCache.push_back(vertex);
+			}
+
+			for (uint32 i = 0; i < nextCache.size(); i++) {
+				cachePositions[nextCache[i]] = i < FORSYTH_CACHE_SIZE ? (int32)i : -1;
+			}
+
+			// Rescore every vertex whose position changed and propagate the change to the triangles using it
+			for (auto vertex : nextCache) {
+				float score = forsyth_vertex_score(cachePositions[vertex], remainingTriangles[vertex]);
+				float delta = score - vertexScores[vertex];
+				vertexScores[vertex] = score;
+
+				uint32 begin = adjacencyOffsets[vertex];
+				for (uint32 i = begin; i < begin + remainingTriangles[vertex]; i++) triangleScores[adjacentTriangles[i]] += delta;
+			}
+
+			if (nextCache.size() > FORSYTH_CACHE_SIZE) nextCache.resize(FORSYTH_CACHE_SIZE);
+			std::swap(cache, nextCache);
+
+			// The next triangle is the best one using a cached vertex
+			bestTriangle = -1;
+			float bestScore = -1.0f;
+			for (auto vertex : cache) {
+				uint32 begin = adjacencyOffsets[vertex];
+				for (uint32 i = begin; i < begin + remainingTriangles[vertex]; i++) {
+					uint32 t = adjacentTriangles[i];
+					if (triangleScores[t] > bestScore) {
+						bestScore = triangleScores[t];
+						bestTriangle = t;
+					}
+				}
+			}
+		}
+
+		indices = std::move(optimizedIndices);
+	}
+
+	void optimize_vertex_cache(Mesh& mesh) {
+		optimize_vertex_cache(mesh.indices, (uint32)mesh.vertices.size());
+	}
+
+	void optimize_overdraw(const std::vector<Vertex>& vertices, std::vector<uint32>& indices, float threshold) {
+		validate_triangles(indices, (uint32)vertices.size(), "Optimizing overdraw");
+
+		uint32 triangleCount = (uint32)indices.size() / 3;
+		if (triangleCount < 2) return;
+
+		constexpr uint32 CACHE_SIZE = 16;
+		float meshAcmr = analyze_vertex_cache(indices.data(), indices.size(), (uint32)vertices.size(), CACHE_SIZE).acmr;
+
+		// Split where the cache order jumps (a triangle missing all of its vertices) and, to get more clusters to sort,
+		// wherever the cluster so far already has a cache miss ratio close to the whole mesh
+		std::vector<uint32> clusterStarts = { 0 };
+		FifoCacheSimulation cache((uint32)vertices.size(), CACHE_SIZE);
+		uint32 clusterMisses = 0;
+
+		for (uint32 t = 0; t < triangleCount; t++) {
+			const uint32* triangle = &indices[t * 3];
+			uint32 misses = cache.access(triangle[0]) + cache.access(triangle[1]) + cache.access(triangle[2]);
+
+			uint32 clusterTriangles = t - clusterStarts.back();
+			if (misses == 3 && clusterTriangles > 0) {
+				clusterStarts.push_back(t);
+				clusterMisses = 0;
+			}
+
+			clusterMisses += misses;
+			clusterTriangles = t + 1 - clusterStarts.back();
+
+			if (t + 1 < triangleCount && (float)clusterMisses / clusterTriangles <= threshold * meshAcmr) {
+				// The cluster will be drawn after other clusters, so its cache should not depend on the triangles before it
+				clusterStarts.push_back(t + 1);
+				clusterMisses = 0;
+				cache.reset();
+			}
+		}
+		clusterStarts.push_back(triangleCount);
+
+		// Area weighted centroids and normals of the clusters and the whole mesh
+		struct Cluster {
+			uint32 begin;
+			uint32 end;
+			float sortKey;
+		};
+
+		std::vector<Cluster> clusters;
+		std::vector<glm::vec3> clusterCentroids;
+		std::vector<glm::vec3> clusterNormals;
+		glm::vec3 meshCentroid(0);
+		float meshArea = 0.0f;
+
+		for (size_t c = 0; c + 1 < clusterStarts.size(); c++) {
+			glm::vec3 centroid(0);
+			glm::vec3 normal(0);
+			float area = 0.0f;
+
+			for (uint32 t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+				const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+				const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+				const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+
+				glm::vec3 scaledNormal = glm::cross(p1 - p0, p2 - p0);
+				float triangleArea = glm::length(scaledNormal);
+
+				centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+				normal += scaledNormal;
+				area += triangleArea;
+			}
+
+			meshCentroid += centroid;
+			meshArea += area;
+
+			clusters.push_back({ clusterStarts[c], clusterStarts[c + 1], 0.0f });
+			clusterCentroids.push_back(area > 0.0f ? centroid / area : centroid);
+			clusterNormals.push_back(normal);
+		}
+
+		if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+		// Clusters far out along their own normal face away from the rest of the mesh and should be drawn first
+		for (size_t c = 0; c < clusters.size(); c++) {
+			float normalLength = glm::length(clusterNormals[c]);
+			if (normalLength > 0.0f) clusters[c].sortKey = glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c] / normalLength);
+		}
+
+		std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+		std::vector<uint32> sortedIndices;
+		sortedIndices.reserve(indices.size());
+		for (auto& cluster : clusters) {
+			sortedIndices.insert(sortedIndices.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+		}
+
+		indices = std::move(sortedIndices);
+	}
+
+	void optimize_overdraw(Mesh& mesh, float threshold) {
+		optimize_overdraw(mesh.vertices, mesh.indices, threshold);
+	}
+
+	void optimize_vertex_fetch(Mesh& mesh) {
+		validate_triangles(mesh.indices, (uint32)mesh.vertices.size(), "Optimizing vertex fetch");
+
+		uint32 vertexCount = (uint32)mesh.vertices.size();
+		std::vector<uint32> remap(vertexCount, std::numeric_limits<uint32>::max());
+		std::vector<Vertex> vertices;
+		vertices.reserve(vertexCount);
+
+		for (auto& index : mesh.indices) {
+			if (remap[index] == std::numeric_limits<uint32>::max()) {
+				remap[index] = (uint32)vertices.size();
+				vertices.push_back(mesh.vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		// Vertices no triangle uses are kept at the end
+		for (uint32 v = 0; v < vertexCount; v++) {
+			if (remap[v] == std::numeric_limits<uint32>::max()) vertices.push_back(mesh.vertices[v]);
+		}
+
+		mesh.vertices = std::move(vertices);
+	}
+
+	VertexCacheStatistics analyze_vertex_cache(const uint32* indices, size_t indexCount, uint32 vertexCount, uint32 cacheSize) {
+		VertexCacheStatistics statistics;
+		// Without a whole triangle there is nothing to average over
+		if (indexCount < 3) return statistics;
+
+		FifoCacheSimulation cache(vertexCount, cacheSize);
+		std::vector<bool> referenced(vertexCount, false);
+		uint32 misses = 0;
+		uint32 uniqueVertices = 0;
+
+		for (size_t i = 0; i < indexCount; i++) {
+			uint32 index = indices[i];
+			misses += cache.access(index);
+			if (!referenced[index]) {
+				referenced[index] = true;
+				uniqueVertices++;
+			}
+		}
+
+		statistics.acmr = (float)misses / (indexCount / 3);
+		statistics.atvr = (float)misses / uniqueVertices;
+		return statistics;
+	}
+
+	VertexCacheStatistics analyze_vertex_cache(const Mesh& mesh, uint32 cacheSize) {
+		return analyze_vertex_cache(mesh.indices.data(), mesh.indices.size(), (uint32)mesh.vertices.size(), cacheSize);
+	}
+
+	MeshProcessingStatistics process_mesh(Mesh& mesh, const MeshProcessingOptions& options) {
+		MeshProcessingStatistics statistics;
+
+		statistics.removedVertices = weld_vertices(mesh, options.weldEpsilon);
+		statistics.cacheBefore = analyze_vertex_cache(mesh);
+
+		if (options.buildLods) statistics.lods = build_lod_chain(mesh, options.lodChain);
+		else statistics.lods = { { 0, (uint32)mesh.indices.size(), 0.0f } };
+
+		// Every level is drawn on its own, so each gets its own triangle order
+		uint32 vertexCount = (uint32)mesh.vertices.size();
+		for (auto& lod : statistics.lods) {
+			std::vector<uint32> indices(mesh.indices.begin() + lod.firstIndex, mesh.indices.begin() + lod.firstIndex + lod.indexCount);
+
+			optimize_vertex_cache(indices, vertexCount);
+			if (options.optimizeOverdraw) optimize_overdraw(mesh.vertices, indices, options.overdrawThreshold);
+
+			std::copy(indices.begin(), indices.end(), mesh.indices.begin() + lod.firstIndex);
+		}
+
+		// Level 0 comes first in the index buffer, so the vertex order follows the full mesh
+		optimize_vertex_fetch(mesh);
+
+		statistics.cacheAfter = analyze_vertex_cache(mesh.indices.data(), statistics.lods[0].indexCount, vertexCount);
+		return statistics;
+	}
+
+	VertexFormat choose_vertex_format(const Mesh& mesh, float maxTexCoordError) {
+		for (auto& vertex : mesh.vertices) {
+			for (uint32 c = 0; c < 2; c++) {
+				float texCoord = vertex.texCoord[c];
+				if (std::abs(glm::unpackHalf1x16(glm::packHalf1x16(texCoord)) - texCoord) > maxTexCoordError) return VertexFormat::Full;
+			}
+
+			// Positions outside of the float range would break the bounds used for quantization
+			for (uint32 c = 0; c < 3; c++) {
+				if (!std::isfinite(vertex.position[c])) return VertexFormat::Full;
+			}
+		}
+
+		return VertexFormat::Packed;
+	}
+
+	std::vector<PackedVertex> pack_vertices(const Mesh& mesh, const BoundingBox& bounds) {
+		glm::vec3 extent = bounds.max - bounds.min;
+		std::vector<PackedVertex> packed(mesh.vertices.size());
+
+		for (size_t v = 0; v < mesh.vertices.size(); v++) {
+			auto& vertex = mesh.vertices[v];
+			auto& packedVertex = packed[v];
+
+			for (uint32 c = 0; c < 3; c++) {
+				// Flat axes have a zero extent, every vertex sits on the minimum
+				float normalized = extent[c] > 0.0f ? (vertex.position[c] - bounds.min[c]) / extent[c] : 0.0f;
+				packedVertex.position[c] = glm::packUnorm1x16(normalized);
+			}
+			packedVertex.position[3] = 0;
+
+			float normalLength = glm::length(vertex.normal);
+			glm::vec2 normal = normalLength > 0.0f ? octahedral_encode(vertex.normal / normalLength) : glm::vec2(0.0f);
+			packedVertex.normal[0] = (int16)glm::packSnorm1x16(normal.x);
+			packedVertex.normal[1] = (int16)glm::packSnorm1x16(normal.y);
+
+			packedVertex.texCoord[0] = glm::packHalf1x16(vertex.texCoord.x);
+			packedVertex.texCoord[1] = glm::packHalf1x16(vertex.texCoord.y);
+		}
+
+		return packed;
+	}
+
+	PackedBounds packed_bounds(const BoundingBox& bounds) {
+		glm::vec3 extent = bounds.max - bounds.min;
+
+		return {
+			{ bounds.min.x, bounds.min.y, bounds.min.z, 0.0f },
+			{ extent.x, extent.y, extent.z, 0.0f }
+		};
+	}
+
+	uint32 index_size_for(uint32 vertexCount) {
+		return vertexCount <= (uint32)std::numeric_limits<uint16>::max() + 1 ? sizeof(uint16) : sizeof(uint32);
+	}
+
+	std::vector<uint8> pack_indices(const std::vector<uint32>& indices, uint32 indexSize) {
+		std::vector<uint8> packed(indices.size() * indexSize);
+
+		if (indexSize == sizeof(uint16)) {
+			uint16* output = (uint16*)packed.data();
+			for (size_t i = 0; i < indices.size(); i++) output[i] = (uint16)indices[i];
+		}
+		else if (indexSize == sizeof(uint32)) {
+			memcpy(packed.data(), indices.data(), packed.size());
+		}
+		else {
+			throw std::runtime_error("Packing indices failed. Unsupported index size " + std::to_string(indexSize) + ".");
+		}
+
+		return packed;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <Core/Render/Mesh.h>
+#include <Core/Render/PackedVertex.h>
+#include <Core/Render/MeshSimplification.h>
+#include <vector>
+
+/*
+	Processing steps applied to meshes after loading and before they are cached and uploaded.
+*/
+
+namespace MeshUtil {
+	// Merges duplicate vertices, remaps the indices onto the remaining ones and drops vertices no index refers to.
+	// With an epsilon of 0 only identical vertices are merged, otherwise all vertices whose components round to the
+	// same multiple of `epsilon` are merged into the first of them.
+	// Returns the number of vertices removed
+	uint32 weld_vertices(Mesh& mesh, float epsilon = 0.0f);
+
+	// Reorders triangles so vertices are reused while they are still in the post-transform cache (Forsyth's algorithm)
+	void optimize_vertex_cache(Mesh& mesh);
+	void optimize_vertex_cache(std::vector<uint32>& indices, uint32 vertexCount);
+	// Splits the triangle order into clusters and sorts them so outward facing clusters are drawn first, which lets
+	// them occlude the rest of the mesh. Should run after optimize_vertex_cache, whose locality it keeps inside clusters.
+	// `threshold` is the factor by which a cluster may exceed the cache miss ratio of the whole mesh when it is split early
+	void optimize_overdraw(Mesh& mesh, float threshold = 1.05f);
+	void optimize_overdraw(const std::vector<Vertex>& vertices, std::vector<uint32>& indices, float threshold = 1.05f);
+	// Reorders vertices by their first use in the index buffer, so vertex fetches walk memory linearly
+	void optimize_vertex_fetch(Mesh& mesh);
+
+	struct VertexCacheStatistics {
+		// Average cache miss ratio, transformed vertices per triangle. 0.5 is optimal for large regular meshes, 3 is the worst
+		float acmr = 0;
+		// Average transform to vertex ratio, transformed vertices per unique vertex. 1 is optimal
+		float atvr = 0;
+	};
+
+	// Simulates a fifo post-transform cache of `cacheSize` entries over the index buffer of `mesh`
+	VertexCacheStatistics analyze_vertex_cache(const Mesh& mesh, uint32 cacheSize = 16);
+	VertexCacheStatistics analyze_vertex_cache(const uint32* indices, size_t indexCount, uint32 vertexCount, uint32 cacheSize = 16);
+
+	// Picks the packed format unless storing texture coordinates as half floats would move one by more than `maxTexCoordError`
+	VertexFormat choose_vertex_format(const Mesh& mesh, float maxTexCoordError);
+	// Quantizes the vertices of `mesh` within `bounds`, which have to contain every vertex
+	std::vector<PackedVertex> pack_vertices(const Mesh& mesh, const BoundingBox& bounds);
+	// Push constants to decode vertices that were packed within `bounds`
+	PackedBounds packed_bounds(const BoundingBox& bounds);
+
+	struct MeshProcessingOptions {
+		// Vertices are welded if their components round to the same multiple, 0 only welds identical vertices
+		float weldEpsilon = 0.0f;
+		bool optimizeOverdraw = true;
+		float overdrawThreshold = 1.05f;
+
+		// Whether the mesh may be stored as PackedVertex, see choose_vertex_format
+		bool allowPackedVertices = true;
+		float maxTexCoordError = 1.0f / 2048;
+
+		// Whether to append simplified levels of detail to the index buffer, see build_lod_chain
+		bool buildLods = true;
+		LodChainOptions lodChain;
+	};
+
+	struct MeshProcessingStatistics {
+		uint32 removedVertices = 0;
+		VertexCacheStatistics cacheBefore;
+		VertexCacheStatistics cacheAfter;
+		// Index ranges and errors of the levels of detail, a single level covering every index if none were built
+		std::vector<MeshLod> lods;
+	};
+
+	// Runs all processing steps in order: welding, level of detail generation, vertex cache and overdraw optimization
+	// of every level and vertex fetch optimization. The cache statistics describe level 0
+	MeshProcessingStatistics process_mesh(Mesh& mesh, const MeshProcessingOptions& options = {});
+
+	// Smallest index size in bytes able to address `vertexCount` vertices
+	uint32 index_size_for(uint32 vertexCount);
+	// Narrows every index to `indexSize` bytes. The indices must fit
+	std::vector<uint8> pack_indices(const std::vector<uint32>& indices, uint32 indexSize);
+}
\ No newline at end of file
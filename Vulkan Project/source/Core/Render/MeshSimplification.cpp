@@ -0,0 +1,473 @@
+#include "MeshSimplification.h"
+
+#include <Core/Util/FileUtil.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace MeshUtil {
+	namespace {
+		// Border planes count this much more than surface planes of the same area, so outlines hold their shape
+		constexpr double BORDER_WEIGHT = 10.0;
+		// Seams lie on the surface and are held less firmly, they only have to stay where the texture or shading changes
+		constexpr double SEAM_WEIGHT = 1.0;
+		// Collapses may turn a triangle by at most about 75 degrees, and never squash it flat
+		constexpr float MIN_FLIP_COSINE = 0.25f;
+		// A level has to drop at least this fraction of the indices of the previous one to be worth keeping
+		constexpr float LOD_MIN_PROGRESS = 0.9f;
+
+		// Symmetric 4x4 matrix summing the weighted squared distances of a point to a set of planes
+		struct Quadric {
+			double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+			double b0 = 0, b1 = 0, b2 = 0;
+			double c = 0;
+			double weight = 0;
+
+			// Plane through all points p with dot(normal, p) + distance = 0
+			static Quadric fromPlane(const glm::vec3& normal, float distance, double weight) {
+				Quadric quadric;
+				double x = normal.x, y = normal.y, z = normal.z, d = distance;
+
+				quadric.a00 = weight * x * x;
+				quadric.a11 = weight * y * y;
+				quadric.a22 = weight * z * z;
+				quadric.a01 = weight * x * y;
+				quadric.a02 = weight * x * z;
+				quadric.a12 = weight * y * z;
+				quadric.b0 = weight * x * d;
+				quadric.b1 = weight * y * d;
+				quadric.b2 = weight * z * d;
+				quadric.c = weight * d * d;
+				quadric.weight = weight;
+
+				return quadric;
+			}
+
+			Quadric& operator+=(const Quadric& other) {
+				a00 += other.a00; a11 += other.a11; a22 += other.a22;
+				a01 += other.a01; a02 += other.a02; a12 += other.a12;
+				b0 += other.b0; b1 += other.b1; b2 += other.b2;
+				c += other.c;
+				weight += other.weight;
+				return *this;
+			}
+
+			// Weighted mean of the squared distances of `point` to the planes
+			double error(const glm::vec3& point) const {
+				if (weight <= 0.0) return 0.0;
+
+				double x = point.x, y = point.y, z = point.z;
+				double error = a00 * x * x + a11 * y * y + a22 * z * z
+					+ 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+					+ 2.0 * (b0 * x + b1 * y + b2 * z)
+					+ c;
+
+				// Mathematically never negative, rounding can make it slightly so
+				return std::abs(error) / weight;
+			}
+		};
+
+		enum class VertexKind : uint8 {
+			// Interior vertex, may collapse onto any neighbour
+			Manifold,
+			// Vertex on an open border, may only collapse along the border
+			Border,
+			// One of the two vertices at a position on an attribute seam, may only collapse along the seam together with the other one
+			Seam,
+			// Vertex where seams meet or on a non-manifold edge, never moves
+			Locked
+		};
+
+		using PositionKey = std::array<uint32, 3>;
+
+		struct PositionKeyHash {
+			size_t operator()(const PositionKey& key) const {
+				return (size_t)FUtil::hash_bytes(key.data(), sizeof(key));
+			}
+		};
+
+		uint64 edge_key(uint32 from, uint32 to) {
+			return ((uint64)from << 32) | to;
+		}
+
+		glm::vec3 triangle_normal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2) {
+			return glm::cross(p1 - p0, p2 - p0);
+		}
+
+		/*
+			Topology of the mesh in terms of positions rather than vertices, so attribute seams do not look like borders.
+			Quadrics are kept per position as well, the vertices on both sides of a seam describe the same surface.
+		*/
+		struct SurfaceTopology {
+			// Id of the position of every vertex, the index of the first vertex at that position
+			std::vector<uint32> positionIds;
+			// The other vertex at the position of a seam vertex, the vertex itself for all other kinds
+			std::vector<uint32> siblings;
+			// Directed edges between vertices, an edge used in one direction only is either on a border or on a seam
+			std::unordered_set<uint64> vertexEdges;
+			// Number of times every directed edge between two positions is used
+			std::unordered_map<uint64, uint32> edgeCounts;
+			std::vector<VertexKind> kinds;
+
+			bool isBorderEdge(uint32 fromVertex, uint32 toVertex) const {
+				uint32 from = positionIds[fromVertex], to = positionIds[toVertex];
+				return (edgeCounts.count(edge_key(from, to)) != 0) != (edgeCounts.count(edge_key(to, from)) != 0);
+			}
+
+			// Edge the surface continues across while the vertices do not
+			bool isSeamEdge(uint32 fromVertex, uint32 toVertex) const {
+				if (positionIds[fromVertex] == positionIds[toVertex] || isBorderEdge(fromVertex, toVertex)) return false;
+				return (vertexEdges.count(edge_key(fromVertex, toVertex)) != 0) != (vertexEdges.count(edge_key(toVertex, fromVertex)) != 0);
+			}
+		};
+
+		SurfaceTopology analyze_topology(const std::vector<Vertex>& vertices, const std::vector<uint32>& indices) {
+			uint32 vertexCount = (uint32)vertices.size();
+			SurfaceTopology topology;
+
+			topology.positionIds.resize(vertexCount);
+			std::vector<uint32> verticesAtPosition(vertexCount, 0);
+			std::unordered_map<PositionKey, uint32, PositionKeyHash> firstAtPosition;
+			firstAtPosition.reserve(vertexCount);
+
+			for (uint32 v = 0; v < vertexCount; v++) {
+				PositionKey key;
+				memcpy(key.data(), &vertices[v].position, sizeof(key));
+
+				uint32 id = firstAtPosition.emplace(key, v).first->second;
+				topology.positionIds[v] = id;
+				verticesAtPosition[id]++;
+			}
+
+			for (size_t i = 0; i < indices.size(); i += 3) {
+				for (uint32 k = 0; k < 3; k++) {
+					uint32 fromVertex = indices[i + k], toVertex = indices[i + (k + 1) % 3];
+					uint32 from = topology.positionIds[fromVertex], to = topology.positionIds[toVertex];
+					if (from == to) continue;
+
+					topology.edgeCounts[edge_key(from, to)]++;
+					topology.vertexEdges.insert(edge_key(fromVertex, toVertex));
+				}
+			}
+
+			std::vector<bool> positionLocked(vertexCount, false);
+			std::vector<bool> positionOnBorder(vertexCount, false);
+
+			for (auto& edge : topology.edgeCounts) {
+				uint32 from = (uint32)(edge.first >> 32), to = (uint32)edge.first;
+
+				if (edge.second > 1) {
+					positionLocked[from] = positionLocked[to] = true;
+				}
+				else if (topology.edgeCounts.count(edge_key(to, from)) == 0) {
+					positionOnBorder[from] = positionOnBorder[to] = true;
+				}
+			}
+
+			// The position id is the first vertex at the position, so the second vertex of a seam pairs up with it
+			topology.siblings.resize(vertexCount);
+			std::iota(topology.siblings.begin(), topology.siblings.end(), 0);
+
+			topology.kinds.resize(vertexCount, VertexKind::Manifold);
+			for (uint32 v = 0; v < vertexCount; v++) {
+				uint32 id = topology.positionIds[v];
+
+				if (positionLocked[id]) {
+					topology.kinds[v] = VertexKind::Locked;
+				}
+				else if (verticesAtPosition[id] == 1) {
+					if (positionOnBorder[id]) topology.kinds[v] = VertexKind::Border;
+				}
+				else if (verticesAtPosition[id] == 2 && !positionOnBorder[id]) {
+					topology.kinds[v] = VertexKind::Seam;
+					topology.siblings[v] = id;
+					topology.siblings[id] = v;
+				}
+				else {
+					topology.kinds[v] = VertexKind::Locked;
+				}
+			}
+
+			return topology;
+		}
+
+		// Quadrics of every position, stored at its position id
+		std::vector<Quadric> compute_quadrics(const std::vector<Vertex>& vertices, const std::vector<uint32>& indices, const SurfaceTopology& topology) {
+			std::vector<Quadric> quadrics(vertices.size());
+			auto& ids = topology.positionIds;
+
+			for (size_t i = 0; i < indices.size(); i += 3) {
+				const uint32* triangle = &indices[i];
+				const glm::vec3& p0 = vertices[triangle[0]].position;
+
+				glm::vec3 normal = triangle_normal(p0, vertices[triangle[1]].position, vertices[triangle[2]].position);
+				float doubleArea = glm::length(normal);
+				if (doubleArea == 0.0f) continue;
+				normal /= doubleArea;
+
+				// Area weighted, so small triangles do not dominate the error of large flat regions
+				Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, p0), doubleArea * 0.5);
+				for (uint32 k = 0; k < 3; k++) quadrics[ids[triangle[k]]] += plane;
+
+				// Planes perpendicular to the triangle through its border and seam edges keep vertices from drifting off them
+				for (uint32 k = 0; k < 3; k++) {
+					uint32 from = triangle[k], to = triangle[(k + 1) % 3];
+
+					if (ids[from] == ids[to]) continue;
+
+					double weight = topology.isBorderEdge(from, to) ? BORDER_WEIGHT : topology.isSeamEdge(from, to) ? SEAM_WEIGHT : 0.0;
+					if (weight == 0.0) continue;
+
+					glm::vec3 edge = vertices[to].position - vertices[from].position;
+					glm::vec3 edgeNormal = glm::cross(edge, normal);
+					float length = glm::length(edgeNormal);
+					if (length == 0.0f) continue;
+					edgeNormal /= length;
+
+					Quadric constraint = Quadric::fromPlane(edgeNormal, -glm::dot(edgeNormal, vertices[from].position), glm::dot(edge, edge) * weight);
+					quadrics[ids[from]] += constraint;
+					quadrics[ids[to]] += constraint;
+				}
+			}
+
+			return quadrics;
+		}
+
+		// Triangles using each vertex, as ranges of one shared array
+		struct TriangleAdjacency {
+			std::vector<uint32> offsets;
+			std::vector<uint32> triangles;
+
+			void build(const std::vector<uint32>& indices, uint32 vertexCount) {
+				offsets.assign(vertexCount + 1, 0);
+				for (auto index : indices) offsets[index + 1]++;
+				for (uint32 v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+
+				triangles.resize(indices.size());
+				std::vector<uint32> fill(offsets.begin(), offsets.end() - 1);
+				for (size_t i = 0; i < indices.size(); i++) triangles[fill[indices[i]]++] = (uint32)(i / 3);
+			}
+		};
+
+		// Whether moving `from` onto `to` would turn any of the remaining triangles around `from` too far
+		bool collapse_flips_triangles(const std::vector<Vertex>& vertices, const std::vector<uint32>& indices, const TriangleAdjacency& adjacency, uint32 from, uint32 to) {
+			for (uint32 i = adjacency.offsets[from]; i < adjacency.offsets[from + 1]; i++) {
+				const uint32* triangle = &indices[adjacency.triangles[i] * 3];
+
+				// Triangles using the edge disappear
+				if (triangle[0] == to || triangle[1] == to || triangle[2] == to) continue;
+
+				glm::vec3 positions[3];
+				for (uint32 k = 0; k < 3; k++) positions[k] = vertices[triangle[k]].position;
+				glm::vec3 before = triangle_normal(positions[0], positions[1], positions[2]);
+
+				for (uint32 k = 0; k < 3; k++) {
+					if (triangle[k] == from) positions[k] = vertices[to].position;
+				}
+				glm::vec3 after = triangle_normal(positions[0], positions[1], positions[2]);
+
+				// Also true for triangles that end up with no area, the test would pass them for every later collapse
+				if (glm::dot(before, after) <= MIN_FLIP_COSINE * glm::length(before) * glm::length(after)) return true;
+			}
+
+			return false;
+		}
+	}
+
+	std::vector<uint32> simplify(const std::vector<Vertex>& vertices, const std::vector<uint32>& indices, uint32 targetIndexCount, float maxError, float& resultError) {
+		uint32 vertexCount = (uint32)vertices.size();
+		if (indices.size() % 3 != 0) throw std::runtime_error("Simplifying mesh failed. The index count is not a multiple of 3.");
+		for (auto index : indices) {
+			if (index >= vertexCount) throw std::runtime_error("Simplifying mesh failed. Index " + std::to_string(index) + " is out of range.");
+		}
+
+		resultError = 0.0f;
+		std::vector<uint32> result = indices;
+		if (result.size() <= targetIndexCount) return result;
+
+		auto topology = analyze_topology(vertices, indices);
+		auto quadrics = compute_quadrics(vertices, indices, topology);
+
+		TriangleAdjacency adjacency;
+		auto& ids = topology.positionIds;
+		const uint32 NO_VERTEX = ~0u;
+
+		// Vertex at the position of `to` in the only current triangle around `from` that uses the edge between their positions.
+		// NO_VERTEX if more or fewer triangles use it. Compared by position, an edge used once lies on a border or a seam
+		auto singleEdgeTarget = [&](uint32 from, uint32 to) {
+			uint32 target = NO_VERTEX, edgeTriangles = 0;
+			for (uint32 i = adjacency.offsets[from]; i < adjacency.offsets[from + 1]; i++) {
+				const uint32* triangle = &result[adjacency.triangles[i] * 3];
+				for (uint32 k = 0; k < 3; k++) {
+					if (ids[triangle[k]] == ids[to]) {
+						target = triangle[k];
+						edgeTriangles++;
+					}
+				}
+			}
+
+			return edgeTriangles == 1 ? target : NO_VERTEX;
+		};
+
+		// Borders and seams change as they get simplified, so their edges are found in the current triangles around `from`.
+		// A seam vertex takes its sibling along the other side of the seam, `siblingTo` receives the vertex it collapses onto
+		auto canCollapse = [&](uint32 from, uint32 to, uint32& siblingTo) {
+			siblingTo = NO_VERTEX;
+
+			switch (topology.kinds[from]) {
+			case VertexKind::Manifold:
+				return true;
+			case VertexKind::Border:
+				return singleEdgeTarget(from, to) != NO_VERTEX;
+			case VertexKind::Seam:
+				if (singleEdgeTarget(from, to) == NO_VERTEX) return false;
+				siblingTo = singleEdgeTarget(topology.siblings[from], to);
+				return siblingTo != NO_VERTEX;
+			default:
+				return false;
+			}
+		};
+
+		struct Collapse {
+			uint32 from;
+			uint32 to;
+			// Where the sibling of a seam vertex goes, NO_VERTEX for all other kinds
+			uint32 siblingTo;
+			double cost;
+		};
+
+		double maxCost = (double)maxError * maxError;
+		double largestCost = 0.0;
+
+		std::vector<Collapse> collapses;
+		std::vector<uint32> remap(vertexCount);
+		std::vector<bool> touched(vertexCount);
+
+		// Collapse in passes, cheapest first, touching every vertex at most once per pass so the flip tests stay valid
+		while (result.size() > targetIndexCount) {
+			adjacency.build(result, vertexCount);
+
+			collapses.clear();
+			for (size_t i = 0; i < result.size(); i += 3) {
+				for (uint32 k = 0; k < 3; k++) {
+					uint32 v0 = result[i + k], v1 = result[i + (k + 1) % 3];
+					if (ids[v0] == ids[v1]) continue;
+
+					for (auto edge : { std::make_pair(v0, v1), std::make_pair(v1, v0) }) {
+						uint32 siblingTo;
+						if (!canCollapse(edge.first, edge.second, siblingTo)) continue;
+
+						Quadric quadric = quadrics[ids[edge.first]];
+						quadric += quadrics[ids[edge.second]];
+						double cost = quadric.error(vertices[edge.second].position);
+						if (cost <= maxCost) collapses.push_back({ edge.first, edge.second, siblingTo, cost });
+					}
+				}
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			std::iota(remap.begin(), remap.end(), 0);
+			std::fill(touched.begin(), touched.end(), false);
+
+			size_t trianglesToRemove = std::max<size_t>(1, (result.size() - targetIndexCount) / 3);
+			size_t trianglesRemoved = 0;
+			uint32 collapseCount = 0;
+
+			// Every triangle around `from` changes, so its vertices wait for the next pass
+			auto collapseVertex = [&](uint32 from, uint32 to) {
+				for (uint32 i = adjacency.offsets[from]; i < adjacency.offsets[from + 1]; i++) {
+					const uint32* triangle = &result[adjacency.triangles[i] * 3];
+					if (ids[triangle[0]] == ids[to] || ids[triangle[1]] == ids[to] || ids[triangle[2]] == ids[to]) trianglesRemoved++;
+
+					for (uint32 k = 0; k < 3; k++) touched[triangle[k]] = true;
+				}
+
+				remap[from] = to;
+			};
+
+			for (auto& collapse : collapses) {
+				if (trianglesRemoved >= trianglesToRemove) break;
+
+				bool seam = collapse.siblingTo != NO_VERTEX;
+				uint32 sibling = topology.siblings[collapse.from];
+
+				if (touched[collapse.from] || touched[collapse.to]) continue;
+				if (seam && (touched[sibling] || touched[collapse.siblingTo])) continue;
+				if (collapse_flips_triangles(vertices, result, adjacency, collapse.from, collapse.to)) continue;
+				if (seam && collapse_flips_triangles(vertices, result, adjacency, sibling, collapse.siblingTo)) continue;
+
+				collapseVertex(collapse.from, collapse.to);
+				if (seam) collapseVertex(sibling, collapse.siblingTo);
+
+				quadrics[ids[collapse.to]] += quadrics[ids[collapse.from]];
+				largestCost = std::max(largestCost, collapse.cost);
+				collapseCount++;
+			}
+
+			if (collapseCount == 0) break;
+
+			size_t write = 0;
+			for (size_t i = 0; i < result.size(); i += 3) {
+				uint32 a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+				if (a == b || b == c || a == c) continue;
+
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+			result.resize(write);
+		}
+
+		resultError = (float)std::sqrt(largestCost);
+		return result;
+	}
+
+	std::vector<MeshLod> build_lod_chain(Mesh& mesh, const LodChainOptions& options) {
+		std::vector<MeshLod> lods = { { 0, (uint32)mesh.indices.size(), 0.0f } };
+		if (mesh.indices.empty()) return lods;
+
+		auto bounds = mesh.computeBounds();
+		float maxError = options.maxRelativeError * glm::length(bounds.max - bounds.min) * 0.5f;
+
+		// Every level is simplified from the full mesh, so its error is measured against the full mesh as well
+		std::vector<uint32> fullIndices = mesh.indices;
+
+		for (uint32 level = 1; level < options.maxLods; level++) {
+			uint32 targetIndexCount = (uint32)(lods.back().indexCount * options.reduction) / 3 * 3;
+
+			float error;
+			auto indices = simplify(mesh.vertices, fullIndices, targetIndexCount, maxError, error);
+			if (indices.empty() || indices.size() > lods.back().indexCount * LOD_MIN_PROGRESS) break;
+
+			lods.push_back({ (uint32)mesh.indices.size(), (uint32)indices.size(), error });
+			mesh.indices.insert(mesh.indices.end(), indices.begin(), indices.end());
+		}
+
+		return lods;
+	}
+
+	uint32 select_lod(const MeshLod* lods, uint32 lodCount, const BoundingBox& bounds, const glm::mat4& model, const Camera& camera, float viewportHeight, float maxPixelError) {
+		if (lodCount == 0) return 0;
+
+		float scale = glm::length(glm::vec3(model[0]));
+		glm::vec3 center = glm::vec3(model * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+		float radius = glm::length(bounds.max - bounds.min) * 0.5f * scale;
+
+		// Distance to the closest point of the bounding sphere, errors are largest there
+		float distance = std::max(glm::distance(camera.transform.position, center) - radius, 1e-3f);
+		// Pixels covered by one unit at a distance of one unit
+		float pixelsPerUnit = std::abs(camera.projection[1][1]) * viewportHeight * 0.5f;
+
+		for (uint32 lod = lodCount - 1; lod > 0; lod--) {
+			float projectedError = lods[lod].error * scale / distance * pixelsPerUnit;
+			if (projectedError <= maxPixelError) return lod;
+		}
+
+		return 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <Core/Render/Mesh.h>
+#include <Core/Render/Camera.h>
+#include <vector>
+
+/*
+	Level of detail generation with a quadric error metric simplifier (Garland and Heckbert).
+
+	Edges are collapsed onto one of their existing vertices, so every level indexes the vertex buffer of the full mesh
+	and a mesh with all of its levels needs a single vertex and index buffer. Errors and topology are measured on
+	positions, so vertices split by an attribute seam count as one. They move along the seam as a pair and vertices
+	on open borders move along the border, both held there by constraint planes, which keeps texture coordinates
+	and outlines intact. Points where seams meet and non-manifold edges stay in place, so hard edged meshes
+	where every corner is such a point (flat shaded boxes) do not simplify at all.
+*/
+
+namespace MeshUtil {
+	// Simplifies the triangles in `indices` until at most `targetIndexCount` indices are left or the next collapse
+	// would move the surface by more than `maxError`, a distance in mesh units.
+	// `resultError` receives the largest error of the collapses performed
+	std::vector<uint32> simplify(const std::vector<Vertex>& vertices, const std::vector<uint32>& indices, uint32 targetIndexCount, float maxError, float& resultError);
+
+	struct MeshLod {
+		// Range of the index buffer holding the triangles of the level
+		uint32 firstIndex;
+		uint32 indexCount;
+		// Distance in mesh units the simplified surface may deviate from the full mesh, 0 for the full mesh
+		float error;
+	};
+
+	struct LodChainOptions {
+		uint32 maxLods = 4;
+		// Index count of every level relative to the previous one
+		float reduction = 0.5f;
+		// Largest error a level may have, relative to the radius of the mesh
+		float maxRelativeError = 0.05f;
+	};
+
+	// Simplifies `mesh` into a chain of levels and appends their indices to the index buffer.
+	// Level 0 is the unchanged mesh, the chain ends early when a level can not be simplified much further
+	std::vector<MeshLod> build_lod_chain(Mesh& mesh, const LodChainOptions& options = {});
+
+	// Picks the coarsest level whose error projects to at most `maxPixelError` pixels on a viewport `viewportHeight`
+	// pixels high. The model matrix may only rotate, translate and scale uniformly
+	uint32 select_lod(const MeshLod* lods, uint32 lodCount, const BoundingBox& bounds, const glm::mat4& model, const Camera& camera, float viewportHeight, float maxPixelError = 1.0f);
+}
\ No newline at end of file
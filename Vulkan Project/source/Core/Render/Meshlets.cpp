@@ -0,0 +1,209 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace MeshUtil {
+	namespace {
+		// Ritter's approximate bounding sphere, usually within 5 to 20 percent of the minimal one
+		void compute_ritter_sphere(const std::vector<glm::vec3>& points, glm::vec3& center, float& radius) {
+			// Start from the pair of points furthest apart along one of the axes
+			uint32 extremeMin[3] = { 0, 0, 0 };
+			uint32 extremeMax[3] = { 0, 0, 0 };
+
+			for (uint32 p = 0; p < points.size(); p++) {
+				for (uint32 axis = 0; axis < 3; axis++) {
+					if (points[p][axis] < points[extremeMin[axis]][axis]) extremeMin[axis] = p;
+					if (points[p][axis] > points[extremeMax[axis]][axis]) extremeMax[axis] = p;
+				}
+			}
+
+			uint32 widestAxis = 0;
+			for (uint32 axis = 1; axis < 3; axis++) {
+				if (glm::distance(points[extremeMin[axis]], points[extremeMax[axis]]) > glm::distance(points[extremeMin[widestAxis]], points[extremeMax[widestAxis]])) widestAxis = axis;
+			}
+
+			center = (points[extremeMin[widestAxis]] + points[extremeMax[widestAxis]]) * 0.5f;
+			radius = glm::distance(points[extremeMin[widestAxis]], points[extremeMax[widestAxis]]) * 0.5f;
+
+			// Grow the sphere just enough to include every point outside of it
+			for (auto& point : points) {
+				float distance = glm::distance(point, center);
+				if (distance > radius) {
+					float grownRadius = (radius + distance) * 0.5f;
+					center += (point - center) * ((grownRadius - radius) / distance);
+					radius = grownRadius;
+				}
+			}
+		}
+
+		// Ritter's sphere is loosest for flat, square patches, which the sphere around their bounding box fits almost exactly
+		void compute_bounding_sphere(const std::vector<glm::vec3>& points, glm::vec3& center, float& radius) {
+			compute_ritter_sphere(points, center, radius);
+
+			glm::vec3 boundsMin = points[0], boundsMax = points[0];
+			for (auto& point : points) {
+				boundsMin = glm::min(boundsMin, point);
+				boundsMax = glm::max(boundsMax, point);
+			}
+
+			glm::vec3 boxCenter = (boundsMin + boundsMax) * 0.5f;
+			float boxRadius = 0.0f;
+			for (auto& point : points) boxRadius = std::max(boxRadius, glm::distance(point, boxCenter));
+
+			if (boxRadius < radius) {
+				center = boxCenter;
+				radius = boxRadius;
+			}
+		}
+
+		void compute_bounds(const Mesh& mesh, Meshlet& meshlet, std::vector<glm::vec3>& points) {
+			points.clear();
+
+			glm::vec3 normalSum(0.0f);
+			std::vector<glm::vec3> normals;
+			normals.reserve(meshlet.triangleCount);
+
+			for (uint32 t = 0; t < meshlet.triangleCount; t++) {
+				const uint32* triangle = &mesh.indices[meshlet.firstIndex + t * 3];
+				const glm::vec3& p0 = mesh.vertices[triangle[0]].position;
+				const glm::vec3& p1 = mesh.vertices[triangle[1]].position;
+				const glm::vec3& p2 = mesh.vertices[triangle[2]].position;
+
+				points.push_back(p0);
+				points.push_back(p1);
+				points.push_back(p2);
+
+				// Degenerate triangles are never rasterized and cannot narrow the cone
+				glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+				float length = glm::length(normal);
+				if (length > 0.0f) {
+					normals.push_back(normal / length);
+					normalSum += normal / length;
+				}
+			}
+
+			compute_bounding_sphere(points, meshlet.center, meshlet.radius);
+
+			meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+			meshlet.coneCutoff = 1.0f;
+
+			float axisLength = glm::length(normalSum);
+			if (normals.empty() || axisLength == 0.0f) return;
+
+			meshlet.coneAxis = normalSum / axisLength;
+
+			float minimumDot = 1.0f;
+			for (auto& normal : normals) minimumDot = std::min(minimumDot, glm::dot(normal, meshlet.coneAxis));
+
+			// Cones wider than about 90 degrees can not be culled from any position in front of the meshlet
+			if (minimumDot <= 0.1f) return;
+
+			// The cutoff is the sine of the cone's half angle, see Meshlet::coneCutoff
+			meshlet.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+		}
+	}
+
+	std::vector<Meshlet> build_meshlets(const Mesh& mesh, uint32 maxVertices, uint32 maxTriangles) {
+		if (maxVertices < 3 || maxTriangles < 1) throw std::runtime_error("Building meshlets failed. A meshlet needs room for at least one triangle.");
+
+		uint32 triangleCount = (uint32)mesh.indices.size() / 3;
+		std::vector<Meshlet> meshlets;
+
+		// Meshlet each vertex was last added to, to count unique vertices without searching
+		std::vector<uint32> lastMeshlet(mesh.vertices.size(), std::numeric_limits<uint32>::max());
+		std::vector<glm::vec3> points;
+
+		// Number of vertices of a triangle that are not part of the meshlet yet, counting repeated vertices once
+		auto countNewVertices = [&](const uint32* triangle, uint32 meshletIndex) {
+			uint32 newVertices = 0;
+			for (uint32 k = 0; k < 3; k++) {
+				bool repeated = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]);
+				if (!repeated && lastMeshlet[triangle[k]] != meshletIndex) newVertices++;
+			}
+			return newVertices;
+		};
+
+		Meshlet current = {};
+		for (uint32 t = 0; t < triangleCount; t++) {
+			const uint32* triangle = &mesh.indices[t * 3];
+			for (uint32 k = 0; k < 3; k++) {
+				if (triangle[k] >= mesh.vertices.size()) throw std::runtime_error("Building meshlets failed. Index " + std::to_string(triangle[k]) + " is out of range.");
+			}
+
+			uint32 newVertices = countNewVertices(triangle, (uint32)meshlets.size());
+			if (current.triangleCount == maxTriangles || current.vertexCount + newVertices > maxVertices) {
+				compute_bounds(mesh, current, points);
+				meshlets.push_back(current);
+
+				current = {};
+				current.firstIndex = t * 3;
+				newVertices = countNewVertices(triangle, (uint32)meshlets.size());
+			}
+
+			for (uint32 k = 0; k < 3; k++) lastMeshlet[triangle[k]] = (uint32)meshlets.size();
+			current.vertexCount += newVertices;
+			current.triangleCount++;
+		}
+
+		if (current.triangleCount > 0) {
+			compute_bounds(mesh, current, points);
+			meshlets.push_back(current);
+		}
+
+		return meshlets;
+	}
+
+	Frustum frustum_from_matrix(const glm::mat4& viewProjection) {
+		// Rows of the matrix, glm stores columns
+		glm::vec4 rows[4];
+		for (uint32 r = 0; r < 4; r++) rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+
+		Frustum frustum;
+		frustum.planes[0] = rows[3] + rows[0];	// Left
+		frustum.planes[1] = rows[3] - rows[0];	// Right
+		frustum.planes[2] = rows[3] + rows[1];	// Bottom
+		frustum.planes[3] = rows[3] - rows[1];	// Top
+		frustum.planes[4] = rows[2];			// Near, depth starts at 0
+		frustum.planes[5] = rows[3] - rows[2];	// Far
+
+		// Normalize, so the plane equations give distances the sphere radii can be compared against
+		for (auto& plane : frustum.planes) plane /= glm::length(glm::vec3(plane));
+
+		return frustum;
+	}
+
+	std::vector<uint32> cull_meshlets(const std::vector<Meshlet>& meshlets, const Frustum& frustum, const glm::vec3& viewerPosition) {
+		std::vector<uint32> visible;
+		visible.reserve(meshlets.size());
+
+		for (uint32 m = 0; m < meshlets.size(); m++) {
+			auto& meshlet = meshlets[m];
+
+			bool outside = false;
+			for (auto& plane : frustum.planes) {
+				if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius) {
+					outside = true;
+					break;
+				}
+			}
+			if (outside) continue;
+
+			glm::vec3 toCenter = meshlet.center - viewerPosition;
+			if (meshlet.coneCutoff < 1.0f && glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius) continue;
+
+			visible.push_back(m);
+		}
+
+		return visible;
+	}
+
+	std::vector<uint32> cull_meshlets(const std::vector<Meshlet>& meshlets, const Camera& camera, const glm::mat4& model) {
+		// Cull in mesh space, which only needs the frustum and the camera transformed instead of every meshlet
+		Frustum frustum = frustum_from_matrix(camera.projection * camera.getViewMatrix() * model);
+		glm::vec3 viewerPosition = glm::vec3(glm::inverse(model) * glm::vec4(camera.transform.position, 1.0f));
+
+		return cull_meshlets(meshlets, frustum, viewerPosition);
+	}
+}
\ No newline at end of file
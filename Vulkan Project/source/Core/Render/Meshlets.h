@@ -0,0 +1,55 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <Core/Render/Mesh.h>
+#include <Core/Render/Camera.h>
+#include <vector>
+
+/*
+	Partitioning of meshes into small clusters of triangles (meshlets) that can be culled individually.
+
+	Meshlets are consecutive runs of the index buffer, so they are drawn from the existing vertex and index buffers
+	with drawIndexed(meshlet.triangleCount * 3, 1, meshlet.firstIndex, 0, 0) and do not need their own copy of the
+	geometry. Building them after MeshUtil::optimize_vertex_cache keeps them spatially compact.
+*/
+
+namespace MeshUtil {
+	constexpr uint32 MAX_MESHLET_VERTICES = 64;
+	constexpr uint32 MAX_MESHLET_TRIANGLES = 126;
+
+	// Laid out for std430, so an array of meshlets can be uploaded to a storage buffer as is
+	struct Meshlet {
+		// Bounding sphere in mesh space
+		glm::vec3 center;
+		float radius;
+
+		// Cone containing the normals of all triangles. Every triangle faces away from a viewer for which
+		// dot(center - viewer, coneAxis) >= coneCutoff * length(center - viewer) + radius. A cutoff of 1 never culls
+		glm::vec3 coneAxis;
+		float coneCutoff;
+
+		// Range of the index buffer the meshlet covers
+		uint32 firstIndex;
+		uint32 triangleCount;
+		uint32 vertexCount;
+		uint32 padding;
+	};
+
+	static_assert(sizeof(Meshlet) == 48, "Meshlet must match its std430 layout");
+
+	// Splits the triangles of `mesh` into meshlets of at most `maxVertices` unique vertices and `maxTriangles` triangles,
+	// in index buffer order
+	std::vector<Meshlet> build_meshlets(const Mesh& mesh, uint32 maxVertices = MAX_MESHLET_VERTICES, uint32 maxTriangles = MAX_MESHLET_TRIANGLES);
+
+	// Planes of a view frustum, pointing inwards. Points p with dot(plane.xyz, p) + plane.w < 0 are outside of a plane
+	struct Frustum {
+		glm::vec4 planes[6];
+	};
+
+	// Extracts the frustum of a Vulkan style projection with depth in [0, 1], in the space `viewProjection` transforms from
+	Frustum frustum_from_matrix(const glm::mat4& viewProjection);
+
+	// Returns the indices of the meshlets that may be visible to a viewer at `viewerPosition`, both given in mesh space
+	std::vector<uint32> cull_meshlets(const std::vector<Meshlet>& meshlets, const Frustum& frustum, const glm::vec3& viewerPosition);
+	// Culls the meshlets of a mesh drawn with the model matrix `model`, which may only rotate, translate and scale uniformly
+	std::vector<uint32> cull_meshlets(const std::vector<Meshlet>& meshlets, const Camera& camera, const glm::mat4& model);
+}
\ No newline at end of file
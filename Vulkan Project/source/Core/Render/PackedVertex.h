@@ -0,0 +1,78 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <vulkan/vulkan.hpp>
+#include <array>
+
+// Vertex layouts a mesh can be uploaded in
+enum class VertexFormat : uint32 {
+	// Vertex, full precision floats
+	Full,
+	// PackedVertex, quantized to half the size
+	Packed
+};
+
+/*
+	16 byte vertex for meshes that do not need full float precision.
+	Positions are quantized to 16 bits within the bounds of the mesh, normals are octahedral encoded and texture coordinates
+	are half floats. Shaders restore the position from the bounds, which are passed in as push constants (see PackedBounds).
+*/
+struct PackedVertex {
+	// Unorm within the bounds of the mesh, w is unused
+	uint16 position[4];
+	// Snorm octahedral encoding
+	int16 normal[2];
+	// Half floats
+	uint16 texCoord[2];
+
+	static vk::VertexInputBindingDescription& getBindingDescription() {
+		static vk::VertexInputBindingDescription bindingDescription = {};
+
+		bindingDescription.stride = sizeof(PackedVertex);
+		bindingDescription.binding = 0;
+		bindingDescription.inputRate = vk::VertexInputRate::eVertex;
+
+		return bindingDescription;
+	}
+
+	static std::array<vk::VertexInputAttributeDescription, 3>& getAttributeDescriptions() {
+		static std::array<vk::VertexInputAttributeDescription, 3> attributeDescriptions = {};
+
+		attributeDescriptions[0].binding = 0;
+		attributeDescriptions[0].location = 0;
+		attributeDescriptions[0].format = vk::Format::eR16G16B16A16Unorm;
+		attributeDescriptions[0].offset = offsetof(PackedVertex, position);
+
+		attributeDescriptions[1].binding = 0;
+		attributeDescriptions[1].location = 1;
+		attributeDescriptions[1].format = vk::Format::eR16G16Snorm;
+		attributeDescriptions[1].offset = offsetof(PackedVertex, normal);
+
+		attributeDescriptions[2].binding = 0;
+		attributeDescriptions[2].location = 2;
+		attributeDescriptions[2].format = vk::Format::eR16G16Sfloat;
+		attributeDescriptions[2].offset = offsetof(PackedVertex, texCoord);
+
+		return attributeDescriptions;
+	}
+
+	static vk::PipelineVertexInputStateCreateInfo getVertexInputState() {
+		auto& binding = PackedVertex::getBindingDescription();
+		auto& attributes = PackedVertex::getAttributeDescriptions();
+
+		vk::PipelineVertexInputStateCreateInfo createInfo;
+		createInfo.pVertexAttributeDescriptions = attributes.data();
+		createInfo.pVertexBindingDescriptions = &binding;
+		createInfo.vertexAttributeDescriptionCount = attributes.size();
+		createInfo.vertexBindingDescriptionCount = 1;
+
+		return createInfo;
+	}
+};
+
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+// Push constants used to decode the positions of packed vertices, position = min + unorm * extent
+struct PackedBounds {
+	float min[4];
+	float extent[4];
+};
\ No newline at end of file
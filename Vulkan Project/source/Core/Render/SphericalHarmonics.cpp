@@ -0,0 +1,227 @@
+#include "SphericalHarmonics.h"
+#include "HalfFloat.h"
+#include <Core/Util/WorkerPool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+#include <vector>
+
+namespace TextureUtil {
+	namespace {
+		constexpr double PI = 3.14159265358979323846;
+		// Keeps threads from starting for small maps
+		constexpr uint32 MIN_ROWS_PER_THREAD = 32;
+
+		// Normalization of each basis function
+		constexpr float BASIS_SCALE[SH_COEFFICIENT_COUNT] = { 0.282095f, 0.488603f, 0.488603f, 0.488603f, 1.092548f, 1.092548f, 0.315392f, 1.092548f, 0.546274f };
+		// Convolution with the clamped cosine lobe divided by pi, which is the same for every function of a band
+		constexpr float IRRADIANCE_SCALE[SH_COEFFICIENT_COUNT] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+
+		void basis_polynomials(float x, float y, float z, float* polynomials) {
+			polynomials[0] = 1.0f;
+			polynomials[1] = y;
+			polynomials[2] = z;
+			polynomials[3] = x;
+			polynomials[4] = x * y;
+			polynomials[5] = y * z;
+			polynomials[6] = 3.0f * z * z - 1.0f;
+			polynomials[7] = x * z;
+			polynomials[8] = x * x - y * y;
+		}
+
+		// Weighted rgba sums of a single row, one per coefficient. Rows are added up in order afterwards,
+		// so the result does not depend on how rows were spread over threads
+		struct RowSum {
+			float values[SH_COEFFICIENT_COUNT][4];
+		};
+
+		class RowAccumulator {
+		public:
+			RowAccumulator() {
+				for (auto& sum : sums) sum = _mm_setzero_ps();
+			}
+
+			void add(const float* rgba, float solidAngle, float x, float y, float z) {
+				float polynomials[SH_COEFFICIENT_COUNT];
+				basis_polynomials(x, y, z, polynomials);
+
+				__m128 weighted = _mm_mul_ps(_mm_loadu_ps(rgba), _mm_set1_ps(solidAngle));
+				for (uint32 i = 0; i < SH_COEFFICIENT_COUNT; i++) {
+					sums[i] = _mm_add_ps(sums[i], _mm_mul_ps(weighted, _mm_set1_ps(polynomials[i] * BASIS_SCALE[i])));
+				}
+			}
+
+			void store(RowSum& row) const {
+				for (uint32 i = 0; i < SH_COEFFICIENT_COUNT; i++) _mm_storeu_ps(row.values[i], sums[i]);
+			}
+
+		private:
+			__m128 sums[SH_COEFFICIENT_COUNT];
+		};
+
+		void load_row(const float* source, size_t count, float* texels) {
+			memcpy(texels, source, count * sizeof(float));
+		}
+
+		void load_row(const uint16* source, size_t count, float* texels) {
+			half_to_float(source, texels, count);
+		}
+
+		// Runs `job(row, texels)` for every row on the shared worker pool. Every worker has its own row of texels
+		template<class Job>
+		void for_each_row(uint32 rowCount, uint32 width, Job job) {
+			parallel_for(rowCount, MIN_ROWS_PER_THREAD, [&](ParallelRange& rows) {
+				std::vector<float> texels((size_t)width * 4);
+				for (uint32 row; rows.next(row);) job(row, texels.data());
+			});
+		}
+
+		SHRadiance sum_rows(const std::vector<RowSum>& rows) {
+			double sums[SH_COEFFICIENT_COUNT][3] = {};
+			for (auto& row : rows) {
+				for (uint32 i = 0; i < SH_COEFFICIENT_COUNT; i++) {
+					for (uint32 c = 0; c < 3; c++) sums[i][c] += row.values[i][c];
+				}
+			}
+
+			SHRadiance radiance;
+			for (uint32 i = 0; i < SH_COEFFICIENT_COUNT; i++) radiance.coefficients[i] = glm::vec3((float)sums[i][0], (float)sums[i][1], (float)sums[i][2]);
+			return radiance;
+		}
+
+		template<class Texel>
+		SHRadiance project_equirect(const Texel* rgba, vk::Extent2D extent) {
+			if (extent.width == 0 || extent.height == 0) throw std::invalid_argument("Can not project an empty image.");
+
+			std::vector<float> cosLongitude(extent.width), sinLongitude(extent.width);
+			for (uint32 x = 0; x < extent.width; x++) {
+				double longitude = ((x + 0.5) / extent.width - 0.5) * 2.0 * PI;
+				cosLongitude[x] = (float)std::cos(longitude);
+				sinLongitude[x] = (float)std::sin(longitude);
+			}
+
+			std::vector<RowSum> rows(extent.height);
+			for_each_row(extent.height, extent.width, [&](uint32 y, float* texels) {
+				load_row(rgba + (size_t)y * extent.width * 4, (size_t)extent.width * 4, texels);
+
+				// Every texel of a row covers the same solid angle, the band between its two latitudes split evenly
+				double top = ((double)y / extent.height - 0.5) * PI;
+				double bottom = ((y + 1.0) / extent.height - 0.5) * PI;
+				double latitude = ((y + 0.5) / extent.height - 0.5) * PI;
+				float solidAngle = (float)(2.0 * PI / extent.width * (std::sin(bottom) - std::sin(top)));
+				float cosLatitude = (float)std::cos(latitude);
+				float sinLatitude = (float)std::sin(latitude);
+
+				RowAccumulator accumulator;
+				for (uint32 x = 0; x < extent.width; x++) {
+					accumulator.add(texels + x * 4, solidAngle, cosLatitude * cosLongitude[x], sinLatitude, cosLatitude * sinLongitude[x]);
+				}
+				accumulator.store(rows[y]);
+			});
+
+			return sum_rows(rows);
+		}
+
+		// Direction through the point (u, v) of a face, both in [-1, 1] with v pointing down the face
+		glm::vec3 cube_direction(uint32 face, float u, float v) {
+			switch (face) {
+			case 0: return glm::vec3(1.0f, -v, -u);
+			case 1: return glm::vec3(-1.0f, -v, u);
+			case 2: return glm::vec3(u, 1.0f, v);
+			case 3: return glm::vec3(u, -1.0f, -v);
+			case 4: return glm::vec3(u, -v, 1.0f);
+			default: return glm::vec3(-u, -v, -1.0f);
+			}
+		}
+
+		// Solid angle of the part of a face between its center and the point (u, v), with the sign of u * v
+		double face_area(double u, double v) {
+			return std::atan2(u * v, std::sqrt(u * u + v * v + 1.0));
+		}
+
+		template<class Texel>
+		SHRadiance project_cube(const Texel* const faces[6], uint32 faceSize) {
+			if (faceSize == 0) throw std::invalid_argument("Can not project an empty cube.");
+
+			std::vector<RowSum> rows(6 * faceSize);
+			for_each_row(6 * faceSize, faceSize, [&](uint32 row, float* texels) {
+				uint32 face = row / faceSize;
+				uint32 y = row % faceSize;
+				load_row(faces[face] + (size_t)y * faceSize * 4, (size_t)faceSize * 4, texels);
+
+				double top = 2.0 * y / faceSize - 1.0;
+				double bottom = 2.0 * (y + 1) / faceSize - 1.0;
+				float v = (float)(2.0 * (y + 0.5) / faceSize - 1.0);
+
+				// Solid angle of a texel from the areas spanned by its corners, the corners are shared by neighbouring texels
+				double previousTop = face_area(-1.0, top);
+				double previousBottom = face_area(-1.0, bottom);
+
+				RowAccumulator accumulator;
+				for (uint32 x = 0; x < faceSize; x++) {
+					double right = 2.0 * (x + 1) / faceSize - 1.0;
+					double nextTop = face_area(right, top);
+					double nextBottom = face_area(right, bottom);
+					float solidAngle = (float)std::abs(nextBottom - previousBottom - nextTop + previousTop);
+					previousTop = nextTop;
+					previousBottom = nextBottom;
+
+					glm::vec3 direction = cube_direction(face, (float)(2.0 * (x + 0.5) / faceSize - 1.0), v);
+					direction = direction * (1.0f / std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z));
+					accumulator.add(texels + x * 4, solidAngle, direction.x, direction.y, direction.z);
+				}
+				accumulator.store(rows[row]);
+			});
+
+			return sum_rows(rows);
+		}
+	}
+
+	SHRadiance project_equirect_sh(const float* rgba, vk::Extent2D extent) {
+		return project_equirect(rgba, extent);
+	}
+
+	SHRadiance project_equirect_sh(const uint16* rgba, vk::Extent2D extent) {
+		return project_equirect(rgba, extent);
+	}
+
+	SHRadiance project_cube_sh(const float* const faces[6], uint32 faceSize) {
+		return project_cube(faces, faceSize);
+	}
+
+	SHRadiance project_cube_sh(const uint16* const faces[6], uint32 faceSize) {
+		return project_cube(faces, faceSize);
+	}
+
+	glm::vec3 evaluate_sh(const SHRadiance& radiance, glm::vec3 direction) {
+		float polynomials[SH_COEFFICIENT_COUNT];
+		basis_polynomials(direction.x, direction.y, direction.z, polynomials);
+
+		glm::vec3 result(0.0f);
+		for (uint32 i = 0; i < SH_COEFFICIENT_COUNT; i++) result += radiance.coefficients[i] * (polynomials[i] * BASIS_SCALE[i]);
+		return result;
+	}
+
+	SHIrradianceUniforms irradiance_uniforms(const SHRadiance& radiance) {
+		SHIrradianceUniforms irradiance;
+		for (uint32 i = 0; i < SH_COEFFICIENT_COUNT; i++) {
+			irradiance.coefficients[i] = glm::vec4(radiance.coefficients[i] * (BASIS_SCALE[i] * IRRADIANCE_SCALE[i]), 0.0f);
+		}
+
+		return irradiance;
+	}
+
+	glm::vec3 evaluate_irradiance(const SHIrradianceUniforms& irradiance, glm::vec3 normal) {
+		float polynomials[SH_COEFFICIENT_COUNT];
+		basis_polynomials(normal.x, normal.y, normal.z, polynomials);
+
+		glm::vec3 result(0.0f);
+		for (uint32 i = 0; i < SH_COEFFICIENT_COUNT; i++) {
+			result += glm::vec3(irradiance.coefficients[i].x, irradiance.coefficients[i].y, irradiance.coefficients[i].z) * polynomials[i];
+		}
+
+		return result;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+
+/*
+	Projection of environment maps onto the first nine real spherical harmonics, bands 0 to 2.
+
+	Nine coefficients reproduce the irradiance of any environment to within a few percent, so diffuse ambient light can be
+	evaluated per pixel from a small uniform block instead of convolving and sampling an irradiance cubemap.
+	Texels are weighted by the solid angle they cover. Directions follow the conventions the shaders sample with:
+	equirectangular maps as in equi_to_cube.frag and cube faces in the Vulkan order +X, -X, +Y, -Y, +Z, -Z.
+*/
+
+namespace TextureUtil {
+	constexpr uint32 SH_COEFFICIENT_COUNT = 9;
+
+	// Radiance projected onto the basis, rgb per basis function in the order
+	// 1, y, z, x, xy, yz, 3z^2 - 1, xz, x^2 - y^2
+	struct SHRadiance {
+		glm::vec3 coefficients[SH_COEFFICIENT_COUNT];
+	};
+
+	// Irradiance for the lighting pass, with the layout of a std140 uniform block of vec4[9]. The coefficients are convolved with the
+	// cosine lobe, divided by pi and have the normalization of their basis function folded in, so the shader only multiplies them with
+	// the polynomials above and gets the light a white lambertian surface reflects
+	struct SHIrradianceUniforms {
+		glm::vec4 coefficients[SH_COEFFICIENT_COUNT];
+	};
+
+	// Rgba texels, as floats or as half floats. Rows are spread over all cores
+	SHRadiance project_equirect_sh(const float* rgba, vk::Extent2D extent);
+	SHRadiance project_equirect_sh(const uint16* rgba, vk::Extent2D extent);
+	SHRadiance project_cube_sh(const float* const faces[6], uint32 faceSize);
+	SHRadiance project_cube_sh(const uint16* const faces[6], uint32 faceSize);
+
+	// Radiance the projection reconstructs for a direction
+	glm::vec3 evaluate_sh(const SHRadiance& radiance, glm::vec3 direction);
+
+	SHIrradianceUniforms irradiance_uniforms(const SHRadiance& radiance);
+	// Same evaluation as the lighting pass
+	glm::vec3 evaluate_irradiance(const SHIrradianceUniforms& irradiance, glm::vec3 normal);
+}
\ No newline at end of file
@@ -0,0 +1,838 @@
+#include "TextureCompression.h"
+#include "HalfFloat.h"
+#include <Core/Util/WorkerPool.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace TextureUtil {
+	namespace {
+		constexpr uint32 BLOCK_TEXELS = 16;
+		// Rows of blocks a thread should at least get, so small levels are not spread over more threads than it is worth
+		constexpr uint32 MIN_BLOCK_ROWS_PER_THREAD = 8;
+
+		// Weight of the second endpoint for every BC1 index, in thirds
+		constexpr float BC1_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		// Weight of the second endpoint for every 4 bit BC6H index, in 64ths
+		constexpr int32 BC6H_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+		// Mode 11 of BC6H, a single region with two 10 bit endpoints stored as is
+		constexpr uint32 BC6H_MODE = 0x03;
+		constexpr uint32 BC6H_ENDPOINT_BITS = 10;
+		constexpr float MAX_HALF = 65504.0f;
+
+		uint32 blocks_across(uint32 size) {
+			return (size + 3) / 4;
+		}
+
+		// Runs `job(blockRow)` for every row of blocks on the shared worker pool
+		template<class Job>
+		void for_each_block_row(uint32 blockRows, Job job) {
+			parallel_for_each(blockRows, MIN_BLOCK_ROWS_PER_THREAD, job);
+		}
+
+		// Copies the 4x4 texels of a block, texels past the edge of the image repeat the edge
+		template<class Component>
+		void gather_block(const Component* image, vk::Extent2D extent, uint32 blockX, uint32 blockY, Component* block) {
+			for (uint32 y = 0; y < 4; y++) {
+				uint32 sourceY = std::min(blockY * 4 + y, extent.height - 1);
+
+				for (uint32 x = 0; x < 4; x++) {
+					uint32 sourceX = std::min(blockX * 4 + x, extent.width - 1);
+					memcpy(block + (y * 4 + x) * 4, image + ((size_t)sourceY * extent.width + sourceX) * 4, sizeof(Component) * 4);
+				}
+			}
+		}
+
+		// Copies the texels of a decoded block that lie inside the image
+		template<class Component>
+		void scatter_block(const Component* block, vk::Extent2D extent, uint32 blockX, uint32 blockY, Component* image) {
+			for (uint32 y = 0; y < 4 && blockY * 4 + y < extent.height; y++) {
+				for (uint32 x = 0; x < 4 && blockX * 4 + x < extent.width; x++) {
+					memcpy(image + ((size_t)(blockY * 4 + y) * extent.width + blockX * 4 + x) * 4, block + (y * 4 + x) * 4, sizeof(Component) * 4);
+				}
+			}
+		}
+
+		// Direction along which the texels of a block vary the most, zero if they are all equal
+		glm::vec3 principal_axis(const glm::vec3* texels, glm::vec3 mean) {
+			float xx = 0, xy = 0, xz = 0, yy = 0, yz = 0, zz = 0;
+			for (uint32 i = 0; i < BLOCK_TEXELS; i++) {
+				glm::vec3 d = texels[i] - mean;
+				xx += d.x * d.x;
+				xy += d.x * d.y;
+				xz += d.x * d.z;
+				yy += d.y * d.y;
+				yz += d.y * d.z;
+				zz += d.z * d.z;
+			}
+
+			glm::vec3 columns[3] = { { xx, xy, xz }, { xy, yy, yz }, { xz, yz, zz } };
+
+			// Power iteration, starting from the column with the most variance so the start is never orthogonal to the result
+			glm::vec3 axis = columns[0];
+			if (glm::dot(columns[1], columns[1]) > glm::dot(axis, axis)) axis = columns[1];
+			if (glm::dot(columns[2], columns[2]) > glm::dot(axis, axis)) axis = columns[2];
+
+			for (int i = 0; i < 8; i++) {
+				float length = glm::length(axis);
+				if (length < 1e-12f) return glm::vec3(0.0f);
+				axis /= length;
+				axis = columns[0] * axis.x + columns[1] * axis.y + columns[2] * axis.z;
+			}
+
+			float length = glm::length(axis);
+			return length < 1e-12f ? glm::vec3(0.0f) : axis / length;
+		}
+
+		// Ends of the segment of `axis` through `mean` that the texels project onto. `first` is the far end in the direction of the axis
+		void project_extent(const glm::vec3* texels, glm::vec3 mean, glm::vec3 axis, glm::vec3& first, glm::vec3& second) {
+			float minimum = std::numeric_limits<float>::max();
+			float maximum = -std::numeric_limits<float>::max();
+
+			for (uint32 i = 0; i < BLOCK_TEXELS; i++) {
+				float t = glm::dot(texels[i] - mean, axis);
+				minimum = std::min(minimum, t);
+				maximum = std::max(maximum, t);
+			}
+
+			first = mean + axis * maximum;
+			second = mean + axis * minimum;
+		}
+
+		// Endpoints that minimize the squared error of the texels for fixed indices, given the weight of the second endpoint per texel
+		bool least_squares_endpoints(const glm::vec3* texels, const float* weights, glm::vec3& first, glm::vec3& second) {
+			float aa = 0, ab = 0, bb = 0;
+			glm::vec3 ax(0.0f), bx(0.0f);
+
+			for (uint32 i = 0; i < BLOCK_TEXELS; i++) {
+				float b = weights[i];
+				float a = 1.0f - b;
+				aa += a * a;
+				ab += a * b;
+				bb += b * b;
+				ax += a * texels[i];
+				bx += b * texels[i];
+			}
+
+			float determinant = aa * bb - ab * ab;
+			if (std::abs(determinant) < 1e-6f) return false;
+
+			first = (ax * bb - bx * ab) / determinant;
+			second = (bx * aa - ax * ab) / determinant;
+			return true;
+		}
+
+		/*
+			BC1
+		*/
+
+		uint16 pack_565(glm::vec3 color) {
+			auto quantize = [](float value, float steps) {
+				return (uint32)std::lround(std::min(std::max(value, 0.0f), 255.0f) * steps / 255.0f);
+			};
+
+			uint32 r = quantize(color.x, 31.0f);
+			uint32 g = quantize(color.y, 63.0f);
+			uint32 b = quantize(color.z, 31.0f);
+			return (uint16)(r << 11 | g << 5 | b);
+		}
+
+		glm::ivec3 unpack_565(uint16 color) {
+			int32 r = color >> 11 & 31;
+			int32 g = color >> 5 & 63;
+			int32 b = color & 31;
+			return { r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2 };
+		}
+
+		// The colors a BC1 block picks from. Blocks whose first color is not greater than the second have three colors and black,
+		// except in BC3, where the color block always has four
+		void bc1_palette(uint16 color0, uint16 color1, bool fourColors, glm::ivec3 palette[4]) {
+			palette[0] = unpack_565(color0);
+			palette[1] = unpack_565(color1);
+
+			if (fourColors) {
+				palette[2] = (2 * palette[0] + palette[1]) / 3;
+				palette[3] = (palette[0] + 2 * palette[1]) / 3;
+			}
+			else {
+				palette[2] = (palette[0] + palette[1]) / 2;
+				palette[3] = glm::ivec3(0);
+			}
+		}
+
+		struct ColorBlock {
+			uint16 color0 = 0;
+			uint16 color1 = 0;
+			// 2 bits per texel, texel 0 in the lowest bits
+			uint32 indices = 0;
+			float error = 0;
+		};
+
+		// Picks the closest of the four colors for every texel
+		void assign_color_indices(const glm::vec3* texels, ColorBlock& block) {
+			glm::ivec3 palette[4];
+			bc1_palette(block.color0, block.color1, true, palette);
+
+			block.indices = 0;
+			block.error = 0;
+			for (uint32 i = 0; i < BLOCK_TEXELS; i++) {
+				uint32 bestIndex = 0;
+				float bestError = std::numeric_limits<float>::max();
+
+				for (uint32 p = 0; p < 4; p++) {
+					glm::vec3 d = texels[i] - glm::vec3(palette[p]);
+					float error = glm::dot(d, d);
+					if (error < bestError) {
+						bestError = error;
+						bestIndex = p;
+					}
+				}
+
+				block.indices |= bestIndex << (i * 2);
+				block.error += bestError;
+			}
+		}
+
+		ColorBlock fit_color_block(const glm::vec3* texels, CompressionQuality quality) {
+			glm::vec3 mean(0.0f);
+			for (uint32 i = 0; i < BLOCK_TEXELS; i++) mean += texels[i];
+			mean /= (float)BLOCK_TEXELS;
+
+			ColorBlock best;
+			glm::vec3 axis = principal_axis(texels, mean);
+			if (axis == glm::vec3(0.0f)) {
+				best.color0 = best.color1 = pack_565(mean);
+				assign_color_indices(texels, best);
+				return best;
+			}
+
+			glm::vec3 first, second;
+			project_extent(texels, mean, axis, first, second);
+			best.color0 = pack_565(first);
+			best.color1 = pack_565(second);
+			assign_color_indices(texels, best);
+
+			// Refit the endpoints to the chosen indices until that stops helping
+			uint32 refinements = quality == CompressionQuality::Fast ? 0 : quality == CompressionQuality::Normal ? 1 : 4;
+			for (uint32 r = 0; r < refinements; r++) {
+				float weights[BLOCK_TEXELS];
+				for (uint32 i = 0; i < BLOCK_TEXELS; i++) weights[i] = BC1_WEIGHTS[best.indices >> (i * 2) & 3];
+
+				if (!least_squares_endpoints(texels, weights, first, second)) break;
+
+				ColorBlock candidate;
+				candidate.color0 = pack_565(first);
+				candidate.color1 = pack_565(second);
+				if (candidate.color0 == best.color0 && candidate.color1 == best.color1) break;
+
+				assign_color_indices(texels, candidate);
+				if (candidate.error >= best.error) break;
+				best = candidate;
+			}
+
+			// Rounding to 565 is not always the best choice, try moving every channel of both endpoints by one step
+			if (quality == CompressionQuality::High) {
+				const uint32 shifts[3] = { 11, 5, 0 };
+				const uint32 masks[3] = { 31, 63, 31 };
+
+				bool improved = true;
+				for (int pass = 0; pass < 4 && improved; pass++) {
+					improved = false;
+
+					for (int endpoint = 0; endpoint < 2; endpoint++) {
+						for (int channel = 0; channel < 3; channel++) {
+							for (int step = -1; step <= 1; step += 2) {
+								ColorBlock candidate = best;
+								uint16& color = endpoint == 0 ? candidate.color0 : candidate.color1;
+
+								int32 value = (color >> shifts[channel] & masks[channel]) + step;
+								if (value < 0 || value > (int32)masks[channel]) continue;
+								color = (uint16)((color & ~(masks[channel] << shifts[channel])) | value << shifts[channel]);
+
+								assign_color_indices(texels, candidate);
+								if (candidate.error < best.error) {
+									best = candidate;
+									improved = true;
+								}
+							}
+						}
+					}
+				}
+			}
+
+			return best;
+		}
+
+		void write_color_block(ColorBlock block, uint8* out) {
+			// Four color mode needs the first color to be greater. Swapping the endpoints swaps indices 0 and 1 as well as 2 and 3
+			if (block.color0 < block.color1) {
+				std::swap(block.color0, block.color1);
+				block.indices ^= 0x55555555;
+			}
+			else if (block.color0 == block.color1) {
+				block.indices = 0;
+			}
+
+			memcpy(out, &block.color0, sizeof(uint16));
+			memcpy(out + 2, &block.color1, sizeof(uint16));
+			memcpy(out + 4, &block.indices, sizeof(uint32));
+		}
+
+		void read_color_block(const uint8* in, bool alwaysFourColors, uint8* texels) {
+			uint16 color0, color1;
+			uint32 indices;
+			memcpy(&color0, in, sizeof(uint16));
+			memcpy(&color1, in + 2, sizeof(uint16));
+			memcpy(&indices, in + 4, sizeof(uint32));
+
+			bool fourColors = alwaysFourColors || color0 > color1;
+			glm::ivec3 palette[4];
+			bc1_palette(color0, color1, fourColors, palette);
+
+			for (uint32 i = 0; i < BLOCK_TEXELS; i++) {
+				uint32 index = indices >> (i * 2) & 3;
+				texels[i * 4 + 0] = (uint8)palette[index].x;
+				texels[i * 4 + 1] = (uint8)palette[index].y;
+				texels[i * 4 + 2] = (uint8)palette[index].z;
+				texels[i * 4 + 3] = !fourColors && index == 3 ? 0 : 255;
+			}
+		}
+
+		/*
+			BC4, the single channel block of BC3 and BC5
+		*/
+
+		// Blocks whose first value is greater interpolate 6 values between them, the others 4 and add 0 and 255
+		void bc4_palette(uint8 value0, uint8 value1, int32 palette[8]) {
+			palette[0] = value0;
+			palette[1] = value1;
+
+			if (value0 > value1) {
+				for (int32 k = 1; k <= 6; k++) palette[k + 1] = ((7 - k) * value0 + k * value1 + 3) / 7;
+			}
+			else {
+				for (int32 k = 1; k <= 4; k++) palette[k + 1] = ((5 - k) * value0 + k * value1 + 2) / 5;
+				palette[6] = 0;
+				palette[7] = 255;
+			}
+		}
+
+		struct ChannelBlock {
+			uint8 value0 = 0;
+			uint8 value1 = 0;
+			// 3 bits per texel, texel 0 in the lowest bits
+			uint64 indices = 0;
+			int32 error = 0;
+		};
+
+		void assign_channel_indices(const uint8* values, ChannelBlock& block) {
+			int32 palette[8];
+			bc4_palette(block.value0, block.value1, palette);
+
+			block.indices = 0;
+			block.error = 0;
+			for (uint32 i = 0; i < BLOCK_TEXELS; i++) {
+				uint64 bestIndex = 0;
+				int32 bestError = std::numeric_limits<int32>::max();
+
+				for (uint32 p = 0; p < 8; p++) {
+					int32 error = (values[i] - palette[p]) * (values[i] - palette[p]);
+					if (error < bestError) {
+						bestError = error;
+						bestIndex = p;
+					}
+				}
+
+				block.indices |= bestIndex << (i * 3);
+				block.error += bestError;
+			}
+		}
+
+		ChannelBlock fit_channel_block(const uint8* values, CompressionQuality quality) {
+			uint8 minimum = 255, maximum = 0;
+			// Extremes of the values that are not 0 or 255, for the mode that has those two built in
+			uint8 innerMinimum = 255, innerMaximum = 0;
+
+			for (uint32 i = 0; i < BLOCK_TEXELS; i++) {
+				minimum = std::min(minimum, values[i]);
+				maximum = std::max(maximum, values[i]);
+
+				if (values[i] != 0 && values[i] != 255) {
+					innerMinimum = std::min(innerMinimum, values[i]);
+					innerMaximum = std::max(innerMaximum, values[i]);
+				}
+			}
+
+			ChannelBlock best;
+			best.value0 = best.value1 = minimum;
+			if (minimum == maximum) return best;
+
+			best.value0 = maximum;
+			best.value1 = minimum;
+			assign_channel_indices(values, best);
+
+			auto consider = [&](int32 value0, int32 value1) {
+				if (value0 < 0 || value0 > 255 || value1 < 0 || value1 > 255) return;
+
+				ChannelBlock candidate;
+				candidate.value0 = (uint8)value0;
+				candidate.value1 = (uint8)value1;
+				assign_channel_indices(values, candidate);
+				if (candidate.error < best.error) best = candidate;
+			};
+
+			if (quality != CompressionQuality::Fast && innerMinimum <= innerMaximum) {
+				consider(innerMinimum, innerMaximum);
+			}
+
+			// Interpolated values round, so endpoints just inside or outside the range can fit better
+			if (quality == CompressionQuality::High) {
+				for (int32 d0 = -2; d0 <= 2; d0++) {
+					for (int32 d1 = -2; d1 <= 2; d1++) {
+						if (maximum + d0 > minimum + d1) consider(maximum + d0, minimum + d1);
+						if (innerMinimum <= innerMaximum && innerMinimum + d0 <= innerMaximum + d1) consider(innerMinimum + d0, innerMaximum + d1);
+					}
+				}
+			}
+
+			return best;
+		}
+
+		void write_channel_block(const ChannelBlock& block, uint8* out) {
+			out[0] = block.value0;
+			out[1] = block.value1;
+			for (uint32 i = 0; i < 6; i++) out[2 + i] = (uint8)(block.indices >> (i * 8));
+		}
+
+		// Decodes into `channel` of 16 rgba8 texels
+		void read_channel_block(const uint8* in, uint8* texels, uint32 channel) {
+			int32 palette[8];
+			bc4_palette(in[0], in[1], palette);
+
+			uint64 indices = 0;
+			for (uint32 i = 0; i < 6; i++) indices |= (uint64)in[2 + i] << (i * 8);
+
+			for (uint32 i = 0; i < BLOCK_TEXELS; i++) texels[i * 4 + channel] = (uint8)palette[indices >> (i * 3) & 7];
+		}
+
+		/*
+			BC6H
+		*/
+
+		class BitWriter {
+		public:
+			explicit BitWriter(uint8* t_block) : block(t_block) {
+				memset(block, 0, 16);
+			}
+
+			void write(uint32 value, uint32 count) {
+				for (uint32 i = 0; i < count; i++, position++) {
+					if (value >> i & 1) block[position / 8] |= (uint8)(1 << position % 8);
+				}
+			}
+
+		private:
+			uint8* block;
+			uint32 position = 0;
+		};
+
+		class BitReader {
+		public:
+			explicit BitReader(const uint8* t_block) : block(t_block) { }
+
+			uint32 read(uint32 count) {
+				uint32 value = 0;
+				for (uint32 i = 0; i < count; i++, position++) {
+					value |= (uint32)(block[position / 8] >> position % 8 & 1) << i;
+				}
+				return value;
+			}
+
+		private:
+			const uint8* block;
+			uint32 position = 0;
+		};
+
+		int32 bc6h_unquantize(int32 value) {
+			if (value == 0) return 0;
+			if (value == (1 << BC6H_ENDPOINT_BITS) - 1) return 0xFFFF;
+			return ((value << 16) + 0x8000) >> BC6H_ENDPOINT_BITS;
+		}
+
+		// Inverse of unquantizing followed by the final scale to half float bits
+		int32 bc6h_quantize(float halfBits) {
+			float unquantized = halfBits * 64.0f / 31.0f;
+			return std::min(std::max((int32)std::lround((unquantized - 32.0f) / 64.0f), 0), (1 << BC6H_ENDPOINT_BITS) - 1);
+		}
+
+		// Texels of a BC6H block as the bit patterns of their unsigned half floats, which is what the format interpolates
+		glm::vec3 half_bits(const float* rgb) {
+			glm::vec3 bits;
+			for (int c = 0; c < 3; c++) {
+				float value = rgb[c] > 0.0f ? std::min(rgb[c], MAX_HALF) : 0.0f;
+				bits[c] = (float)glm::packHalf1x16(value);
+			}
+			return bits;
+		}
+
+		struct HdrBlock {
+			glm::ivec3 endpoint0 = glm::ivec3(0);
+			glm::ivec3 endpoint1 = glm::ivec3(0);
+			uint8 indices[BLOCK_TEXELS] = {};
+			float error = 0;
+		};
+
+		void bc6h_palette(glm::ivec3 endpoint0, glm::ivec3 endpoint1, glm::ivec3 palette[16]) {
+			for (int c = 0; c < 3; c++) {
+				int32 a = bc6h_unquantize(endpoint0[c]);
+				int32 b = bc6h_unquantize(endpoint1[c]);
+
+				for (uint32 i = 0; i < 16; i++) {
+					int32 interpolated = ((64 - BC6H_WEIGHTS[i]) * a + BC6H_WEIGHTS[i] * b + 32) >> 6;
+					palette[i][c] = (interpolated * 31) >> 6;
+				}
+			}
+		}
+
+		void assign_hdr_indices(const glm::vec3* texels, HdrBlock& block) {
+			glm::ivec3 palette[16];
+			bc6h_palette(block.endpoint0, block.endpoint1, palette);
+
+			block.error = 0;
+			for (uint32 i = 0; i < BLOCK_TEXELS; i++) {
+				uint8 bestIndex = 0;
+				float bestError = std::numeric_limits<float>::max();
+
+				for (uint8 p = 0; p < 16; p++) {
+					glm::vec3 d = texels[i] - glm::vec3(palette[p]);
+					float error = glm::dot(d, d);
+					if (error < bestError) {
+						bestError = error;
+						bestIndex = p;
+					}
+				}
+
+				block.indices[i] = bestIndex;
+				block.error += bestError;
+			}
+		}
+
+		glm::ivec3 quantize_endpoint(glm::vec3 halfBits) {
+			return { bc6h_quantize(halfBits.x), bc6h_quantize(halfBits.y), bc6h_quantize(halfBits.z) };
+		}
+
+		// Same approach as fit_color_block, on half float bit patterns
+		HdrBlock fit_hdr_block(const glm::vec3* texels, CompressionQuality quality) {
+			glm::vec3 mean(0.0f);
+			for (uint32 i = 0; i < BLOCK_TEXELS; i++) mean += texels[i];
+			mean /= (float)BLOCK_TEXELS;
+
+			HdrBlock best;
+			glm::vec3 axis = principal_axis(texels, mean);
+			if (axis == glm::vec3(0.0f)) {
+				best.endpoint0 = best.endpoint1 = quantize_endpoint(mean);
+				assign_hdr_indices(texels, best);
+				return best;
+			}
+
+			glm::vec3 first, second;
+			project_extent(texels, mean, axis, first, second);
+			best.endpoint0 = quantize_endpoint(first);
+			best.endpoint1 = quantize_endpoint(second);
+			assign_hdr_indices(texels, best);
+
+			uint32 refinements = quality == CompressionQuality::Fast ? 0 : quality == CompressionQuality::Normal ? 1 : 4;
+			for (uint32 r = 0; r < refinements; r++) {
+				float weights[BLOCK_TEXELS];
+				for (uint32 i = 0; i < BLOCK_TEXELS; i++) weights[i] = BC6H_WEIGHTS[best.indices[i]] / 64.0f;
+
+				if (!least_squares_endpoints(texels, weights, first, second)) break;
+
+				HdrBlock candidate;
+				candidate.endpoint0 = quantize_endpoint(first);
+				candidate.endpoint1 = quantize_endpoint(second);
+				if (candidate.endpoint0 == best.endpoint0 && candidate.endpoint1 == best.endpoint1) break;
+
+				assign_hdr_indices(texels, candidate);
+				if (candidate.error >= best.error) break;
+				best = candidate;
+			}
+
+			if (quality == CompressionQuality::High) {
+				bool improved = true;
+				for (int pass = 0; pass < 4 && improved; pass++) {
+					improved = false;
+
+					for (int endpoint = 0; endpoint < 2; endpoint++) {
+						for (int channel = 0; channel < 3; channel++) {
+							for (int step = -1; step <= 1; step += 2) {
+								HdrBlock candidate = best;
+								int32& value = endpoint == 0 ? candidate.endpoint0[channel] : candidate.endpoint1[channel];
+
+								value += step;
+								if (value < 0 || value >= (1 << BC6H_ENDPOINT_BITS)) continue;
+
+								assign_hdr_indices(texels, candidate);
+								if (candidate.error < best.error) {
+									best = candidate;
+									improved = true;
+								}
+							}
+						}
+					}
+				}
+			}
+
+			return best;
+		}
+
+		void write_hdr_block(HdrBlock block, uint8* out) {
+			// The index of the first texel has one bit less and must leave it 0. Swapping the endpoints mirrors all indices
+			if (block.indices[0] >= 8) {
+				std::swap(block.endpoint0, block.endpoint1);
+				for (auto& index : block.indices) index = 15 - index;
+			}
+
+			BitWriter bits(out);
+			bits.write(BC6H_MODE, 5);
+			for (int c = 0; c < 3; c++) bits.write(block.endpoint0[c], BC6H_ENDPOINT_BITS);
+			for (int c = 0; c < 3; c++) bits.write(block.endpoint1[c], BC6H_ENDPOINT_BITS);
+
+			bits.write(block.indices[0], 3);
+			for (uint32 i = 1; i < BLOCK_TEXELS; i++) bits.write(block.indices[i], 4);
+		}
+
+		void read_hdr_block(const uint8* in, float* texels) {
+			BitReader bits(in);
+			if (bits.read(5) != BC6H_MODE) throw std::runtime_error("Decoding BC6H failed. Only single region blocks with 10 bit endpoints are supported.");
+
+			glm::ivec3 endpoint0, endpoint1;
+			for (int c = 0; c < 3; c++) endpoint0[c] = bits.read(BC6H_ENDPOINT_BITS);
+			for (int c = 0; c < 3; c++) endpoint1[c] = bits.read(BC6H_ENDPOINT_BITS);
+
+			glm::ivec3 palette[16];
+			bc6h_palette(endpoint0, endpoint1, palette);
+
+			for (uint32 i = 0; i < BLOCK_TEXELS; i++) {
+				uint32 index = bits.read(i == 0 ? 3 : 4);
+				for (int c = 0; c < 3; c++) texels[i * 4 + c] = glm::unpackHalf1x16((uint16)palette[index][c]);
+				texels[i * 4 + 3] = 1.0f;
+			}
+		}
+
+		void compress_block(const uint8* texels, BlockFormat format, CompressionQuality quality, uint8* out) {
+			auto channel = [&](uint32 c, uint8* values) {
+				for (uint32 i = 0; i < BLOCK_TEXELS; i++) values[i] = texels[i * 4 + c];
+			};
+
+			if (format == BlockFormat::BC1 || format == BlockFormat::BC3) {
+				glm::vec3 colors[BLOCK_TEXELS];
+				for (uint32 i = 0; i < BLOCK_TEXELS; i++) colors[i] = glm::vec3(texels[i * 4], texels[i * 4 + 1], texels[i * 4 + 2]);
+
+				if (format == BlockFormat::BC1) {
+					write_color_block(fit_color_block(colors, quality), out);
+				}
+				else {
+					uint8 alpha[BLOCK_TEXELS];
+					channel(3, alpha);
+					write_channel_block(fit_channel_block(alpha, quality), out);
+					write_color_block(fit_color_block(colors, quality), out + 8);
+				}
+			}
+			else {
+				uint8 values[BLOCK_TEXELS];
+				channel(0, values);
+				write_channel_block(fit_channel_block(values, quality), out);
+				channel(1, values);
+				write_channel_block(fit_channel_block(values, quality), out + 8);
+			}
+		}
+
+		void decompress_block(const uint8* in, BlockFormat format, uint8* texels) {
+			switch (format) {
+			case BlockFormat::BC1:
+				read_color_block(in, false, texels);
+				break;
+			case BlockFormat::BC3:
+				read_color_block(in + 8, true, texels);
+				read_channel_block(in, texels, 3);
+				break;
+			case BlockFormat::BC5:
+				read_channel_block(in, texels, 0);
+				read_channel_block(in + 8, texels, 1);
+				for (uint32 i = 0; i < BLOCK_TEXELS; i++) {
+					texels[i * 4 + 2] = 0;
+					texels[i * 4 + 3] = 255;
+				}
+				break;
+			default:
+				throw std::invalid_argument("BC6H decodes to floats, see decompress_image_hdr.");
+			}
+		}
+	}
+
+	uint32 block_bytes(BlockFormat format) {
+		return format == BlockFormat::BC1 ? 8 : 16;
+	}
+
+	vk::Format block_vk_format(BlockFormat format, bool srgb) {
+		switch (format) {
+		case BlockFormat::BC1: return srgb ? vk::Format::eBc1RgbaSrgbBlock : vk::Format::eBc1RgbaUnormBlock;
+		case BlockFormat::BC3: return srgb ? vk::Format::eBc3SrgbBlock : vk::Format::eBc3UnormBlock;
+		case BlockFormat::BC5: return vk::Format::eBc5UnormBlock;
+		default: return vk::Format::eBc6HUfloatBlock;
+		}
+	}
+
+	const char* block_format_name(BlockFormat format) {
+		switch (format) {
+		case BlockFormat::BC1: return "BC1";
+		case BlockFormat::BC3: return "BC3";
+		case BlockFormat::BC5: return "BC5";
+		default: return "BC6H";
+		}
+	}
+
+	std::vector<uint8> compress_image(const uint8* rgba, vk::Extent2D extent, BlockFormat format, CompressionQuality quality) {
+		if (format == BlockFormat::BC6H) throw std::invalid_argument("BC6H compresses float images, see compress_image_hdr.");
+
+		uint32 blocksX = blocks_across(extent.width);
+		uint32 blockSize = block_bytes(format);
+		std::vector<uint8> blocks((size_t)blocksX * blocks_across(extent.height) * blockSize);
+
+		for_each_block_row(blocks_across(extent.height), [&](uint32 blockY) {
+			uint8 texels[BLOCK_TEXELS * 4];
+
+			for (uint32 blockX = 0; blockX < blocksX; blockX++) {
+				gather_block(rgba, extent, blockX, blockY, texels);
+				compress_block(texels, format, quality, &blocks[((size_t)blockY * blocksX + blockX) * blockSize]);
+			}
+		});
+
+		return blocks;
+	}
+
+	std::vector<uint8> compress_image_hdr(const float* rgba, vk::Extent2D extent, CompressionQuality quality) {
+		uint32 blocksX = blocks_across(extent.width);
+		std::vector<uint8> blocks((size_t)blocksX * blocks_across(extent.height) * block_bytes(BlockFormat::BC6H));
+
+		for_each_block_row(blocks_across(extent.height), [&](uint32 blockY) {
+			float texels[BLOCK_TEXELS * 4];
+			glm::vec3 halfTexels[BLOCK_TEXELS];
+
+			for (uint32 blockX = 0; blockX < blocksX; blockX++) {
+				gather_block(rgba, extent, blockX, blockY, texels);
+				for (uint32 i = 0; i < BLOCK_TEXELS; i++) halfTexels[i] = half_bits(texels + i * 4);
+
+				write_hdr_block(fit_hdr_block(halfTexels, quality), &blocks[((size_t)blockY * blocksX + blockX) * 16]);
+			}
+		});
+
+		return blocks;
+	}
+
+	MipChain compress_mip_chain(const MipChain& chain, BlockFormat format, CompressionQuality quality) {
+		bool half = chain.format == vk::Format::eR16G16B16A16Sfloat;
+		bool hdr = half || chain.format == vk::Format::eR32G32B32A32Sfloat;
+		bool srgb = chain.format == vk::Format::eR8G8B8A8Srgb;
+		if ((format == BlockFormat::BC6H) != hdr || (!hdr && !srgb && chain.format != vk::Format::eR8G8B8A8Unorm)) {
+			throw std::invalid_argument(std::string("Can not compress the texels of this mip chain to ") + block_format_name(format) + ".");
+		}
+
+		MipChain compressed;
+		compressed.format = block_vk_format(format, srgb);
+		compressed.levels = chain.levels;
+
+		std::vector<std::vector<uint8>> levels;
+		size_t size = 0;
+		for (auto& level : compressed.levels) {
+			const uint8* texels = chain.data.data() + level.offset;
+
+			if (half) {
+				std::vector<float> floats((size_t)level.extent.width * level.extent.height * 4);
+				half_to_float((const uint16*)texels, floats.data(), floats.size());
+				levels.push_back(compress_image_hdr(floats.data(), level.extent, quality));
+			}
+			else {
+				levels.push_back(hdr ? compress_image_hdr((const float*)texels, level.extent, quality) : compress_image(texels, level.extent, format, quality));
+			}
+
+			level.offset = size;
+			level.size = levels.back().size();
+			size += level.size;
+		}
+
+		compressed.data.reserve(size);
+		for (auto& level : levels) compressed.data.insert(compressed.data.end(), level.begin(), level.end());
+
+		return compressed;
+	}
+
+	std::vector<uint8> decompress_image(const uint8* blocks, vk::Extent2D extent, BlockFormat format) {
+		uint32 blocksX = blocks_across(extent.width);
+		std::vector<uint8> rgba((size_t)extent.width * extent.height * 4);
+
+		uint8 texels[BLOCK_TEXELS * 4];
+		for (uint32 blockY = 0; blockY < blocks_across(extent.height); blockY++) {
+			for (uint32 blockX = 0; blockX < blocksX; blockX++) {
+				decompress_block(blocks + ((size_t)blockY * blocksX + blockX) * block_bytes(format), format, texels);
+				scatter_block(texels, extent, blockX, blockY, rgba.data());
+			}
+		}
+
+		return rgba;
+	}
+
+	std::vector<float> decompress_image_hdr(const uint8* blocks, vk::Extent2D extent) {
+		uint32 blocksX = blocks_across(extent.width);
+		std::vector<float> rgba((size_t)extent.width * extent.height * 4);
+
+		float texels[BLOCK_TEXELS * 4];
+		for (uint32 blockY = 0; blockY < blocks_across(extent.height); blockY++) {
+			for (uint32 blockX = 0; blockX < blocksX; blockX++) {
+				read_hdr_block(blocks + ((size_t)blockY * blocksX + blockX) * 16, texels);
+				scatter_block(texels, extent, blockX, blockY, rgba.data());
+			}
+		}
+
+		return rgba;
+	}
+
+	float psnr(const uint8* reference, const uint8* image, size_t texelCount, uint32 channelCount) {
+		double squaredError = 0;
+		for (size_t i = 0; i < texelCount; i++) {
+			for (uint32 c = 0; c < channelCount; c++) {
+				double d = (double)reference[i * 4 + c] - image[i * 4 + c];
+				squaredError += d * d;
+			}
+		}
+
+		if (squaredError == 0) return std::numeric_limits<float>::infinity();
+		return (float)(10.0 * std::log10(255.0 * 255.0 / (squaredError / (texelCount * channelCount))));
+	}
+
+	float psnr_hdr(const float* reference, const float* image, size_t texelCount) {
+		auto map = [](float value) {
+			return std::log2(1.0f + std::max(value, 0.0f));
+		};
+
+		double squaredError = 0;
+		float peak = 0;
+		for (size_t i = 0; i < texelCount; i++) {
+			for (uint32 c = 0; c < 3; c++) {
+				float expected = map(reference[i * 4 + c]);
+				double d = expected - map(image[i * 4 + c]);
+				squaredError += d * d;
+				peak = std::max(peak, expected);
+			}
+		}
+
+		if (squaredError == 0) return std::numeric_limits<float>::infinity();
+		return (float)(10.0 * std::log10((double)peak * peak / (squaredError / (texelCount * 3))));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <Core/Render/TextureProcessing.h>
+#include <vector>
+
+/*
+	Block compression of textures into the BCn formats every desktop gpu samples natively.
+
+	Images are split into blocks of 4x4 texels, blocks at the right and bottom edge repeat the edge texels.
+	BC1 stores rgb in 8 bytes per block and is used for opaque color, BC3 adds an 8 byte alpha block.
+	BC5 stores two independent channels in 16 bytes, which suits tangent space normals whose z is reconstructed.
+	BC6H stores unsigned half float rgb in 16 bytes per block. Only its single region mode with 10 bit endpoints
+	is written, which is the mode that never loses range and still beats 8 bit rgb for most environment maps.
+*/
+
+namespace TextureUtil {
+	enum class BlockFormat {
+		BC1,
+		BC3,
+		BC5,
+		BC6H
+	};
+
+	enum class CompressionQuality {
+		// Endpoints from the extent of each block along its principal axis
+		Fast,
+		// Endpoints along the principal axis of each block, refined once by least squares
+		Normal,
+		// Several refinements and a search of neighbouring quantized endpoints
+		High
+	};
+
+	uint32 block_bytes(BlockFormat format);
+	vk::Format block_vk_format(BlockFormat format, bool srgb);
+	const char* block_format_name(BlockFormat format);
+
+	// Compresses an rgba8 image. BC1 ignores alpha and BC5 keeps red and green only.
+	// Rows of blocks are spread over all cores
+	std::vector<uint8> compress_image(const uint8* rgba, vk::Extent2D extent, BlockFormat format, CompressionQuality quality);
+	// Compresses an image of rgba floats to BC6H, alpha is dropped
+	std::vector<uint8> compress_image_hdr(const float* rgba, vk::Extent2D extent, CompressionQuality quality);
+	// Compresses every level of a chain generated by generate_mip_chain, or of one generated by generate_mip_chain_hdr or
+	// generate_mip_chain_half for BC6H
+	MipChain compress_mip_chain(const MipChain& chain, BlockFormat format, CompressionQuality quality);
+
+	// Decoders for measuring the quality of the encoders. The BC6H decoder only reads the mode compress_image_hdr writes
+	std::vector<uint8> decompress_image(const uint8* blocks, vk::Extent2D extent, BlockFormat format);
+	std::vector<float> decompress_image_hdr(const uint8* blocks, vk::Extent2D extent);
+
+	// Peak signal to noise ratio in dB over the first `channelCount` channels of rgba8 texels, infinite for identical images
+	float psnr(const uint8* reference, const uint8* image, size_t texelCount, uint32 channelCount);
+	// Peak signal to noise ratio of rgb after mapping values with log2(1 + x), which weighs errors by their visibility across the range
+	float psnr_hdr(const float* reference, const float* image, size_t texelCount);
+}
\ No newline at end of file
@@ -0,0 +1,377 @@
+#include "TextureProcessing.h"
+#include "HalfFloat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace TextureUtil {
+	namespace {
+		// Support of the Kaiser filter in destination texels on either side, and the shape parameter of its window
+		constexpr float KAISER_RADIUS = 2.0f;
+		constexpr float KAISER_ALPHA = 4.0f;
+		// Resolution of the table encoding linear values to srgb, which keeps its rounding error below a fifth of a code
+		constexpr uint32 SRGB_ENCODE_STEPS = 1 << 14;
+
+		float srgb_to_linear(float c) {
+			return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+
+		float linear_to_srgb(float c) {
+			return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+		}
+
+		struct ColorTables {
+			float decode[256];
+			uint8 encode[SRGB_ENCODE_STEPS + 1];
+
+			ColorTables() {
+				for (uint32 i = 0; i < 256; i++) decode[i] = srgb_to_linear(i / 255.0f);
+				for (uint32 i = 0; i <= SRGB_ENCODE_STEPS; i++) encode[i] = (uint8)std::lround(linear_to_srgb((float)i / SRGB_ENCODE_STEPS) * 255.0f);
+			}
+		};
+
+		const ColorTables& color_tables() {
+			static const ColorTables tables;
+			return tables;
+		}
+
+		// Premultiplied linear rgba, four floats per texel
+		struct LinearImage {
+			vk::Extent2D extent;
+			std::vector<float> texels;
+		};
+
+		void decode_texels(const uint8* rgba, size_t count, bool srgb, float* texels) {
+			auto& tables = color_tables();
+
+			const __m128 byteScale = _mm_set1_ps(1.0f / 255.0f);
+			for (size_t i = 0; i < count; i++) {
+				const uint8* texel = rgba + i * 4;
+				float alpha = texel[3] / 255.0f;
+
+				__m128 color = srgb
+					? _mm_set_ps(1.0f, tables.decode[texel[2]], tables.decode[texel[1]], tables.decode[texel[0]])
+					: _mm_mul_ps(_mm_set_ps(255.0f, texel[2], texel[1], texel[0]), byteScale);
+
+				_mm_storeu_ps(texels + i * 4, _mm_mul_ps(color, _mm_set1_ps(alpha)));
+			}
+		}
+
+		void encode_image(const LinearImage& image, bool srgb, uint8* rgba) {
+			auto& tables = color_tables();
+
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+			// Selects the alpha lane
+			const __m128 alphaLane = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+			const __m128 scale = srgb ? _mm_set_ps(255.0f, SRGB_ENCODE_STEPS, SRGB_ENCODE_STEPS, SRGB_ENCODE_STEPS) : _mm_set1_ps(255.0f);
+
+			for (size_t i = 0; i < (size_t)image.extent.width * image.extent.height; i++) {
+				__m128 texel = _mm_loadu_ps(&image.texels[i * 4]);
+				__m128 alpha = _mm_shuffle_ps(texel, texel, _MM_SHUFFLE(3, 3, 3, 3));
+
+				// Undo the alpha weighting, fully transparent texels end up black
+				__m128 visible = _mm_cmpgt_ps(alpha, zero);
+				__m128 inverseAlpha = _mm_and_ps(visible, _mm_div_ps(one, _mm_max_ps(alpha, _mm_set1_ps(1e-20f))));
+				texel = _mm_mul_ps(texel, _mm_or_ps(_mm_and_ps(alphaLane, one), _mm_andnot_ps(alphaLane, inverseAlpha)));
+
+				// Sharpening filters overshoot, clamp before quantizing
+				texel = _mm_min_ps(_mm_max_ps(texel, zero), one);
+				__m128i quantized = _mm_cvtps_epi32(_mm_mul_ps(texel, scale));
+
+				uint8* out = rgba + i * 4;
+				if (srgb) {
+					alignas(16) int32 steps[4];
+					_mm_store_si128((__m128i*)steps, quantized);
+
+					out[0] = tables.encode[steps[0]];
+					out[1] = tables.encode[steps[1]];
+					out[2] = tables.encode[steps[2]];
+					out[3] = (uint8)steps[3];
+				}
+				else {
+					__m128i bytes = _mm_packus_epi16(_mm_packs_epi32(quantized, quantized), quantized);
+					int32 packed = _mm_cvtsi128_si32(bytes);
+					memcpy(out, &packed, 4);
+				}
+			}
+		}
+
+		// Float images only need the alpha weighting, there is no range to clamp to besides not going negative
+		void decode_texels_hdr(const float* rgba, size_t count, float* texels) {
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 alphaLane = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+
+			for (size_t i = 0; i < count; i++) {
+				__m128 texel = _mm_max_ps(_mm_loadu_ps(rgba + i * 4), zero);
+				__m128 alpha = _mm_shuffle_ps(texel, texel, _MM_SHUFFLE(3, 3, 3, 3));
+				_mm_storeu_ps(texels + i * 4, _mm_mul_ps(texel, _mm_or_ps(_mm_and_ps(alphaLane, one), _mm_andnot_ps(alphaLane, alpha))));
+			}
+		}
+
+		void encode_image_hdr(const LinearImage& image, float* rgba) {
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 alphaLane = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+
+			for (size_t i = 0; i < (size_t)image.extent.width * image.extent.height; i++) {
+				__m128 texel = _mm_max_ps(_mm_loadu_ps(&image.texels[i * 4]), zero);
+				__m128 alpha = _mm_shuffle_ps(texel, texel, _MM_SHUFFLE(3, 3, 3, 3));
+
+				__m128 visible = _mm_cmpgt_ps(alpha, zero);
+				__m128 inverseAlpha = _mm_and_ps(visible, _mm_div_ps(one, _mm_max_ps(alpha, _mm_set1_ps(1e-20f))));
+				texel = _mm_mul_ps(texel, _mm_or_ps(_mm_and_ps(alphaLane, one), _mm_andnot_ps(alphaLane, inverseAlpha)));
+				_mm_storeu_ps(rgba + i * 4, _mm_min_ps(texel, _mm_or_ps(_mm_and_ps(alphaLane, one), _mm_andnot_ps(alphaLane, _mm_set1_ps(65504.0f)))));
+			}
+		}
+
+		float bessel_i0(float x) {
+			float sum = 1.0f;
+			float term = 1.0f;
+
+			for (int k = 1; term > sum * 1e-8f; k++) {
+				float factor = x / (2.0f * k);
+				term *= factor * factor;
+				sum += term;
+			}
+
+			return sum;
+		}
+
+		float kaiser(float x) {
+			if (std::abs(x) >= KAISER_RADIUS) return 0.0f;
+
+			float sinc = x == 0.0f ? 1.0f : std::sin(3.14159265f * x) / (3.14159265f * x);
+			float t = x / KAISER_RADIUS;
+			return sinc * bessel_i0(KAISER_ALPHA * std::sqrt(1.0f - t * t)) / bessel_i0(KAISER_ALPHA);
+		}
+
+		// Source texels and weights contributing to each destination texel along one axis
+		struct FilterTaps {
+			uint32 maxTapCount = 0;
+			std::vector<uint32> first;
+			std::vector<uint32> count;
+			// maxTapCount weights per destination texel
+			std::vector<float> weights;
+		};
+
+		FilterTaps build_taps(uint32 sourceSize, uint32 destinationSize, MipFilter filter) {
+			float scale = (float)sourceSize / destinationSize;
+			float radius = filter == MipFilter::Box ? scale * 0.5f : KAISER_RADIUS * scale;
+
+			struct Tap {
+				uint32 first = 0;
+				std::vector<float> weights;
+			};
+			std::vector<Tap> taps(destinationSize);
+
+			FilterTaps result;
+			for (uint32 i = 0; i < destinationSize; i++) {
+				float center = (i + 0.5f) * scale;
+				int32 begin = (int32)std::floor(center - radius);
+				int32 end = (int32)std::ceil(center + radius);
+
+				// Texels outside the image are clamped to the edge, so their weight goes to the edge texel
+				auto& tap = taps[i];
+				tap.first = (uint32)std::max(begin, 0);
+				tap.weights.assign(std::min<int32>(end, sourceSize) - tap.first, 0.0f);
+
+				float sum = 0.0f;
+				for (int32 j = begin; j < end; j++) {
+					float weight;
+					if (filter == MipFilter::Box) {
+						// Coverage of the texel by the footprint of the destination texel
+						weight = std::max(0.0f, std::min<float>(j + 1.0f, center + radius) - std::max<float>((float)j, center - radius));
+					}
+					else {
+						weight = kaiser((j + 0.5f - center) / scale);
+					}
+
+					int32 clamped = std::min(std::max(j, 0), (int32)sourceSize - 1);
+					tap.weights[clamped - tap.first] += weight;
+					sum += weight;
+				}
+
+				for (auto& weight : tap.weights) weight /= sum;
+				result.maxTapCount = std::max(result.maxTapCount, (uint32)tap.weights.size());
+			}
+
+			result.first.resize(destinationSize);
+			result.count.resize(destinationSize);
+			result.weights.assign((size_t)destinationSize * result.maxTapCount, 0.0f);
+
+			for (uint32 i = 0; i < destinationSize; i++) {
+				result.first[i] = taps[i].first;
+				result.count[i] = (uint32)taps[i].weights.size();
+				std::copy(taps[i].weights.begin(), taps[i].weights.end(), result.weights.begin() + (size_t)i * result.maxTapCount);
+			}
+
+			return result;
+		}
+
+		// Resamples an image of `sourceExtent` to `extent` with a separable filter, rows first.
+		// `sourceRow(y)` returns the premultiplied linear texels of row y, rows are requested in order
+		template<class SourceRow>
+		LinearImage downsample(vk::Extent2D sourceExtent, SourceRow sourceRow, vk::Extent2D extent, MipFilter filter) {
+			FilterTaps horizontal = build_taps(sourceExtent.width, extent.width, filter);
+			FilterTaps vertical = build_taps(sourceExtent.height, extent.height, filter);
+
+			std::vector<float> rows((size_t)extent.width * sourceExtent.height * 4);
+
+			for (uint32 y = 0; y < sourceExtent.height; y++) {
+				const float* sourceTexels = sourceRow(y);
+				float* row = &rows[(size_t)y * extent.width * 4];
+
+				for (uint32 x = 0; x < extent.width; x++) {
+					const float* weights = &horizontal.weights[(size_t)x * horizontal.maxTapCount];
+					const float* texel = sourceTexels + (size_t)horizontal.first[x] * 4;
+
+					__m128 sum = _mm_setzero_ps();
+					for (uint32 t = 0; t < horizontal.count[x]; t++) {
+						sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(texel + t * 4), _mm_set1_ps(weights[t])));
+					}
+					_mm_storeu_ps(row + x * 4, sum);
+				}
+			}
+
+			LinearImage result;
+			result.extent = extent;
+			result.texels.assign((size_t)extent.width * extent.height * 4, 0.0f);
+
+			// Whole rows are accumulated at once, which walks memory linearly
+			for (uint32 y = 0; y < extent.height; y++) {
+				const float* weights = &vertical.weights[(size_t)y * vertical.maxTapCount];
+				float* destinationRow = &result.texels[(size_t)y * extent.width * 4];
+
+				for (uint32 t = 0; t < vertical.count[y]; t++) {
+					const float* row = &rows[(size_t)(vertical.first[y] + t) * extent.width * 4];
+					__m128 weight = _mm_set1_ps(weights[t]);
+
+					for (uint32 x = 0; x < extent.width; x++) {
+						_mm_storeu_ps(destinationRow + x * 4, _mm_add_ps(_mm_loadu_ps(destinationRow + x * 4), _mm_mul_ps(_mm_loadu_ps(row + x * 4), weight)));
+					}
+				}
+			}
+
+			return result;
+		}
+
+		MipChain allocate_chain(vk::Extent2D extent, vk::Format format, uint32 texelSize) {
+			if (extent.width == 0 || extent.height == 0) throw std::invalid_argument("Can not generate mips of an empty image.");
+
+			MipChain chain;
+			chain.format = format;
+			chain.levels.resize(mip_level_count(extent));
+
+			size_t size = 0;
+			vk::Extent2D levelExtent = extent;
+			for (auto& level : chain.levels) {
+				level.extent = levelExtent;
+				level.offset = size;
+				level.size = (size_t)levelExtent.width * levelExtent.height * texelSize;
+				size += level.size;
+
+				levelExtent = { std::max(levelExtent.width / 2, 1u), std::max(levelExtent.height / 2, 1u) };
+			}
+
+			chain.data.resize(size);
+			return chain;
+		}
+
+		// Fills every level below the first. `decodeRow(y, texels)` converts row y of the source to premultiplied linear floats,
+		// `encodeLevel(image, level)` stores a filtered level in the format of the chain
+		template<class DecodeRow, class EncodeLevel>
+		void filter_levels(MipChain& chain, MipFilter filter, DecodeRow decodeRow, EncodeLevel encodeLevel) {
+			if (chain.levels.size() == 1) return;
+
+			// The full size image is decoded one row at a time, so it never exists in floating point as a whole
+			vk::Extent2D extent = chain.levels[0].extent;
+			std::vector<float> decodedRow((size_t)extent.width * 4);
+			LinearImage previous = downsample(extent, [&](uint32 y) {
+				decodeRow(y, decodedRow.data());
+				return decodedRow.data();
+			}, chain.levels[1].extent, filter);
+			encodeLevel(previous, chain.data.data() + chain.levels[1].offset);
+
+			// Every further level is filtered from the one above it, which stays close to filtering the full image at a fraction of the cost
+			for (size_t i = 2; i < chain.levels.size(); i++) {
+				previous = downsample(previous.extent, [&](uint32 y) {
+					return &previous.texels[(size_t)y * previous.extent.width * 4];
+				}, chain.levels[i].extent, filter);
+				encodeLevel(previous, chain.data.data() + chain.levels[i].offset);
+			}
+		}
+	}
+
+	uint32 mip_level_count(vk::Extent2D extent) {
+		uint32 levels = 1;
+		for (uint32 size = std::max(extent.width, extent.height); size > 1; size /= 2) levels++;
+		return levels;
+	}
+
+	MipChain generate_mip_chain(const uint8* rgba, vk::Extent2D extent, MipFilter filter, bool srgb) {
+		MipChain chain = allocate_chain(extent, srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm, 4);
+		memcpy(chain.data.data(), rgba, chain.levels[0].size);
+
+		filter_levels(chain, filter, [&](uint32 y, float* texels) {
+			decode_texels(rgba + (size_t)y * extent.width * 4, extent.width, srgb, texels);
+		}, [&](const LinearImage& image, uint8* level) {
+			encode_image(image, srgb, level);
+		});
+
+		return chain;
+	}
+
+	MipChain generate_mip_chain_hdr(const float* rgba, vk::Extent2D extent, MipFilter filter) {
+		MipChain chain = allocate_chain(extent, vk::Format::eR32G32B32A32Sfloat, 16);
+		memcpy(chain.data.data(), rgba, chain.levels[0].size);
+
+		filter_levels(chain, filter, [&](uint32 y, float* texels) {
+			decode_texels_hdr(rgba + (size_t)y * extent.width * 4, extent.width, texels);
+		}, [&](const LinearImage& image, uint8* level) {
+			encode_image_hdr(image, (float*)level);
+		});
+
+		return chain;
+	}
+
+	MipChain generate_mip_chain_half(const uint16* rgba, vk::Extent2D extent, MipFilter filter) {
+		MipChain chain = allocate_chain(extent, vk::Format::eR16G16B16A16Sfloat, 8);
+		memcpy(chain.data.data(), rgba, chain.levels[0].size);
+
+		std::vector<float> row((size_t)extent.width * 4);
+		filter_levels(chain, filter, [&](uint32 y, float* texels) {
+			half_to_float(rgba + (size_t)y * extent.width * 4, row.data(), row.size());
+			decode_texels_hdr(row.data(), extent.width, texels);
+		}, [&](const LinearImage& image, uint8* level) {
+			std::vector<float> texels(image.texels.size());
+			encode_image_hdr(image, texels.data());
+			float_to_half(texels.data(), (uint16*)level, texels.size());
+		});
+
+		return chain;
+	}
+
+	std::vector<vk::BufferImageCopy> mip_copy_regions(const MipChain& chain, vk::DeviceSize bufferOffset, uint32 layerCount) {
+		return mip_copy_regions(chain.levels.data(), chain.levelCount(), bufferOffset, layerCount);
+	}
+
+	std::vector<vk::BufferImageCopy> mip_copy_regions(const MipLevel* levels, uint32 levelCount, vk::DeviceSize bufferOffset, uint32 layerCount) {
+		std::vector<vk::BufferImageCopy> regions(levelCount);
+
+		// Levels of block compressed formats are tightly packed blocks, which is what a row length of 0 means for them as well
+		for (uint32 i = 0; i < levelCount; i++) {
+			auto& region = regions[i];
+			region.bufferOffset = bufferOffset + levels[i].offset;
+			region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+			region.imageSubresource.mipLevel = i;
+			region.imageSubresource.layerCount = layerCount;
+			region.imageExtent = { levels[i].extent.width, levels[i].extent.height, 1 };
+		}
+
+		return regions;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <vulkan/vulkan.hpp>
+#include <vector>
+
+/*
+	Processing steps applied to textures after decoding and before they are uploaded.
+*/
+
+namespace TextureUtil {
+	enum class MipFilter {
+		// Averages the source texels a destination texel covers, exact for odd sizes as well
+		Box,
+		// Kaiser windowed sinc, keeps distant levels sharper than a box at the cost of slight ringing
+		Kaiser
+	};
+
+	struct MipLevel {
+		vk::Extent2D extent;
+		// Byte range of the level in MipChain::data
+		size_t offset = 0;
+		size_t size = 0;
+	};
+
+	// Texels of every level of a texture, largest first and stored back to back. Depending on `format` they are rgba8,
+	// rgba16 or rgba32 floats or compressed blocks
+	struct MipChain {
+		vk::Format format = vk::Format::eR8G8B8A8Unorm;
+		std::vector<uint8> data;
+		std::vector<MipLevel> levels;
+
+		vk::Extent2D extent() const { return levels.empty() ? vk::Extent2D() : levels[0].extent; }
+		uint32 levelCount() const { return (uint32)levels.size(); }
+	};
+
+	// Number of levels of a full mip chain down to 1x1
+	uint32 mip_level_count(vk::Extent2D extent);
+
+	// Builds the full mip chain of an rgba8 image. Levels are filtered in linear space, so with `srgb` the color channels are
+	// decoded before and encoded again after filtering. Color is weighted by alpha while filtering, so transparent texels do not
+	// bleed into opaque ones
+	MipChain generate_mip_chain(const uint8* rgba, vk::Extent2D extent, MipFilter filter = MipFilter::Kaiser, bool srgb = true);
+	// Same for high dynamic range images of rgba floats, which are already linear. Negative values are clamped to 0
+	MipChain generate_mip_chain_hdr(const float* rgba, vk::Extent2D extent, MipFilter filter = MipFilter::Kaiser);
+	// Same for rgba half floats, the levels are stored as half floats as well. Rows are widened to floats for filtering one at a time
+	MipChain generate_mip_chain_half(const uint16* rgba, vk::Extent2D extent, MipFilter filter = MipFilter::Kaiser);
+
+	// One copy region per level of `chain`, for a staging buffer holding MipChain::data at `bufferOffset`. Chains of array or cube
+	// images hold the `layerCount` layers of each level back to back
+	std::vector<vk::BufferImageCopy> mip_copy_regions(const MipChain& chain, vk::DeviceSize bufferOffset = 0, uint32 layerCount = 1);
+	std::vector<vk::BufferImageCopy> mip_copy_regions(const MipLevel* levels, uint32 levelCount, vk::DeviceSize bufferOffset = 0, uint32 layerCount = 1);
+}
\ No newline at end of file
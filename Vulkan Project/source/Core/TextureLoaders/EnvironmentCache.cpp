@@ -0,0 +1,176 @@
+#include "EnvironmentCache.h"
+#include "TextureCache.h"
+#include <Core/Util/CacheFile.h>
+
+#include <chrono>
+#include <cstring>
+
+namespace TextureLoaders {
+
+	namespace {
+		constexpr char CACHE_MAGIC[4] = { 'V', 'E', 'N', 'V' };
+		// Bump whenever the layout of the file or the way the lighting is baked changes
+		constexpr uint32 CACHE_VERSION = 1;
+		// Blobs start on this alignment, which covers the texel size of both formats
+		constexpr uint64 BLOB_ALIGNMENT = 16;
+
+		// Bake options as stored in the cache
+		struct CacheOptions {
+			uint32 faceSize;
+			uint32 levelCount;
+			uint32 sampleCount;
+			uint32 brdfLutSize;
+			uint32 brdfLutSampleCount;
+		};
+
+		struct CacheLevel {
+			uint32 faceSize;
+			uint32 padding;
+			// Offset from the start of the specular blob
+			uint64 offset;
+			uint64 size;
+		};
+
+		struct CacheHeader {
+			FUtil::CacheFileHeader file;
+
+			CacheOptions options;
+
+			// Offsets of the blobs from the start of the file
+			uint32 levelCount;
+			uint64 levelOffset;
+			uint64 specularOffset;
+			uint64 specularSize;
+			uint32 brdfLutSize;
+			uint64 brdfLutOffset;
+			uint64 brdfLutDataSize;
+		};
+
+		uint64 align_up(uint64 value, uint64 alignment) {
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		CacheOptions make_cache_options(const EnvironmentBakeOptions& options) {
+			CacheOptions cacheOptions = {};
+			cacheOptions.faceSize = options.specular.faceSize;
+			cacheOptions.levelCount = options.specular.levelCount;
+			cacheOptions.sampleCount = options.specular.sampleCount;
+			cacheOptions.brdfLutSize = options.brdfLut.size;
+			cacheOptions.brdfLutSampleCount = options.brdfLut.sampleCount;
+			return cacheOptions;
+		}
+
+		FUtil::MappedFile write_cache(const std::filesystem::path& cachePath, FUtil::CacheSource& cacheSource, const FUtil::CacheValidator& isValid, const TextureUtil::MipChain& specular, const TextureUtil::MipChain& brdfLut, CacheHeader header) {
+			std::vector<CacheLevel> levels;
+			for (auto& level : specular.levels) levels.push_back({ level.extent.width, 0, level.offset, level.size });
+
+			header.levelCount = (uint32)levels.size();
+			header.levelOffset = align_up(sizeof(CacheHeader), BLOB_ALIGNMENT);
+			header.specularOffset = align_up(header.levelOffset + levels.size() * sizeof(CacheLevel), BLOB_ALIGNMENT);
+			header.specularSize = specular.data.size();
+			header.brdfLutSize = brdfLut.extent().width;
+			header.brdfLutOffset = align_up(header.specularOffset + header.specularSize, BLOB_ALIGNMENT);
+			header.brdfLutDataSize = brdfLut.data.size();
+
+			return FUtil::write_cache_file(cachePath, cacheSource, CACHE_MAGIC, CACHE_VERSION, isValid, [&](std::ostream& file) {
+				const char padding[BLOB_ALIGNMENT] = {};
+
+				file.write((const char*)&header, sizeof(header));
+				file.write(padding, header.levelOffset - sizeof(header));
+				file.write((const char*)levels.data(), levels.size() * sizeof(CacheLevel));
+				file.write(padding, header.specularOffset - (header.levelOffset + levels.size() * sizeof(CacheLevel)));
+				file.write((const char*)specular.data.data(), specular.data.size());
+				file.write(padding, header.brdfLutOffset - (header.specularOffset + header.specularSize));
+				file.write((const char*)brdfLut.data.data(), brdfLut.data.size());
+			});
+		}
+
+		// Checks the header and level table against the file they were read from, so a truncated or foreign file is never trusted
+		bool cache_is_valid(const FUtil::MappedFile& file, const CacheHeader& header) {
+			if (header.levelCount == 0 || header.levelCount > 32) return false;
+			if (header.levelOffset % BLOB_ALIGNMENT != 0 || header.specularOffset % BLOB_ALIGNMENT != 0 || header.brdfLutOffset % BLOB_ALIGNMENT != 0) return false;
+			if (header.levelOffset + (uint64)header.levelCount * sizeof(CacheLevel) > file.size()) return false;
+			if (header.specularOffset + header.specularSize > file.size()) return false;
+			if (header.brdfLutOffset + header.brdfLutDataSize > file.size()) return false;
+			if (header.brdfLutDataSize != (uint64)header.brdfLutSize * header.brdfLutSize * 2 * sizeof(uint16)) return false;
+
+			for (uint32 i = 0; i < header.levelCount; i++) {
+				CacheLevel level;
+				memcpy(&level, file.data() + header.levelOffset + i * sizeof(CacheLevel), sizeof(level));
+				if (level.offset + level.size > header.specularSize) return false;
+				if (level.size != 6 * (uint64)level.faceSize * level.faceSize * 4 * sizeof(uint16)) return false;
+			}
+
+			return true;
+		}
+
+		// Points the environment into its mapped cache file
+		void bind_mapping(CachedEnvironment& environment) {
+			CacheHeader header;
+			memcpy(&header, environment.file.data(), sizeof(header));
+
+			environment.specularData = environment.file.data() + header.specularOffset;
+			environment.specularDataSize = header.specularSize;
+			environment.brdfLutExtent = { header.brdfLutSize, header.brdfLutSize };
+			environment.brdfLutData = environment.file.data() + header.brdfLutOffset;
+			environment.brdfLutDataSize = header.brdfLutDataSize;
+
+			environment.specularLevels.resize(header.levelCount);
+			for (uint32 i = 0; i < header.levelCount; i++) {
+				CacheLevel level;
+				memcpy(&level, environment.file.data() + header.levelOffset + i * sizeof(CacheLevel), sizeof(level));
+				environment.specularLevels[i].extent = { level.faceSize, level.faceSize };
+				environment.specularLevels[i].offset = level.offset;
+				environment.specularLevels[i].size = level.size;
+			}
+
+			environment.faceSize = environment.specularLevels[0].extent.width;
+		}
+	}
+
+	CachedEnvironment load_cached_environment(const std::filesystem::path& sourcePath, const EnvironmentBakeOptions& options) {
+		auto startTime = std::chrono::high_resolution_clock::now();
+		auto cacheOptions = make_cache_options(options);
+		auto cachePath = FUtil::cache_path_for(sourcePath, &cacheOptions, sizeof(cacheOptions), ".venv");
+
+		CachedEnvironment environment;
+
+		FUtil::CacheValidator isValid = [&](const FUtil::MappedFile& file) {
+			CacheHeader header;
+			if (file.size() < sizeof(header)) return false;
+			memcpy(&header, file.data(), sizeof(header));
+			return cache_is_valid(file, header) && memcmp(&header.options, &cacheOptions, sizeof(cacheOptions)) == 0;
+		};
+
+		FUtil::CacheSource cacheSource(sourcePath);
+		environment.file = FUtil::open_cache_file(cachePath, cacheSource, CACHE_MAGIC, CACHE_VERSION, isValid);
+
+		if (environment.file.data()) {
+			bind_mapping(environment);
+			environment.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+			return environment;
+		}
+
+		// The uncompressed mip chain of the source doubles as the set of prefiltered sources for wide lobes
+		TextureImportOptions sourceOptions;
+		sourceOptions.compress = false;
+		CachedTexture source = load_cached_texture(sourcePath, sourceOptions);
+		if (source.format != vk::Format::eR16G16B16A16Sfloat) throw std::runtime_error("Environments have to be OpenEXR or Radiance images.");
+
+		auto bakeStartTime = std::chrono::high_resolution_clock::now();
+		TextureUtil::MipChain specular = TextureUtil::prefilter_specular(source.data, source.levels.data(), source.levelCount(), options.specular);
+		TextureUtil::MipChain brdfLut = TextureUtil::generate_brdf_lut(options.brdfLut);
+		environment.bakeSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - bakeStartTime).count();
+
+		CacheHeader header = {};
+		header.file = cacheSource.header(CACHE_MAGIC, CACHE_VERSION);
+		header.options = cacheOptions;
+		environment.file = write_cache(cachePath, cacheSource, isValid, specular, brdfLut, header);
+		environment.rebuilt = true;
+		bind_mapping(environment);
+
+		environment.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+		return environment;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+#include <Core/Render/EnvironmentLighting.h>
+#include <Core/Util/FileUtil.h>
+
+#include <filesystem>
+#include <vector>
+
+namespace std {
+	namespace filesystem = experimental::filesystem;
+}
+
+/*
+	Binary cache for the image based lighting of an environment, stored next to the source file as "<source>.<options hash>.venv".
+
+	The cache holds the GGX prefiltered specular cube chain and the BRDF lookup table of the split sum, both exactly as they are
+	uploaded to the gpu. Prefiltering takes seconds even at small sample counts, loading the cache only maps the file.
+	It is keyed by the size, modification time and content hash of the source environment like the texture cache and rebuilt
+	whenever those change, the bake options differ or the cache format version is bumped.
+*/
+
+namespace TextureLoaders {
+	struct EnvironmentBakeOptions {
+		TextureUtil::SpecularPrefilterOptions specular;
+		TextureUtil::BrdfLutOptions brdfLut;
+	};
+
+	struct CachedEnvironment {
+		FUtil::MappedFile file;
+
+		// Rgba half floats, every level holds its six faces back to back, see TextureUtil::prefilter_specular
+		vk::Format specularFormat = vk::Format::eR16G16B16A16Sfloat;
+		uint32 faceSize = 0;
+		const uint8* specularData = nullptr;
+		size_t specularDataSize = 0;
+		std::vector<TextureUtil::MipLevel> specularLevels;
+
+		// Single level of r16g16 half floats, see TextureUtil::generate_brdf_lut
+		vk::Format brdfLutFormat = vk::Format::eR16G16Sfloat;
+		vk::Extent2D brdfLutExtent;
+		const uint8* brdfLutData = nullptr;
+		size_t brdfLutDataSize = 0;
+
+		// Whether the cache had to be (re)built on this load
+		bool rebuilt = false;
+		// Time spent prefiltering and generating the lookup table, only valid if the cache was rebuilt
+		double bakeSeconds = 0;
+		// Time spent in load_cached_environment, including a rebuild
+		double seconds = 0;
+
+		uint32 specularLevelCount() const { return (uint32)specularLevels.size(); }
+	};
+
+	// Loads the image based lighting of the OpenEXR or Radiance environment at `sourcePath` through its cache, baking it first if
+	// the cache is missing or stale. The source is read through the texture cache as uncompressed half floats
+	extern CachedEnvironment load_cached_environment(const std::filesystem::path& sourcePath, const EnvironmentBakeOptions& options = {});
+}
\ No newline at end of file
@@ -0,0 +1,697 @@
+#include "Exr.h"
+
+#include <Core/Render/HalfFloat.h>
+#include <Core/Util/FileUtil.h>
+#include <Core/Util/WorkerPool.h>
+#include <stb/image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+namespace TextureLoaders {
+
+	namespace {
+		constexpr uint32 EXR_MAGIC = 20000630;
+		constexpr uint32 EXR_VERSION = 2;
+		constexpr uint32 VERSION_MASK = 0xff;
+		constexpr uint32 FLAG_TILED = 0x200;
+		constexpr uint32 FLAG_NON_IMAGE = 0x800;
+		constexpr uint32 FLAG_MULTI_PART = 0x1000;
+
+		// A chunk of a PIZ file is 32 scanlines, so this keeps threads from starting for small images
+		constexpr uint32 MIN_CHUNKS_PER_THREAD = 4;
+		constexpr uint16 HALF_ONE = 0x3c00;
+
+		enum class PixelType : uint32 {
+			Uint = 0,
+			Half = 1,
+			Float = 2
+		};
+
+		enum class Compression : uint8 {
+			None = 0,
+			Rle = 1,
+			Zips = 2,
+			Zip = 3,
+			Piz = 4
+		};
+
+		struct Channel {
+			std::string name;
+			PixelType type;
+			// Component of the rgba texel the channel is stored in, -1 for channels that are skipped
+			int32 component;
+
+			uint32 size() const { return type == PixelType::Half ? 2 : 4; }
+		};
+
+		struct Header {
+			// Sorted by name, which is the order their values are stored in
+			std::vector<Channel> channels;
+			Compression compression = Compression::None;
+			int32 minY = 0;
+			uint32 width = 0;
+			uint32 height = 0;
+
+			uint32 linesPerChunk = 1;
+			// Bytes of a single uncompressed scanline over all channels
+			size_t lineSize = 0;
+		};
+
+		// Bounds checked reads of little endian values
+		class Reader {
+		public:
+			Reader(const uint8* data, size_t size) : data(data), size(size) { }
+
+			template<class T>
+			T read() {
+				T value;
+				memcpy(&value, take(sizeof(T)), sizeof(T));
+				return value;
+			}
+
+			std::string readString() {
+				const uint8* end = (const uint8*)memchr(data + position, 0, size - position);
+				if (!end) throw std::runtime_error("Unexpected end of OpenEXR file.");
+
+				std::string string((const char*)data + position, end - (data + position));
+				position += string.size() + 1;
+				return string;
+			}
+
+			const uint8* take(size_t count) {
+				if (count > size - position) throw std::runtime_error("Unexpected end of OpenEXR file.");
+
+				const uint8* taken = data + position;
+				position += count;
+				return taken;
+			}
+
+		private:
+			const uint8* data;
+			size_t size;
+			size_t position = 0;
+		};
+
+		int32 channel_component(const std::string& name) {
+			if (name == "R") return 0;
+			if (name == "G") return 1;
+			if (name == "B") return 2;
+			if (name == "A") return 3;
+			return -1;
+		}
+
+		uint32 lines_per_chunk(Compression compression) {
+			switch (compression) {
+			case Compression::None:
+			case Compression::Rle:
+			case Compression::Zips:
+				return 1;
+			case Compression::Zip:
+				return 16;
+			case Compression::Piz:
+				return 32;
+			default:
+				throw std::runtime_error("Unsupported OpenEXR compression method " + std::to_string((uint32)compression) + ".");
+			}
+		}
+
+		Header parse_header(Reader& reader) {
+			if (reader.read<uint32>() != EXR_MAGIC) throw std::runtime_error("Not an OpenEXR file.");
+
+			uint32 version = reader.read<uint32>();
+			if ((version & VERSION_MASK) != EXR_VERSION) throw std::runtime_error("Unsupported OpenEXR version.");
+			if (version & (FLAG_TILED | FLAG_NON_IMAGE | FLAG_MULTI_PART)) throw std::runtime_error("Only single part scanline OpenEXR files are supported.");
+
+			Header header;
+			bool hasChannels = false, hasCompression = false, hasDataWindow = false;
+
+			for (std::string name = reader.readString(); !name.empty(); name = reader.readString()) {
+				std::string type = reader.readString();
+				uint32 size = reader.read<uint32>();
+				Reader value(reader.take(size), size);
+
+				if (name == "channels" && type == "chlist") {
+					for (std::string channelName = value.readString(); !channelName.empty(); channelName = value.readString()) {
+						Channel channel;
+						channel.name = channelName;
+						channel.type = (PixelType)value.read<uint32>();
+						channel.component = channel_component(channelName);
+
+						// Linear flag and reserved bytes
+						value.take(4);
+						int32 xSampling = value.read<int32>();
+						int32 ySampling = value.read<int32>();
+
+						if ((uint32)channel.type > (uint32)PixelType::Float) throw std::runtime_error("Unknown OpenEXR pixel type in channel " + channelName + ".");
+						if (xSampling != 1 || ySampling != 1) throw std::runtime_error("Subsampled OpenEXR channels are not supported.");
+
+						header.channels.push_back(channel);
+					}
+
+					hasChannels = true;
+				}
+				else if (name == "compression" && type == "compression") {
+					header.compression = (Compression)value.read<uint8>();
+					hasCompression = true;
+				}
+				else if (name == "dataWindow" && type == "box2i") {
+					int32 minX = value.read<int32>();
+					int32 minY = value.read<int32>();
+					int32 maxX = value.read<int32>();
+					int32 maxY = value.read<int32>();
+					if (maxX < minX || maxY < minY) throw std::runtime_error("Empty OpenEXR data window.");
+
+					header.minY = minY;
+					header.width = (uint32)((int64)maxX - minX + 1);
+					header.height = (uint32)((int64)maxY - minY + 1);
+					hasDataWindow = true;
+				}
+			}
+
+			if (!hasChannels || !hasCompression || !hasDataWindow) throw std::runtime_error("OpenEXR header is missing a required attribute.");
+
+			header.linesPerChunk = lines_per_chunk(header.compression);
+			for (auto& channel : header.channels) header.lineSize += (size_t)header.width * channel.size();
+
+			return header;
+		}
+
+		/* RLE and ZIP */
+
+		// Both methods store bytes as differences to the previous byte, with the two halves of every value split into separate runs
+		void undo_predictor(uint8* bytes, size_t size, uint8* out) {
+			for (size_t i = 1; i < size; i++) bytes[i] = (uint8)(bytes[i - 1] + bytes[i] - 128);
+
+			const uint8* first = bytes;
+			const uint8* second = bytes + (size + 1) / 2;
+			for (size_t i = 0; i < size; i++) out[i] = i % 2 == 0 ? *first++ : *second++;
+		}
+
+		void decompress_rle(const uint8* packed, size_t packedSize, uint8* scratch, uint8* out, size_t size) {
+			size_t written = 0;
+			size_t position = 0;
+
+			while (position < packedSize) {
+				int32 count = (int8)packed[position++];
+
+				if (count < 0) {
+					// Literal run
+					if ((size_t)-count > packedSize - position || (size_t)-count > size - written) throw std::runtime_error("Corrupt OpenEXR RLE data.");
+					memcpy(scratch + written, packed + position, -count);
+					position += -count;
+					written += -count;
+				}
+				else {
+					// Repeated byte
+					if (position >= packedSize || (size_t)count + 1 > size - written) throw std::runtime_error("Corrupt OpenEXR RLE data.");
+					memset(scratch + written, packed[position++], count + 1);
+					written += count + 1;
+				}
+			}
+
+			if (written != size) throw std::runtime_error("Corrupt OpenEXR RLE data.");
+			undo_predictor(scratch, size, out);
+		}
+
+		void decompress_zip(const uint8* packed, size_t packedSize, uint8* scratch, uint8* out, size_t size) {
+			int written = stbi_zlib_decode_buffer((char*)scratch, (int)size, (const char*)packed, (int)packedSize);
+			if (written != (int)size) throw std::runtime_error("Corrupt OpenEXR ZIP data.");
+
+			undo_predictor(scratch, size, out);
+		}
+
+		/* PIZ, a wavelet transform followed by huffman coding */
+
+		constexpr uint32 USHORT_RANGE = 1 << 16;
+		constexpr uint32 BITMAP_SIZE = USHORT_RANGE >> 3;
+
+		constexpr int32 HUFFMAN_ENCODE_SIZE = (1 << 16) + 1;
+		// Codes up to this length are decoded with a single table lookup, longer ones by searching the symbols sharing their prefix
+		constexpr int32 HUFFMAN_DECODE_BITS = 14;
+		constexpr int32 HUFFMAN_DECODE_SIZE = 1 << HUFFMAN_DECODE_BITS;
+		constexpr int32 HUFFMAN_DECODE_MASK = HUFFMAN_DECODE_SIZE - 1;
+		// Code lengths from here up encode runs of unused symbols in the code length table
+		constexpr int32 SHORT_ZEROCODE_RUN = 59;
+		constexpr int32 LONG_ZEROCODE_RUN = 63;
+		constexpr int32 SHORTEST_LONG_RUN = 2 + LONG_ZEROCODE_RUN - SHORT_ZEROCODE_RUN;
+
+		struct HuffmanEntry {
+			// Length and symbol of a code that fits the table, 0 if the entry is a prefix of longer codes
+			int32 length = 0;
+			uint32 symbol = 0;
+			std::vector<uint32> longSymbols;
+		};
+
+		// Tables are large, so every thread keeps its own across chunks
+		struct PizScratch {
+			std::vector<uint8> bitmap;
+			std::vector<uint16> lut;
+			std::vector<uint16> values;
+			// Length in the low 6 bits and the canonical code above them, for every symbol
+			std::vector<uint64> codes;
+			std::vector<HuffmanEntry> decodeTable;
+		};
+
+		struct ChunkScratch {
+			std::vector<uint8> unpacked;
+			std::vector<uint8> predicted;
+			std::vector<uint16> halves;
+			std::vector<float> floats;
+			PizScratch piz;
+		};
+
+		class BitReader {
+		public:
+			BitReader(const uint8* data, const uint8* end) : data(data), end(end) { }
+
+			void fetchByte() {
+				if (data >= end) throw std::runtime_error("Unexpected end of OpenEXR huffman data.");
+				bits = (bits << 8) | *data++;
+				bitCount += 8;
+			}
+
+			uint32 read(int32 count) {
+				while (bitCount < count) fetchByte();
+				bitCount -= count;
+				return (uint32)(bits >> bitCount) & ((1u << count) - 1);
+			}
+
+			const uint8* data;
+			const uint8* end;
+			uint64 bits = 0;
+			int32 bitCount = 0;
+		};
+
+		// Reads the code lengths of the symbols in [minSymbol, maxSymbol] and assigns canonical codes to them
+		void read_code_table(BitReader& reader, int32 minSymbol, int32 maxSymbol, std::vector<uint64>& codes) {
+			codes.assign(HUFFMAN_ENCODE_SIZE, 0);
+
+			for (int32 symbol = minSymbol; symbol <= maxSymbol; symbol++) {
+				uint32 length = reader.read(6);
+
+				if (length >= SHORT_ZEROCODE_RUN) {
+					int32 run = length == LONG_ZEROCODE_RUN ? reader.read(8) + SHORTEST_LONG_RUN : length - SHORT_ZEROCODE_RUN + 2;
+					if (symbol + run > maxSymbol + 1) throw std::runtime_error("Corrupt OpenEXR huffman table.");
+
+					// The symbols of the run keep their length of 0
+					symbol += run - 1;
+					continue;
+				}
+
+				codes[symbol] = length;
+			}
+
+			uint64 firstCode[SHORT_ZEROCODE_RUN] = {};
+			for (auto length : codes) firstCode[length]++;
+
+			// Longer codes come first, so the codes of every length start where the longer ones left off
+			uint64 code = 0;
+			for (int32 length = SHORT_ZEROCODE_RUN - 1; length > 0; length--) {
+				uint64 next = (code + firstCode[length]) >> 1;
+				firstCode[length] = code;
+				code = next;
+			}
+
+			for (auto& entry : codes) {
+				if (entry > 0) entry = entry | (firstCode[entry]++ << 6);
+			}
+		}
+
+		void build_decode_table(const std::vector<uint64>& codes, int32 minSymbol, int32 maxSymbol, std::vector<HuffmanEntry>& table) {
+			table.assign(HUFFMAN_DECODE_SIZE, HuffmanEntry());
+
+			for (int32 symbol = minSymbol; symbol <= maxSymbol; symbol++) {
+				uint64 code = codes[symbol] >> 6;
+				int32 length = (int32)(codes[symbol] & 63);
+				if (code >> length) throw std::runtime_error("Corrupt OpenEXR huffman table.");
+
+				if (length > HUFFMAN_DECODE_BITS) {
+					auto& entry = table[code >> (length - HUFFMAN_DECODE_BITS)];
+					if (entry.length) throw std::runtime_error("Corrupt OpenEXR huffman table.");
+					entry.longSymbols.push_back(symbol);
+				}
+				else if (length > 0) {
+					size_t first = code << (HUFFMAN_DECODE_BITS - length);
+					for (size_t i = 0; i < ((size_t)1 << (HUFFMAN_DECODE_BITS - length)); i++) {
+						auto& entry = table[first + i];
+						if (entry.length || !entry.longSymbols.empty()) throw std::runtime_error("Corrupt OpenEXR huffman table.");
+						entry.length = length;
+						entry.symbol = symbol;
+					}
+				}
+			}
+		}
+
+		void huffman_decode(const uint8* data, size_t size, uint16* out, size_t outCount, PizScratch& scratch) {
+			if (size == 0) {
+				if (outCount != 0) throw std::runtime_error("Missing OpenEXR huffman data.");
+				return;
+			}
+
+			Reader header(data, size);
+			int32 minSymbol = header.read<int32>();
+			int32 maxSymbol = header.read<int32>();
+			header.take(4);
+			uint32 bitCount = header.read<uint32>();
+			header.take(4);
+
+			if (minSymbol < 0 || minSymbol >= HUFFMAN_ENCODE_SIZE || maxSymbol < 0 || maxSymbol >= HUFFMAN_ENCODE_SIZE) throw std::runtime_error("Corrupt OpenEXR huffman table.");
+
+			const uint8* end = data + size;
+			BitReader tableReader(data + 20, end);
+			read_code_table(tableReader, minSymbol, maxSymbol, scratch.codes);
+			build_decode_table(scratch.codes, minSymbol, maxSymbol, scratch.decodeTable);
+
+			const uint8* bitsStart = tableReader.data;
+			if ((bitCount + 7) / 8 > (size_t)(end - bitsStart)) throw std::runtime_error("Unexpected end of OpenEXR huffman data.");
+
+			// The largest symbol is reserved for runs, it is followed by 8 bits counting repeats of the previous value
+			const uint32 runSymbol = (uint32)maxSymbol;
+			size_t written = 0;
+			BitReader reader(bitsStart, end);
+
+			auto emit = [&](uint32 symbol) {
+				if (symbol == runSymbol) {
+					uint32 count = reader.read(8);
+					if (written == 0 || written + count > outCount) throw std::runtime_error("Corrupt OpenEXR huffman data.");
+
+					uint16 previous = out[written - 1];
+					for (uint32 i = 0; i < count; i++) out[written++] = previous;
+				}
+				else {
+					if (written >= outCount) throw std::runtime_error("Corrupt OpenEXR huffman data.");
+					out[written++] = (uint16)symbol;
+				}
+			};
+
+			const uint8* bitsEnd = bitsStart + (bitCount + 7) / 8;
+			while (reader.data < bitsEnd) {
+				reader.fetchByte();
+
+				while (reader.bitCount >= HUFFMAN_DECODE_BITS) {
+					auto& entry = scratch.decodeTable[(reader.bits >> (reader.bitCount - HUFFMAN_DECODE_BITS)) & HUFFMAN_DECODE_MASK];
+
+					if (entry.length) {
+						reader.bitCount -= entry.length;
+						emit(entry.symbol);
+						continue;
+					}
+
+					bool found = false;
+					for (uint32 symbol : entry.longSymbols) {
+						int32 length = (int32)(scratch.codes[symbol] & 63);
+						while (reader.bitCount < length && reader.data < bitsEnd) reader.fetchByte();
+
+						if (reader.bitCount >= length && (scratch.codes[symbol] >> 6) == ((reader.bits >> (reader.bitCount - length)) & (((uint64)1 << length) - 1))) {
+							reader.bitCount -= length;
+							emit(symbol);
+							found = true;
+							break;
+						}
+					}
+
+					if (!found) throw std::runtime_error("Invalid OpenEXR huffman code.");
+				}
+			}
+
+			// The last codes are shorter than a table lookup, the padding bits of the final byte are dropped first
+			int32 padding = (8 - bitCount) & 7;
+			reader.bits >>= padding;
+			reader.bitCount -= padding;
+
+			while (reader.bitCount > 0) {
+				auto& entry = scratch.decodeTable[(reader.bits << (HUFFMAN_DECODE_BITS - reader.bitCount)) & HUFFMAN_DECODE_MASK];
+				if (!entry.length || entry.length > reader.bitCount) throw std::runtime_error("Invalid OpenEXR huffman code.");
+
+				reader.bitCount -= entry.length;
+				emit(entry.symbol);
+			}
+
+			if (written != outCount) throw std::runtime_error("Not enough OpenEXR huffman data.");
+		}
+
+		// Inverse of the 14 bit wavelet, used when every value fits in 14 bits
+		void wavelet_decode14(uint16 low, uint16 high, uint16& a, uint16& b) {
+			int16 ls = (int16)low;
+			int16 hs = (int16)high;
+
+			int32 hi = hs;
+			int32 ai = ls + (hi & 1) + (hi >> 1);
+			a = (uint16)(int16)ai;
+			b = (uint16)(int16)(ai - hi);
+		}
+
+		// Inverse of the 16 bit wavelet, which wraps around instead of needing headroom
+		void wavelet_decode16(uint16 low, uint16 high, uint16& a, uint16& b) {
+			constexpr int32 OFFSET = 1 << 15;
+			constexpr int32 MASK = (1 << 16) - 1;
+
+			int32 m = low;
+			int32 d = high;
+			int32 bb = (m - (d >> 1)) & MASK;
+			int32 aa = (d + bb - OFFSET) & MASK;
+			a = (uint16)aa;
+			b = (uint16)bb;
+		}
+
+		// Undoes the 2D Haar wavelet transform of an nx by ny plane of values, `ox` and `oy` apart along x and y
+		void wavelet_decode(uint16* values, int64 nx, int64 ox, int64 ny, int64 oy, uint16 maxValue) {
+			bool narrow = maxValue < (1 << 14);
+			auto decode = narrow ? wavelet_decode14 : wavelet_decode16;
+
+			int64 n = std::min(nx, ny);
+			int64 p = 1;
+			while (p <= n) p <<= 1;
+			p >>= 1;
+			int64 p2 = p;
+			p >>= 1;
+
+			// Levels from the coarsest to the finest
+			while (p >= 1) {
+				int64 oy1 = oy * p, oy2 = oy * p2;
+				int64 ox1 = ox * p, ox2 = ox * p2;
+				uint16 i00, i01, i10, i11;
+
+				int64 py = 0;
+				int64 ey = oy * (ny - p2);
+				for (; py <= ey; py += oy2) {
+					int64 px = py;
+					int64 ex = py + ox * (nx - p2);
+
+					for (; px <= ex; px += ox2) {
+						int64 p01 = px + ox1;
+						int64 p10 = px + oy1;
+						int64 p11 = p10 + ox1;
+
+						decode(values[px], values[p10], i00, i10);
+						decode(values[p01], values[p11], i01, i11);
+						decode(i00, i01, values[px], values[p01]);
+						decode(i10, i11, values[p10], values[p11]);
+					}
+
+					// Odd column
+					if (nx & p) {
+						int64 p10 = px + oy1;
+						decode(values[px], values[p10], i00, values[p10]);
+						values[px] = i00;
+					}
+				}
+
+				// Odd line
+				if (ny & p) {
+					int64 px = py;
+					int64 ex = py + ox * (nx - p2);
+
+					for (; px <= ex; px += ox2) {
+						int64 p01 = px + ox1;
+						decode(values[px], values[p01], i00, values[p01]);
+						values[px] = i00;
+					}
+				}
+
+				p2 = p;
+				p >>= 1;
+			}
+		}
+
+		void decompress_piz(const Header& header, const uint8* packed, size_t packedSize, uint32 lineCount, PizScratch& scratch, uint8* out, size_t size) {
+			Reader reader(packed, packedSize);
+
+			// Values that occur in the chunk, they were remapped to a dense range before the wavelet transform
+			scratch.bitmap.assign(BITMAP_SIZE, 0);
+			uint16 minNonZero = reader.read<uint16>();
+			uint16 maxNonZero = reader.read<uint16>();
+			if (maxNonZero >= BITMAP_SIZE) throw std::runtime_error("Corrupt OpenEXR PIZ bitmap.");
+			if (minNonZero <= maxNonZero) memcpy(&scratch.bitmap[minNonZero], reader.take(maxNonZero - minNonZero + 1), maxNonZero - minNonZero + 1);
+
+			scratch.lut.assign(USHORT_RANGE, 0);
+			uint32 lutSize = 0;
+			for (uint32 i = 0; i < USHORT_RANGE; i++) {
+				if (i == 0 || (scratch.bitmap[i >> 3] & (1 << (i & 7)))) scratch.lut[lutSize++] = (uint16)i;
+			}
+			uint16 maxValue = (uint16)(lutSize - 1);
+
+			uint32 huffmanSize = reader.read<uint32>();
+			scratch.values.resize(size / 2);
+			huffman_decode(reader.take(huffmanSize), huffmanSize, scratch.values.data(), scratch.values.size(), scratch);
+
+			// Channels are stored one after another, values of float and uint channels are split into two interleaved planes
+			size_t start = 0;
+			for (auto& channel : header.channels) {
+				uint32 words = channel.size() / 2;
+				for (uint32 i = 0; i < words; i++) {
+					wavelet_decode(scratch.values.data() + start + i, header.width, words, lineCount, (int64)header.width * words, maxValue);
+				}
+
+				start += (size_t)header.width * lineCount * words;
+			}
+
+			for (auto& value : scratch.values) value = scratch.lut[value];
+
+			// Back to scanlines with the channels of each line after one another
+			uint16* target = (uint16*)out;
+			size_t planeStart = 0;
+			size_t lineOffset = 0;
+			for (auto& channel : header.channels) {
+				size_t lineWords = (size_t)header.width * channel.size() / 2;
+
+				for (uint32 line = 0; line < lineCount; line++) {
+					memcpy(target + line * (header.lineSize / 2) + lineOffset, &scratch.values[planeStart + line * lineWords], lineWords * 2);
+				}
+
+				planeStart += lineWords * lineCount;
+				lineOffset += lineWords;
+			}
+		}
+
+		/* Chunks */
+
+		// Copies the channels of decompressed scanlines into rgba half float texels
+		void store_lines(const Header& header, const uint8* lines, uint32 firstLine, uint32 lineCount, ChunkScratch& scratch, uint16* texels) {
+			scratch.halves.resize(header.width);
+			scratch.floats.resize(header.width);
+
+			for (uint32 line = 0; line < lineCount; line++) {
+				const uint8* source = lines + line * header.lineSize;
+				uint16* row = texels + (size_t)(firstLine + line) * header.width * 4;
+
+				for (auto& channel : header.channels) {
+					const uint8* values = source;
+					source += (size_t)header.width * channel.size();
+					if (channel.component < 0) continue;
+
+					if (channel.type == PixelType::Half) {
+						memcpy(scratch.halves.data(), values, header.width * sizeof(uint16));
+					}
+					else {
+						if (channel.type == PixelType::Float) {
+							memcpy(scratch.floats.data(), values, header.width * sizeof(float));
+						}
+						else {
+							for (uint32 x = 0; x < header.width; x++) {
+								uint32 value;
+								memcpy(&value, values + x * sizeof(uint32), sizeof(uint32));
+								scratch.floats[x] = (float)value;
+							}
+						}
+
+						TextureUtil::float_to_half(scratch.floats.data(), scratch.halves.data(), header.width);
+					}
+
+					for (uint32 x = 0; x < header.width; x++) row[x * 4 + channel.component] = scratch.halves[x];
+				}
+			}
+		}
+
+		void decode_chunk(const Header& header, const FUtil::MappedFile& file, uint64 offset, ChunkScratch& scratch, uint16* texels) {
+			if (offset >= file.size()) throw std::runtime_error("Corrupt OpenEXR chunk offset.");
+
+			Reader reader(file.data() + offset, file.size() - offset);
+			int32 y = reader.read<int32>();
+			uint32 packedSize = reader.read<uint32>();
+			const uint8* packed = reader.take(packedSize);
+
+			int64 firstLine = (int64)y - header.minY;
+			if (firstLine < 0 || firstLine >= header.height || firstLine % header.linesPerChunk != 0) throw std::runtime_error("Corrupt OpenEXR chunk.");
+
+			uint32 lineCount = std::min(header.linesPerChunk, header.height - (uint32)firstLine);
+			size_t size = lineCount * header.lineSize;
+
+			// Chunks that would not get any smaller are stored uncompressed, whatever the compression of the file
+			const uint8* lines = packed;
+			if (packedSize < size) {
+				scratch.unpacked.resize(size);
+				scratch.predicted.resize(size);
+
+				switch (header.compression) {
+				case Compression::Rle:
+					decompress_rle(packed, packedSize, scratch.predicted.data(), scratch.unpacked.data(), size);
+					break;
+				case Compression::Zips:
+				case Compression::Zip:
+					decompress_zip(packed, packedSize, scratch.predicted.data(), scratch.unpacked.data(), size);
+					break;
+				case Compression::Piz:
+					decompress_piz(header, packed, packedSize, lineCount, scratch.piz, scratch.unpacked.data(), size);
+					break;
+				default:
+					throw std::runtime_error("Corrupt OpenEXR chunk.");
+				}
+
+				lines = scratch.unpacked.data();
+			}
+			else if (packedSize != size) {
+				throw std::runtime_error("Corrupt OpenEXR chunk.");
+			}
+
+			store_lines(header, lines, (uint32)firstLine, lineCount, scratch, texels);
+		}
+
+		// Runs `job(chunk, scratch)` for every chunk on the shared worker pool. Every worker has its own scratch.
+		// Returns the number of workers that took part
+		template<class Job>
+		uint32 for_each_chunk(uint32 chunkCount, Job job) {
+			return parallel_for(chunkCount, MIN_CHUNKS_PER_THREAD, [&](ParallelRange& chunks) {
+				ChunkScratch scratch;
+				for (uint32 chunk; chunks.next(chunk);) job(chunk, scratch);
+			});
+		}
+	}
+
+	HdrImage load_exr(const std::filesystem::path& path) {
+		HdrLoadStatistics statistics;
+		return load_exr(path, statistics);
+	}
+
+	HdrImage load_exr(const std::filesystem::path& path, HdrLoadStatistics& statistics) {
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		FUtil::MappedFile file(path);
+		Reader reader(file.data(), file.size());
+		Header header = parse_header(reader);
+
+		uint32 chunkCount = (header.height + header.linesPerChunk - 1) / header.linesPerChunk;
+		const uint8* offsets = reader.take((size_t)chunkCount * sizeof(uint64));
+
+		HdrImage image;
+		image.extent = { header.width, header.height };
+		image.texels.resize((size_t)header.width * header.height * 4, 0);
+		for (size_t i = 3; i < image.texels.size(); i += 4) image.texels[i] = HALF_ONE;
+
+		statistics.threadCount = for_each_chunk(chunkCount, [&](uint32 chunk, ChunkScratch& scratch) {
+			uint64 offset;
+			memcpy(&offset, offsets + chunk * sizeof(uint64), sizeof(uint64));
+			decode_chunk(header, file, offset, scratch, image.texels.data());
+		});
+
+		statistics.fileSize = file.size();
+		statistics.texelCount = (size_t)header.width * header.height;
+		statistics.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+		return image;
+	}
+
+}
\ No newline at end of file
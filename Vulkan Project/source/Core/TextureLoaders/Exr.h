@@ -0,0 +1,22 @@
+#pragma once
+#include <Core/TextureLoaders/HdrImage.h>
+
+#include <filesystem>
+
+namespace std {
+	namespace filesystem = experimental::filesystem;
+}
+
+/*
+	Loader for OpenEXR images.
+
+	Reads single part scanline files compressed with NONE, RLE, ZIPS, ZIP or PIZ, which covers what common tools write by default.
+	Tiled, deep and multi part files, subsampled channels and the lossy compression methods are rejected.
+	The R, G, B and A channels are read in any of the half, float and uint pixel types, missing color channels are 0 and a missing
+	alpha is 1. Any other channel is skipped. Chunks of scanlines are independent and decoded in parallel.
+*/
+
+namespace TextureLoaders {
+	extern HdrImage load_exr(const std::filesystem::path& path);
+	extern HdrImage load_exr(const std::filesystem::path& path, HdrLoadStatistics& statistics);
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <vulkan/vulkan.hpp>
+
+#include <vector>
+
+namespace TextureLoaders {
+	/* Decoded high dynamic range image as rgba half floats, the texel layout of R16G16B16A16Sfloat */
+	struct HdrImage {
+		vk::Extent2D extent;
+		std::vector<uint16> texels;
+	};
+
+	/* Throughput of decoding a single high dynamic range image */
+	struct HdrLoadStatistics {
+		size_t fileSize = 0;
+		size_t texelCount = 0;
+		uint32 threadCount = 0;
+		double seconds = 0;
+
+		double megabytesPerSecond() const { return seconds > 0 ? fileSize / (1024.0 * 1024.0) / seconds : 0; }
+		double megatexelsPerSecond() const { return seconds > 0 ? texelCount / 1000000.0 / seconds : 0; }
+	};
+}
\ No newline at end of file
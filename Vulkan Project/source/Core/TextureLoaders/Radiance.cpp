@@ -0,0 +1,235 @@
+#include "Radiance.h"
+
+#include <Core/Render/HalfFloat.h>
+#include <Core/Util/FileUtil.h>
+#include <Core/Util/WorkerPool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+namespace TextureLoaders {
+
+	namespace {
+		// Keeps threads from starting for small images
+		constexpr uint32 MIN_ROWS_PER_THREAD = 64;
+		// Scanlines of this width range can be run length encoded per component
+		constexpr uint32 MIN_RLE_WIDTH = 8;
+		constexpr uint32 MAX_RLE_WIDTH = 0x7fff;
+
+		struct Header {
+			uint32 width = 0;
+			uint32 height = 0;
+			// Whether the first scanline is the bottom of the image
+			bool bottomUp = false;
+			// Offset of the first scanline in the file
+			size_t dataOffset = 0;
+		};
+
+		std::string read_line(const FUtil::MappedFile& file, size_t& position) {
+			const uint8* end = (const uint8*)memchr(file.data() + position, '\n', file.size() - position);
+			if (!end) throw std::runtime_error("Unexpected end of Radiance header.");
+
+			std::string line((const char*)file.data() + position, end - (file.data() + position));
+			position += line.size() + 1;
+			return line;
+		}
+
+		Header parse_header(const FUtil::MappedFile& file) {
+			Header header;
+			size_t position = 0;
+
+			std::string signature = read_line(file, position);
+			if (signature != "#?RADIANCE" && signature != "#?RGBE") throw std::runtime_error("Not a Radiance file.");
+
+			// Variables up to an empty line, only the format matters
+			for (std::string line = read_line(file, position); !line.empty(); line = read_line(file, position)) {
+				if (line.compare(0, 7, "FORMAT=") == 0 && line != "FORMAT=32-bit_rle_rgbe") throw std::runtime_error("Unsupported Radiance format " + line.substr(7) + ".");
+			}
+
+			std::stringstream resolution(read_line(file, position));
+			std::string yAxis, xAxis;
+			int64 height = 0, width = 0;
+			resolution >> yAxis >> height >> xAxis >> width;
+
+			if (resolution.fail() || (yAxis != "-Y" && yAxis != "+Y") || xAxis != "+X") throw std::runtime_error("Unsupported Radiance image orientation.");
+			if (width <= 0 || height <= 0 || width > UINT32_MAX || height > UINT32_MAX) throw std::runtime_error("Invalid Radiance image size.");
+
+			header.width = (uint32)width;
+			header.height = (uint32)height;
+			header.bottomUp = yAxis == "+Y";
+			header.dataOffset = position;
+			return header;
+		}
+
+		bool is_rle_scanline(const Header& header, const uint8* data, size_t available) {
+			if (header.width < MIN_RLE_WIDTH || header.width > MAX_RLE_WIDTH || available < 4) return false;
+			return data[0] == 2 && data[1] == 2 && (data[2] & 0x80) == 0;
+		}
+
+		// Size of the scanline starting at `data`, found by stepping over the runs without expanding them
+		size_t scanline_size(const Header& header, const uint8* data, size_t available) {
+			auto require = [&](size_t position) {
+				if (position > available) throw std::runtime_error("Unexpected end of Radiance file.");
+			};
+
+			if (is_rle_scanline(header, data, available)) {
+				if ((uint32)((data[2] << 8) | data[3]) != header.width) throw std::runtime_error("Corrupt Radiance scanline.");
+
+				size_t position = 4;
+				for (uint32 component = 0; component < 4; component++) {
+					for (uint32 x = 0; x < header.width;) {
+						require(position + 1);
+						uint32 count = data[position];
+
+						if (count > 128) {
+							count -= 128;
+							position += 2;
+						}
+						else {
+							if (count == 0) throw std::runtime_error("Corrupt Radiance scanline.");
+							position += 1 + count;
+						}
+
+						x += count;
+						if (x > header.width) throw std::runtime_error("Corrupt Radiance scanline.");
+					}
+				}
+
+				require(position);
+				return position;
+			}
+
+			// Flat texels, possibly with the older run length encoding that repeats the previous texel
+			size_t position = 0;
+			uint32 shift = 0;
+			for (uint32 x = 0; x < header.width;) {
+				require(position + 4);
+				const uint8* texel = data + position;
+				position += 4;
+
+				if (texel[0] == 1 && texel[1] == 1 && texel[2] == 1) {
+					if (x == 0 || shift > 24) throw std::runtime_error("Corrupt Radiance scanline.");
+					x += texel[3] << shift;
+					shift += 8;
+					if (x > header.width) throw std::runtime_error("Corrupt Radiance scanline.");
+				}
+				else {
+					x++;
+					shift = 0;
+				}
+			}
+
+			return position;
+		}
+
+		// Expands a scanline located by scanline_size to rgbe texels
+		void decode_scanline(const Header& header, const uint8* data, size_t size, uint8* rgbe) {
+			if (is_rle_scanline(header, data, size)) {
+				size_t position = 4;
+				for (uint32 component = 0; component < 4; component++) {
+					for (uint32 x = 0; x < header.width;) {
+						uint32 count = data[position++];
+
+						if (count > 128) {
+							count -= 128;
+							uint8 value = data[position++];
+							for (uint32 i = 0; i < count; i++) rgbe[(x + i) * 4 + component] = value;
+						}
+						else {
+							for (uint32 i = 0; i < count; i++) rgbe[(x + i) * 4 + component] = data[position++];
+						}
+
+						x += count;
+					}
+				}
+
+				return;
+			}
+
+			uint32 shift = 0;
+			uint32 x = 0;
+			for (size_t position = 0; position < size; position += 4) {
+				const uint8* texel = data + position;
+
+				if (texel[0] == 1 && texel[1] == 1 && texel[2] == 1) {
+					uint32 count = texel[3] << shift;
+					for (uint32 i = 0; i < count; i++, x++) memcpy(rgbe + x * 4, rgbe + (x - 1) * 4, 4);
+					shift += 8;
+				}
+				else {
+					memcpy(rgbe + x * 4, texel, 4);
+					x++;
+					shift = 0;
+				}
+			}
+		}
+
+		// Rgbe shares one exponent between the three mantissas, values are taken from the middle of their quantization step
+		void rgbe_to_float(const uint8* rgbe, uint32 count, float* rgba) {
+			for (uint32 i = 0; i < count; i++) {
+				const uint8* texel = rgbe + i * 4;
+				float scale = texel[3] == 0 ? 0.0f : std::ldexp(1.0f, (int32)texel[3] - (128 + 8));
+
+				rgba[i * 4 + 0] = texel[3] == 0 ? 0.0f : (texel[0] + 0.5f) * scale;
+				rgba[i * 4 + 1] = texel[3] == 0 ? 0.0f : (texel[1] + 0.5f) * scale;
+				rgba[i * 4 + 2] = texel[3] == 0 ? 0.0f : (texel[2] + 0.5f) * scale;
+				rgba[i * 4 + 3] = 1.0f;
+			}
+		}
+
+		// Runs `job(row, rgbe, floats)` for every row on the shared worker pool. Every worker has its own row buffers.
+		// Returns the number of workers that took part
+		template<class Job>
+		uint32 for_each_row(uint32 width, uint32 rowCount, Job job) {
+			return parallel_for(rowCount, MIN_ROWS_PER_THREAD, [&](ParallelRange& rows) {
+				std::vector<uint8> rgbe((size_t)width * 4);
+				std::vector<float> floats((size_t)width * 4);
+				for (uint32 row; rows.next(row);) job(row, rgbe.data(), floats.data());
+			});
+		}
+	}
+
+	HdrImage load_radiance(const std::filesystem::path& path) {
+		HdrLoadStatistics statistics;
+		return load_radiance(path, statistics);
+	}
+
+	HdrImage load_radiance(const std::filesystem::path& path, HdrLoadStatistics& statistics) {
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		FUtil::MappedFile file(path);
+		Header header = parse_header(file);
+
+		// Scanlines do not record their size, but walking the run lengths is much cheaper than expanding them
+		std::vector<size_t> scanlineOffsets(header.height + 1);
+		size_t position = header.dataOffset;
+		for (uint32 row = 0; row < header.height; row++) {
+			scanlineOffsets[row] = position;
+			position += scanline_size(header, file.data() + position, file.size() - position);
+		}
+		scanlineOffsets[header.height] = position;
+
+		HdrImage image;
+		image.extent = { header.width, header.height };
+		image.texels.resize((size_t)header.width * header.height * 4);
+
+		statistics.threadCount = for_each_row(header.width, header.height, [&](uint32 row, uint8* rgbe, float* floats) {
+			decode_scanline(header, file.data() + scanlineOffsets[row], scanlineOffsets[row + 1] - scanlineOffsets[row], rgbe);
+			rgbe_to_float(rgbe, header.width, floats);
+
+			uint32 y = header.bottomUp ? header.height - 1 - row : row;
+			TextureUtil::float_to_half(floats, image.texels.data() + (size_t)y * header.width * 4, (size_t)header.width * 4);
+		});
+
+		statistics.fileSize = file.size();
+		statistics.texelCount = (size_t)header.width * header.height;
+		statistics.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+		return image;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+#include <Core/TextureLoaders/HdrImage.h>
+
+#include <filesystem>
+
+namespace std {
+	namespace filesystem = experimental::filesystem;
+}
+
+/*
+	Loader for Radiance .hdr images with rgbe texels, flat or run length encoded.
+	Scanlines are located in a quick pass over the run lengths and then decoded in parallel.
+*/
+
+namespace TextureLoaders {
+	extern HdrImage load_radiance(const std::filesystem::path& path);
+	extern HdrImage load_radiance(const std::filesystem::path& path, HdrLoadStatistics& statistics);
+}
\ No newline at end of file
@@ -0,0 +1,278 @@
+#include "TextureCache.h"
+#include "Exr.h"
+#include "Radiance.h"
+
+#include <Core/Render/HalfFloat.h>
+#include <Core/Util/CacheFile.h>
+
+#include <stb/image.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+namespace TextureLoaders {
+
+	namespace {
+		constexpr char CACHE_MAGIC[4] = { 'V', 'T', 'E', 'X' };
+		// Bump whenever the layout of the file or the processing applied to cached textures changes
+		constexpr uint32 CACHE_VERSION = 2;
+		// Blobs start on this alignment, which covers the texel and block size of every format
+		constexpr uint64 BLOB_ALIGNMENT = 16;
+
+		// Import options as stored in the cache. Options that have no effect are zeroed, so they compare and hash equal
+		struct CacheOptions {
+			uint32 usage;
+			uint32 compress;
+			uint32 quality;
+			uint32 mipFilter;
+		};
+
+		struct CacheLevel {
+			uint32 width;
+			uint32 height;
+			// Offset from the start of the data blob
+			uint64 offset;
+			uint64 size;
+		};
+
+		struct CacheHeader {
+			FUtil::CacheFileHeader file;
+
+			CacheOptions options;
+
+			vk::Format format;
+			uint32 width;
+			uint32 height;
+			float psnr;
+
+			// Offsets of the blobs from the start of the file
+			uint32 levelCount;
+			uint64 levelOffset;
+			uint64 dataOffset;
+			uint64 dataSize;
+		};
+
+		// Decoded source file, either rgba8 or rgba half floats
+		struct SourceImage {
+			vk::Extent2D extent;
+			std::vector<uint8> texels;
+			std::vector<uint16> hdrTexels;
+
+			bool hdr() const { return !hdrTexels.empty(); }
+		};
+
+		uint64 align_up(uint64 value, uint64 alignment) {
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		CacheOptions make_cache_options(const TextureImportOptions& options) {
+			CacheOptions cacheOptions = {};
+			cacheOptions.usage = (uint32)options.usage;
+			cacheOptions.compress = options.compress;
+			cacheOptions.quality = options.compress ? (uint32)options.quality : 0;
+			cacheOptions.mipFilter = (uint32)options.mipFilter;
+			return cacheOptions;
+		}
+
+		bool is_supported_format(vk::Format format) {
+			switch (format) {
+			case vk::Format::eR8G8B8A8Unorm:
+			case vk::Format::eR8G8B8A8Srgb:
+			case vk::Format::eR16G16B16A16Sfloat:
+			case vk::Format::eBc1RgbaUnormBlock:
+			case vk::Format::eBc1RgbaSrgbBlock:
+			case vk::Format::eBc3UnormBlock:
+			case vk::Format::eBc3SrgbBlock:
+			case vk::Format::eBc5UnormBlock:
+			case vk::Format::eBc6HUfloatBlock:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		SourceImage decode_source(const std::filesystem::path& sourcePath, HdrLoadStatistics& statistics) {
+			std::string extension = sourcePath.extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+
+			SourceImage image;
+
+			if (extension == ".exr" || extension == ".hdr") {
+				HdrImage hdr = extension == ".exr" ? load_exr(sourcePath, statistics) : load_radiance(sourcePath, statistics);
+				image.extent = hdr.extent;
+				image.hdrTexels = std::move(hdr.texels);
+				return image;
+			}
+
+			int width, height, channels;
+			std::unique_ptr<uint8, void(*)(void*)> texels(stbi_load(sourcePath.string().c_str(), &width, &height, &channels, STBI_rgb_alpha), stbi_image_free);
+			if (!texels) throw std::runtime_error(std::string("Failed to load texture. ") + stbi_failure_reason());
+
+			image.extent = { (uint32)width, (uint32)height };
+			image.texels.assign(texels.get(), texels.get() + (size_t)width * height * 4);
+			return image;
+		}
+
+		bool is_opaque(const std::vector<uint8>& rgba) {
+			for (size_t i = 3; i < rgba.size(); i += 4) {
+				if (rgba[i] != 255) return false;
+			}
+			return true;
+		}
+
+		// Generates the mip chain of the source and compresses it, measuring the quality of the compressed top level
+		TextureUtil::MipChain process_texture(const SourceImage& source, const TextureImportOptions& options, float& psnr) {
+			using namespace TextureUtil;
+
+			size_t texelCount = (size_t)source.extent.width * source.extent.height;
+			psnr = std::numeric_limits<float>::infinity();
+
+			if (source.hdr()) {
+				MipChain chain = generate_mip_chain_half(source.hdrTexels.data(), source.extent, options.mipFilter);
+				if (!options.compress) return chain;
+
+				MipChain compressed = compress_mip_chain(chain, BlockFormat::BC6H, options.quality);
+				auto decoded = decompress_image_hdr(compressed.data.data(), source.extent);
+
+				std::vector<float> reference(source.hdrTexels.size());
+				half_to_float(source.hdrTexels.data(), reference.data(), reference.size());
+				psnr = psnr_hdr(reference.data(), decoded.data(), texelCount);
+				return compressed;
+			}
+
+			MipChain chain = generate_mip_chain(source.texels.data(), source.extent, options.mipFilter, options.usage == TextureUsage::Color);
+			if (!options.compress) return chain;
+
+			BlockFormat format = options.usage == TextureUsage::NormalMap ? BlockFormat::BC5 : is_opaque(source.texels) ? BlockFormat::BC1 : BlockFormat::BC3;
+			uint32 channelCount = format == BlockFormat::BC1 ? 3 : format == BlockFormat::BC3 ? 4 : 2;
+
+			MipChain compressed = compress_mip_chain(chain, format, options.quality);
+			auto decoded = decompress_image(compressed.data.data(), source.extent, format);
+			psnr = TextureUtil::psnr(source.texels.data(), decoded.data(), texelCount, channelCount);
+			return compressed;
+		}
+
+		FUtil::MappedFile write_cache(const std::filesystem::path& cachePath, FUtil::CacheSource& cacheSource, const FUtil::CacheValidator& isValid, const TextureUtil::MipChain& chain, CacheHeader header) {
+			std::vector<CacheLevel> levels;
+			for (auto& level : chain.levels) levels.push_back({ level.extent.width, level.extent.height, level.offset, level.size });
+
+			header.format = chain.format;
+			header.width = chain.extent().width;
+			header.height = chain.extent().height;
+			header.levelCount = (uint32)levels.size();
+			header.levelOffset = align_up(sizeof(CacheHeader), BLOB_ALIGNMENT);
+			header.dataOffset = align_up(header.levelOffset + levels.size() * sizeof(CacheLevel), BLOB_ALIGNMENT);
+			header.dataSize = chain.data.size();
+
+			return FUtil::write_cache_file(cachePath, cacheSource, CACHE_MAGIC, CACHE_VERSION, isValid, [&](std::ostream& file) {
+				const char padding[BLOB_ALIGNMENT] = {};
+
+				file.write((const char*)&header, sizeof(header));
+				file.write(padding, header.levelOffset - sizeof(header));
+				file.write((const char*)levels.data(), levels.size() * sizeof(CacheLevel));
+				file.write(padding, header.dataOffset - (header.levelOffset + levels.size() * sizeof(CacheLevel)));
+				file.write((const char*)chain.data.data(), chain.data.size());
+			});
+		}
+
+		// Checks the header and level table against the file they were read from, so a truncated or foreign file is never trusted
+		bool cache_is_valid(const FUtil::MappedFile& file, const CacheHeader& header) {
+			if (!is_supported_format(header.format)) return false;
+			if (header.levelCount == 0 || header.levelCount > TextureUtil::mip_level_count({ header.width, header.height })) return false;
+			if (header.levelOffset % BLOB_ALIGNMENT != 0 || header.dataOffset % BLOB_ALIGNMENT != 0) return false;
+			if (header.levelOffset + (uint64)header.levelCount * sizeof(CacheLevel) > file.size()) return false;
+			if (header.dataOffset + header.dataSize > file.size()) return false;
+
+			for (uint32 i = 0; i < header.levelCount; i++) {
+				CacheLevel level;
+				memcpy(&level, file.data() + header.levelOffset + i * sizeof(CacheLevel), sizeof(level));
+				if (level.offset + level.size > header.dataSize) return false;
+			}
+
+			return true;
+		}
+
+		// Points the texture into its mapped cache file
+		void bind_mapping(CachedTexture& texture) {
+			CacheHeader header;
+			memcpy(&header, texture.file.data(), sizeof(header));
+
+			texture.format = header.format;
+			texture.extent = { header.width, header.height };
+			texture.data = texture.file.data() + header.dataOffset;
+			texture.dataSize = header.dataSize;
+			texture.psnr = header.psnr;
+
+			texture.levels.resize(header.levelCount);
+			for (uint32 i = 0; i < header.levelCount; i++) {
+				CacheLevel level;
+				memcpy(&level, texture.file.data() + header.levelOffset + i * sizeof(CacheLevel), sizeof(level));
+				texture.levels[i].extent = { level.width, level.height };
+				texture.levels[i].offset = level.offset;
+				texture.levels[i].size = level.size;
+			}
+		}
+	}
+
+	CachedTexture load_cached_texture(const std::filesystem::path& sourcePath, const TextureImportOptions& options) {
+		auto startTime = std::chrono::high_resolution_clock::now();
+		auto cacheOptions = make_cache_options(options);
+		auto cachePath = FUtil::cache_path_for(sourcePath, &cacheOptions, sizeof(cacheOptions), ".vtex");
+
+		CachedTexture texture;
+
+		FUtil::CacheValidator isValid = [&](const FUtil::MappedFile& file) {
+			CacheHeader header;
+			if (file.size() < sizeof(header)) return false;
+			memcpy(&header, file.data(), sizeof(header));
+			return cache_is_valid(file, header) && memcmp(&header.options, &cacheOptions, sizeof(cacheOptions)) == 0;
+		};
+
+		FUtil::CacheSource cacheSource(sourcePath);
+		texture.file = FUtil::open_cache_file(cachePath, cacheSource, CACHE_MAGIC, CACHE_VERSION, isValid);
+
+		if (texture.file.data()) {
+			bind_mapping(texture);
+			texture.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+			return texture;
+		}
+
+		CacheHeader header = {};
+		TextureUtil::MipChain chain = process_texture(decode_source(sourcePath, texture.sourceStatistics), options, header.psnr);
+
+		header.file = cacheSource.header(CACHE_MAGIC, CACHE_VERSION);
+		header.options = cacheOptions;
+		texture.file = write_cache(cachePath, cacheSource, isValid, chain, header);
+		texture.rebuilt = true;
+		bind_mapping(texture);
+
+		texture.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+		return texture;
+	}
+
+	CachedTexture create_texture(const uint8* rgba, vk::Extent2D extent, const TextureImportOptions& options) {
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		SourceImage source;
+		source.extent = extent;
+		source.texels.assign(rgba, rgba + (size_t)extent.width * extent.height * 4);
+
+		CachedTexture texture;
+		TextureUtil::MipChain chain = process_texture(source, options, texture.psnr);
+
+		texture.format = chain.format;
+		texture.extent = extent;
+		texture.levels = chain.levels;
+		texture.memory = std::move(chain.data);
+		texture.data = texture.memory.data();
+		texture.dataSize = texture.memory.size();
+
+		texture.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+		return texture;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+#include <Core/Render/TextureCompression.h>
+#include <Core/TextureLoaders/HdrImage.h>
+#include <Core/Util/FileUtil.h>
+
+#include <filesystem>
+#include <vector>
+
+namespace std {
+	namespace filesystem = experimental::filesystem;
+}
+
+/*
+	Binary cache for imported textures, stored next to the source file as "<source>.<options hash>.vtex".
+
+	The cache holds every mip level exactly as it is uploaded to the gpu, block compressed unless the import options
+	ask otherwise. Compressing a large texture takes seconds, loading the cache only maps the file.
+	It is keyed by the size, modification time and content hash of the source file and rebuilt whenever those change,
+	the import options differ or the cache format version is bumped.
+*/
+
+namespace TextureLoaders {
+	enum class TextureUsage {
+		// Srgb color, compressed to BC1 or to BC3 if any texel is not opaque
+		Color,
+		// Data like roughness or masks, compressed like color but filtered and sampled without srgb conversion
+		Linear,
+		// Tangent space normals, compressed to BC5 which keeps x and y. The shader has to reconstruct z
+		NormalMap
+	};
+
+	struct TextureImportOptions {
+		// Ignored for high dynamic range sources, which are always linear color and compress to BC6H
+		TextureUsage usage = TextureUsage::Color;
+		// Uncompressed textures are stored as rgba8, or as rgba half floats for high dynamic range sources
+		bool compress = true;
+		TextureUtil::CompressionQuality quality = TextureUtil::CompressionQuality::Normal;
+		TextureUtil::MipFilter mipFilter = TextureUtil::MipFilter::Kaiser;
+	};
+
+	struct CachedTexture {
+		FUtil::MappedFile file;
+
+		vk::Format format = vk::Format::eUndefined;
+		vk::Extent2D extent;
+		// Texels or blocks of every level, largest first. Points into the mapped file, or into `memory` for create_texture
+		const uint8* data = nullptr;
+		size_t dataSize = 0;
+		std::vector<TextureUtil::MipLevel> levels;
+
+		// Peak signal to noise ratio of the compressed top level against the source, infinite if stored uncompressed
+		float psnr = 0;
+
+		// Whether the cache had to be (re)built from the source file on this load
+		bool rebuilt = false;
+		// Statistics of decoding the source file, only valid if the cache was rebuilt from an .exr or .hdr file
+		HdrLoadStatistics sourceStatistics;
+		// Time spent in load_cached_texture, including a rebuild
+		double seconds = 0;
+
+		std::vector<uint8> memory;
+
+		uint32 levelCount() const { return (uint32)levels.size(); }
+	};
+
+	// Loads the texture at `sourcePath` through its cache, building the cache first if it is missing or stale.
+	// OpenEXR and Radiance .hdr files are loaded as high dynamic range images, see Exr.h and Radiance.h. Any other format is read
+	// through stb_image
+	extern CachedTexture load_cached_texture(const std::filesystem::path& sourcePath, const TextureImportOptions& options = {});
+	// Processes rgba8 texels in memory the same way, without a cache
+	extern CachedTexture create_texture(const uint8* rgba, vk::Extent2D extent, const TextureImportOptions& options = {});
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "CacheFile.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+namespace FUtil {
+
+	namespace {
+		// Name no other writer in this or another process uses at the same time
+		std::filesystem::path temporary_path_for(const std::filesystem::path& cachePath) {
+			static std::atomic<uint64> writeCount(0);
+
+			uint64 unique[3] = {
+				(uint64)std::hash<std::thread::id>()(std::this_thread::get_id()),
+				(uint64)std::chrono::high_resolution_clock::now().time_since_epoch().count(),
+				writeCount++
+			};
+
+			std::stringstream suffix;
+			suffix << "." << std::hex << std::setw(16) << std::setfill('0') << hash_bytes(unique, sizeof(unique)) << ".tmp";
+
+			auto temporaryPath = cachePath;
+			temporaryPath += suffix.str();
+			return temporaryPath;
+		}
+	}
+
+	CacheSource::CacheSource(const std::filesystem::path& t_path) : path(t_path) {
+		size = std::filesystem::file_size(path);
+		modificationTime = file_modification_time(path);
+	}
+
+	uint64 CacheSource::hash() {
+		if (!hashed) {
+			MappedFile file(path);
+			contentHash = hash_bytes(file.data(), file.size());
+			hashed = true;
+		}
+
+		return contentHash;
+	}
+
+	CacheFileHeader CacheSource::header(const char (&magic)[4], uint32 version) {
+		CacheFileHeader header;
+		memcpy(header.magic, magic, sizeof(header.magic));
+		header.version = version;
+		header.sourceSize = size;
+		header.sourceModificationTime = modificationTime;
+		header.sourceHash = hash();
+		return header;
+	}
+
+	std::filesystem::path cache_path_for(const std::filesystem::path& sourcePath, const void* options, size_t optionsSize, const char* extension) {
+		std::stringstream suffix;
+		suffix << "." << std::hex << std::setw(16) << std::setfill('0') << hash_bytes(options, optionsSize) << extension;
+
+		auto cachePath = sourcePath;
+		cachePath += suffix.str();
+		return cachePath;
+	}
+
+	MappedFile open_cache_file(const std::filesystem::path& cachePath, CacheSource& source, const char (&magic)[4], uint32 version, const CacheValidator& isValid) {
+		if (!std::filesystem::exists(cachePath)) return MappedFile();
+
+		MappedFile file(cachePath);
+		if (file.size() < sizeof(CacheFileHeader)) return MappedFile();
+
+		CacheFileHeader header;
+		memcpy(&header, file.data(), sizeof(header));
+		if (memcmp(header.magic, magic, sizeof(header.magic)) != 0 || header.version != version) return MappedFile();
+		if (header.sourceSize != source.size || !isValid(file)) return MappedFile();
+
+		if (header.sourceModificationTime != source.modificationTime) {
+			if (header.sourceHash != source.hash()) return MappedFile();
+
+			// Only the time is rewritten, the mapping is released first so the file can be opened for writing
+			file = MappedFile();
+			{
+				std::fstream stream(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+				stream.seekp(offsetof(CacheFileHeader, sourceModificationTime));
+				stream.write((const char*)&source.modificationTime, sizeof(source.modificationTime));
+			}
+			file = MappedFile(cachePath);
+		}
+
+		return file;
+	}
+
+	MappedFile write_cache_file(const std::filesystem::path& cachePath, CacheSource& source, const char (&magic)[4], uint32 version, const CacheValidator& isValid, const std::function<void(std::ostream& file)>& write) {
+		auto temporaryPath = temporary_path_for(cachePath);
+
+		try {
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) throw std::runtime_error("Failed to write cache: " + cachePath.string());
+
+			write(file);
+			if (!file) throw std::runtime_error("Failed to write cache: " + cachePath.string());
+		}
+		catch (...) {
+			std::error_code ignored;
+			std::filesystem::remove(temporaryPath, ignored);
+			throw;
+		}
+
+		// Renaming over an existing file fails on windows. If another loader put its equal cache in place meanwhile, that one is kept
+		try {
+			std::filesystem::remove(cachePath);
+			std::filesystem::rename(temporaryPath, cachePath);
+		}
+		catch (std::filesystem::filesystem_error&) {
+			std::error_code ignored;
+			std::filesystem::remove(temporaryPath, ignored);
+			if (!std::filesystem::exists(cachePath)) throw;
+		}
+
+		// The file in place is only known to be ours if the move succeeded, a stale cache that could not be removed fails here
+		MappedFile file = open_cache_file(cachePath, source, magic, version, isValid);
+		if (!file.data()) throw std::runtime_error("Failed to replace cache: " + cachePath.string() + ". Is it still opened by another process?");
+
+		return file;
+	}
+}
\ No newline at end of file
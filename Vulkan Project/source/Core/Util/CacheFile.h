@@ -0,0 +1,63 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <Core/Util/FileUtil.h>
+
+#include <functional>
+#include <ostream>
+
+/*
+	Shared handling of the cache files assets are converted into.
+
+	Every cache header starts with a CacheFileHeader naming the format and the source file it was built from. A cache with
+	a matching size and modification time is trusted as is, if only the time changed the content of the source decides.
+	This keeps caches alive across checkouts and copies that touch every file. New caches are written to a uniquely
+	named temporary file first and then moved into place, so an interrupted write never leaves a valid looking cache behind
+	and loaders building the same cache at once do not write into each other's file. Whatever ends up in place is
+	validated again before it is used.
+*/
+
+namespace FUtil {
+	struct CacheFileHeader {
+		char magic[4];
+		uint32 version;
+
+		// Identity of the source file the cache was built from
+		uint64 sourceSize;
+		int64 sourceModificationTime;
+		uint64 sourceHash;
+	};
+
+	// Checks the part of a cache header behind the CacheFileHeader against the file and the options it is loaded with
+	using CacheValidator = std::function<bool(const MappedFile& file)>;
+
+	class CacheSource {
+	public:
+		explicit CacheSource(const std::filesystem::path& path);
+
+		// Hash of the content, only read from disk on first use
+		uint64 hash();
+		// Header of a new cache of this source
+		CacheFileHeader header(const char (&magic)[4], uint32 version);
+
+		std::filesystem::path path;
+		uint64 size;
+		int64 modificationTime;
+
+	private:
+		uint64 contentHash = 0;
+		bool hashed = false;
+	};
+
+	// `sourcePath` with the hash of the options and `extension` appended, so every set of options gets a cache of its own
+	std::filesystem::path cache_path_for(const std::filesystem::path& sourcePath, const void* options, size_t optionsSize, const char* extension);
+
+	// Maps the cache at `cachePath` if it was built from `source` in the given format and `isValid` accepts the rest of its
+	// header. Returns an empty mapping if the cache is missing or stale. A cache kept by its content is updated to the
+	// new modification time, so the next load skips hashing again
+	MappedFile open_cache_file(const std::filesystem::path& cachePath, CacheSource& source, const char (&magic)[4], uint32 version, const CacheValidator& isValid);
+
+	// Writes a new cache through `write`, moves it to `cachePath` and maps the cache that ended up there, checked like in
+	// open_cache_file. That may also be an equal cache another loader put in place meanwhile. Throws if the cache in place
+	// is not valid, e.g. a stale one another process still holds open
+	MappedFile write_cache_file(const std::filesystem::path& cachePath, CacheSource& source, const char (&magic)[4], uint32 version, const CacheValidator& isValid, const std::function<void(std::ostream& file)>& write);
+}
\ No newline at end of file
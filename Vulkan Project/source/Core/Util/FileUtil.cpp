@@ -1,5 +1,17 @@
 #include "FileUtil.h"
 #include <fstream>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace FUtil {
 	
@@ -29,4 +41,122 @@ namespace FUtil {
 		file.close();
 		return stream;
 	}
+
+	uint64 hash_bytes(const void* data, size_t size) {
+		// FNV-1a, applied to 64 bit words instead of single bytes to keep up with the disk
+		constexpr uint64 offsetBasis = 14695981039346656037ull;
+		constexpr uint64 prime = 1099511628211ull;
+
+		const uint8* bytes = (const uint8*)data;
+		uint64 hash = offsetBasis ^ size;
+
+		size_t wordCount = size / sizeof(uint64);
+		for (size_t i = 0; i < wordCount; i++) {
+			uint64 word;
+			memcpy(&word, bytes + i * sizeof(uint64), sizeof(uint64));
+			hash = (hash ^ word) * prime;
+		}
+
+		for (size_t i = wordCount * sizeof(uint64); i < size; i++) {
+			hash = (hash ^ bytes[i]) * prime;
+		}
+
+		// FNV leaves the last words poorly mixed into the high bits, which small keys differing in a single field collide on.
+		// The fmix64 finalizer of MurmurHash3 spreads every input bit over the whole result
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdull;
+		hash ^= hash >> 33;
+		hash *= 0xc4ceb9fe1a85ec53ull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+	int64 file_modification_time(const std::filesystem::path& path) {
+		return (int64)std::filesystem::last_write_time(path).time_since_epoch().count();
+	}
+
+	MappedFile::MappedFile(const std::filesystem::path& path) {
+		// The view keeps the underlying file alive, so none of the os handles outlive the constructor
+#ifdef _WIN32
+		HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Failed to open file: " + path.string());
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize)) {
+			CloseHandle(file);
+			throw std::runtime_error("Failed to query size of file: " + path.string());
+		}
+
+		// Mapping an empty file is an error on windows, so an empty file is simply an empty view
+		if (fileSize.QuadPart == 0) {
+			CloseHandle(file);
+			return;
+		}
+
+		HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping) {
+			mappedData = (const uint8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+
+		if (!mappedData) throw std::runtime_error("Failed to map file: " + path.string());
+		mappedSize = (size_t)fileSize.QuadPart;
+#else
+		int file = open(path.c_str(), O_RDONLY);
+		if (file < 0) throw std::runtime_error("Failed to open file: " + path.string());
+
+		struct stat fileStat;
+		if (fstat(file, &fileStat) != 0) {
+			::close(file);
+			throw std::runtime_error("Failed to query size of file: " + path.string());
+		}
+
+		if (fileStat.st_size == 0) {
+			::close(file);
+			return;
+		}
+
+		void* mapping = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		::close(file);
+
+		if (mapping == MAP_FAILED) throw std::runtime_error("Failed to map file: " + path.string());
+		madvise(mapping, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+
+		mappedData = (const uint8*)mapping;
+		mappedSize = (size_t)fileStat.st_size;
+#endif
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) {
+		*this = std::move(other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) {
+		if (this != &other) {
+			close();
+
+			std::swap(mappedData, other.mappedData);
+			std::swap(mappedSize, other.mappedSize);
+		}
+
+		return *this;
+	}
+
+	MappedFile::~MappedFile() {
+		close();
+	}
+
+	void MappedFile::close() {
+		if (mappedData) {
+#ifdef _WIN32
+			UnmapViewOfFile(mappedData);
+#else
+			munmap((void*)mappedData, mappedSize);
+#endif
+		}
+
+		mappedData = nullptr;
+		mappedSize = 0;
+	}
 }
\ No newline at end of file
@@ -12,4 +12,34 @@ namespace FUtil {
 	std::vector<int8> file_read_binary(const std::string& filename);
 	std::stringstream file_read_stringstream(const std::filesystem::path);
 
+	// Hashes a block of memory, used to detect changes in source files of cached assets. Not cryptographically secure
+	uint64 hash_bytes(const void* data, size_t size);
+	// Last modification time of a file as an opaque tick count, only meaningful for comparisons
+	int64 file_modification_time(const std::filesystem::path& path);
+
+	/*
+		Read-only view of a file mapped into the address space of the process.
+		Pages are only read from disk when they are first touched, so large files can be consumed
+		straight from the mapping without copying them into an intermediate buffer first.
+	*/
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		explicit MappedFile(const std::filesystem::path& path);
+		MappedFile(MappedFile&& other);
+		MappedFile& operator=(MappedFile&& other);
+		~MappedFile();
+
+		const uint8* data() const { return mappedData; }
+		size_t size() const { return mappedSize; }
+
+	private:
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		void close();
+
+		const uint8* mappedData = nullptr;
+		size_t mappedSize = 0;
+	};
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <atomic>
+#include <utility>
+
+/*
+	Queue for many producer threads and a single consumer that never takes a lock.
+
+	Producers push onto an atomic list with a compare and swap. The consumer takes the whole list with a single exchange
+	and reverses it, so items come out in the order they were pushed. As nodes are only ever removed all at once
+	the queue is not affected by the ABA problem of lock-free stacks that pop single nodes.
+*/
+
+template<class T>
+class LockFreeQueue {
+public:
+	LockFreeQueue() = default;
+	~LockFreeQueue() {
+		drain([](T&) { });
+	}
+
+	void push(T value) {
+		Node* node = new Node{ std::move(value), head.load(std::memory_order_relaxed) };
+		while (!head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	// Calls `consumer` for every item pushed so far, oldest first. Only one thread may drain the queue at a time
+	template<class Consumer>
+	size_t drain(Consumer consumer) {
+		Node* node = head.exchange(nullptr, std::memory_order_acquire);
+
+		Node* oldest = nullptr;
+		while (node) {
+			Node* next = node->next;
+			node->next = oldest;
+			oldest = node;
+			node = next;
+		}
+
+		size_t count = 0;
+		while (oldest) {
+			uptr<Node> current(oldest);
+			oldest = current->next;
+
+			consumer(current->value);
+			count++;
+		}
+
+		return count;
+	}
+
+	bool empty() const {
+		return head.load(std::memory_order_acquire) == nullptr;
+	}
+
+private:
+	LockFreeQueue(const LockFreeQueue&) = delete;
+	LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+	struct Node {
+		T value;
+		Node* next;
+	};
+
+	std::atomic<Node*> head { nullptr };
+};
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "TlsfAllocator.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+	// Index of the lowest set bit, `value` must not be 0
+	uint32 lowest_bit(uint64 value) {
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return (uint32)index;
+#else
+		return (uint32)__builtin_ctzll(value);
+#endif
+	}
+
+	// Index of the highest set bit, `value` must not be 0
+	uint32 highest_bit(uint64 value) {
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return (uint32)index;
+#else
+		return 63 - (uint32)__builtin_clzll(value);
+#endif
+	}
+
+	uint64 align_up(uint64 value, uint64 alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+TlsfAllocator::TlsfAllocator(uint64 size) : totalSize(size) {
+	for (auto& lists : freeLists) {
+		for (auto& list : lists) list = INVALID_NODE;
+	}
+
+	if (size > 0) insertFree(createNode(0, size));
+}
+
+void TlsfAllocator::mapping(uint64 size, uint32& firstLevel, uint32& secondLevel) {
+	if (size < (1ull << SMALL_SIZE_BITS)) {
+		firstLevel = 0;
+		secondLevel = (uint32)(size >> (SMALL_SIZE_BITS - SECOND_LEVEL_BITS));
+		return;
+	}
+
+	uint32 log = highest_bit(size);
+	firstLevel = log - SMALL_SIZE_BITS + 1;
+	secondLevel = (uint32)(size >> (log - SECOND_LEVEL_BITS)) & (SECOND_LEVEL_COUNT - 1);
+}
+
+uint32 TlsfAllocator::createNode(uint64 offset, uint64 size) {
+	uint32 node;
+	if (!unusedNodes.empty()) {
+		node = unusedNodes.back();
+		unusedNodes.pop_back();
+		nodes[node] = Node();
+	}
+	else {
+		node = (uint32)nodes.size();
+		nodes.emplace_back();
+	}
+
+	nodes[node].offset = offset;
+	nodes[node].size = size;
+	return node;
+}
+
+void TlsfAllocator::releaseNode(uint32 node) {
+	unusedNodes.push_back(node);
+}
+
+void TlsfAllocator::insertFree(uint32 node) {
+	uint32 firstLevel, secondLevel;
+	mapping(nodes[node].size, firstLevel, secondLevel);
+
+	uint32& head = freeLists[firstLevel][secondLevel];
+	nodes[node].free = true;
+	nodes[node].previousFree = INVALID_NODE;
+	nodes[node].nextFree = head;
+	if (head != INVALID_NODE) nodes[head].previousFree = node;
+	head = node;
+
+	firstLevelBitmap |= 1ull << firstLevel;
+	secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+	freeCount++;
+}
+
+void TlsfAllocator::removeFree(uint32 node) {
+	uint32 firstLevel, secondLevel;
+	mapping(nodes[node].size, firstLevel, secondLevel);
+
+	Node& entry = nodes[node];
+	if (entry.previousFree != INVALID_NODE) nodes[entry.previousFree].nextFree = entry.nextFree;
+	else freeLists[firstLevel][secondLevel] = entry.nextFree;
+	if (entry.nextFree != INVALID_NODE) nodes[entry.nextFree].previousFree = entry.previousFree;
+
+	if (freeLists[firstLevel][secondLevel] == INVALID_NODE) {
+		secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+		if (secondLevelBitmaps[firstLevel] == 0) firstLevelBitmap &= ~(1ull << firstLevel);
+	}
+
+	entry.free = false;
+	freeCount--;
+}
+
+uint32 TlsfAllocator::findFree(uint64 size) const {
+	uint32 firstLevel, secondLevel;
+
+	// Round up to the next class boundary, so every range in the class found is large enough
+	uint64 classSize = size < (1ull << SMALL_SIZE_BITS) ? 1ull << (SMALL_SIZE_BITS - SECOND_LEVEL_BITS) : 1ull << (highest_bit(size) - SECOND_LEVEL_BITS);
+	if (size <= ~0ull - classSize) {
+		mapping(align_up(size, classSize), firstLevel, secondLevel);
+
+		uint32 secondLevelMap = secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+		uint64 firstLevelMap = firstLevel + 1 < 64 ? firstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+
+		if (secondLevelMap != 0) return freeLists[firstLevel][lowest_bit(secondLevelMap)];
+		if (firstLevelMap != 0) {
+			firstLevel = lowest_bit(firstLevelMap);
+			return freeLists[firstLevel][lowest_bit(secondLevelBitmaps[firstLevel])];
+		}
+	}
+
+	// Only the class of `size` itself is left, its ranges may still fit, e.g. a range of exactly the requested size
+	mapping(size, firstLevel, secondLevel);
+	for (uint32 node = freeLists[firstLevel][secondLevel]; node != INVALID_NODE; node = nodes[node].nextFree) {
+		if (nodes[node].size >= size) return node;
+	}
+
+	return INVALID_NODE;
+}
+
+TlsfAllocator::Allocation TlsfAllocator::allocate(uint64 size, uint64 alignment) {
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0) throw std::runtime_error("Alignment has to be a power of two.");
+	if (size == 0) size = 1;
+
+	// Room for moving the start up to the alignment, unless every range is aligned well enough already
+	uint64 padding = alignment > 1 ? alignment - 1 : 0;
+	if (size > ~0ull - padding) return Allocation();
+
+	uint32 node = findFree(size + padding);
+	if (node == INVALID_NODE) return Allocation();
+	removeFree(node);
+
+	// The free space before the aligned start becomes a range of its own. Its physical neighbour is in use, free neighbours are always merged
+	uint64 alignedOffset = align_up(nodes[node].offset, alignment);
+	if (alignedOffset > nodes[node].offset) {
+		uint32 front = createNode(nodes[node].offset, alignedOffset - nodes[node].offset);
+		nodes[front].previousPhysical = nodes[node].previousPhysical;
+		nodes[front].nextPhysical = node;
+		if (nodes[front].previousPhysical != INVALID_NODE) nodes[nodes[front].previousPhysical].nextPhysical = front;
+
+		nodes[node].previousPhysical = front;
+		nodes[node].offset = alignedOffset;
+		nodes[node].size -= nodes[front].size;
+		insertFree(front);
+	}
+
+	// Same for the space behind the allocation
+	if (nodes[node].size > size) {
+		uint32 back = createNode(nodes[node].offset + size, nodes[node].size - size);
+		nodes[back].previousPhysical = node;
+		nodes[back].nextPhysical = nodes[node].nextPhysical;
+		if (nodes[back].nextPhysical != INVALID_NODE) nodes[nodes[back].nextPhysical].previousPhysical = back;
+
+		nodes[node].nextPhysical = back;
+		nodes[node].size = size;
+		insertFree(back);
+	}
+
+	allocatedSize += size;
+	allocatedCount++;
+
+	Allocation allocation;
+	allocation.offset = nodes[node].offset;
+	allocation.size = size;
+	allocation.node = node;
+	return allocation;
+}
+
+void TlsfAllocator::free(const Allocation& allocation) {
+	uint32 node = allocation.node;
+	if (node >= nodes.size() || nodes[node].free || nodes[node].offset != allocation.offset) throw std::runtime_error("Freeing a range that is not allocated.");
+
+	allocatedSize -= nodes[node].size;
+	allocatedCount--;
+
+	// Absorb free neighbours, keeping this node
+	uint32 previous = nodes[node].previousPhysical;
+	if (previous != INVALID_NODE && nodes[previous].free) {
+		removeFree(previous);
+		nodes[node].offset = nodes[previous].offset;
+		nodes[node].size += nodes[previous].size;
+		nodes[node].previousPhysical = nodes[previous].previousPhysical;
+		if (nodes[node].previousPhysical != INVALID_NODE) nodes[nodes[node].previousPhysical].nextPhysical = node;
+		releaseNode(previous);
+	}
+
+	uint32 next = nodes[node].nextPhysical;
+	if (next != INVALID_NODE && nodes[next].free) {
+		removeFree(next);
+		nodes[node].size += nodes[next].size;
+		nodes[node].nextPhysical = nodes[next].nextPhysical;
+		if (nodes[node].nextPhysical != INVALID_NODE) nodes[nodes[node].nextPhysical].previousPhysical = node;
+		releaseNode(next);
+	}
+
+	insertFree(node);
+}
+
+uint64 TlsfAllocator::largestFreeRange() const {
+	if (firstLevelBitmap == 0) return 0;
+
+	// Only the highest non-empty class can hold the largest range, but ranges within a class differ in size
+	uint32 firstLevel = highest_bit(firstLevelBitmap);
+	uint32 secondLevel = highest_bit(secondLevelBitmaps[firstLevel]);
+
+	uint64 largest = 0;
+	for (uint32 node = freeLists[firstLevel][secondLevel]; node != INVALID_NODE; node = nodes[node].nextFree) {
+		if (nodes[node].size > largest) largest = nodes[node].size;
+	}
+
+	return largest;
+}
\ No newline at end of file
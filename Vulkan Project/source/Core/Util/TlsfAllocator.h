@@ -0,0 +1,82 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <vector>
+
+/*
+	Two level segregated fit allocator for ranges of an address space it does not own, like a block of device memory.
+
+	Free ranges are kept in lists by size class, a first level per power of two split into 32 linear second level classes,
+	with a bitmap per level. Finding a fitting range and freeing one are constant time, freed ranges are merged with free
+	neighbours right away so no two free ranges are ever adjacent.
+	Only offsets are handed out, the allocator never touches the memory itself, so it runs without a device.
+*/
+
+class TlsfAllocator {
+public:
+	static constexpr uint32 INVALID_NODE = ~0u;
+
+	struct Allocation {
+		uint64 offset = 0;
+		uint64 size = 0;
+		// Identifies the range for TlsfAllocator::free
+		uint32 node = INVALID_NODE;
+
+		bool valid() const { return node != INVALID_NODE; }
+	};
+
+	explicit TlsfAllocator(uint64 size);
+
+	// Finds `size` bytes starting at a multiple of `alignment`, which has to be a power of two.
+	// Returns an invalid allocation if no free range fits
+	Allocation allocate(uint64 size, uint64 alignment = 1);
+	void free(const Allocation& allocation);
+
+	uint64 size() const { return totalSize; }
+	uint64 usedSize() const { return allocatedSize; }
+	uint32 allocationCount() const { return allocatedCount; }
+	uint32 freeRangeCount() const { return freeCount; }
+	// Largest request without alignment that would succeed right now
+	uint64 largestFreeRange() const;
+	bool empty() const { return allocatedCount == 0; }
+
+private:
+	static constexpr uint32 SECOND_LEVEL_BITS = 5;
+	static constexpr uint32 SECOND_LEVEL_COUNT = 1 << SECOND_LEVEL_BITS;
+	// Ranges below this size share the first level and are split into linear classes of 8 bytes
+	static constexpr uint32 SMALL_SIZE_BITS = 8;
+	static constexpr uint32 FIRST_LEVEL_COUNT = 64 - SMALL_SIZE_BITS + 1;
+
+	struct Node {
+		uint64 offset = 0;
+		uint64 size = 0;
+		// Neighbours in the address space
+		uint32 previousPhysical = INVALID_NODE;
+		uint32 nextPhysical = INVALID_NODE;
+		// Neighbours in the free list of the size class, only used while free
+		uint32 previousFree = INVALID_NODE;
+		uint32 nextFree = INVALID_NODE;
+		bool free = false;
+	};
+
+	static void mapping(uint64 size, uint32& firstLevel, uint32& secondLevel);
+
+	uint32 createNode(uint64 offset, uint64 size);
+	void releaseNode(uint32 node);
+	void insertFree(uint32 node);
+	void removeFree(uint32 node);
+	// Free node of at least `size` bytes from the first class guaranteed to fit, falling back to the class of `size` itself. INVALID_NODE if none fits
+	uint32 findFree(uint64 size) const;
+
+	std::vector<Node> nodes;
+	// Unused entries of `nodes`
+	std::vector<uint32> unusedNodes;
+
+	uint64 firstLevelBitmap = 0;
+	uint32 secondLevelBitmaps[FIRST_LEVEL_COUNT] = {};
+	uint32 freeLists[FIRST_LEVEL_COUNT][SECOND_LEVEL_COUNT];
+
+	uint64 totalSize = 0;
+	uint64 allocatedSize = 0;
+	uint32 allocatedCount = 0;
+	uint32 freeCount = 0;
+};
\ No newline at end of file
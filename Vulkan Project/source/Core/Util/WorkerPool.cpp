@@ -0,0 +1,124 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+
+WorkerPool::WorkerPool(uint32 threadCount) {
+	if (threadCount == 0) threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+	for (uint32 i = 0; i < threadCount; i++) {
+		threads.emplace_back(&WorkerPool::run, this);
+	}
+}
+
+namespace {
+	// State of one parallel_for, shared with helper jobs that may still be queued when the loop returns
+	struct ParallelLoop {
+		ParallelLoop(uint32 count, const std::function<void(ParallelRange&)>& t_worker) : range(count), worker(&t_worker) { }
+
+		ParallelRange range;
+		// Only valid until `finished` is set
+		const std::function<void(ParallelRange&)>* worker;
+
+		std::mutex mutex;
+		std::condition_variable helperStopped;
+		uint32 runningHelpers = 0;
+		uint32 workerCount = 1;
+		bool finished = false;
+		std::exception_ptr error;
+
+		void run() {
+			try {
+				(*worker)(range);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!error) error = std::current_exception();
+				range.cancel();
+			}
+		}
+	};
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		jobs.clear();
+	}
+	jobAvailable.notify_all();
+
+	for (auto& thread : threads) thread.join();
+}
+
+void WorkerPool::submit(std::function<void()> job) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+void WorkerPool::run() {
+	while (true) {
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [&]() { return stopping || !jobs.empty(); });
+			if (stopping) return;
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		job();
+	}
+}
+
+WorkerPool& WorkerPool::shared() {
+	static WorkerPool pool;
+	return pool;
+}
+
+uint32 parallel_for(uint32 count, uint32 minPerWorker, const std::function<void(ParallelRange& range)>& worker) {
+	WorkerPool& pool = WorkerPool::shared();
+	uint32 workerCount = std::max(1u, std::min(pool.threadCount() + 1, count / std::max(1u, minPerWorker)));
+
+	if (workerCount == 1) {
+		ParallelRange range(count);
+		worker(range);
+		return 1;
+	}
+
+	auto loop = std::make_shared<ParallelLoop>(count, worker);
+
+	for (uint32 i = 1; i < workerCount; i++) {
+		pool.submit([loop]() {
+			{
+				std::lock_guard<std::mutex> lock(loop->mutex);
+				if (loop->finished) return;
+				loop->runningHelpers++;
+				loop->workerCount++;
+			}
+
+			loop->run();
+
+			{
+				std::lock_guard<std::mutex> lock(loop->mutex);
+				loop->runningHelpers--;
+			}
+			loop->helperStopped.notify_all();
+		});
+	}
+
+	loop->run();
+
+	std::unique_lock<std::mutex> lock(loop->mutex);
+	loop->finished = true;
+	loop->helperStopped.wait(lock, [&]() { return loop->runningHelpers == 0; });
+
+	if (loop->error) std::rethrow_exception(loop->error);
+	return loop->workerCount;
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+	Fixed set of threads running jobs in the order they were submitted.
+	Jobs that are still queued when the pool is destroyed are dropped, running jobs are finished first.
+	Jobs must not throw, errors have to be handed back to whoever submitted the job.
+*/
+
+class WorkerPool {
+public:
+	// 0 threads picks one less than the hardware has, leaving a core to the render thread
+	explicit WorkerPool(uint32 threadCount = 0);
+	~WorkerPool();
+
+	void submit(std::function<void()> job);
+
+	// Pool shared by the whole process. Background decoding and parallel loops all run on it, so nested parallel work
+	// never starts more threads than the hardware has
+	static WorkerPool& shared();
+
+	uint32 threadCount() const { return (uint32)threads.size(); }
+
+private:
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	void run();
+
+	std::vector<std::thread> threads;
+	std::deque<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	bool stopping = false;
+};
+
+/*
+	Indices of a parallel loop, handed out one at a time to whichever worker asks first.
+*/
+
+class ParallelRange {
+public:
+	explicit ParallelRange(uint32 t_count) : count(t_count) { }
+
+	// Takes the next index, false once every index was taken
+	bool next(uint32& index) {
+		index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+		return index < count;
+	}
+
+	// Makes next fail for every worker, used to stop a loop early after an error
+	void cancel() { nextIndex.store(count, std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint32> nextIndex { 0 };
+	uint32 count;
+};
+
+// Runs `worker` on the calling thread and on up to count / minPerWorker - 1 threads of the shared pool, each taking indices
+// from the range until it is exhausted. Pool threads that only start once the calling thread ran out of indices skip the loop,
+// so this never waits for queued jobs and can be called from jobs on the pool itself.
+// Rethrows the first exception of any worker once all of them stopped. Returns the number of workers that took part
+uint32 parallel_for(uint32 count, uint32 minPerWorker, const std::function<void(ParallelRange& range)>& worker);
+
+// Runs `job(index)` for every index below `count`, see parallel_for
+template<class Job>
+uint32 parallel_for_each(uint32 count, uint32 minPerWorker, Job job) {
+	return parallel_for(count, minPerWorker, [&](ParallelRange& range) {
+		for (uint32 index; range.next(index);) job(index);
+	});
+}
\ No newline at end of file
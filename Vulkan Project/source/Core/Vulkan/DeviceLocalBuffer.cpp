@@ -1,6 +1,9 @@
 #include "DeviceLocalBuffer.h"
 #include <Core/Vulkan/VkUtil.h>
 
+#include <algorithm>
+#include <cstring>
+
 DeviceLocalBuffer::DeviceLocalBuffer(VulkanInstance& t_vulkan, vk::BufferUsageFlags t_flags) : vulkan(t_vulkan), usageFlags(t_flags) {
 
 }
@@ -10,31 +13,83 @@ DeviceLocalBuffer::~DeviceLocalBuffer() {
 }
 
 void DeviceLocalBuffer::destroyCurrentBuffers() {
-	vulkan.device.freeMemory(bufferMemory);
-	vulkan.device.freeMemory(stagingBufferMemory);
-	vulkan.device.destroyBuffer(buffer);
-	vulkan.device.destroyBuffer(stagingBuffer);
+	VkUtil::destroyBuffer(vulkan, buffer, bufferMemory);
+}
+
+void DeviceLocalBuffer::fill(const void* data, uint32 dataSize) {
+	UploadContext upload(vulkan);
+	fill(data, dataSize, upload);
+	upload.wait();
+}
+
+void DeviceLocalBuffer::fill(const void* data, uint32 dataSize, UploadContext& upload) {
+	// The old contents are overwritten completely, so growing does not have to copy them
+	dirtyRanges.clear();
+	resize(dataSize);
+	update(0, data, dataSize);
+	flush(upload);
 }
 
-void DeviceLocalBuffer::fill(void* data, uint32 dataSize) {
-	if (currentBufferSize != dataSize) {
-		resize(dataSize);
+void DeviceLocalBuffer::update(uint32 offset, const void* data, uint32 dataSize) {
+	if (dataSize == 0) return;
+	if (offset + dataSize > currentBufferSize) resize(offset + dataSize);
+
+	// Merge with every range that overlaps or touches the new one, the new data wins
+	auto first = std::lower_bound(dirtyRanges.begin(), dirtyRanges.end(), offset, [](const DirtyRange& range, uint32 offset) {
+		return range.offset + range.data.size() < offset;
+	});
+	auto last = first;
+	while (last != dirtyRanges.end() && last->offset <= offset + dataSize) last++;
+
+	DirtyRange merged;
+	merged.offset = offset;
+	uint32 end = offset + dataSize;
+	if (first != last) {
+		merged.offset = std::min(offset, first->offset);
+		end = std::max(end, (uint32)((last - 1)->offset + (last - 1)->data.size()));
 	}
 
-	void* datamap = vulkan.device.mapMemory(stagingBufferMemory, 0, dataSize);
-	memcpy(datamap, data, dataSize);
-	vulkan.device.unmapMemory(stagingBufferMemory);
+	merged.data.resize(end - merged.offset);
+	for (auto range = first; range != last; range++) memcpy(merged.data.data() + (range->offset - merged.offset), range->data.data(), range->data.size());
+	memcpy(merged.data.data() + (offset - merged.offset), data, dataSize);
 
-	VkUtil::copyBuffer(vulkan, stagingBuffer, buffer, dataSize);
+	auto position = dirtyRanges.erase(first, last);
+	dirtyRanges.insert(position, std::move(merged));
 }
 
-void DeviceLocalBuffer::resize(uint32 bufferSize) {
-	// Destroy the old buffers
-	destroyCurrentBuffers();
+void DeviceLocalBuffer::flush(UploadContext& upload) {
+	if (currentBufferSize > capacity) {
+		uint32 newCapacity = std::max(currentBufferSize, capacity * 2);
 
-	// Recreate the vertex and staging buffers
-	VkUtil::createBuffer(vulkan, bufferSize, vk::BufferUsageFlagBits::eTransferDst | usageFlags, vk::MemoryPropertyFlagBits::eDeviceLocal, buffer, bufferMemory);
-	VkUtil::createBuffer(vulkan, bufferSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory);
+		vk::Buffer newBuffer;
+		MemoryAllocation newMemory;
+		VkUtil::createBuffer(vulkan, newCapacity, vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst | usageFlags, vk::MemoryPropertyFlagBits::eDeviceLocal, newBuffer, newMemory);
 
+		// Contents that are not about to be overwritten anyway are copied over on the gpu
+		bool overwritten = !dirtyRanges.empty() && dirtyRanges.front().offset == 0 && dirtyRanges.front().data.size() >= capacity;
+		if (buffer) {
+			if (!overwritten) {
+				upload.copyBuffer(buffer, newBuffer, capacity);
+				upload.transferBarrier();
+			}
+			upload.retireBuffer(buffer, bufferMemory);
+		}
+
+		buffer = newBuffer;
+		bufferMemory = newMemory;
+		capacity = newCapacity;
+	}
+
+	for (auto& range : dirtyRanges) upload.uploadBuffer(range.data.data(), range.data.size(), buffer, range.offset);
+	dirtyRanges.clear();
+}
+
+void DeviceLocalBuffer::resize(uint32 bufferSize) {
 	currentBufferSize = bufferSize;
+
+	// Updates past the new end are dropped
+	while (!dirtyRanges.empty() && dirtyRanges.back().offset >= bufferSize) dirtyRanges.pop_back();
+	if (!dirtyRanges.empty() && dirtyRanges.back().offset + dirtyRanges.back().data.size() > bufferSize) {
+		dirtyRanges.back().data.resize(bufferSize - dirtyRanges.back().offset);
+	}
 }
\ No newline at end of file
@@ -1,13 +1,18 @@
 #pragma once
 #include <Core/Definitions.h>
 #include <Core/Vulkan/VulkanInstance.h>
+#include <Core/Vulkan/UploadContext.h>
+
+#include <vector>
 
 /*
 	Provides a simple to use interface with a device local buffer.
 	As such it provides super high performance perfect for rarely changing vertex or index buffers.
 
-	It however requires that the entire buffer be updated as a whole and uses a staging buffer for 
-	transfering data to the gpu. As such frequent updates are gonna be slower than using a HostVisibleBuffer.
+	Data is written with update, which keeps a copy of it until the next flush records the copies to the gpu. Overlapping and
+	neighbouring updates are merged into a single copy. The buffer has a capacity that grows by at least doubling whenever
+	the data reaches past it, the old contents are copied over on the gpu and the old buffer lives until that copy finished.
+	Staging memory is owned by the UploadContext the copies are recorded into, not by the buffer.
 */
 
 class DeviceLocalBuffer {
@@ -15,22 +20,34 @@ public:
 	DeviceLocalBuffer(VulkanInstance& vulkan, vk::BufferUsageFlags usageFlags);
 	~DeviceLocalBuffer();
 
-	/* Fills the current buffer. If dataSize is unequal to the current size of the buffer, it also calls this::resize. */
-	void fill(void* data, uint32 dataSize);
+	/* Replaces the contents of the buffer with `data` and waits for the upload */
+	void fill(const void* data, uint32 dataSize);
+	/* Same as fill, but only records the copy into `upload` instead of waiting for it */
+	void fill(const void* data, uint32 dataSize, UploadContext& upload);
 
-	/* Deletes the current buffers and replaces them with new ones */
-	void resize(uint32 bufferSize);
+	/* Writes `dataSize` bytes at `offset` with the next flush, growing the buffer if they reach past its end */
+	void update(uint32 offset, const void* data, uint32 dataSize);
+	/* Records the copies of all updates since the last flush into `upload`, growing the buffer first if needed.
+	   `buffer` may be replaced by this */
+	void flush(UploadContext& upload);
 
+	/* Changes the size of the contents. Growing past the capacity happens with the next flush, contents up to the smaller size are kept */
+	void resize(uint32 bufferSize);
 
 	vk::Buffer buffer;
-	vk::DeviceMemory bufferMemory;
-	uint32 currentBufferSize;
+	MemoryAllocation bufferMemory;
+	uint32 currentBufferSize = 0;
+	uint32 capacity = 0;
 private:
+	// Data of an update, sorted by offset and never overlapping or touching another one
+	struct DirtyRange {
+		uint32 offset;
+		std::vector<uint8> data;
+	};
+
 	VulkanInstance& vulkan;
-	vk::Buffer stagingBuffer;
-	vk::DeviceMemory stagingBufferMemory;
 	vk::BufferUsageFlags usageFlags;
+	std::vector<DirtyRange> dirtyRanges;
 
 	void destroyCurrentBuffers();
-};
-
+};
\ No newline at end of file
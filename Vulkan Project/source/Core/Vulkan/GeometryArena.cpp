@@ -0,0 +1,49 @@
+#include "GeometryArena.h"
+#include <Core/Vulkan/VkUtil.h>
+
+GeometryArena::GeometryArena(VulkanInstance& t_vulkan, vk::DeviceSize vertexCapacity, vk::DeviceSize indexCapacity) : vulkan(t_vulkan), vertexAllocator(vertexCapacity), indexAllocator(indexCapacity) {
+	VkUtil::createBuffer(vulkan, vertexCapacity, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, vertexBuffer, vertexMemory, true);
+	VkUtil::createBuffer(vulkan, indexCapacity, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, indexBuffer, indexMemory, true);
+}
+
+GeometryArena::~GeometryArena() {
+	VkUtil::destroyBuffer(vulkan, vertexBuffer, vertexMemory);
+	VkUtil::destroyBuffer(vulkan, indexBuffer, indexMemory);
+}
+
+GeometryRange GeometryArena::allocate(uint32 vertexCount, uint32 vertexStride, uint32 indexCount, uint32 indexSize) {
+	GeometryRange range;
+	range.vertexCount = vertexCount;
+	range.indexCount = indexCount;
+
+	// Strides are rarely powers of two, so the range is padded by up to one vertex and its start rounded up to the stride
+	range.vertexRange = vertexAllocator.allocate((vk::DeviceSize)vertexCount * vertexStride + vertexStride - 1);
+	if (!range.vertexRange.valid()) throw std::runtime_error("The geometry arena is out of vertex space.");
+	range.firstVertex = (uint32)((range.vertexRange.offset + vertexStride - 1) / vertexStride);
+	range.vertexDataOffset = (vk::DeviceSize)range.firstVertex * vertexStride;
+
+	if (indexCount > 0) {
+		range.indexRange = indexAllocator.allocate((vk::DeviceSize)indexCount * indexSize, INDEX_ALIGNMENT);
+		if (!range.indexRange.valid()) {
+			vertexAllocator.free(range.vertexRange);
+			throw std::runtime_error("The geometry arena is out of index space.");
+		}
+
+		range.firstIndex = (uint32)(range.indexRange.offset / indexSize);
+		range.indexDataOffset = range.indexRange.offset;
+	}
+
+	return range;
+}
+
+void GeometryArena::free(GeometryRange& range) {
+	if (range.vertexRange.valid()) vertexAllocator.free(range.vertexRange);
+	if (range.indexRange.valid()) indexAllocator.free(range.indexRange);
+	range = GeometryRange();
+}
+
+void GeometryArena::bind(vk::CommandBuffer commandBuffer, vk::IndexType indexType) const {
+	vk::DeviceSize offsets[] = { 0 };
+	commandBuffer.bindVertexBuffers(0, 1, &vertexBuffer, offsets);
+	commandBuffer.bindIndexBuffer(indexBuffer, 0, indexType);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <Core/Util/TlsfAllocator.h>
+#include <Core/Vulkan/VulkanInstance.h>
+
+/*
+	One device local vertex buffer and one index buffer that the geometry of every mesh is sub-allocated from.
+
+	Meshes are drawn out of their range with the firstVertex and firstIndex of a draw instead of binding buffers of their own,
+	so any number of meshes can be drawn after a single bind. Vertex ranges start on a multiple of the vertex stride, which
+	lets meshes of different vertex formats share the buffer, index ranges on a multiple of 4 bytes for both index types.
+	Freed ranges go back to the free lists of a TlsfAllocator and are merged with free neighbours.
+	The buffers never grow, allocating past their capacity throws. Both are shared between the graphics and transfer queue
+	families, so uploads into free ranges can run next to draws from the rest.
+*/
+
+struct GeometryRange {
+	// In vertices of the stride the range was allocated with
+	uint32 firstVertex = 0;
+	uint32 vertexCount = 0;
+	// In indices of the size the range was allocated with
+	uint32 firstIndex = 0;
+	uint32 indexCount = 0;
+
+	// Byte offsets of the range for copies into the arena buffers
+	vk::DeviceSize vertexDataOffset = 0;
+	vk::DeviceSize indexDataOffset = 0;
+
+	bool valid() const { return vertexRange.valid(); }
+
+private:
+	friend class GeometryArena;
+
+	TlsfAllocator::Allocation vertexRange;
+	TlsfAllocator::Allocation indexRange;
+};
+
+class GeometryArena {
+public:
+	static constexpr vk::DeviceSize INDEX_ALIGNMENT = 4;
+
+	GeometryArena(VulkanInstance& vulkan, vk::DeviceSize vertexCapacity, vk::DeviceSize indexCapacity);
+	~GeometryArena();
+
+	/* Reserves space for `vertexCount` vertices of `vertexStride` bytes and `indexCount` indices of `indexSize` bytes.
+	   Meshes drawn without indices pass an indexCount of 0 */
+	GeometryRange allocate(uint32 vertexCount, uint32 vertexStride, uint32 indexCount = 0, uint32 indexSize = sizeof(uint32));
+	/* Returns the space of `range` to the arena and invalidates it. The gpu must not be drawing from it anymore */
+	void free(GeometryRange& range);
+
+	/* Binds the vertex buffer to binding 0 and the index buffer with `indexType` */
+	void bind(vk::CommandBuffer commandBuffer, vk::IndexType indexType = vk::IndexType::eUint32) const;
+
+	vk::DeviceSize usedVertexSize() const { return vertexAllocator.usedSize(); }
+	vk::DeviceSize usedIndexSize() const { return indexAllocator.usedSize(); }
+	uint32 rangeCount() const { return vertexAllocator.allocationCount(); }
+
+	vk::Buffer vertexBuffer;
+	vk::Buffer indexBuffer;
+private:
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+
+	VulkanInstance& vulkan;
+	MemoryAllocation vertexMemory;
+	MemoryAllocation indexMemory;
+	TlsfAllocator vertexAllocator;
+	TlsfAllocator indexAllocator;
+};
\ No newline at end of file
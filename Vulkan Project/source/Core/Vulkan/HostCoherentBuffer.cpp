@@ -1,6 +1,9 @@
 #include "HostCoherentBuffer.h"
 #include <Core/Vulkan/VkUtil.h>
 
+#include <algorithm>
+#include <cstring>
+
 HostCoherentBuffer::HostCoherentBuffer(VulkanInstance& t_vulkan, vk::BufferUsageFlags t_flags) : vulkan(t_vulkan), usageFlags(t_flags) {
 
 }
@@ -10,26 +13,35 @@ HostCoherentBuffer::~HostCoherentBuffer() {
 }
 
 void HostCoherentBuffer::destroyCurrentBuffers() {
-	vulkan.device.freeMemory(bufferMemory);
-	vulkan.device.destroyBuffer(buffer);
+	VkUtil::destroyBuffer(vulkan, buffer, bufferMemory);
 }
 
-void HostCoherentBuffer::fill(void* data, uint32 dataSize) {
-	if (currentBufferSize != dataSize) {
-		resize(dataSize);
-	}
+void HostCoherentBuffer::fill(const void* data, uint32 dataSize) {
+	// Nothing of the old contents is kept, so growing does not have to copy them
+	if (dataSize > capacity) currentBufferSize = 0;
+	update(0, data, dataSize);
+	currentBufferSize = dataSize;
+}
 
-	void* datamap = vulkan.device.mapMemory(bufferMemory, 0, dataSize);
-	memcpy(datamap, data, dataSize);
-	vulkan.device.unmapMemory(bufferMemory);
+void HostCoherentBuffer::update(uint32 offset, const void* data, uint32 dataSize) {
+	if (offset + dataSize > currentBufferSize) resize(offset + dataSize);
+	memcpy(bufferMemory.mapped + offset, data, dataSize);
 }
 
 void HostCoherentBuffer::resize(uint32 bufferSize) {
-	// Destroy the old buffers
-	destroyCurrentBuffers();
-
-	// Recreate the vertex and staging buffers
-	VkUtil::createBuffer(vulkan, bufferSize, usageFlags, vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostVisible, buffer, bufferMemory);
+	if (bufferSize > capacity) {
+		uint32 newCapacity = std::max(bufferSize, capacity * 2);
+
+		vk::Buffer newBuffer;
+		MemoryAllocation newMemory;
+		VkUtil::createBuffer(vulkan, newCapacity, usageFlags, vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostVisible, newBuffer, newMemory);
+		if (currentBufferSize > 0) memcpy(newMemory.mapped, bufferMemory.mapped, currentBufferSize);
+
+		destroyCurrentBuffers();
+		buffer = newBuffer;
+		bufferMemory = newMemory;
+		capacity = newCapacity;
+	}
 
 	currentBufferSize = bufferSize;
 }
\ No newline at end of file
@@ -7,8 +7,9 @@
 Provides a simple to use interface with a host coherent buffer.
 As such it provides decent read and excellent write performance perfect for requently changing vertex or uniform buffers.
 
-It however requires that the entire buffer be updated as a whole and uses less efficient memory on the gpu
-as such it is slower to access than a DeviceLocalBuffer.
+It uses less efficient memory on the gpu as such it is slower to access than a DeviceLocalBuffer.
+The buffer stays mapped, updates are written straight into it. Its capacity grows by at least doubling whenever data reaches
+past it, which replaces `buffer` and copies the old contents on the cpu.
 */
 
 class HostCoherentBuffer {
@@ -16,19 +17,22 @@ public:
 	HostCoherentBuffer(VulkanInstance& vulkan, vk::BufferUsageFlags usageFlags);
 	~HostCoherentBuffer();
 
-	/* Fills the current buffer. If dataSize is unequal to the current size of the buffer, it also calls this::resize. */
-	void fill(void* data, uint32 dataSize);
+	/* Replaces the contents of the buffer with `data` */
+	void fill(const void* data, uint32 dataSize);
+	/* Writes `dataSize` bytes at `offset`, growing the buffer if they reach past its end */
+	void update(uint32 offset, const void* data, uint32 dataSize);
 
-	/* Deletes the current buffer and replaces it */
+	/* Changes the size of the contents, contents up to the smaller size are kept */
 	void resize(uint32 bufferSize);
 
 
 	vk::Buffer buffer;
-	vk::DeviceMemory bufferMemory;
-	uint32 currentBufferSize;
+	MemoryAllocation bufferMemory;
+	uint32 currentBufferSize = 0;
+	uint32 capacity = 0;
 private:
 	VulkanInstance& vulkan;
 	vk::BufferUsageFlags usageFlags;
 
 	void destroyCurrentBuffers();
-};
+};
\ No newline at end of file
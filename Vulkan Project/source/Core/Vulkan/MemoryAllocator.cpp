@@ -0,0 +1,177 @@
+#include "MemoryAllocator.h"
+
+#include <algorithm>
+
+MemoryAllocator::MemoryAllocator(vk::Device t_device, vk::PhysicalDevice physicalDevice, vk::DeviceSize t_blockSize) : device(t_device), blockSize(t_blockSize) {
+	memoryProperties = physicalDevice.getMemoryProperties();
+
+	vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+	bufferImageGranularity = limits.bufferImageGranularity;
+	nonCoherentAtomSize = limits.nonCoherentAtomSize;
+
+	pools.resize(memoryProperties.memoryTypeCount * 2);
+	for (uint32 i = 0; i < pools.size(); i++) pools[i].memoryType = i / 2;
+}
+
+MemoryAllocator::~MemoryAllocator() {
+	for (auto& pool : pools) {
+		for (auto& block : pool.blocks) {
+			if (!block) continue;
+			if (block->mapped) device.unmapMemory(block->memory);
+			device.freeMemory(block->memory);
+		}
+	}
+}
+
+uint32 MemoryAllocator::findMemoryType(uint32 typeBits, vk::MemoryPropertyFlags properties) const {
+	for (uint32 i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if ((typeBits & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+
+	throw std::runtime_error("failed to find suitable memory type!");
+}
+
+bool MemoryAllocator::hasMemoryType(uint32 typeBits, vk::MemoryPropertyFlags properties) const {
+	for (uint32 i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if ((typeBits & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) return true;
+	}
+
+	return false;
+}
+
+uint32 MemoryAllocator::createBlock(Pool& pool, vk::DeviceSize size, bool dedicated) {
+	vk::MemoryAllocateInfo allocInfo = {};
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = pool.memoryType;
+
+	auto block = std::make_unique<Block>(size);
+	block->memory = device.allocateMemory(allocInfo);
+	block->dedicated = dedicated;
+
+	if (memoryProperties.memoryTypes[pool.memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+		block->mapped = (uint8*)device.mapMemory(block->memory, 0, size);
+	}
+
+	// Reuse the slot of a released block
+	auto slot = std::find(pool.blocks.begin(), pool.blocks.end(), nullptr);
+	if (slot != pool.blocks.end()) {
+		*slot = std::move(block);
+		return (uint32)(slot - pool.blocks.begin());
+	}
+
+	pool.blocks.push_back(std::move(block));
+	return (uint32)pool.blocks.size() - 1;
+}
+
+void MemoryAllocator::releaseBlock(Pool& pool, uint32 block) {
+	if (pool.blocks[block]->mapped) device.unmapMemory(pool.blocks[block]->memory);
+	device.freeMemory(pool.blocks[block]->memory);
+	pool.blocks[block].reset();
+}
+
+MemoryAllocation MemoryAllocator::allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags properties, ResourceKind kind) {
+	uint32 memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+
+	// Without a granularity to respect both kinds can share blocks
+	if (bufferImageGranularity <= 1) kind = ResourceKind::Linear;
+
+	// Flushed ranges of non coherent memory are rounded to whole atoms, which must not reach into a neighbour
+	vk::DeviceSize alignment = std::max<vk::DeviceSize>(requirements.alignment, 1);
+	vk::MemoryPropertyFlags typeProperties = memoryProperties.memoryTypes[memoryType].propertyFlags;
+	if ((typeProperties & vk::MemoryPropertyFlagBits::eHostVisible) && !(typeProperties & vk::MemoryPropertyFlagBits::eHostCoherent)) {
+		alignment = std::max(alignment, nonCoherentAtomSize);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	MemoryAllocation allocation;
+	allocation.pool = memoryType * 2 + (uint32)kind;
+	Pool& pool = pools[allocation.pool];
+
+	if (requirements.size > blockSize / 2) {
+		allocation.block = createBlock(pool, requirements.size, true);
+		allocation.range = pool.blocks[allocation.block]->ranges.allocate(requirements.size);
+	}
+	else {
+		allocation.block = (uint32)pool.blocks.size();
+		for (uint32 i = 0; i < pool.blocks.size(); i++) {
+			if (!pool.blocks[i] || pool.blocks[i]->dedicated) continue;
+
+			allocation.range = pool.blocks[i]->ranges.allocate(requirements.size, alignment);
+			if (allocation.range.valid()) {
+				allocation.block = i;
+				break;
+			}
+		}
+
+		if (!allocation.range.valid()) {
+			allocation.block = createBlock(pool, blockSize, false);
+			allocation.range = pool.blocks[allocation.block]->ranges.allocate(requirements.size, alignment);
+		}
+	}
+
+	if (!allocation.range.valid()) {
+		releaseBlock(pool, allocation.block);
+		throw std::runtime_error("Failed to sub-allocate device memory.");
+	}
+
+	Block& block = *pool.blocks[allocation.block];
+	allocation.memory = block.memory;
+	allocation.offset = allocation.range.offset;
+	allocation.size = allocation.range.size;
+	if (block.mapped) allocation.mapped = block.mapped + allocation.offset;
+
+	return allocation;
+}
+
+void MemoryAllocator::free(MemoryAllocation& allocation) {
+	if (!allocation.valid()) return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		Pool& pool = pools[allocation.pool];
+		Block& block = *pool.blocks[allocation.block];
+		block.ranges.free(allocation.range);
+
+		if (block.ranges.empty()) {
+			// Keep the last shared block around, so a pool that is emptied and refilled does not hit the driver every time
+			bool keep = !block.dedicated && std::none_of(pool.blocks.begin(), pool.blocks.end(), [&](const uptr<Block>& other) {
+				return other && other.get() != &block && !other->dedicated;
+			});
+
+			if (!keep) releaseBlock(pool, allocation.block);
+		}
+	}
+
+	allocation = MemoryAllocation();
+}
+
+MemoryStatistics MemoryAllocator::statistics() const {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	MemoryStatistics statistics;
+	for (auto& pool : pools) {
+		for (auto& block : pool.blocks) {
+			if (!block) continue;
+
+			statistics.blockCount++;
+			statistics.reservedSize += block->ranges.size();
+			statistics.usedSize += block->ranges.usedSize();
+			statistics.allocationCount += block->ranges.allocationCount();
+
+			if (block->dedicated) {
+				statistics.dedicatedBlockCount++;
+				continue;
+			}
+
+			statistics.freeRangeCount += block->ranges.freeRangeCount();
+			statistics.freeSize += block->ranges.size() - block->ranges.usedSize();
+			statistics.largestFreeRange = std::max(statistics.largestFreeRange, block->ranges.largestFreeRange());
+		}
+	}
+
+	return statistics;
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <Core/Util/TlsfAllocator.h>
+#include <vulkan/vulkan.hpp>
+
+#include <mutex>
+#include <vector>
+
+/*
+	Sub-allocates device memory for buffers and images out of large blocks instead of asking the driver for every resource.
+
+	Blocks are kept in a pool per memory type and carved up by a TlsfAllocator, which honours the alignment of each resource.
+	Buffers and linear images may not share a page of bufferImageGranularity with optimal images, so when the device has such
+	a granularity each kind of resource gets pools of its own. Host visible blocks are mapped once when they are created and
+	stay mapped, allocations point into that mapping.
+	Resources larger than half a block get a dedicated block, empty blocks are released except for the last one of a pool.
+*/
+
+enum class ResourceKind {
+	// Buffers and images with linear tiling
+	Linear,
+	// Images with optimal tiling
+	Optimal
+};
+
+struct MemoryAllocation {
+	vk::DeviceMemory memory;
+	vk::DeviceSize offset = 0;
+	vk::DeviceSize size = 0;
+	// Start of the allocation in the persistent mapping of its block, only set for host visible memory
+	uint8* mapped = nullptr;
+
+	bool valid() const { return (bool)memory; }
+
+private:
+	friend class MemoryAllocator;
+
+	uint32 pool = 0;
+	uint32 block = 0;
+	TlsfAllocator::Allocation range;
+};
+
+struct MemoryStatistics {
+	uint32 blockCount = 0;
+	uint32 dedicatedBlockCount = 0;
+	// Memory allocated from the driver
+	vk::DeviceSize reservedSize = 0;
+	// Memory handed out to resources
+	vk::DeviceSize usedSize = 0;
+	uint32 allocationCount = 0;
+	// Free ranges between and behind allocations in shared blocks
+	uint32 freeRangeCount = 0;
+	vk::DeviceSize freeSize = 0;
+	vk::DeviceSize largestFreeRange = 0;
+
+	float utilization() const { return reservedSize > 0 ? (float)usedSize / reservedSize : 1.0f; }
+	// 0 while the free memory of shared blocks is a single range, approaching 1 the more it is split up
+	float fragmentation() const { return freeSize > 0 ? 1.0f - (float)largestFreeRange / freeSize : 0.0f; }
+};
+
+class MemoryAllocator {
+public:
+	static constexpr vk::DeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+	MemoryAllocator(vk::Device device, vk::PhysicalDevice physicalDevice, vk::DeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+	~MemoryAllocator();
+
+	MemoryAllocator(const MemoryAllocator&) = delete;
+	MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+	// Finds memory of a type allowed by `requirements` that has all of `properties`, allocating a new block if none has room
+	MemoryAllocation allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags properties, ResourceKind kind);
+	// Whether allocate would find a memory type for `typeBits` with all of `properties`
+	bool hasMemoryType(uint32 typeBits, vk::MemoryPropertyFlags properties) const;
+	// Returns the memory to its block and resets `allocation`. Invalid allocations are ignored
+	void free(MemoryAllocation& allocation);
+
+	MemoryStatistics statistics() const;
+
+private:
+	struct Block {
+		Block(vk::DeviceSize size) : ranges(size) {}
+
+		vk::DeviceMemory memory;
+		uint8* mapped = nullptr;
+		TlsfAllocator ranges;
+		// Dedicated blocks hold a single resource and are released with it
+		bool dedicated = false;
+	};
+
+	struct Pool {
+		uint32 memoryType = 0;
+		// Released blocks leave an empty slot, so the indices stored in allocations stay valid
+		std::vector<uptr<Block>> blocks;
+	};
+
+	uint32 findMemoryType(uint32 typeBits, vk::MemoryPropertyFlags properties) const;
+	uint32 createBlock(Pool& pool, vk::DeviceSize size, bool dedicated);
+	void releaseBlock(Pool& pool, uint32 block);
+
+	vk::Device device;
+	vk::PhysicalDeviceMemoryProperties memoryProperties;
+	vk::DeviceSize blockSize;
+	vk::DeviceSize bufferImageGranularity;
+	vk::DeviceSize nonCoherentAtomSize;
+
+	// Two pools per memory type, one for each ResourceKind
+	std::vector<Pool> pools;
+	mutable std::mutex mutex;
+};
\ No newline at end of file
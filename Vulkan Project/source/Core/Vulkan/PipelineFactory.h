@@ -4,6 +4,8 @@
 struct PipelineFactory {
 	vk::PipelineLayout layout;
 	vk::RenderPass renderPass;
+	// Index of the subpass of `renderPass` the pipeline is used in
+	uint32_t subpass = 0;
 
 	vk::Pipeline createPipeline(vk::Device device) const;
 
@@ -15,6 +17,8 @@ struct PipelineFactory {
 	vk::PipelineMultisampleStateCreateInfo multisampling;
 	vk::PipelineColorBlendStateCreateInfo colorBlending;
 	vk::PipelineDepthStencilStateCreateInfo depthStencil;
+	// State set while recording instead, e.g. the viewport of passes rendering to several sizes
+	std::vector<vk::DynamicState> dynamicStates;
 	
 	std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
 };
@@ -39,8 +43,14 @@ vk::Pipeline PipelineFactory::createPipeline(vk::Device device) const {
 	pipelineInfo.pMultisampleState = &multisampling;
 	pipelineInfo.pDepthStencilState = &depthStencil;
 	pipelineInfo.pColorBlendState = &colorBlending;
+
+	vk::PipelineDynamicStateCreateInfo dynamicState;
+	dynamicState.dynamicStateCount = (uint32_t)dynamicStates.size();
+	dynamicState.pDynamicStates = dynamicStates.data();
+	if (!dynamicStates.empty()) pipelineInfo.pDynamicState = &dynamicState;
 	pipelineInfo.layout = layout;
 	pipelineInfo.renderPass = renderPass;
+	pipelineInfo.subpass = subpass;
 
 
 
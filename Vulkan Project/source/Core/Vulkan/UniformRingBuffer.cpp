@@ -0,0 +1,39 @@
+#include "UniformRingBuffer.h"
+#include <Core/Vulkan/VkUtil.h>
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+UniformRingBuffer::UniformRingBuffer(VulkanInstance& t_vulkan, vk::DeviceSize t_bufferSize) : bufferSize(t_bufferSize), vulkan(t_vulkan) {
+	alignment = std::max<vk::DeviceSize>(1, vulkan.physicalDevice.getProperties().limits.minUniformBufferOffsetAlignment);
+	VkUtil::createBuffer(vulkan, bufferSize, vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, buffer, bufferMemory);
+}
+
+UniformRingBuffer::~UniformRingBuffer() {
+	VkUtil::destroyBuffer(vulkan, buffer, bufferMemory);
+}
+
+uint32 UniformRingBuffer::push(const void* data, vk::DeviceSize dataSize) {
+	// Data is never split over the end of the buffer, the rest of the buffer is skipped instead
+	vk::DeviceSize start = (head + alignment - 1) / alignment * alignment;
+	if (start % bufferSize + dataSize > bufferSize) start += bufferSize - start % bufferSize;
+	if (start - tail + dataSize > bufferSize) throw std::runtime_error("Uniforms of the frames in flight exceed the uniform ring buffer.");
+
+	head = start + dataSize;
+	memcpy(bufferMemory.mapped + start % bufferSize, data, dataSize);
+	return (uint32)(start % bufferSize);
+}
+
+void UniformRingBuffer::endFrame(uint32 frame) {
+	framesInFlight.push_back({ frame, head });
+}
+
+void UniformRingBuffer::frameCompleted(uint32 frame) {
+	// Frames complete in submission order, so everything up to the last frame of the slot is done
+	auto last = std::find_if(framesInFlight.rbegin(), framesInFlight.rend(), [&](const Frame& f) { return f.slot == frame; });
+	if (last == framesInFlight.rend()) return;
+
+	tail = last->end;
+	framesInFlight.erase(framesInFlight.begin(), last.base());
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <Core/Vulkan/VulkanInstance.h>
+
+#include <deque>
+
+/*
+	Persistently mapped host coherent buffer that uniforms of every frame are written into, one after another.
+
+	Each push copies the data behind the previous one, aligned to minUniformBufferOffsetAlignment, and returns its offset
+	for binding a descriptor of type eUniformBufferDynamic. Everything written up to an endFrame is kept until frameCompleted
+	is called for the same frame slot, so the gpu can still read the uniforms of earlier frames while new ones are written.
+	The ring holds no fences, the caller reports completion after waiting for its own per frame fence. Running full means
+	the frames in flight need more uniforms than the buffer holds, which is an error.
+*/
+
+class UniformRingBuffer {
+public:
+	UniformRingBuffer(VulkanInstance& vulkan, vk::DeviceSize bufferSize);
+	~UniformRingBuffer();
+
+	/* Copies `dataSize` bytes into the ring and returns their dynamic offset */
+	uint32 push(const void* data, vk::DeviceSize dataSize);
+
+	template<class T>
+	uint32 push(const T& value) { return push(&value, sizeof(T)); }
+
+	/* Everything pushed since the last call belongs to the frame recorded in slot `frame` */
+	void endFrame(uint32 frame);
+
+	/* The gpu finished the frame last ended in slot `frame`, its uniforms and those of all earlier frames may be reused */
+	void frameCompleted(uint32 frame);
+
+	vk::Buffer buffer;
+	vk::DeviceSize bufferSize;
+private:
+	struct Frame {
+		uint32 slot;
+		// Value of `head` when the frame ended
+		uint64 end;
+	};
+
+	VulkanInstance& vulkan;
+	MemoryAllocation bufferMemory;
+	vk::DeviceSize alignment;
+
+	// Bytes ever pushed and ever reclaimed, their difference is the space in use
+	uint64 head = 0;
+	uint64 tail = 0;
+	std::deque<Frame> framesInFlight;
+
+};
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "UploadContext.h"
+#include <Core/Vulkan/VkUtil.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+namespace {
+	// Covers the texel size of every format uploaded and the 4 byte alignment of buffer image copies
+	constexpr vk::DeviceSize STAGING_ALIGNMENT = 16;
+}
+
+UploadContext::UploadContext(VulkanInstance& t_vulkan) : vulkan(t_vulkan) {
+
+}
+
+UploadContext::~UploadContext() {
+	wait();
+}
+
+vk::CommandBuffer UploadContext::record() {
+	if (submitted) throw std::runtime_error("Recording into an upload context that was already submitted.");
+
+	if (!commandBuffer) {
+		vk::CommandBufferAllocateInfo allocInfo = {};
+		allocInfo.commandPool = vulkan.utilityPool;
+		allocInfo.level = vk::CommandBufferLevel::ePrimary;
+		allocInfo.commandBufferCount = 1;
+		commandBuffer = vulkan.device.allocateCommandBuffers(allocInfo)[0];
+		commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+	}
+
+	recordedCommands++;
+	return commandBuffer;
+}
+
+UploadContext::StagedData UploadContext::stage(const void* data, vk::DeviceSize dataSize) {
+	vk::DeviceSize offset = 0;
+	if (!stagingBuffers.empty()) offset = (stagingBuffers.back().used + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+
+	if (stagingBuffers.empty() || offset + dataSize > stagingBuffers.back().memory.size) {
+		OwnedBuffer staging;
+		VkUtil::createBuffer(vulkan, std::max(dataSize, STAGING_BLOCK_SIZE), vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, staging.buffer, staging.memory);
+		stagingBuffers.push_back(staging);
+		offset = 0;
+	}
+
+	OwnedBuffer& staging = stagingBuffers.back();
+	memcpy(staging.memory.mapped + offset, data, dataSize);
+	staging.used = offset + dataSize;
+
+	return { staging.buffer, offset };
+}
+
+void UploadContext::uploadBuffer(const void* data, vk::DeviceSize dataSize, vk::Buffer destination, vk::DeviceSize destinationOffset) {
+	StagedData staged = stage(data, dataSize);
+	copyBuffer(staged.buffer, destination, dataSize, staged.offset, destinationOffset);
+}
+
+void UploadContext::uploadImage(const void* data, vk::DeviceSize dataSize, vk::Image image, const std::vector<vk::BufferImageCopy>& regions) {
+	StagedData staged = stage(data, dataSize);
+
+	std::vector<vk::BufferImageCopy> stagedRegions = regions;
+	for (auto& region : stagedRegions) region.bufferOffset += staged.offset;
+	copyBufferToImage(staged.buffer, image, stagedRegions);
+}
+
+void UploadContext::copyBuffer(vk::Buffer sourceBuffer, vk::Buffer destinationBuffer, vk::DeviceSize size, vk::DeviceSize sourceOffset, vk::DeviceSize destinationOffset) {
+	auto commandBuffer = record();
+	commandBuffer.copyBuffer(sourceBuffer, destinationBuffer, vk::BufferCopy(sourceOffset, destinationOffset, size));
+}
+
+void UploadContext::copyBufferToImage(vk::Buffer buffer, vk::Image image, const std::vector<vk::BufferImageCopy>& regions) {
+	auto commandBuffer = record();
+	commandBuffer.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, (uint32)regions.size(), regions.data());
+}
+
+void UploadContext::transitionImageLayout(vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout) {
+	VkUtil::recordImageLayoutTransition(record(), image, format, oldLayout, newLayout);
+}
+
+void UploadContext::transferBarrier() {
+	vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite);
+	record().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void UploadContext::retireBuffer(vk::Buffer buffer, MemoryAllocation memory) {
+	OwnedBuffer retired;
+	retired.buffer = buffer;
+	retired.memory = memory;
+	retiredBuffers.push_back(retired);
+}
+
+void UploadContext::submit() {
+	if (submitted) return;
+	submitted = true;
+	if (!commandBuffer) return;
+
+	// Buffers are read as vertices, indices or uniforms or copied again by later submissions, images wait through their layout transitions
+	vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eUniformRead | vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 1, &barrier, 0, nullptr, 0, nullptr);
+	commandBuffer.end();
+
+	fence = vulkan.device.createFence({});
+
+	vk::SubmitInfo submitInfo = {};
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	vulkan.graphicsQueue.submit(1, &submitInfo, fence);
+}
+
+void UploadContext::wait() {
+	submit();
+	if (released) return;
+
+	if (fence) {
+		auto startTime = std::chrono::high_resolution_clock::now();
+		vulkan.device.waitForFences(1, &fence, true, std::numeric_limits<uint64>::max());
+		waitedSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	release();
+}
+
+bool UploadContext::finished() {
+	if (released) return true;
+	if (!submitted) return false;
+
+	if (fence && vulkan.device.getFenceStatus(fence) != vk::Result::eSuccess) return false;
+
+	release();
+	return true;
+}
+
+void UploadContext::release() {
+	released = true;
+
+	for (auto& staging : stagingBuffers) VkUtil::destroyBuffer(vulkan, staging.buffer, staging.memory);
+	for (auto& retired : retiredBuffers) VkUtil::destroyBuffer(vulkan, retired.buffer, retired.memory);
+	stagingBuffers.clear();
+	retiredBuffers.clear();
+
+	if (commandBuffer) vulkan.device.freeCommandBuffers(vulkan.utilityPool, 1, &commandBuffer);
+	if (fence) vulkan.device.destroyFence(fence);
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+#include <Core/Definitions.h>
+#include <Core/Vulkan/VulkanInstance.h>
+
+#include <vector>
+
+/*
+	Records buffer copies, image copies and layout transitions into a single command buffer instead of submitting
+	and waiting for every one of them.
+
+	Commands are recorded in call order. Copies are not ordered against each other, transferBarrier orders the ones that
+	write the same memory.
+	Uploaded data is packed into shared staging buffers of STAGING_BLOCK_SIZE bytes, larger uploads get a buffer of their own.
+	submit ends the command buffer and submits it with a fence, wait blocks until it has finished and releases the
+	staging memory and command buffer. Resources written by the context may only be used by later submissions after
+	it has been submitted, and only be read or destroyed on the host after waiting.
+	Destroying a context that was never waited for waits for it.
+*/
+
+class UploadContext {
+public:
+	static constexpr vk::DeviceSize STAGING_BLOCK_SIZE = 1024 * 1024;
+
+	UploadContext(VulkanInstance& vulkan);
+	~UploadContext();
+
+	UploadContext(const UploadContext&) = delete;
+	UploadContext& operator=(const UploadContext&) = delete;
+
+	/* Copies `data` into staging memory owned by the context and records a copy of it into `destination` */
+	void uploadBuffer(const void* data, vk::DeviceSize dataSize, vk::Buffer destination, vk::DeviceSize destinationOffset = 0);
+	/* Copies `data` into staging memory owned by the context and records copies of the `regions` into `image`, which has to be in eTransferDstOptimal.
+	   Buffer offsets of the regions are relative to `data` */
+	void uploadImage(const void* data, vk::DeviceSize dataSize, vk::Image image, const std::vector<vk::BufferImageCopy>& regions);
+
+	void copyBuffer(vk::Buffer sourceBuffer, vk::Buffer destinationBuffer, vk::DeviceSize size, vk::DeviceSize sourceOffset = 0, vk::DeviceSize destinationOffset = 0);
+	void copyBufferToImage(vk::Buffer buffer, vk::Image image, const std::vector<vk::BufferImageCopy>& regions);
+	void transitionImageLayout(vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
+	/* Makes copies recorded after this wait for the ones recorded before */
+	void transferBarrier();
+
+	/* Destroys `buffer` once the commands have finished, for buffers that are replaced by commands of this context */
+	void retireBuffer(vk::Buffer buffer, MemoryAllocation memory);
+
+	/* Ends recording and submits the commands to the graphics queue. Contexts without commands submit nothing */
+	void submit();
+	/* Submits if that did not happen yet and blocks until the commands have finished */
+	void wait();
+	/* Whether the commands have finished, without blocking */
+	bool finished();
+
+	uint32 commandCount() const { return recordedCommands; }
+	// Time spent blocking in wait
+	double waitSeconds() const { return waitedSeconds; }
+
+private:
+	struct OwnedBuffer {
+		vk::Buffer buffer;
+		MemoryAllocation memory;
+		// Bytes handed out, staging buffers only
+		vk::DeviceSize used = 0;
+	};
+
+	struct StagedData {
+		vk::Buffer buffer;
+		vk::DeviceSize offset;
+	};
+
+	VulkanInstance& vulkan;
+	vk::CommandBuffer commandBuffer;
+	vk::Fence fence;
+	// The last one is filled next
+	std::vector<OwnedBuffer> stagingBuffers;
+	std::vector<OwnedBuffer> retiredBuffers;
+
+	uint32 recordedCommands = 0;
+	bool submitted = false;
+	bool released = false;
+	double waitedSeconds = 0;
+
+	// Begins the command buffer with the first command
+	vk::CommandBuffer record();
+	StagedData stage(const void* data, vk::DeviceSize dataSize);
+	void release();
+};
\ No newline at end of file
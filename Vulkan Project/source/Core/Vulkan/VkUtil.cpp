@@ -2,43 +2,32 @@
 #include <Core/Definitions.h>
 
 namespace VkUtil {
-	namespace {
-		uint32 findMemoryType(vk::PhysicalDevice pDevice, uint32 typeFilter, vk::MemoryPropertyFlags properties) {
-			vk::PhysicalDeviceMemoryProperties memProperties = pDevice.getMemoryProperties();
+	void createBuffer(VulkanInstance& vulkan, vk::DeviceSize bufferSize, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer& buffer, MemoryAllocation& memory, bool shared) {
+		uint32 queueFamilies[] = { vulkan.graphicsFamily, vulkan.transferFamily };
 
-			for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-				if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-					return i;
-				}
-			}
-
-			throw std::runtime_error("failed to find suitable memory type!");
-		}
-	}
-
-	void createBuffer(VulkanInstance& vulkan, vk::DeviceSize bufferSize, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer& buffer, vk::DeviceMemory& memory) {
 		vk::BufferCreateInfo bufferInfo = {};
 		bufferInfo.size = bufferSize;
 		bufferInfo.usage = usage;
 		bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+		if (shared && vulkan.hasDedicatedTransferQueue()) {
+			bufferInfo.sharingMode = vk::SharingMode::eConcurrent;
+			bufferInfo.queueFamilyIndexCount = 2;
+			bufferInfo.pQueueFamilyIndices = queueFamilies;
+		}
 	
 		buffer = vulkan.device.createBuffer(bufferInfo);
 
-		vk::MemoryRequirements memoryRequirements = vulkan.device.getBufferMemoryRequirements(buffer);
-		vk::MemoryAllocateInfo allocInfo = {};
-		allocInfo.allocationSize = memoryRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(vulkan.physicalDevice, memoryRequirements.memoryTypeBits, properties);
-
-		memory = vulkan.device.allocateMemory(allocInfo);
-		vulkan.device.bindBufferMemory(buffer, memory, 0);
+		memory = vulkan.allocator->allocate(vulkan.device.getBufferMemoryRequirements(buffer), properties, ResourceKind::Linear);
+		vulkan.device.bindBufferMemory(buffer, memory.memory, memory.offset);
 	}
 
-	void createImage(VulkanInstance& vulkan, vk::Image& image, vk::DeviceMemory& memory, vk::Extent2D extent, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties) {
+	void createImage(VulkanInstance& vulkan, vk::Image& image, MemoryAllocation& memory, vk::Extent2D extent, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, uint32 mipLevels, uint32 arrayLayers, vk::ImageCreateFlags createFlags) {
 		vk::ImageCreateInfo imageInfo = {};
+		imageInfo.flags = createFlags;
 		imageInfo.imageType = vk::ImageType::e2D;
 		imageInfo.extent = { (uint32)extent.width, (uint32)extent.height, 1 };
-		imageInfo.mipLevels = 1;
-		imageInfo.arrayLayers = 1;
+		imageInfo.mipLevels = mipLevels;
+		imageInfo.arrayLayers = arrayLayers;
 		imageInfo.format = format;
 		imageInfo.tiling = tiling;
 		imageInfo.initialLayout = vk::ImageLayout::ePreinitialized;
@@ -48,27 +37,74 @@ namespace VkUtil {
 
 		image = vulkan.device.createImage(imageInfo);
 
-		vk::MemoryRequirements memoryRequirements = vulkan.device.getImageMemoryRequirements(image);
-		vk::MemoryAllocateInfo allocInfo = {};
-		allocInfo.allocationSize = memoryRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(vulkan.physicalDevice, memoryRequirements.memoryTypeBits, properties);
+		ResourceKind kind = tiling == vk::ImageTiling::eOptimal ? ResourceKind::Optimal : ResourceKind::Linear;
+		memory = vulkan.allocator->allocate(vulkan.device.getImageMemoryRequirements(image), properties, kind);
+		vulkan.device.bindImageMemory(image, memory.memory, memory.offset);
+	}
+
+	void createTransientImage(VulkanInstance& vulkan, vk::Image& image, MemoryAllocation& memory, vk::Extent2D extent, vk::Format format, vk::ImageUsageFlags usage) {
+		vk::ImageCreateInfo imageInfo = {};
+		imageInfo.imageType = vk::ImageType::e2D;
+		imageInfo.extent = { (uint32)extent.width, (uint32)extent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = format;
+		imageInfo.tiling = vk::ImageTiling::eOptimal;
+		imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+		imageInfo.usage = usage | vk::ImageUsageFlagBits::eTransientAttachment;
+		imageInfo.sharingMode = vk::SharingMode::eExclusive;
+		imageInfo.samples = vk::SampleCountFlagBits::e1;
+
+		image = vulkan.device.createImage(imageInfo);
+
+		auto requirements = vulkan.device.getImageMemoryRequirements(image);
+		vk::MemoryPropertyFlags properties = vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eLazilyAllocated;
+		if (!vulkan.allocator->hasMemoryType(requirements.memoryTypeBits, properties)) properties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+
+		memory = vulkan.allocator->allocate(requirements, properties, ResourceKind::Optimal);
+		vulkan.device.bindImageMemory(image, memory.memory, memory.offset);
+	}
 
-		memory = vulkan.device.allocateMemory(allocInfo);
-		vulkan.device.bindImageMemory(image, memory, 0);
+	void destroyBuffer(VulkanInstance& vulkan, vk::Buffer& buffer, MemoryAllocation& memory) {
+		vulkan.device.destroyBuffer(buffer);
+		vulkan.allocator->free(memory);
+		buffer = nullptr;
 	}
 
-	vk::ImageView createImageView(VulkanInstance& vulkan, vk::Image image, vk::Format format, vk::ImageAspectFlags flags) {
+	void destroyImage(VulkanInstance& vulkan, vk::Image& image, MemoryAllocation& memory) {
+		vulkan.device.destroyImage(image);
+		vulkan.allocator->free(memory);
+		image = nullptr;
+	}
+
+	vk::ImageView createImageView(VulkanInstance& vulkan, vk::Image image, vk::Format format, vk::ImageAspectFlags flags, uint32 mipLevels, vk::ImageViewType viewType, uint32 layerCount) {
 		vk::ImageViewCreateInfo viewInfo = {};
 		viewInfo.image = image;
-		viewInfo.viewType = vk::ImageViewType::e2D;
+		viewInfo.viewType = viewType;
 		viewInfo.format = format;
 		viewInfo.subresourceRange.aspectMask = flags;
-		viewInfo.subresourceRange.levelCount = 1;
-		viewInfo.subresourceRange.layerCount = 1;
+		viewInfo.subresourceRange.levelCount = mipLevels;
+		viewInfo.subresourceRange.layerCount = layerCount;
 		
 		return vulkan.device.createImageView(viewInfo);
 	}
 
+	vk::Sampler createSampler(VulkanInstance& vulkan, uint32 mipLevels, vk::SamplerAddressMode addressMode) {
+		vk::SamplerCreateInfo samplerInfo = {};
+		samplerInfo.magFilter = vk::Filter::eLinear;
+		samplerInfo.minFilter = vk::Filter::eLinear;
+		samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
+		samplerInfo.addressModeU = addressMode;
+		samplerInfo.addressModeV = addressMode;
+		samplerInfo.addressModeW = addressMode;
+		samplerInfo.anisotropyEnable = true;
+		samplerInfo.maxAnisotropy = 16.f;
+		samplerInfo.minLod = 0.0f;
+		samplerInfo.maxLod = (float)mipLevels;
+
+		return vulkan.device.createSampler(samplerInfo);
+	}
+
 	void copyBuffer(VulkanInstance& vulkan, vk::Buffer sourceBuffer, vk::Buffer destinationBuffer, vk::DeviceSize size) {
 		auto commandBuffer = vulkan.getSingleUseCommandBuffer();
 
@@ -91,27 +127,43 @@ namespace VkUtil {
 		vulkan.returnSingleUseCommandBuffer(commandBuffer);
 	}
 
+	void copyBufferToImage(VulkanInstance& vulkan, vk::Buffer buffer, vk::Image image, const std::vector<vk::BufferImageCopy>& regions) {
+		auto commandBuffer = vulkan.getSingleUseCommandBuffer();
+		commandBuffer.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, (uint32)regions.size(), regions.data());
+		vulkan.returnSingleUseCommandBuffer(commandBuffer);
+	}
+
 	void transitionImageLayout(VulkanInstance& vulkan, vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout) {
 		auto commandBuffer = vulkan.getSingleUseCommandBuffer();
-	
+		recordImageLayoutTransition(commandBuffer, image, format, oldLayout, newLayout);
+		vulkan.returnSingleUseCommandBuffer(commandBuffer);
+	}
+
+	void recordImageLayoutTransition(vk::CommandBuffer commandBuffer, vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout) {
 		vk::ImageMemoryBarrier barrier = {};
 		barrier.oldLayout = oldLayout;
 		barrier.newLayout = newLayout;
 		barrier.image = image;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.layerCount = 1;
+		barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+		barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
 
 		if (newLayout == vk::ImageLayout::eDepthStencilAttachmentOptimal) barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eDepth;
 		else barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
 
+		// Transitions that are recorded next to the commands using the image have to wait for the stages involved
+		vk::PipelineStageFlags sourceStage = vk::PipelineStageFlagBits::eTopOfPipe;
+		vk::PipelineStageFlags destinationStage = vk::PipelineStageFlagBits::eTopOfPipe;
 
 		if (oldLayout == vk::ImageLayout::ePreinitialized && newLayout == vk::ImageLayout::eTransferDstOptimal) {
 			barrier.srcAccessMask = vk::AccessFlagBits::eHostWrite;
 			barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+			destinationStage = vk::PipelineStageFlagBits::eTransfer;
 		}
 		else if (oldLayout == vk::ImageLayout::eTransferDstOptimal && newLayout == vk::ImageLayout::eShaderReadOnlyOptimal) {
 			barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
 			barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+			sourceStage = vk::PipelineStageFlagBits::eTransfer;
+			destinationStage = vk::PipelineStageFlagBits::eFragmentShader;
 		}
 		else if (oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eDepthStencilAttachmentOptimal) {
 			barrier.srcAccessMask = vk::AccessFlagBits(0);
@@ -125,8 +177,7 @@ namespace VkUtil {
 			throw std::invalid_argument("unsupported layout transition!");
 		}
 
-		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTopOfPipe, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &barrier);
-		vulkan.returnSingleUseCommandBuffer(commandBuffer);
+		commandBuffer.pipelineBarrier(sourceStage, destinationStage, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &barrier);
 	}
 
 }
\ No newline at end of file
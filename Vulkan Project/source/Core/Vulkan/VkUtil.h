@@ -2,14 +2,31 @@
 #include <Core/Vulkan/VulkanInstance.h>
 
 namespace VkUtil {
-	void createBuffer(VulkanInstance&, vk::DeviceSize, vk::BufferUsageFlags, vk::MemoryPropertyFlags, vk::Buffer&, vk::DeviceMemory&);
-	void createImage(VulkanInstance&, vk::Image&, vk::DeviceMemory&, vk::Extent2D, vk::Format, vk::ImageTiling, vk::ImageUsageFlags, vk::MemoryPropertyFlags);
-	vk::ImageView createImageView(VulkanInstance&, vk::Image image, vk::Format format, vk::ImageAspectFlags flags);
+	// Buffers and images are bound to memory from VulkanInstance::allocator and have to be destroyed with destroyBuffer and destroyImage
+	// Shared buffers are used concurrently by the graphics and the transfer queue family, so ranges of them can be written by
+	// the transfer queue while the graphics queue reads others without moving ownership of the whole buffer
+	void createBuffer(VulkanInstance&, vk::DeviceSize, vk::BufferUsageFlags, vk::MemoryPropertyFlags, vk::Buffer&, MemoryAllocation&, bool shared = false);
+	// Cubemaps are created with 6 array layers and vk::ImageCreateFlagBits::eCubeCompatible
+	void createImage(VulkanInstance&, vk::Image&, MemoryAllocation&, vk::Extent2D, vk::Format, vk::ImageTiling, vk::ImageUsageFlags, vk::MemoryPropertyFlags, uint32 mipLevels = 1, uint32 arrayLayers = 1, vk::ImageCreateFlags createFlags = {});
+	// Attachments whose contents only live within a render pass, e.g. a g buffer read as input attachments.
+	// Their memory is lazily allocated where the device supports it, so tiled gpus may never back them at all
+	void createTransientImage(VulkanInstance&, vk::Image&, MemoryAllocation&, vk::Extent2D, vk::Format, vk::ImageUsageFlags);
+	void destroyBuffer(VulkanInstance&, vk::Buffer&, MemoryAllocation&);
+	void destroyImage(VulkanInstance&, vk::Image&, MemoryAllocation&);
+
+	vk::ImageView createImageView(VulkanInstance&, vk::Image image, vk::Format format, vk::ImageAspectFlags flags, uint32 mipLevels = 1, vk::ImageViewType viewType = vk::ImageViewType::e2D, uint32 layerCount = 1);
+	// Trilinear, anisotropic sampler that may sample every level of an image with `mipLevels` levels
+	vk::Sampler createSampler(VulkanInstance&, uint32 mipLevels, vk::SamplerAddressMode addressMode = vk::SamplerAddressMode::eRepeat);
 
 	void copyBuffer(VulkanInstance&, vk::Buffer sourceBuffer, vk::Buffer destinationBuffer, vk::DeviceSize size);
 	void copyBufferToImage(VulkanInstance&, vk::Buffer buffer, vk::Image image, vk::Extent2D);
+	// Copies all regions with a single command, e.g. every level of a mip chain
+	void copyBufferToImage(VulkanInstance&, vk::Buffer buffer, vk::Image image, const std::vector<vk::BufferImageCopy>& regions);
 
+	// Layout transitions cover every mip level and array layer of the image
 	void transitionImageLayout(VulkanInstance&, vk::Image, vk::Format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
+	// Records the barrier of transitionImageLayout into `commandBuffer` instead of submitting and waiting for it
+	void recordImageLayoutTransition(vk::CommandBuffer commandBuffer, vk::Image, vk::Format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
 
 }
 
@@ -1,5 +1,6 @@
 #include "VulkanInstance.h"
 #include <GLFW/glfw3.h>
+#include <limits>
 #include <set>
 
 /* Application metadata */
@@ -23,7 +24,9 @@ const std::vector<const char*> validationLayers = {
 
 /* Device extensions to load */
 const std::vector<const char*> deviceExtensions = {
-	VK_KHR_SWAPCHAIN_EXTENSION_NAME
+	VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+	// Renders all six faces of a cubemap in one pass
+	VK_KHR_MULTIVIEW_EXTENSION_NAME
 };
 
 
@@ -39,6 +42,8 @@ std::vector<const char*> VulkanInstance::getRequiredExtensions() const {
 		extensions.push_back(glfwExtensions[i]);
 	}
 
+	// Required by VK_KHR_multiview
+	extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
 	if (enableValidationLayers) extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
 	return extensions;
 }
@@ -68,6 +73,7 @@ VulkanInstance::VulkanInstance() {
 }
 
 VulkanInstance::~VulkanInstance() {
+	allocator.reset();
 	instance.destroyDebugReportCallbackEXT(debugCallback);
 	instance.destroy();
 }
@@ -112,16 +118,30 @@ void VulkanInstance::createSurface(GLFWwindow* window) {
 VulkanInstance::QueueFamilyIndices VulkanInstance::findQueueFamilyIndices(vk::PhysicalDevice device) {
 	QueueFamilyIndices indices;
 	auto queueFamilies = device.getQueueFamilyProperties();
+	bool transferOnlyFound = false;
 
 	for (int i = 0; i < queueFamilies.size(); i++) {
 		auto& queueFamily = queueFamilies.at(i);
 
 		if (queueFamily.queueCount <= 0) continue;
 
-		if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) indices.graphicsFamily = i;
-		if (device.getSurfaceSupportKHR(i, surface)) indices.presentFamily = i;
+		if (!indices.isComplete()) {
+			if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) indices.graphicsFamily = i;
+			if (device.getSurfaceSupportKHR(i, surface)) indices.presentFamily = i;
+		}
+
+		// Families made for copies have neither graphics nor compute support and run next to the graphics queue,
+		// compute families without graphics support copy as well
+		bool transferOnly = (queueFamily.queueFlags & vk::QueueFlagBits::eTransfer) && !(queueFamily.queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute));
+		bool asyncTransfer = (queueFamily.queueFlags & (vk::QueueFlagBits::eTransfer | vk::QueueFlagBits::eCompute)) && !(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics);
 
-		if (indices.isComplete()) break;
+		if (transferOnly && !transferOnlyFound) {
+			indices.transferFamily = i;
+			transferOnlyFound = true;
+		}
+		else if (asyncTransfer && indices.transferFamily < 0) {
+			indices.transferFamily = i;
+		}
 	}
 
 	return indices;
@@ -181,6 +201,7 @@ void VulkanInstance::createLogicalDevice() {
 
 	std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
 	std::set<int32> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+	if (indices.transferFamily >= 0) uniqueQueueFamilies.insert(indices.transferFamily);
 
 	float queuePriority = 1.0f;
 	for (auto queueFamily : uniqueQueueFamilies) {
@@ -194,8 +215,15 @@ void VulkanInstance::createLogicalDevice() {
 	// Insert any dank features here
 	vk::PhysicalDeviceFeatures deviceFeatures = {};
 	deviceFeatures.samplerAnisotropy = true;
+	// Not required, the texture cache falls back to uncompressed texels on devices without it
+	textureCompressionBC = physicalDevice.getFeatures().textureCompressionBC;
+	deviceFeatures.textureCompressionBC = textureCompressionBC;
+
+	vk::PhysicalDeviceMultiviewFeaturesKHR multiviewFeatures = {};
+	multiviewFeatures.multiview = true;
 
 	vk::DeviceCreateInfo createInfo = {};
+	createInfo.pNext = &multiviewFeatures;
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.queueCreateInfoCount = queueCreateInfos.size();
 	createInfo.pEnabledFeatures = &deviceFeatures;
@@ -211,6 +239,13 @@ void VulkanInstance::createLogicalDevice() {
 	device = physicalDevice.createDevice(createInfo);
 	graphicsQueue = device.getQueue(indices.graphicsFamily, 0);
 	presentQueue = device.getQueue(indices.presentFamily, 0);
+
+	// Without a family of its own transfers share the graphics queue
+	graphicsFamily = indices.graphicsFamily;
+	transferFamily = indices.transferFamily >= 0 ? indices.transferFamily : indices.graphicsFamily;
+	transferQueue = device.getQueue(transferFamily, 0);
+
+	allocator = std::make_unique<MemoryAllocator>(device, physicalDevice);
 }
 
 void VulkanInstance::createUtilityPool() {
@@ -218,6 +253,12 @@ void VulkanInstance::createUtilityPool() {
 	poolInfo.queueFamilyIndex = findQueueFamilyIndices(physicalDevice).graphicsFamily;
 
 	utilityPool = device.createCommandPool(poolInfo);
+	transferPool = utilityPool;
+
+	if (hasDedicatedTransferQueue()) {
+		poolInfo.queueFamilyIndex = transferFamily;
+		transferPool = device.createCommandPool(poolInfo);
+	}
 }
 
 
@@ -246,8 +287,11 @@ void VulkanInstance::returnSingleUseCommandBuffer(vk::CommandBuffer commandBuffe
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffer;
 
-	graphicsQueue.submit(submitInfo, nullptr);
-	graphicsQueue.waitIdle();
+	// Only wait for this submission, not for frames that may be in flight on the same queue
+	vk::Fence fence = device.createFence({});
+	graphicsQueue.submit(submitInfo, fence);
+	device.waitForFences(1, &fence, true, std::numeric_limits<uint64>::max());
+	device.destroyFence(fence);
 
 	device.freeCommandBuffers(utilityPool, 1, &commandBuffer);
 }
\ No newline at end of file
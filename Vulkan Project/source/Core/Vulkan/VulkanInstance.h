@@ -1,5 +1,6 @@
 #pragma once
 #include <Core/Definitions.h>
+#include <Core/Vulkan/MemoryAllocator.h>
 #include <vulkan/vulkan.hpp>
 
 struct GLFWwindow;
@@ -16,11 +17,25 @@ struct VulkanInstance {
 
 	vk::Queue graphicsQueue;
 	vk::Queue presentQueue;
+	// Queue of a family without graphics support for streaming copies, the graphics queue if the device has none
+	vk::Queue transferQueue;
+	uint32 graphicsFamily = 0;
+	uint32 transferFamily = 0;
+	// Whether transferQueue is a queue of its own, resources written there have to be handed to the graphics family
+	bool hasDedicatedTransferQueue() const { return transferFamily != graphicsFamily; }
 
+	// Whether the device samples BCn formats, textures are uploaded uncompressed without it
+	bool textureCompressionBC = false;
+
+	// Created with the logical device, every buffer and image made through VkUtil lives in its blocks
+	uptr<MemoryAllocator> allocator;
 
 	vk::CommandPool utilityPool;
+	// Command pool of transferFamily, the same as utilityPool without a dedicated transfer queue
+	vk::CommandPool transferPool;
 	void createUtilityPool();
 
+	// Blocks until the commands have finished, an UploadContext batches many commands into a single wait
 	vk::CommandBuffer getSingleUseCommandBuffer();
 	void returnSingleUseCommandBuffer(vk::CommandBuffer commandBuffer);
 
@@ -32,6 +47,8 @@ struct VulkanInstance {
 	struct QueueFamilyIndices {
 		int graphicsFamily = -1;
 		int presentFamily = -1;
+		// A family with transfer but without graphics support, preferring one without compute support as well. Optional
+		int transferFamily = -1;
 
 		bool isComplete() { return graphicsFamily >= 0 && presentFamily >= 0; }
 	};
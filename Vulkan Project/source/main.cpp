@@ -11,6 +11,7 @@
 #include <Core/Render/Camera.h>
 #include <Core/Render/Vertex.h>
 #include <Core/Render/Material.h>
+#include <Core/Render/SphericalHarmonics.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -20,12 +21,19 @@
 #include <set>
 #include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <functional>
 
-#include <Core/MeshLoaders/Ply.h>
+#include <Core/Assets/AssetLoader.h>
+#include <Core/MeshLoaders/MeshCache.h>
+#include <Core/TextureLoaders/EnvironmentCache.h>
+#include <Core/TextureLoaders/TextureCache.h>
 
-#include <Core/Vulkan/DeviceLocalBuffer.h>
+#include <Core/Vulkan/GeometryArena.h>
 #include <Core/Vulkan/HostCoherentBuffer.h>
 #include <Core/Vulkan/PipelineFactory.h>
+#include <Core/Vulkan/UploadContext.h>
+#include <Core/Vulkan/UniformRingBuffer.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/image.h>
@@ -45,6 +53,9 @@ constexpr bool enableValidationLayers = false;
 constexpr bool enableValidationLayers = true;
 #endif
 
+// Frames the cpu may record ahead of the gpu, each with its own command buffer, semaphores and fence
+constexpr uint32 FRAMES_IN_FLIGHT = 2;
+
 
 struct GeneralRenderUniforms {
 	glm::mat4 model;
@@ -190,11 +201,65 @@ vk::ShaderModule createShaderModule(const std::vector<int8>& code, vk::Device de
 	return device.createShaderModule(createInfo);
 }
 
+void logMeshLoad(const std::string& path, const MeshLoaders::CachedMesh& mesh) {
+	if (mesh.rebuilt) {
+		auto& loadStatistics = mesh.sourceStatistics;
+		std::cout << "Rebuilt mesh cache for " << path << " in " << mesh.seconds * 1000 << "ms (parsed at " << loadStatistics.megabytesPerSecond() << " MB/s, " << loadStatistics.verticesPerSecond() << " vertices/s)\n";
+		auto& processingStatistics = mesh.processingStatistics;
+		std::cout << "  Welded " << processingStatistics.removedVertices << " vertices, ACMR " << processingStatistics.cacheBefore.acmr << " -> " << processingStatistics.cacheAfter.acmr << ", ATVR " << processingStatistics.cacheBefore.atvr << " -> " << processingStatistics.cacheAfter.atvr << "\n";
+	}
+	else {
+		std::cout << "Loaded " << path << " from cache in " << mesh.seconds * 1000 << "ms\n";
+	}
+
+	std::cout << "  " << (mesh.vertexFormat == VertexFormat::Packed ? "Packed" : "Full") << " vertices, " << mesh.vertexDataSize() + mesh.indexDataSize() << " bytes of geometry\n";
+	for (uint32 lod = 0; lod < mesh.lodCount; lod++) {
+		std::cout << "  LOD " << lod << ": " << mesh.lods[lod].indexCount / 3 << " triangles, error " << mesh.lods[lod].error << "\n";
+	}
+}
+
+void logTextureLoad(const std::string& path, const TextureLoaders::CachedTexture& texture) {
+	if (texture.rebuilt) {
+		std::cout << "Rebuilt texture cache for " << path << " in " << texture.seconds * 1000 << "ms";
+
+		auto& loadStatistics = texture.sourceStatistics;
+		if (loadStatistics.texelCount > 0) std::cout << " (decoded at " << loadStatistics.megabytesPerSecond() << " MB/s, " << loadStatistics.megatexelsPerSecond() << " Mtexels/s on " << loadStatistics.threadCount << " threads)";
+		std::cout << "\n";
+	}
+	else {
+		std::cout << "Loaded " << path << " from cache in " << texture.seconds * 1000 << "ms\n";
+	}
+
+	std::cout << "  " << vk::to_string(texture.format) << ", " << texture.extent.width << "x" << texture.extent.height << ", " << texture.levelCount() << " levels, " << texture.dataSize << " bytes";
+	if (std::isfinite(texture.psnr)) std::cout << ", PSNR " << texture.psnr << " dB";
+	std::cout << "\n";
+}
+
+void logEnvironmentLoad(const std::string& path, const TextureLoaders::CachedEnvironment& environment, const TextureLoaders::EnvironmentBakeOptions& options) {
+	if (environment.rebuilt) {
+		std::cout << "Baked environment lighting for " << path << " in " << environment.bakeSeconds * 1000 << "ms (" << options.specular.sampleCount << " samples per texel)\n";
+	}
+	else {
+		std::cout << "Loaded environment lighting for " << path << " from cache in " << environment.seconds * 1000 << "ms\n";
+	}
+
+	std::cout << "  Specular " << environment.faceSize << "x" << environment.faceSize << " cube, " << environment.specularLevelCount() << " levels, BRDF LUT " << environment.brdfLutExtent.width << "x" << environment.brdfLutExtent.height << "\n";
+}
+
+void logMemoryStatistics(const MemoryAllocator& allocator) {
+	MemoryStatistics statistics = allocator.statistics();
+	std::cout << "Device memory: " << statistics.allocationCount << " allocations in " << statistics.blockCount << " blocks (" << statistics.dedicatedBlockCount << " dedicated), " << statistics.usedSize << " of " << statistics.reservedSize << " bytes used (" << statistics.utilization() * 100 << "%)\n";
+	std::cout << "  " << statistics.freeRangeCount << " free ranges, largest " << statistics.largestFreeRange << " bytes, fragmentation " << statistics.fragmentation() * 100 << "%\n";
+}
+
 int main() {
 	Window window(1280, 720, "Praise kek");
 	Camera camera(Transform(glm::vec3(0, 5, 3)), glm::perspective(glm::radians(75.0f), 1280.f / 720.f, 0.1f, 100.0f));
 
-	Mesh tableMesh = MeshLoaders::load_ply("meshes/UnitCube.ply");
+	// The skybox only has a pipeline for full precision vertices and always covers the screen
+	MeshUtil::MeshProcessingOptions fullPrecision;
+	fullPrecision.allowPackedVertices = false;
+	fullPrecision.buildLods = false;
 	Material pbrMaterial;
 
 
@@ -221,6 +286,24 @@ int main() {
 	vulkan.createPhysicalDevice();
 	vulkan.createLogicalDevice();
 	vulkan.createUtilityPool();
+
+	// Vertices and indices of every mesh, bound once per pass
+	GeometryArena geometry(vulkan, 64 * 1024 * 1024, 32 * 1024 * 1024);
+
+	// Loading starts right away and runs in the background, frames render with placeholders until assets are resident
+	AssetLoader assets(vulkan, geometry);
+	// Each mesh is decoded and cached once, the unit cube serves the skybox and stands in for the table
+	auto unitCube = assets.loadMesh("meshes/UnitCube.ply", fullPrecision);
+	auto tableMesh = assets.loadMesh("meshes/table.ply");
+	// Kept as half floats, block compression would cost the bake precision in the bright parts of the sky
+	TextureLoaders::TextureImportOptions environmentOptions;
+	environmentOptions.compress = false;
+	auto environmentTexture = assets.loadTexture("textures/waterfall_Env.exr", environmentOptions);
+	// Specular lighting of the environment, requested once the texture is in its cache so the bake reads the same mip chain
+	TextureLoaders::EnvironmentBakeOptions environmentBakeOptions;
+	environmentBakeOptions.specular.sampleCount = 512;
+	std::shared_ptr<EnvironmentAsset> environmentLighting;
+
 	auto si = createSwapChain(vulkan, vulkan.instance, swapChain, vulkan.physicalDevice, vulkan.surface, vulkan.device, swapChainImages);
 	format = std::get<vk::Format>(si);
 	extent = std::get<vk::Extent2D>(si);
@@ -238,12 +321,21 @@ int main() {
 
 	std::vector<vk::Framebuffer> swapChainFramebuffers;
 	vk::CommandPool commandPool;
-	std::vector<vk::CommandBuffer> commandBuffers;
+	// Everything a frame in flight uses on its own
+	struct Frame {
+		vk::CommandBuffer commandBuffer;
+		vk::Semaphore imageAvailable;
+		vk::Semaphore renderFinished;
+		// Signalled when the frame finished, its command buffers and the uniforms it read can be reused
+		vk::Fence fence;
+	};
+	std::array<Frame, FRAMES_IN_FLIGHT> frames;
+	uint32 frameIndex = 0;
+	// Records the deferred pass into a command buffer, drawing to the given swap chain image with the given level of detail of the table
+	std::function<void(vk::CommandBuffer, uint32, uint32)> recordFrame;
 
 	vk::DescriptorPool descriptorPool;
 
-	vk::Semaphore imageAvailableSemaphore, renderFinishedSemaphore;
-
 	vk::Image textureImage;
 	vk::DeviceMemory textureImageMemory;
 	vk::ImageView textureImageView;
@@ -251,57 +343,80 @@ int main() {
 
 	vk::Image depthImage;
 	vk::ImageView depthImageView;
-	vk::DeviceMemory depthImageMemory;
+	MemoryAllocation depthImageMemory;
 
 
-	DeviceLocalBuffer vertexBuffer(vulkan, vk::BufferUsageFlagBits::eVertexBuffer);
-	DeviceLocalBuffer indexBuffer(vulkan, vk::BufferUsageFlagBits::eIndexBuffer);
-	HostCoherentBuffer uniformBuffer(vulkan, vk::BufferUsageFlagBits::eUniformBuffer);
-	HostCoherentBuffer lightUniformBuffer(vulkan, vk::BufferUsageFlagBits::eUniformBuffer);
+	// Camera and light uniforms of every frame, bound with dynamic offsets
+	UniformRingBuffer uniformRing(vulkan, 256 * 1024);
+	uint32 generalUniformOffset = 0;
+	uint32 lightUniformOffset = 0;
+	// Pushed to the lighting subpass, which reconstructs world positions from depth
+	struct LightingConstants {
+		glm::mat4 inverseViewProjection;
+		glm::vec3 cameraPosition;
+		// Scales the specular light of the environment, 0 until it is resident
+		float specularIntensity = 0.0f;
+	} lightingConstants;
+	// Ambient light from the environment, no ambient light until the environment is resident
+	HostCoherentBuffer irradianceUniformBuffer(vulkan, vk::BufferUsageFlagBits::eUniformBuffer);
 
 
 	/* Deferred renderer! */
 	vk::ShaderModule geometryVertexShader;
+	vk::ShaderModule geometryPackedVertexShader;
 	vk::ShaderModule geometryFragmentShader;
 
-	vk::RenderPass geometryPass;
+	// Geometry and lighting as two subpasses of one render pass, drawing into the swap chain framebuffers
+	vk::RenderPass deferredPass;
 	vk::PipelineLayout geometryPipelineLayout;
 	vk::Pipeline geometryPipeline;
-	vk::Framebuffer geometryFramebuffer;
-
-	vk::Image gPositionBuffer;
-	vk::ImageView gPositionView;
-	vk::DeviceMemory gPositionMemory;
+	vk::Pipeline geometryPackedPipeline;
 
+	// Octahedral encoded normals
 	vk::Image gNormalBuffer;
 	vk::ImageView gNormalView;
-	vk::DeviceMemory gNormalMemory;
+	MemoryAllocation gNormalMemory;
+
+	// Albedo in rgb, roughness in alpha
+	vk::Image gAlbedoBuffer;
+	vk::ImageView gAlbedoView;
+	MemoryAllocation gAlbedoMemory;
 
-	vk::CommandBuffer geometryPassCommandBuffer;
+	uint32 tableLod = 0;
+	// Whether the table and the environment texture replaced their placeholders
+	bool tableBound = false;
+	bool environmentBound = false;
+	bool environmentLightingBound = false;
 
 	/* Normal renderer */
 	vk::ShaderModule lightingVertexShader;
 	vk::ShaderModule lightingFragmentShader;
 
-	vk::RenderPass lightingPass;
 	vk::Pipeline lightingPipeline;
 	vk::PipelineLayout lightingPipelineLayout;
 
-	DeviceLocalBuffer screenQuadBuffer(vulkan, vk::BufferUsageFlagBits::eVertexBuffer);
-	Vertex screenQuad[] = {
+	// Copies and layout transitions of the setup, submitted together once it is done
+	UploadContext setupUploads(vulkan);
+
+	Vertex screenQuadVertices[] = {
 		{ glm::vec3(-1, -1, 0) }, { glm::vec3(1, -1, 0) },
 		{ glm::vec3(-1, 1, 0) }, { glm::vec3(1, 1, 0) }
 	};
-	screenQuadBuffer.fill(screenQuad, sizeof(Vertex) * 4);
+	GeometryRange screenQuad = geometry.allocate(4, sizeof(Vertex));
+	setupUploads.uploadBuffer(screenQuadVertices, sizeof(screenQuadVertices), geometry.vertexBuffer, screenQuad.vertexDataOffset);
 
 
 
-	Mesh unitCube = MeshLoaders::load_ply("meshes/UnitCube.ply");
-	DeviceLocalBuffer unitCubeVertexBuffer(vulkan, vk::BufferUsageFlagBits::eVertexBuffer);
-	DeviceLocalBuffer unitCubeIndexBuffer(vulkan, vk::BufferUsageFlagBits::eIndexBuffer);
+	// The skybox is recorded once, so the unit cube has to be there before it is.
+	// It also stands in for the table until that is resident
+	assets.waitFor(*unitCube);
+	if (!unitCube->resident()) throw std::runtime_error("Failed to load the unit cube: " + unitCube->error);
+	logMeshLoad(unitCube->path.string(), unitCube->mesh);
 
-	unitCubeVertexBuffer.fill(unitCube.vertices.data(), sizeof(Vertex) * unitCube.vertices.size());
-	unitCubeIndexBuffer.fill(unitCube.indices.data(), sizeof(uint32) * unitCube.indices.size());
+	// Mid grey until the environment texture is resident
+	const uint8 placeholderPixel[] = { 128, 128, 128, 255 };
+	auto placeholderTexture = assets.createTexture({ 1, 1 }, placeholderPixel);
+	assets.waitFor(*placeholderTexture);
 
 	/*
 		Refactor
@@ -312,7 +427,6 @@ int main() {
 	vk::DescriptorSetLayout lightBufferLayout;
 
 	vk::DescriptorSet gBufferSet, mvpBufferSet, lightBufferSet;
-	vk::Sampler gBufferSampler;
 
 
 	struct RenderPipeline {
@@ -321,24 +435,35 @@ int main() {
 		vk::Pipeline pipeline;
 	};
 
-	struct CubemapRenderTarget {
-		std::array<vk::ImageView, 6> imageViews;
-		std::array<vk::Framebuffer, 6> framebuffers;
-	};
-
+	// The environment baked into a cubemap with a full mip chain. All six faces of a level are rendered by one multiview pass
 	struct Cubemap {
-		~Cubemap() { delete renderTarget; }
-
-		vk::ImageView view;
 		vk::Image image;
-		vk::DeviceMemory memory;
-		
-		CubemapRenderTarget* renderTarget = nullptr;
+		MemoryAllocation memory;
+		// Cube view of every level
+		vk::ImageView view;
+		vk::Sampler sampler;
+		uint32 faceSize = 0;
+		uint32 levelCount = 0;
+
+		// Array views of the six faces of each level and the framebuffers rendering into them
+		std::vector<vk::ImageView> levelViews;
+		std::vector<vk::Framebuffer> framebuffers;
 	};
 
 	Cubemap environmentCubemap;
+	// Half floats keep the range of the environment through the bake
+	const vk::Format cubemapFormat = vk::Format::eR16G16B16A16Sfloat;
+	const uint32 cubemapFaceSize = 512;
 
 	vk::CommandBuffer cubemapCommandBuffer;
+	// Records the bake for a source of the given width, which decides the level of the source each level of the cubemap reads
+	std::function<void(uint32)> recordCubemapBake;
+	// Samples the equirectangular source of the bake, pointed at the environment texture once it is resident
+	vk::DescriptorSet cubemapSourceSet;
+	// Gpu time of the bake, read back from a pair of timestamps once its fence signalled
+	vk::QueryPool cubemapTimestamps;
+	vk::Fence cubemapFence;
+	bool cubemapBakePending = false;
 
 
 	vk::Sampler plainSampler;
@@ -356,16 +481,19 @@ int main() {
 
 	vk::Pipeline skyboxPipeline;
 	vk::PipelineLayout skyboxPipelineLayout;
-	vk::RenderPass skyboxPass;
 
 	try {
 		// Create descriptor pool
 		{
-			std::array<vk::DescriptorPoolSize, 2> poolSizes = {};
+			std::array<vk::DescriptorPoolSize, 4> poolSizes = {};
 			poolSizes[0].type = vk::DescriptorType::eUniformBuffer;
 			poolSizes[0].descriptorCount = 16;
 			poolSizes[1].type = vk::DescriptorType::eCombinedImageSampler;
 			poolSizes[1].descriptorCount = 16;
+			poolSizes[2].type = vk::DescriptorType::eUniformBufferDynamic;
+			poolSizes[2].descriptorCount = 8;
+			poolSizes[3].type = vk::DescriptorType::eInputAttachment;
+			poolSizes[3].descriptorCount = 3;
 
 			vk::DescriptorPoolCreateInfo poolInfo = {};
 			poolInfo.poolSizeCount = poolSizes.size();
@@ -381,15 +509,17 @@ int main() {
 
 			vk::CommandPoolCreateInfo poolInfo = {};
 			poolInfo.queueFamilyIndex = indices.graphicsFamily;
+			// The geometry pass is recorded again whenever the level of detail changes
+			poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
 			commandPool = vulkan.device.createCommandPool(poolInfo);
 		}
 
 		// Create depth buffer
 		{
 			vk::Format depthFormat = vk::Format::eD32Sfloat;
-			VkUtil::createImage(vulkan, depthImage, depthImageMemory, extent, depthFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment, vk::MemoryPropertyFlagBits::eDeviceLocal);
+			// Also read by the lighting subpass to reconstruct positions
+			VkUtil::createTransientImage(vulkan, depthImage, depthImageMemory, extent, depthFormat, vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eInputAttachment);
 			depthImageView = VkUtil::createImageView(vulkan, depthImage, depthFormat, vk::ImageAspectFlagBits::eDepth);
-			VkUtil::transitionImageLayout(vulkan, depthImage, depthFormat, vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal);
 		}
 
 		// Bake Environment Map Into Cubemap
@@ -403,44 +533,6 @@ int main() {
 
 			vk::CommandBuffer commandBuffer;
 
-			struct {
-				vk::Image image;
-				vk::ImageView view;
-				vk::DeviceMemory memory;
-			} sourceImage;
-
-			// Load source image
-			{
-				int texWidth, texHeight, texChannels;
-				uint8* pixels = stbi_load("textures/waterfall_Bg.jpg", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-				vk::DeviceSize imageSize = texWidth * texHeight * 4;
-
-				if (!pixels) throw std::runtime_error("Failed to load texture.");
-
-				vk::Buffer stagingBuffer;
-				vk::DeviceMemory stagingBufferMemory;
-
-				VkUtil::createBuffer(vulkan, imageSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingBufferMemory);
-
-				void* data = vulkan.device.mapMemory(stagingBufferMemory, 0, imageSize);
-				memcpy(data, pixels, imageSize);
-				vulkan.device.unmapMemory(stagingBufferMemory);
-
-				stbi_image_free(pixels);
-
-				vk::Extent2D imgExtent = { (uint32)texWidth, (uint32)texHeight };
-
-				VkUtil::createImage(vulkan, sourceImage.image, sourceImage.memory, imgExtent, vk::Format::eR8G8B8A8Unorm, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal);
-				VkUtil::transitionImageLayout(vulkan, sourceImage.image, vk::Format::eR8G8B8A8Unorm, vk::ImageLayout::ePreinitialized, vk::ImageLayout::eTransferDstOptimal);
-				VkUtil::copyBufferToImage(vulkan, stagingBuffer, sourceImage.image, imgExtent);
-				VkUtil::transitionImageLayout(vulkan, sourceImage.image, vk::Format::eR8G8B8A8Unorm, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
-
-				vulkan.device.destroyBuffer(stagingBuffer);
-				vulkan.device.freeMemory(stagingBufferMemory);
-
-				sourceImage.view = VkUtil::createImageView(vulkan, sourceImage.image, vk::Format::eR8G8B8A8Unorm, vk::ImageAspectFlagBits::eColor);
-			}
-
 			// Create Descriptor Set Layout
 			{
 				vk::DescriptorSetLayoutBinding envMap;
@@ -467,7 +559,7 @@ int main() {
 
 				vk::DescriptorImageInfo imageInfo;
 				imageInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-				imageInfo.imageView = sourceImage.view;
+				imageInfo.imageView = placeholderTexture->view;
 				imageInfo.sampler = plainSampler;
 
 				vk::WriteDescriptorSet descWrite;
@@ -483,180 +575,153 @@ int main() {
 
 			// Create Renderpass
 			{
-				// 1 Attachment for the face we are rendering in to
-				// 1 Depth Attachment
-				std::array<vk::AttachmentDescription, 2> attachments;
-				for (auto& it : attachments) {
-					it.samples = vk::SampleCountFlagBits::e1;
-					it.initialLayout = vk::ImageLayout::eUndefined;
-				}
-
-				attachments[0].format = vk::Format::eR8G8B8A8Unorm;
-				attachments[0].loadOp = vk::AttachmentLoadOp::eClear;
-				attachments[0].storeOp = vk::AttachmentStoreOp::eStore;
-				attachments[0].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
-				attachments[0].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-				attachments[0].finalLayout = vk::ImageLayout::eColorAttachmentOptimal;
-
-				attachments[1].format = vk::Format::eD32Sfloat;
-				attachments[1].loadOp = vk::AttachmentLoadOp::eClear;
-				attachments[1].storeOp = vk::AttachmentStoreOp::eDontCare;
-				attachments[1].stencilLoadOp = vk::AttachmentLoadOp::eClear;
-				attachments[1].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-				attachments[1].finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-
-				std::array<vk::AttachmentReference, 2> attachmentRefs;
-				for (int i = 0; i < attachmentRefs.size(); i++) {
-					attachmentRefs[i].attachment = i;
-				}
-
-				attachmentRefs[0].layout = vk::ImageLayout::eColorAttachmentOptimal;
-				attachmentRefs[1].layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+				// Every texel of a level is written, so the previous contents never have to be loaded
+				vk::AttachmentDescription attachment;
+				attachment.format = cubemapFormat;
+				attachment.samples = vk::SampleCountFlagBits::e1;
+				attachment.loadOp = vk::AttachmentLoadOp::eDontCare;
+				attachment.storeOp = vk::AttachmentStoreOp::eStore;
+				attachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+				attachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+				attachment.initialLayout = vk::ImageLayout::eUndefined;
+				attachment.finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+				vk::AttachmentReference attachmentRef;
+				attachmentRef.attachment = 0;
+				attachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
 
 				vk::SubpassDescription subpass;
+				subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
 				subpass.colorAttachmentCount = 1;
-				subpass.pColorAttachments = &attachmentRefs[0];
-				subpass.pDepthStencilAttachment = &attachmentRefs[1];
-
-				vk::SubpassDependency dependency;
-				dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-				dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+				subpass.pColorAttachments = &attachmentRef;
+
+				// A bake overwrites faces the skybox may still read, and the skybox reads them after the bake
+				std::array<vk::SubpassDependency, 2> dependencies;
+				dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+				dependencies[0].dstSubpass = 0;
+				dependencies[0].srcStageMask = vk::PipelineStageFlagBits::eFragmentShader;
+				dependencies[0].dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+				dependencies[0].dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+
+				dependencies[1].srcSubpass = 0;
+				dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+				dependencies[1].srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+				dependencies[1].srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+				dependencies[1].dstStageMask = vk::PipelineStageFlagBits::eFragmentShader;
+				dependencies[1].dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+				// View i renders to layer i, which is face i of the cube
+				const uint32 viewMask = 0x3f;
+				vk::RenderPassMultiviewCreateInfoKHR multiviewInfo;
+				multiviewInfo.subpassCount = 1;
+				multiviewInfo.pViewMasks = &viewMask;
+				multiviewInfo.correlationMaskCount = 1;
+				multiviewInfo.pCorrelationMasks = &viewMask;
 
 				vk::RenderPassCreateInfo renderPassInfo;
-				renderPassInfo.attachmentCount = attachments.size();
-				renderPassInfo.pAttachments = attachments.data();
+				renderPassInfo.pNext = &multiviewInfo;
+				renderPassInfo.attachmentCount = 1;
+				renderPassInfo.pAttachments = &attachment;
 				renderPassInfo.subpassCount = 1;
 				renderPassInfo.pSubpasses = &subpass;
-				renderPassInfo.dependencyCount = 1;
-				renderPassInfo.pDependencies = &dependency;
+				renderPassInfo.dependencyCount = dependencies.size();
+				renderPassInfo.pDependencies = dependencies.data();
 
 				renderPass = vulkan.device.createRenderPass(renderPassInfo);
 			}
 
 			// Create Pipeline
 			{
-				{
-					auto vertexShaderModule = createShaderModule(FUtil::file_read_binary("shaders/compiled/process/equi_to_cube.vert.spv"), vulkan.device);
-					auto fragmentShaderModule = createShaderModule(FUtil::file_read_binary("shaders/compiled/process/equi_to_cube.frag.spv"), vulkan.device);
-
-					PipelineFactory factory;
-					factory.shaderStages.emplace_back(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eVertex, vertexShaderModule, "main");
-					factory.shaderStages.emplace_back(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eFragment, fragmentShaderModule, "main");
-
-					auto bindingDescription = Vertex::getBindingDescription();
-					auto attributeDescriptions = Vertex::getAttributeDescriptions();
+				auto vertexShaderModule = createShaderModule(FUtil::file_read_binary("shaders/compiled/process/equi_to_cube.vert.spv"), vulkan.device);
+				auto fragmentShaderModule = createShaderModule(FUtil::file_read_binary("shaders/compiled/process/equi_to_cube.frag.spv"), vulkan.device);
 
-					factory.vertexInput.vertexBindingDescriptionCount = 1;
-					factory.vertexInput.pVertexBindingDescriptions = &bindingDescription;
-					factory.vertexInput.vertexAttributeDescriptionCount = attributeDescriptions.size();
-					factory.vertexInput.pVertexAttributeDescriptions = attributeDescriptions.data();
+				PipelineFactory factory;
+				factory.shaderStages.emplace_back(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eVertex, vertexShaderModule, "main");
+				factory.shaderStages.emplace_back(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eFragment, fragmentShaderModule, "main");
 
-					factory.inputAssembly.topology = vk::PrimitiveTopology::eTriangleList;
-					factory.viewport = screenViewport;
-					factory.scissor = screenScissor;
+				// The triangle covering a face is generated from the vertex index, there are no vertex buffers
+				factory.inputAssembly.topology = vk::PrimitiveTopology::eTriangleList;
+				factory.viewport = screenViewport;
+				factory.scissor = screenScissor;
+				// Levels differ in size
+				factory.dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
 
-					factory.rasterizer.lineWidth = 1.0f;
+				factory.rasterizer.lineWidth = 1.0f;
 
-					vk::PipelineColorBlendAttachmentState colorBlendAttachment = {};
-					colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB;
-					auto colorBlendAttachments = { colorBlendAttachment };
+				vk::PipelineColorBlendAttachmentState colorBlendAttachment = {};
+				colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+				auto colorBlendAttachments = { colorBlendAttachment };
 
-					factory.colorBlending.attachmentCount = 1;
-					factory.colorBlending.pAttachments = colorBlendAttachments.begin();
+				factory.colorBlending.attachmentCount = 1;
+				factory.colorBlending.pAttachments = colorBlendAttachments.begin();
 
-					factory.multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
+				factory.multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
 
-					factory.depthStencil.depthTestEnable = true;
-					factory.depthStencil.depthWriteEnable = true;
-					factory.depthStencil.depthCompareOp = vk::CompareOp::eLessOrEqual;
+				auto setLayouts = { descSetLayout };
 
-					auto setLayouts = { descSetLayout };
+				std::array<vk::PushConstantRange, 1> pushConstants;
+				pushConstants[0].offset = 0;
+				pushConstants[0].size = sizeof(float);
+				pushConstants[0].stageFlags = vk::ShaderStageFlagBits::eFragment;
 
-					std::array<vk::PushConstantRange, 1> pushConstants;
-					pushConstants[0].offset = 0;
-					pushConstants[0].size = sizeof(glm::mat4) * 2;
-					pushConstants[0].stageFlags = vk::ShaderStageFlagBits::eVertex;
+				vk::PipelineLayoutCreateInfo pipelineLayoutInfo = {};
+				pipelineLayoutInfo.setLayoutCount = setLayouts.size();
+				pipelineLayoutInfo.pSetLayouts = setLayouts.begin();
+				pipelineLayoutInfo.pushConstantRangeCount = pushConstants.size();
+				pipelineLayoutInfo.pPushConstantRanges = pushConstants.data();
 
-					vk::PipelineLayoutCreateInfo pipelineLayoutInfo = {};
-					pipelineLayoutInfo.setLayoutCount = setLayouts.size();
-					pipelineLayoutInfo.pSetLayouts = setLayouts.begin();
-					pipelineLayoutInfo.pushConstantRangeCount = pushConstants.size();
-					pipelineLayoutInfo.pPushConstantRanges = pushConstants.data();
+				pipelineLayout = vulkan.device.createPipelineLayout(pipelineLayoutInfo);
 
-					pipelineLayout = vulkan.device.createPipelineLayout(pipelineLayoutInfo);
-
-					factory.layout = pipelineLayout;
-					factory.renderPass = renderPass;
-					pipeline = factory.createPipeline(vulkan.device);
-				}
+				factory.layout = pipelineLayout;
+				factory.renderPass = renderPass;
+				pipeline = factory.createPipeline(vulkan.device);
 			}
 
 			// Create cubemap
 			{
-				vk::ImageCreateInfo imageInfo;
-				imageInfo.imageType = vk::ImageType::e2D;
-				imageInfo.extent = { (uint32)extent.width, (uint32)extent.height, 1 };
-				imageInfo.mipLevels = 1;
-				imageInfo.arrayLayers = 6;
-				imageInfo.format = vk::Format::eR8G8B8A8Unorm;
-				imageInfo.initialLayout = vk::ImageLayout::ePreinitialized;
-				imageInfo.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled;
-				imageInfo.samples = vk::SampleCountFlagBits::e1;
-				environmentCubemap.image = vulkan.device.createImage(imageInfo);
-
-				vk::MemoryRequirements memReq = vulkan.device.getImageMemoryRequirements(environmentCubemap.image);
-				vk::MemoryAllocateInfo allocInfo;
-				allocInfo.allocationSize = memReq.size;
-				allocInfo.memoryTypeIndex = findMemoryType(vulkan.physicalDevice, memReq.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-				environmentCubemap.memory = vulkan.device.allocateMemory(allocInfo);
-				vulkan.device.bindImageMemory(environmentCubemap.image, environmentCubemap.memory, 0);
-
-				VkUtil::transitionImageLayout(vulkan, environmentCubemap.image, vk::Format::eR8G8B8A8Unorm, vk::ImageLayout::ePreinitialized, vk::ImageLayout::eColorAttachmentOptimal);
-
-				{
-					vk::ImageViewCreateInfo viewInfo;
-					viewInfo.image = environmentCubemap.image;
-					viewInfo.viewType = vk::ImageViewType::e3D;
-					viewInfo.format = vk::Format::eR8G8B8A8Unorm;
-					viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-					viewInfo.subresourceRange.levelCount = 1;
-					viewInfo.subresourceRange.layerCount = 1;
+				environmentCubemap.faceSize = cubemapFaceSize;
+				environmentCubemap.levelCount = TextureUtil::mip_level_count({ cubemapFaceSize, cubemapFaceSize });
 
-					environmentCubemap.view = vulkan.device.createImageView(viewInfo);
-				}
+				VkUtil::createImage(vulkan, environmentCubemap.image, environmentCubemap.memory, { cubemapFaceSize, cubemapFaceSize }, cubemapFormat, vk::ImageTiling::eOptimal,
+					vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal, environmentCubemap.levelCount, 6, vk::ImageCreateFlagBits::eCubeCompatible);
+				environmentCubemap.view = VkUtil::createImageView(vulkan, environmentCubemap.image, cubemapFormat, vk::ImageAspectFlagBits::eColor, environmentCubemap.levelCount, vk::ImageViewType::eCube, 6);
+				environmentCubemap.sampler = VkUtil::createSampler(vulkan, environmentCubemap.levelCount, vk::SamplerAddressMode::eClampToEdge);
 
-				environmentCubemap.renderTarget = new CubemapRenderTarget();
-
-				for (int i = 0; i < 6; i++) {
+				for (uint32 level = 0; level < environmentCubemap.levelCount; level++) {
 					vk::ImageViewCreateInfo viewInfo;
 					viewInfo.image = environmentCubemap.image;
-					viewInfo.viewType = vk::ImageViewType::e2D;
-					viewInfo.format = vk::Format::eR8G8B8A8Unorm;
+					viewInfo.viewType = vk::ImageViewType::e2DArray;
+					viewInfo.format = cubemapFormat;
 					viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+					viewInfo.subresourceRange.baseMipLevel = level;
 					viewInfo.subresourceRange.levelCount = 1;
-					viewInfo.subresourceRange.layerCount = 1;
-					viewInfo.subresourceRange.baseArrayLayer = i;
-
-					environmentCubemap.renderTarget->imageViews[i] = vulkan.device.createImageView(viewInfo);
+					viewInfo.subresourceRange.layerCount = 6;
 
-					auto attachments = {
-						environmentCubemap.renderTarget->imageViews[i],
-						depthImageView
-					};
+					environmentCubemap.levelViews.push_back(vulkan.device.createImageView(viewInfo));
 
+					// Multiview framebuffers have a single layer, the views select the layers of the attachment
+					uint32 faceSize = std::max(1u, cubemapFaceSize >> level);
 					vk::FramebufferCreateInfo fbInfo;
-					fbInfo.attachmentCount = attachments.size();
-					fbInfo.pAttachments = attachments.begin();
-					fbInfo.height = extent.height;
-					fbInfo.width = extent.width;
+					fbInfo.attachmentCount = 1;
+					fbInfo.pAttachments = &environmentCubemap.levelViews.back();
+					fbInfo.height = faceSize;
+					fbInfo.width = faceSize;
 					fbInfo.layers = 1;
 					fbInfo.renderPass = renderPass;
 
-					environmentCubemap.renderTarget->framebuffers[i] = vulkan.device.createFramebuffer(fbInfo);
+					environmentCubemap.framebuffers.push_back(vulkan.device.createFramebuffer(fbInfo));
 				}
 			}
 
+			// Create timestamp queries
+			{
+				vk::QueryPoolCreateInfo queryInfo;
+				queryInfo.queryType = vk::QueryType::eTimestamp;
+				queryInfo.queryCount = 2;
+
+				cubemapTimestamps = vulkan.device.createQueryPool(queryInfo);
+				cubemapFence = vulkan.device.createFence({});
+			}
 
 			// Create command buffer
 			{
@@ -668,61 +733,55 @@ int main() {
 			}
 
 			// Record commands
-			{
-				auto& cb = commandBuffer;
-				cb.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eSimultaneousUse));
-
-				std::array<vk::ClearValue, 2> clearColors = {};
-				clearColors[0].color = vk::ClearColorValue(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 0.0f });
-				clearColors[1].depthStencil = vk::ClearDepthStencilValue(1, 0);
-
-				glm::mat4 captureViews[] =
-				{
-					glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-					glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-					glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
-					glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
-					glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-					glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
-				};
-				glm::mat4 captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-				captureProjection[1][1] *= -1;
+			recordCubemapBake = [&environmentCubemap, &cubemapTimestamps, renderPass, pipeline, pipelineLayout, descSet, commandBuffer](uint32 sourceWidth) {
+				auto cb = commandBuffer;
+				cb.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
 
-				for (int i = 0; i < 6; i++) {
+				cb.resetQueryPool(cubemapTimestamps, 0, 2);
+				cb.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, cubemapTimestamps, 0);
+
+				for (uint32 level = 0; level < environmentCubemap.levelCount; level++) {
+					uint32 faceSize = std::max(1u, environmentCubemap.faceSize >> level);
 
 					vk::RenderPassBeginInfo rInfo;
 					rInfo.renderPass = renderPass;
-					rInfo.framebuffer = environmentCubemap.renderTarget->framebuffers[i];
-					rInfo.clearValueCount = clearColors.size();
-					rInfo.pClearValues = clearColors.data();
-					rInfo.renderArea = vk::Rect2D({ 0, 0, }, extent);
+					rInfo.framebuffer = environmentCubemap.framebuffers[level];
+					rInfo.renderArea = vk::Rect2D({ 0, 0 }, { faceSize, faceSize });
 
 					cb.beginRenderPass(rInfo, vk::SubpassContents::eInline);
 
+					vk::Viewport viewport(0.0f, 0.0f, (float)faceSize, (float)faceSize, 0.0f, 1.0f);
+					vk::Rect2D scissor({ 0, 0 }, { faceSize, faceSize });
+					cb.setViewport(0, 1, &viewport);
+					cb.setScissor(0, 1, &scissor);
+
 					cb.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
 					cb.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &descSet, 0, nullptr);
 
-					vk::DeviceSize offsets[] = { 0 };
-					cb.bindVertexBuffers(0, 1, &unitCubeVertexBuffer.buffer, offsets);
-					cb.bindIndexBuffer(unitCubeIndexBuffer.buffer, 0, vk::IndexType::eUint32);
-
-					glm::mat4 pushConstants[] = { captureViews[i], captureProjection };
-
-					cb.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(glm::mat4) * 2, pushConstants);
-					cb.drawIndexed(unitCube.indices.size(), 1, 0, 0, 0);
+					// A face texel spans about 4 / pi times the angle of a source texel at the same resolution, the source
+					// covers 2 pi radians across and a face pi / 2
+					float sourceLod = std::max(0.0f, std::log2((float)sourceWidth / (4.0f * faceSize)));
+					cb.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(float), &sourceLod);
+					cb.draw(3, 1, 0, 0);
 
 					cb.endRenderPass();
 				}
 
-
+				cb.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, cubemapTimestamps, 1);
 				cb.end();
-			}
-		
+			};
+
+			recordCubemapBake(placeholderTexture->extent.width);
+
 			vk::SubmitInfo submitInfo;
 			submitInfo.commandBufferCount = 1;
 			submitInfo.pCommandBuffers = &commandBuffer;
 			
-			vulkan.graphicsQueue.submit(1, &submitInfo, nullptr);
+			vulkan.graphicsQueue.submit(1, &submitInfo, cubemapFence);
+
+			// Baked again once the environment texture is resident
+			cubemapSourceSet = descSet;
+			cubemapCommandBuffer = commandBuffer;
 		}
 
 		// Create descriptor set layouts 
@@ -731,7 +790,7 @@ int main() {
 		vk::DescriptorSetLayoutBinding mvpLayoutBinding = {};
 		mvpLayoutBinding.binding = 0;
 		mvpLayoutBinding.descriptorCount = 1;
-		mvpLayoutBinding.descriptorType = vk::DescriptorType::eUniformBuffer;
+		mvpLayoutBinding.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
 		mvpLayoutBinding.stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
 
 		vk::DescriptorSetLayoutCreateInfo layoutInfo = {};
@@ -742,19 +801,19 @@ int main() {
 		}
 
 		{
-			vk::DescriptorSetLayoutBinding positionBuffer = {};
-			positionBuffer.binding = 0;
-			positionBuffer.descriptorCount = 1;
-			positionBuffer.descriptorType = vk::DescriptorType::eCombinedImageSampler;
-			positionBuffer.stageFlags = vk::ShaderStageFlagBits::eFragment;
+			vk::DescriptorSetLayoutBinding depthBuffer = {};
+			depthBuffer.binding = 0;
+			depthBuffer.descriptorCount = 1;
+			depthBuffer.descriptorType = vk::DescriptorType::eInputAttachment;
+			depthBuffer.stageFlags = vk::ShaderStageFlagBits::eFragment;
 
-			vk::DescriptorSetLayoutBinding normalBuffer = {};
+			vk::DescriptorSetLayoutBinding normalBuffer = depthBuffer;
 			normalBuffer.binding = 1;
-			normalBuffer.descriptorCount = 1;
-			normalBuffer.descriptorType = vk::DescriptorType::eCombinedImageSampler;
-			normalBuffer.stageFlags = vk::ShaderStageFlagBits::eFragment;
 
-			auto gBufferBindings = { positionBuffer, normalBuffer };
+			vk::DescriptorSetLayoutBinding albedoBuffer = depthBuffer;
+			albedoBuffer.binding = 2;
+
+			auto gBufferBindings = { depthBuffer, normalBuffer, albedoBuffer };
 			vk::DescriptorSetLayoutCreateInfo layoutInfo({}, gBufferBindings.size(), gBufferBindings.begin());
 			gBufferLayout = vulkan.device.createDescriptorSetLayout(layoutInfo);
 		}
@@ -763,10 +822,27 @@ int main() {
 			vk::DescriptorSetLayoutBinding lightBuffer = {};
 			lightBuffer.binding = 0;
 			lightBuffer.descriptorCount = 1;
-			lightBuffer.descriptorType = vk::DescriptorType::eUniformBuffer;
+			lightBuffer.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
 			lightBuffer.stageFlags = vk::ShaderStageFlagBits::eFragment;
 
-			vk::DescriptorSetLayoutCreateInfo layoutInfo({}, 1, &lightBuffer);
+			vk::DescriptorSetLayoutBinding irradianceBuffer = {};
+			irradianceBuffer.binding = 1;
+			irradianceBuffer.descriptorCount = 1;
+			irradianceBuffer.descriptorType = vk::DescriptorType::eUniformBuffer;
+			irradianceBuffer.stageFlags = vk::ShaderStageFlagBits::eFragment;
+
+			// Prefiltered specular cube and BRDF lookup table of the environment
+			vk::DescriptorSetLayoutBinding specularEnvironment = {};
+			specularEnvironment.binding = 2;
+			specularEnvironment.descriptorCount = 1;
+			specularEnvironment.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+			specularEnvironment.stageFlags = vk::ShaderStageFlagBits::eFragment;
+
+			vk::DescriptorSetLayoutBinding brdfLut = specularEnvironment;
+			brdfLut.binding = 3;
+
+			auto lightBindings = { lightBuffer, irradianceBuffer, specularEnvironment, brdfLut };
+			vk::DescriptorSetLayoutCreateInfo layoutInfo({}, lightBindings.size(), lightBindings.begin());
 			lightBufferLayout = vulkan.device.createDescriptorSetLayout(layoutInfo);
 		}
 
@@ -783,65 +859,104 @@ int main() {
 
 		/* Create deferred render pipeline */
 		geometryVertexShader	= createShaderModule(FUtil::file_read_binary("shaders/compiled/deferred/geometry_pass.vert.spv"), vulkan.device);
+		geometryPackedVertexShader = createShaderModule(FUtil::file_read_binary("shaders/compiled/deferred/geometry_pass_packed.vert.spv"), vulkan.device);
 		geometryFragmentShader	= createShaderModule(FUtil::file_read_binary("shaders/compiled/deferred/geometry_pass.frag.spv"), vulkan.device);
 
 		/* Create render pass */
 		{
+			// The g buffer and depth are only read by the lighting subpass, so they never have to leave the tile memory
 			vk::AttachmentDescription attachmentBlueprint = { };
 			attachmentBlueprint.samples = vk::SampleCountFlagBits::e1;
 			attachmentBlueprint.loadOp = vk::AttachmentLoadOp::eClear;
-			attachmentBlueprint.storeOp = vk::AttachmentStoreOp::eStore;
+			attachmentBlueprint.storeOp = vk::AttachmentStoreOp::eDontCare;
 			attachmentBlueprint.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
 			attachmentBlueprint.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
 			attachmentBlueprint.initialLayout = vk::ImageLayout::eUndefined;
-			attachmentBlueprint.finalLayout = vk::ImageLayout::eColorAttachmentOptimal;
+			attachmentBlueprint.finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
 
-			vk::AttachmentDescription positionAttachment = attachmentBlueprint;
-			positionAttachment.format = vk::Format::eR16G16B16A16Sfloat;
+			vk::AttachmentDescription colorAttachment = attachmentBlueprint;
+			colorAttachment.format = format;
+			colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+			colorAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
 
+			// Positions are reconstructed from depth, so the g buffer is 8 bytes per pixel besides it
 			vk::AttachmentDescription normalAttachment = attachmentBlueprint;
-			normalAttachment.format = vk::Format::eR16G16B16A16Sfloat;
-
-			vk::AttachmentReference positionAttachmentRef = { };
-			positionAttachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
-			positionAttachmentRef.attachment = 0;
-
-			vk::AttachmentReference normalAttachmentRef = {};
-			normalAttachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
-			normalAttachmentRef.attachment = 1;
+			normalAttachment.format = vk::Format::eR16G16Snorm;
 
+			vk::AttachmentDescription albedoAttachment = attachmentBlueprint;
+			albedoAttachment.format = vk::Format::eR8G8B8A8Unorm;
 
 			vk::AttachmentDescription depthAttachment = attachmentBlueprint;
 			depthAttachment.format = vk::Format::eD32Sfloat;
-			depthAttachment.storeOp = vk::AttachmentStoreOp::eStore;
-			depthAttachment.finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-			vk::AttachmentReference depthAttachmentRef(2, vk::ImageLayout::eDepthStencilAttachmentOptimal);
-
-			auto colorAttachments = { positionAttachmentRef, normalAttachmentRef };
+			depthAttachment.finalLayout = vk::ImageLayout::eDepthStencilReadOnlyOptimal;
 
-			vk::SubpassDescription subpass = {};
-			subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
-			subpass.colorAttachmentCount = 2;
-			subpass.pColorAttachments = colorAttachments.begin();
-			subpass.pDepthStencilAttachment = &depthAttachmentRef;
+			auto attachments = { colorAttachment, normalAttachment, albedoAttachment, depthAttachment };
 
-			auto attachments = { positionAttachment, normalAttachment, depthAttachment };
+			// Geometry subpass, writes the g buffer
+			auto gBufferOutputs = {
+				vk::AttachmentReference(1, vk::ImageLayout::eColorAttachmentOptimal),
+				vk::AttachmentReference(2, vk::ImageLayout::eColorAttachmentOptimal)
+			};
+			vk::AttachmentReference depthOutput(3, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+			// Lighting subpass, shades every pixel from the g buffer, then draws the skybox where the geometry left depth at the far plane
+			// Depth is read as an input and tested against by the skybox at the same time, both in the read-only layout
+			auto gBufferInputs = {
+				vk::AttachmentReference(3, vk::ImageLayout::eDepthStencilReadOnlyOptimal),
+				vk::AttachmentReference(1, vk::ImageLayout::eShaderReadOnlyOptimal),
+				vk::AttachmentReference(2, vk::ImageLayout::eShaderReadOnlyOptimal)
+			};
+			vk::AttachmentReference colorOutput(0, vk::ImageLayout::eColorAttachmentOptimal);
+			vk::AttachmentReference depthInput(3, vk::ImageLayout::eDepthStencilReadOnlyOptimal);
+
+			std::array<vk::SubpassDescription, 2> subpasses = {};
+			subpasses[0].pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+			subpasses[0].colorAttachmentCount = gBufferOutputs.size();
+			subpasses[0].pColorAttachments = gBufferOutputs.begin();
+			subpasses[0].pDepthStencilAttachment = &depthOutput;
+
+			subpasses[1].pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+			subpasses[1].inputAttachmentCount = gBufferInputs.size();
+			subpasses[1].pInputAttachments = gBufferInputs.begin();
+			subpasses[1].colorAttachmentCount = 1;
+			subpasses[1].pColorAttachments = &colorOutput;
+			subpasses[1].pDepthStencilAttachment = &depthInput;
+
+			std::array<vk::SubpassDependency, 3> dependencies;
+			// The g buffer and depth are shared by all frames in flight. The previous frame may still be writing them in its geometry subpass
+			// or reading them in its lighting subpass, and both have to finish before the transition out of the undefined layout
+			dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+			dependencies[0].dstSubpass = 0;
+			dependencies[0].srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+			dependencies[0].srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+			dependencies[0].dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+			dependencies[0].dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+
+			// The swap chain image is acquired with a semaphore waiting at the color output stage
+			dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
+			dependencies[1].dstSubpass = 1;
+			dependencies[1].srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+			dependencies[1].dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+			dependencies[1].dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+
+			// Every pixel of the lighting subpass only reads the g buffer at its own position, so tiles can move on independently
+			dependencies[2].srcSubpass = 0;
+			dependencies[2].dstSubpass = 1;
+			dependencies[2].srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests;
+			dependencies[2].srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+			dependencies[2].dstStageMask = vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eEarlyFragmentTests;
+			dependencies[2].dstAccessMask = vk::AccessFlagBits::eInputAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentRead;
+			dependencies[2].dependencyFlags = vk::DependencyFlagBits::eByRegion;
 
 			vk::RenderPassCreateInfo renderPassInfo = {};
 			renderPassInfo.attachmentCount = attachments.size();
 			renderPassInfo.pAttachments = attachments.begin();
-			renderPassInfo.subpassCount = 1;
-			renderPassInfo.pSubpasses = &subpass;
-
-			vk::SubpassDependency dependency = {};
-			dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-			dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
-			dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+			renderPassInfo.subpassCount = subpasses.size();
+			renderPassInfo.pSubpasses = subpasses.data();
+			renderPassInfo.dependencyCount = dependencies.size();
+			renderPassInfo.pDependencies = dependencies.data();
 
-			renderPassInfo.dependencyCount = 1;
-			renderPassInfo.pDependencies = &dependency;
-
-			geometryPass = vulkan.device.createRenderPass(renderPassInfo);
+			deferredPass = vulkan.device.createRenderPass(renderPassInfo);
 		}
 
 		{
@@ -849,13 +964,7 @@ int main() {
 			factory.shaderStages.emplace_back(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eVertex, geometryVertexShader, "main");
 			factory.shaderStages.emplace_back(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eFragment, geometryFragmentShader, "main");
 
-			auto bindingDescription = Vertex::getBindingDescription();
-			auto attributeDescriptions = Vertex::getAttributeDescriptions();
-
-			factory.vertexInput.vertexBindingDescriptionCount = 1;
-			factory.vertexInput.pVertexBindingDescriptions = &bindingDescription;
-			factory.vertexInput.vertexAttributeDescriptionCount = attributeDescriptions.size();
-			factory.vertexInput.pVertexAttributeDescriptions = attributeDescriptions.data();
+			factory.vertexInput = Vertex::getVertexInputState();
 
 			factory.inputAssembly.topology = vk::PrimitiveTopology::eTriangleList;
 			factory.viewport = screenViewport;
@@ -866,7 +975,7 @@ int main() {
 			factory.depthStencil.depthWriteEnable = true;
 
 			vk::PipelineColorBlendAttachmentState colorBlendAttachment = {};
-			colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB;
+			colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
 			auto colorBlendAttachments = { colorBlendAttachment, colorBlendAttachment };
 
 			factory.colorBlending.attachmentCount = 2;
@@ -881,14 +990,24 @@ int main() {
 
 			auto setLayouts = { mvpBufferLayout };
 
+			// Bounds to decode packed vertices, unused by the full precision pipeline
+			vk::PushConstantRange packedBoundsRange(vk::ShaderStageFlagBits::eVertex, 0, sizeof(PackedBounds));
+
 			vk::PipelineLayoutCreateInfo pipelineLayoutInfo = {};
 			pipelineLayoutInfo.setLayoutCount = setLayouts.size();
 			pipelineLayoutInfo.pSetLayouts = setLayouts.begin();
+			pipelineLayoutInfo.pushConstantRangeCount = 1;
+			pipelineLayoutInfo.pPushConstantRanges = &packedBoundsRange;
 			geometryPipelineLayout = vulkan.device.createPipelineLayout(pipelineLayoutInfo);
 
 			factory.layout = geometryPipelineLayout;
-			factory.renderPass = geometryPass;
+			factory.renderPass = deferredPass;
+			factory.subpass = 0;
 			geometryPipeline = factory.createPipeline(vulkan.device);
+
+			factory.shaderStages[0].module = geometryPackedVertexShader;
+			factory.vertexInput = PackedVertex::getVertexInputState();
+			geometryPackedPipeline = factory.createPipeline(vulkan.device);
 		}
 
 
@@ -896,53 +1015,6 @@ int main() {
 		lightingVertexShader	= createShaderModule(FUtil::file_read_binary("shaders/compiled/deferred/lighting_pass.vert.spv"), vulkan.device);
 		lightingFragmentShader	= createShaderModule(FUtil::file_read_binary("shaders/compiled/deferred/lighting_pass.frag.spv"), vulkan.device);
 
-		/* Create render pass */
-		{
-			vk::AttachmentDescription colorAttachment;
-			colorAttachment.format = format;
-			colorAttachment.loadOp = vk::AttachmentLoadOp::eClear;
-			colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
-			colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
-			colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-			colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
-			colorAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
-			colorAttachment.samples = vk::SampleCountFlagBits::e1;
-
-			vk::AttachmentDescription depthAttachment;
-			depthAttachment.format = vk::Format::eD32Sfloat;
-			depthAttachment.loadOp = vk::AttachmentLoadOp::eLoad;
-			depthAttachment.storeOp = vk::AttachmentStoreOp::eStore;
-			depthAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
-			depthAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-			depthAttachment.initialLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-			depthAttachment.finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-			depthAttachment.samples = vk::SampleCountFlagBits::e1;
-
-			vk::AttachmentReference colorAttachmentRef;
-			colorAttachmentRef.attachment = 0;
-			colorAttachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
-
-			vk::AttachmentReference depthAttachmentRef;
-			depthAttachmentRef.attachment = 1;
-			depthAttachmentRef.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-
-			vk::SubpassDescription subpass;
-			subpass.colorAttachmentCount = 1;
-			subpass.pColorAttachments = &colorAttachmentRef;
-			subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
-			subpass.pDepthStencilAttachment = &depthAttachmentRef;
-
-			auto attachments = { colorAttachment, depthAttachment };
-
-			vk::RenderPassCreateInfo renderPassInfo;
-			renderPassInfo.attachmentCount = 2;
-			renderPassInfo.pAttachments = attachments.begin();
-			renderPassInfo.subpassCount = 1;
-			renderPassInfo.pSubpasses = &subpass;
-
-			lightingPass = vulkan.device.createRenderPass(renderPassInfo);
-		}
-
 		/* Create lighting pipeline */
 		{
 			PipelineFactory factory;
@@ -981,65 +1053,25 @@ int main() {
 			factory.multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
 
 			auto layouts = { gBufferLayout, lightBufferLayout };
+
+			vk::PushConstantRange lightingConstantsRange(vk::ShaderStageFlagBits::eFragment, 0, sizeof(LightingConstants));
+
 			vk::PipelineLayoutCreateInfo layoutInfo;
 			layoutInfo.setLayoutCount = layouts.size();
 			layoutInfo.pSetLayouts = layouts.begin();
+			layoutInfo.pushConstantRangeCount = 1;
+			layoutInfo.pPushConstantRanges = &lightingConstantsRange;
 
 			lightingPipelineLayout = vulkan.device.createPipelineLayout(layoutInfo);
 
 			factory.layout = lightingPipelineLayout;
-			factory.renderPass = lightingPass;
+			factory.renderPass = deferredPass;
+			factory.subpass = 1;
 
 			lightingPipeline = factory.createPipeline(vulkan.device);
 		}
 
 		// Create skybox pipeline
-		/* Create render pass */
-		{
-			vk::AttachmentDescription colorAttachment;
-			colorAttachment.format = format;
-			colorAttachment.loadOp = vk::AttachmentLoadOp::eLoad;
-			colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
-			colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
-			colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-			colorAttachment.initialLayout = vk::ImageLayout::ePresentSrcKHR;
-			colorAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
-			colorAttachment.samples = vk::SampleCountFlagBits::e1;
-
-			vk::AttachmentDescription depthAttachment;
-			depthAttachment.format = vk::Format::eD32Sfloat;
-			depthAttachment.loadOp = vk::AttachmentLoadOp::eLoad;
-			depthAttachment.storeOp = vk::AttachmentStoreOp::eStore;
-			depthAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
-			depthAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-			depthAttachment.initialLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-			depthAttachment.finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-
-			vk::AttachmentReference colorAttachmentRef;
-			colorAttachmentRef.attachment = 0;
-			colorAttachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
-
-			vk::AttachmentReference depthAttachmentRef;
-			depthAttachmentRef.attachment = 1;
-			depthAttachmentRef.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-
-			auto attachments = { colorAttachment, depthAttachment };
-
-			vk::SubpassDescription subpass;
-			subpass.colorAttachmentCount = 1;
-			subpass.pColorAttachments = &colorAttachmentRef;
-			subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
-			subpass.pDepthStencilAttachment = &depthAttachmentRef;
-			
-
-			vk::RenderPassCreateInfo renderPassInfo;
-			renderPassInfo.attachmentCount = 2;
-			renderPassInfo.pAttachments = attachments.begin();
-			renderPassInfo.subpassCount = 1;
-			renderPassInfo.pSubpasses = &subpass;
-
-			skyboxPass = vulkan.device.createRenderPass(renderPassInfo);
-		}
 		{
 			PipelineFactory factory;
 			factory.shaderStages.emplace_back(vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eVertex, createShaderModule(FUtil::file_read_binary("shaders/compiled/forward/skybox.vert.spv"), vulkan.device), "main");
@@ -1073,7 +1105,8 @@ int main() {
 			skyboxPipelineLayout = vulkan.device.createPipelineLayout(layoutInfo);
 
 			factory.layout = skyboxPipelineLayout;
-			factory.renderPass = skyboxPass;
+			factory.renderPass = deferredPass;
+			factory.subpass = 1;
 
 			skyboxPipeline = factory.createPipeline(vulkan.device);
 
@@ -1081,39 +1114,19 @@ int main() {
 
 		// Create g buffer
 		{
-			vk::Format gFormat = vk::Format::eR16G16B16A16Sfloat;
-			VkUtil::createImage(vulkan, gPositionBuffer, gPositionMemory, extent, gFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal);
-			gPositionView = VkUtil::createImageView(vulkan, gPositionBuffer, gFormat, vk::ImageAspectFlagBits::eColor);
-			VkUtil::transitionImageLayout(vulkan, gPositionBuffer, gFormat, vk::ImageLayout::ePreinitialized, vk::ImageLayout::eColorAttachmentOptimal);
-
+			vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eInputAttachment;
 
-			VkUtil::createImage(vulkan, gNormalBuffer, gPositionMemory, extent, gFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal);
-			gNormalView = VkUtil::createImageView(vulkan, gNormalBuffer, gFormat, vk::ImageAspectFlagBits::eColor);
-			VkUtil::transitionImageLayout(vulkan, gNormalBuffer, gFormat, vk::ImageLayout::ePreinitialized, vk::ImageLayout::eColorAttachmentOptimal);
+			VkUtil::createTransientImage(vulkan, gNormalBuffer, gNormalMemory, extent, vk::Format::eR16G16Snorm, usage);
+			gNormalView = VkUtil::createImageView(vulkan, gNormalBuffer, vk::Format::eR16G16Snorm, vk::ImageAspectFlagBits::eColor);
 
+			VkUtil::createTransientImage(vulkan, gAlbedoBuffer, gAlbedoMemory, extent, vk::Format::eR8G8B8A8Unorm, usage);
+			gAlbedoView = VkUtil::createImageView(vulkan, gAlbedoBuffer, vk::Format::eR8G8B8A8Unorm, vk::ImageAspectFlagBits::eColor);
 		}
 
-		{
-			auto attachments = {
-				gPositionView,
-				gNormalView,
-				depthImageView
-			};
 
-			vk::FramebufferCreateInfo framebufferInfo = {};
-			framebufferInfo.renderPass = geometryPass;
-			framebufferInfo.attachmentCount = attachments.size();
-			framebufferInfo.pAttachments = attachments.begin();
-			framebufferInfo.width = extent.width;
-			framebufferInfo.height = extent.height;
-			framebufferInfo.layers = 1;
-			geometryFramebuffer = vulkan.device.createFramebuffer(framebufferInfo);
-
-		}
 
-
-		uniformBuffer.resize(sizeof(GeneralRenderUniforms));
-		lightUniformBuffer.resize(sizeof(Lights));
+		TextureUtil::SHIrradianceUniforms noIrradiance = {};
+		irradianceUniformBuffer.fill(&noIrradiance, sizeof(noIrradiance));
 
 
 
@@ -1123,14 +1136,17 @@ int main() {
 		// Create framebuffers
 		swapChainFramebuffers.resize(swapChainImageViews.size());
 		for (size_t i = 0; i < swapChainImageViews.size(); i++) {
+			// The g buffer and depth are shared, they do not outlive a frame
 			vk::ImageView attachments[] = {
 				swapChainImageViews[i],
+				gNormalView,
+				gAlbedoView,
 				depthImageView
 			};
 
 			vk::FramebufferCreateInfo framebufferInfo = {};
-			framebufferInfo.renderPass = lightingPass;
-			framebufferInfo.attachmentCount = 2;
+			framebufferInfo.renderPass = deferredPass;
+			framebufferInfo.attachmentCount = 4;
 			framebufferInfo.pAttachments = attachments;
 			framebufferInfo.width = extent.width;
 			framebufferInfo.height = extent.height;
@@ -1139,10 +1155,6 @@ int main() {
 			swapChainFramebuffers[i] = vulkan.device.createFramebuffer(framebufferInfo);
 		}
 
-		// Create vertex buffer		
-		vertexBuffer.fill(tableMesh.vertices.data(), tableMesh.vertices.size() * sizeof(Vertex));
-		indexBuffer.fill(tableMesh.indices.data(), tableMesh.indices.size() * sizeof(uint32));
-
 		// Load texture
 		{
 
@@ -1160,11 +1172,9 @@ int main() {
 			samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
 			samplerInfo.mipLodBias = 0.0f;
 			samplerInfo.minLod = 0.0f;
-			samplerInfo.maxLod = 0.0f;
+			samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 			//
 			textureImageSampler = vulkan.device.createSampler(samplerInfo);
-
-			gBufferSampler = vulkan.device.createSampler({});
 		}
 
 
@@ -1188,35 +1198,66 @@ int main() {
 			{
 				// MVP Buffer
 				vk::DescriptorBufferInfo bufferInfo = {};
-				bufferInfo.buffer = uniformBuffer.buffer;
+				bufferInfo.buffer = uniformRing.buffer;
 				bufferInfo.offset = 0;
 				bufferInfo.range = sizeof(GeneralRenderUniforms);
 
-				descriptorWrites.push_back(vk::WriteDescriptorSet(mvpBufferSet, 0, 0, 1, vk::DescriptorType::eUniformBuffer, nullptr, &bufferInfo));
+				descriptorWrites.push_back(vk::WriteDescriptorSet(mvpBufferSet, 0, 0, 1, vk::DescriptorType::eUniformBufferDynamic, nullptr, &bufferInfo));
 			}
 			{
 				// Light buffer
 				vk::DescriptorBufferInfo bufferInfo = { };
-				bufferInfo.buffer = lightUniformBuffer.buffer;
+				bufferInfo.buffer = uniformRing.buffer;
 				bufferInfo.offset = 0;
 				bufferInfo.range = sizeof(Lights);
 
-				descriptorWrites.push_back(vk::WriteDescriptorSet(lightBufferSet, 0, 0, 1, vk::DescriptorType::eUniformBuffer, nullptr, &bufferInfo));
+				descriptorWrites.push_back(vk::WriteDescriptorSet(lightBufferSet, 0, 0, 1, vk::DescriptorType::eUniformBufferDynamic, nullptr, &bufferInfo));
+			}
+			{
+				// Irradiance buffer
+				vk::DescriptorBufferInfo bufferInfo = { };
+				bufferInfo.buffer = irradianceUniformBuffer.buffer;
+				bufferInfo.offset = 0;
+				bufferInfo.range = sizeof(TextureUtil::SHIrradianceUniforms);
+
+				vk::WriteDescriptorSet descWrite(lightBufferSet, 1, 0, 1, vk::DescriptorType::eUniformBuffer, nullptr, &bufferInfo);
+				vulkan.device.updateDescriptorSets(1, &descWrite, 0, nullptr);
+			}
+			{
+				// Stand-ins for the specular lighting of the environment, which is scaled to nothing until it is resident
+				vk::DescriptorImageInfo specularInfo = {};
+				specularInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+				specularInfo.imageView = environmentCubemap.view;
+				specularInfo.sampler = environmentCubemap.sampler;
+
+				vk::DescriptorImageInfo brdfLutInfo = {};
+				brdfLutInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+				brdfLutInfo.imageView = placeholderTexture->view;
+				brdfLutInfo.sampler = placeholderTexture->sampler;
+
+				std::array<vk::WriteDescriptorSet, 2> descWrites = {
+					vk::WriteDescriptorSet(lightBufferSet, 2, 0, 1, vk::DescriptorType::eCombinedImageSampler, &specularInfo, nullptr),
+					vk::WriteDescriptorSet(lightBufferSet, 3, 0, 1, vk::DescriptorType::eCombinedImageSampler, &brdfLutInfo, nullptr)
+				};
+				vulkan.device.updateDescriptorSets((uint32)descWrites.size(), descWrites.data(), 0, nullptr);
 			}
 			{
-				// GBuffer
-				vk::DescriptorImageInfo posInfo = {};
-				posInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-				posInfo.imageView = gPositionView;
-				posInfo.sampler = gBufferSampler;
+				// GBuffer, read as input attachments of the lighting subpass
+				vk::DescriptorImageInfo depthInfo = {};
+				depthInfo.imageLayout = vk::ImageLayout::eDepthStencilReadOnlyOptimal;
+				depthInfo.imageView = depthImageView;
 
 				vk::DescriptorImageInfo normInfo = {};
 				normInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
 				normInfo.imageView = gNormalView;
-				normInfo.sampler = gBufferSampler;
 
-				descriptorWrites.push_back(vk::WriteDescriptorSet(gBufferSet, 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &posInfo, nullptr));
-				descriptorWrites.push_back(vk::WriteDescriptorSet(gBufferSet, 1, 0, 1, vk::DescriptorType::eCombinedImageSampler, &normInfo, nullptr));
+				vk::DescriptorImageInfo albedoInfo = {};
+				albedoInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+				albedoInfo.imageView = gAlbedoView;
+
+				descriptorWrites.push_back(vk::WriteDescriptorSet(gBufferSet, 0, 0, 1, vk::DescriptorType::eInputAttachment, &depthInfo, nullptr));
+				descriptorWrites.push_back(vk::WriteDescriptorSet(gBufferSet, 1, 0, 1, vk::DescriptorType::eInputAttachment, &normInfo, nullptr));
+				descriptorWrites.push_back(vk::WriteDescriptorSet(gBufferSet, 2, 0, 1, vk::DescriptorType::eInputAttachment, &albedoInfo, nullptr));
 			}
 
 			{
@@ -1224,7 +1265,7 @@ int main() {
 				vk::DescriptorImageInfo envMapInfo;
 				envMapInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
 				envMapInfo.imageView = environmentCubemap.view;
-				envMapInfo.sampler = plainSampler;
+				envMapInfo.sampler = environmentCubemap.sampler;
 
 				descriptorWrites.push_back(vk::WriteDescriptorSet(skyboxSet, 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &envMapInfo, nullptr));
 			}
@@ -1234,106 +1275,74 @@ int main() {
 
 		// Create command buffers
 		{
-			commandBuffers.resize(swapChainFramebuffers.size());
 			vk::CommandBufferAllocateInfo allocInfo = {};
 			allocInfo.commandPool = commandPool;
 			allocInfo.level = vk::CommandBufferLevel::ePrimary;
-			allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
-
-			commandBuffers = vulkan.device.allocateCommandBuffers(allocInfo);
-		}
-
-		{
-			vk::CommandBufferAllocateInfo allocInfo = {};
-			allocInfo.commandPool = commandPool;
-			allocInfo.level = vk::CommandBufferLevel::ePrimary;
-			allocInfo.commandBufferCount = 1;
-
-			geometryPassCommandBuffer = vulkan.device.allocateCommandBuffers(allocInfo)[0];
+			allocInfo.commandBufferCount = FRAMES_IN_FLIGHT;
 
+			auto commandBuffers = vulkan.device.allocateCommandBuffers(allocInfo);
+			for (uint32 i = 0; i < FRAMES_IN_FLIGHT; i++) frames[i].commandBuffer = commandBuffers[i];
 		}
 
 
 		// record commands
 
-			 // Geometry pass
-		{
-			auto& commandBuffer = geometryPassCommandBuffer;
+		// The frame binds the uniforms of the current frame and is recorded again every frame
+		recordFrame = [&](vk::CommandBuffer commandBuffer, uint32 i, uint32 lod) {
+			// The unit cube stands in for the table until it is resident
+			auto& mesh = tableMesh->resident() ? *tableMesh : *unitCube;
 
-			vk::CommandBufferBeginInfo beginInfo(vk::CommandBufferUsageFlagBits::eSimultaneousUse);
+			vk::CommandBufferBeginInfo beginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
 			commandBuffer.begin(beginInfo);
 
-			std::array<vk::ClearValue, 3> clearColors = {};
-			clearColors[0].color = vk::ClearColorValue(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 0.0f });
+			std::array<vk::ClearValue, 4> clearColors = {};
+			clearColors[0].color = vk::ClearColorValue(std::array<float, 4>{ 0.15f, 0.05f, 0.05f, 1.f });
 			clearColors[1].color = vk::ClearColorValue(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 0.0f });
-			clearColors[2].depthStencil = { 1.0, 0 };
+			clearColors[2].color = vk::ClearColorValue(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 0.0f });
+			clearColors[3].depthStencil = { 1.0, 0 };
 
-			vk::RenderPassBeginInfo renderPassInfo(geometryPass, geometryFramebuffer, vk::Rect2D({ 0, 0, }, extent), 3, clearColors.data());
+			vk::RenderPassBeginInfo renderPassInfo(deferredPass, swapChainFramebuffers[i], vk::Rect2D({ 0, 0, }, extent), clearColors.size(), clearColors.data());
 			commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
-			commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, geometryPipeline);
-			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, geometryPipelineLayout, 0, 1, &mvpBufferSet, 0, nullptr);
-
-			vk::DeviceSize offsets[] = { 0 };
-
-			commandBuffer.bindVertexBuffers(0, 1, &vertexBuffer.buffer, offsets);
-			commandBuffer.bindIndexBuffer(indexBuffer.buffer, 0, vk::IndexType::eUint32);
-			commandBuffer.drawIndexed(tableMesh.indices.size(), 1, 0, 0, 0);
-			commandBuffer.endRenderPass();
-			commandBuffer.end();
-		}
 
-		// Main render pass
-		for (size_t i = 0; i < commandBuffers.size(); i++) {
-			auto& commandBuffer = commandBuffers[i];
+			// Geometry subpass
+			commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, mesh.mesh.vertexFormat == VertexFormat::Packed ? geometryPackedPipeline : geometryPipeline);
+			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, geometryPipelineLayout, 0, 1, &mvpBufferSet, 1, &generalUniformOffset);
 
-			vk::CommandBufferBeginInfo beginInfo(vk::CommandBufferUsageFlagBits::eSimultaneousUse, nullptr);
-			commandBuffer.begin(beginInfo);
-
-			vk::RenderPassBeginInfo renderPassInfo = {};
-			renderPassInfo.renderPass = lightingPass;
-			renderPassInfo.framebuffer = swapChainFramebuffers[i];
-			renderPassInfo.renderArea.offset = { 0, 0 };
-			renderPassInfo.renderArea.extent = extent;
-
-			std::array<vk::ClearValue, 1> clearColors = {};
-			clearColors[0].color = vk::ClearColorValue(std::array<float, 4>{ 0.15f, 0.05f, 0.05f, 1.f });
+			PackedBounds packedBounds = MeshUtil::packed_bounds(mesh.mesh.bounds);
+			commandBuffer.pushConstants(geometryPipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(PackedBounds), &packedBounds);
 
-			renderPassInfo.clearValueCount = 1;
-			renderPassInfo.pClearValues = clearColors.data();
+			geometry.bind(commandBuffer, mesh.mesh.indexType());
+			commandBuffer.drawIndexed(mesh.mesh.lods[lod].indexCount, 1, mesh.geometry.firstIndex + mesh.mesh.lods[lod].firstIndex, (int32)mesh.geometry.firstVertex, 0);
 
-			commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+			// Lighting subpass
+			commandBuffer.nextSubpass(vk::SubpassContents::eInline);
 			commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, lightingPipeline);
 			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, lightingPipelineLayout, 0, 1, &gBufferSet, 0, nullptr);
-			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, lightingPipelineLayout, 1, 1, &lightBufferSet, 0, nullptr);
-
-			vk::DeviceSize offsets[] = { 0 };
+			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, lightingPipelineLayout, 1, 1, &lightBufferSet, 1, &lightUniformOffset);
+			commandBuffer.pushConstants(lightingPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(LightingConstants), &lightingConstants);
 
-			commandBuffer.bindVertexBuffers(0, 1, &screenQuadBuffer.buffer, offsets);
-			commandBuffer.bindIndexBuffer(indexBuffer.buffer, 0, vk::IndexType::eUint32);
-			commandBuffer.draw(4, 1, 0, 0);
-			commandBuffer.endRenderPass();
+			// The screen quad and the skybox cube draw from the same buffers
+			geometry.bind(commandBuffer, unitCube->mesh.indexType());
+			commandBuffer.draw(screenQuad.vertexCount, 1, screenQuad.firstVertex, 0);
 
-
-			vk::RenderPassBeginInfo fwdPass;
-			fwdPass.renderPass = skyboxPass;
-			fwdPass.framebuffer = swapChainFramebuffers[i];
-			fwdPass.renderArea = renderPassInfo.renderArea;
-			
-			commandBuffer.beginRenderPass(fwdPass, vk::SubpassContents::eInline);
 			commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, skyboxPipeline);
-			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, skyboxPipelineLayout, 0, 1, &mvpBufferSet, 0, nullptr);
+			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, skyboxPipelineLayout, 0, 1, &mvpBufferSet, 1, &generalUniformOffset);
 			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, skyboxPipelineLayout, 1, 1, &skyboxSet, 0, nullptr);
-			commandBuffer.bindVertexBuffers(0, 1, &unitCubeVertexBuffer.buffer, offsets);
-			commandBuffer.bindIndexBuffer(unitCubeIndexBuffer.buffer, 0, vk::IndexType::eUint32);
-			commandBuffer.drawIndexed(unitCube.indices.size(), 1, 0, 0, 0);
+			commandBuffer.drawIndexed(unitCube->mesh.indexCount, 1, unitCube->geometry.firstIndex, (int32)unitCube->geometry.firstVertex, 0);
 			commandBuffer.endRenderPass();
 			commandBuffer.end();
+		};
+
+		// Create semaphores and fences, the fences signalled as no frame was submitted yet
+		for (auto& frame : frames) {
+			vk::SemaphoreCreateInfo semaphoreInfo = {};
+			frame.imageAvailable = vulkan.device.createSemaphore(semaphoreInfo);
+			frame.renderFinished = vulkan.device.createSemaphore(semaphoreInfo);
+			frame.fence = vulkan.device.createFence(vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled));
 		}
 
-		// Create semaphores
-		vk::SemaphoreCreateInfo semaphoreInfo = {};
-		imageAvailableSemaphore = vulkan.device.createSemaphore(semaphoreInfo);
-		renderFinishedSemaphore = vulkan.device.createSemaphore(semaphoreInfo);
+		// The first frame is recorded right after this, the gpu can work through the uploads meanwhile
+		setupUploads.submit();
 
 	}	
 	catch (std::runtime_error& error) {
@@ -1351,6 +1360,10 @@ int main() {
 
 	ubo.projection = camera.projection;
 	ubo.projection[1][1] *= -1;
+
+	setupUploads.wait();
+	std::cout << "Setup uploads: " << setupUploads.commandCount() << " commands in one submission, waited " << setupUploads.waitSeconds() * 1000 << "ms\n";
+
 	while (window.isOpen()) {
 		glfwPollEvents();		
 
@@ -1415,6 +1428,90 @@ int main() {
 		//}
 
 
+		// Swap out placeholders for assets that finished loading
+		if (assets.update() > 0) {
+			if (tableMesh->resident() && !tableBound) {
+				tableBound = true;
+				logMeshLoad(tableMesh->path.string(), tableMesh->mesh);
+			}
+
+			if (environmentTexture->resident() && !environmentBound) {
+				environmentBound = true;
+				logTextureLoad(environmentTexture->path.string(), environmentTexture->texture);
+
+				// The bake submitted during setup may still be running, its command buffer and descriptor set are reused
+				vulkan.device.waitForFences(1, &cubemapFence, true, std::numeric_limits<uint64_t>::max());
+
+				vk::DescriptorImageInfo imageInfo;
+				imageInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+				imageInfo.imageView = environmentTexture->view;
+				imageInfo.sampler = environmentTexture->sampler;
+
+				vk::WriteDescriptorSet descWrite(cubemapSourceSet, 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfo, nullptr);
+				vulkan.device.updateDescriptorSets(1, &descWrite, 0, nullptr);
+
+				recordCubemapBake(environmentTexture->extent.width);
+				vulkan.device.resetFences(1, &cubemapFence);
+
+				vk::SubmitInfo submitInfo;
+				submitInfo.commandBufferCount = 1;
+				submitInfo.pCommandBuffers = &cubemapCommandBuffer;
+				vulkan.graphicsQueue.submit(1, &submitInfo, cubemapFence);
+				cubemapBakePending = true;
+
+				environmentLighting = assets.loadEnvironment(environmentTexture->path, environmentBakeOptions);
+			}
+
+			if (environmentLighting && environmentLighting->resident() && !environmentLightingBound) {
+				environmentLightingBound = true;
+				logEnvironmentLoad(environmentLighting->path.string(), environmentLighting->environment, environmentBakeOptions);
+
+				// The descriptors and the irradiance may still be in use by frames in flight, every one of them was submitted with its fence
+				std::array<vk::Fence, FRAMES_IN_FLIGHT> frameFences;
+				for (uint32 i = 0; i < FRAMES_IN_FLIGHT; i++) frameFences[i] = frames[i].fence;
+				vulkan.device.waitForFences((uint32)frameFences.size(), frameFences.data(), true, std::numeric_limits<uint64_t>::max());
+
+				vk::DescriptorImageInfo specularInfo = {};
+				specularInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+				specularInfo.imageView = environmentLighting->specularView;
+				specularInfo.sampler = environmentLighting->specularSampler;
+
+				vk::DescriptorImageInfo brdfLutInfo = {};
+				brdfLutInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+				brdfLutInfo.imageView = environmentLighting->brdfLutView;
+				brdfLutInfo.sampler = environmentLighting->brdfLutSampler;
+
+				std::array<vk::WriteDescriptorSet, 2> descWrites = {
+					vk::WriteDescriptorSet(lightBufferSet, 2, 0, 1, vk::DescriptorType::eCombinedImageSampler, &specularInfo, nullptr),
+					vk::WriteDescriptorSet(lightBufferSet, 3, 0, 1, vk::DescriptorType::eCombinedImageSampler, &brdfLutInfo, nullptr)
+				};
+				vulkan.device.updateDescriptorSets((uint32)descWrites.size(), descWrites.data(), 0, nullptr);
+				lightingConstants.specularIntensity = 1.0f;
+
+				irradianceUniformBuffer.fill(&environmentLighting->irradiance, sizeof(environmentLighting->irradiance));
+
+				// Everything the scene loads is resident by now
+				logMemoryStatistics(*vulkan.allocator);
+			}
+		}
+
+		// Report the gpu time of the environment bake once it finished
+		if (cubemapBakePending && vulkan.device.getFenceStatus(cubemapFence) == vk::Result::eSuccess) {
+			cubemapBakePending = false;
+
+			uint64 timestamps[2] = {};
+			vulkan.device.getQueryPoolResults(cubemapTimestamps, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64), vk::QueryResultFlagBits::e64);
+			double milliseconds = (timestamps[1] - timestamps[0]) * (double)vulkan.physicalDevice.getProperties().limits.timestampPeriod / 1e6;
+
+			std::cout << "Baked environment cubemap, " << environmentCubemap.faceSize << "x" << environmentCubemap.faceSize << " faces with " << environmentCubemap.levelCount << " levels, in " << milliseconds << "ms on the gpu\n";
+		}
+
+		// The command buffers of this frame were submitted FRAMES_IN_FLIGHT frames ago and may still be executing
+		Frame& frame = frames[frameIndex];
+		vulkan.device.waitForFences(1, &frame.fence, true, std::numeric_limits<uint64_t>::max());
+		vulkan.device.resetFences(1, &frame.fence);
+		uniformRing.frameCompleted(frameIndex);
+
 		// Update uniforms
 		{
 			static auto startTime = std::chrono::high_resolution_clock().now();
@@ -1430,9 +1527,14 @@ int main() {
 			ubo.projection = camera.projection;
 			ubo.projection[1][1] *= -1;
 
-			uniformBuffer.fill(&ubo, sizeof(ubo));
+			generalUniformOffset = uniformRing.push(ubo);
+			lightUniformOffset = uniformRing.push(lights);
+			lightingConstants.inverseViewProjection = glm::inverse(ubo.projection * ubo.view);
+			lightingConstants.cameraPosition = camera.transform.position;
 
-			lightUniformBuffer.fill(&lights, sizeof(Lights));
+			if (tableBound) {
+				tableLod = MeshUtil::select_lod(tableMesh->mesh.lods, tableMesh->mesh.lodCount, tableMesh->mesh.bounds, ubo.model, camera, (float)extent.height);
+			}
 
 			// 10 seconds passed
 			if (time > 10) {
@@ -1443,45 +1545,41 @@ int main() {
 		}
 
 
-		// Geometry pass
-		{
-			vk::SubmitInfo submitInfo = {};
-			submitInfo.commandBufferCount = 1;
-			submitInfo.pCommandBuffers = &geometryPassCommandBuffer;
-			vulkan.graphicsQueue.submit(1, &submitInfo, nullptr);
-		}
-		vulkan.graphicsQueue.waitIdle();
-		uint32_t imageIndex = vulkan.device.acquireNextImageKHR(swapChain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphore, nullptr).value;
+		// The framebuffer is chosen by the swap chain image, so the frame is recorded once it is known
+		uint32_t imageIndex = vulkan.device.acquireNextImageKHR(swapChain, std::numeric_limits<uint64_t>::max(), frame.imageAvailable, nullptr).value;
 
 
-		// Lighting pass  
+		// Deferred pass
 		{
-			
+			recordFrame(frame.commandBuffer, imageIndex, tableLod);
+
 			vk::SubmitInfo submitInfo = {};
 			submitInfo.commandBufferCount = 1;
-			submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+			submitInfo.pCommandBuffers = &frame.commandBuffer;
 
 			// Wait for image to be acquired and signal when render is finished
 			vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
 			submitInfo.waitSemaphoreCount = 1;
-			submitInfo.pWaitSemaphores = &imageAvailableSemaphore;
+			submitInfo.pWaitSemaphores = &frame.imageAvailable;
 			submitInfo.pWaitDstStageMask = waitStages;			
 			submitInfo.signalSemaphoreCount = 1;
-			submitInfo.pSignalSemaphores = &renderFinishedSemaphore;
+			submitInfo.pSignalSemaphores = &frame.renderFinished;
 
-			vulkan.graphicsQueue.submit(1, &submitInfo, nullptr);			
+			vulkan.graphicsQueue.submit(1, &submitInfo, frame.fence);
+			uniformRing.endFrame(frameIndex);
 		}
 
 		// Wait with presenting till rendering has finished
 		vk::PresentInfoKHR presentInfo = {};
 		presentInfo.waitSemaphoreCount = 1;
-		presentInfo.pWaitSemaphores = &renderFinishedSemaphore;
+		presentInfo.pWaitSemaphores = &frame.renderFinished;
 
 		presentInfo.swapchainCount = 1;
 		presentInfo.pSwapchains = &swapChain;
 		presentInfo.pImageIndices = &imageIndex;
 
 		vulkan.presentQueue.presentKHR(presentInfo);
+		frameIndex = (frameIndex + 1) % FRAMES_IN_FLIGHT;
 
 		// Required to prevent Lunar SDK Validation Layers from leaking about 1mb/s of memory...
 		if (enableValidationLayers) {
@@ -0,0 +1,29 @@
+#pragma once
+#include <cmath>
+#include <iostream>
+
+/*
+	Minimal checks for the headless tests. Every test is its own console program built from the sources it names,
+	a failed check is reported with its location and makes the program exit with a non zero code.
+*/
+
+namespace Check {
+	inline int& failures() {
+		static int count = 0;
+		return count;
+	}
+
+	inline void fail(const char* expression, const char* file, int line) {
+		std::cerr << file << ":" << line << ": check failed: " << expression << "\n";
+		failures()++;
+	}
+
+	inline int result() {
+		if (failures() == 0) std::cout << "All checks passed\n";
+		else std::cerr << failures() << " checks failed\n";
+		return failures() == 0 ? 0 : 1;
+	}
+}
+
+#define CHECK(expression) ((expression) ? (void)0 : Check::fail(#expression, __FILE__, __LINE__))
+#define CHECK_NEAR(a, b, tolerance) CHECK(std::abs((double)(a) - (double)(b)) <= (tolerance))
\ No newline at end of file
@@ -0,0 +1,178 @@
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "Check.h"
+#include <Core/Render/MeshSimplification.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <map>
+#include <set>
+#include <tuple>
+
+/*
+	Simplifies synthetic grids and picks levels of detail for them.
+	Built from Core/Render/MeshSimplification.cpp, Core/Render/Camera.cpp and Core/Util/FileUtil.cpp.
+*/
+
+namespace {
+	// Grid of `size` x `size` quads over [0, 1]^2 with z = height(x, y). With `charts` the grid is split into four texture
+	// charts at x = 0.5 and y = 0.5, so the vertices along those lines are duplicated with different texture coordinates
+	Mesh grid(uint32 size, bool charts, float (*height)(float, float)) {
+		Mesh mesh;
+		std::map<std::tuple<uint32, uint32, uint32>, uint32> vertexIds;
+
+		auto vertex = [&](uint32 x, uint32 y, uint32 chart) {
+			if (!charts) chart = 0;
+			auto key = std::make_tuple(x, y, chart);
+			auto found = vertexIds.find(key);
+			if (found != vertexIds.end()) return found->second;
+
+			float u = (float)x / size, v = (float)y / size;
+			glm::vec2 texCoord = glm::vec2(u, v) + glm::vec2((float)(chart & 1), (float)(chart >> 1)) * 2.0f;
+			mesh.vertices.push_back({ glm::vec3(u, v, height(u, v)), glm::vec3(0, 0, 1), texCoord });
+			return vertexIds[key] = (uint32)mesh.vertices.size() - 1;
+		};
+
+		for (uint32 y = 0; y < size; y++) {
+			for (uint32 x = 0; x < size; x++) {
+				uint32 chart = (x >= size / 2 ? 1 : 0) + (y >= size / 2 ? 2 : 0);
+				uint32 corners[4] = { vertex(x, y, chart), vertex(x + 1, y, chart), vertex(x + 1, y + 1, chart), vertex(x, y + 1, chart) };
+				mesh.indices.insert(mesh.indices.end(), { corners[0], corners[1], corners[2], corners[0], corners[2], corners[3] });
+			}
+		}
+		return mesh;
+	}
+
+	float flat(float, float) { return 0.0f; }
+	float hills(float x, float y) { return 0.05f * std::sin(x * 6.0f) * std::cos(y * 5.0f); }
+
+	// Chart a vertex belongs to, from the offset of its texture coordinates
+	uint32 chart_of(const Vertex& vertex) {
+		return (vertex.texCoord.x >= 1.5f ? 1 : 0) + (vertex.texCoord.y >= 1.5f ? 2 : 0);
+	}
+
+	void check_chain(const Mesh& mesh, const std::vector<MeshUtil::MeshLod>& lods, const MeshUtil::LodChainOptions& options) {
+		CHECK(lods.size() == options.maxLods);
+		CHECK(lods[0].firstIndex == 0 && lods[0].error == 0.0f);
+
+		for (uint32 level = 1; level < lods.size(); level++) {
+			// Every level reaches the index count it was asked for, and its error grows along the chain
+			uint32 target = (uint32)(lods[level - 1].indexCount * options.reduction) / 3 * 3;
+			CHECK(lods[level].indexCount > 0 && lods[level].indexCount <= target);
+			CHECK(lods[level].error >= lods[level - 1].error);
+			CHECK(lods[level].firstIndex == lods[level - 1].firstIndex + lods[level - 1].indexCount);
+		}
+		CHECK(lods.back().firstIndex + lods.back().indexCount == mesh.indices.size());
+	}
+
+	void smooth_surface() {
+		Mesh mesh = grid(64, false, hills);
+		MeshUtil::LodChainOptions options;
+		options.maxLods = 5;
+		options.maxRelativeError = 0.2f;
+
+		auto lods = MeshUtil::build_lod_chain(mesh, options);
+		check_chain(mesh, lods, options);
+		CHECK(lods.back().error > 0.0f);
+
+		float maxError = options.maxRelativeError * glm::length(glm::vec3(1, 1, 0.1f)) * 0.5f;
+		CHECK(lods.back().error <= maxError);
+	}
+
+	void seams() {
+		// Seams used to lock every vertex on them, a grid cut into charts simplifies just as far as one without
+		Mesh mesh = grid(64, true, flat);
+		MeshUtil::LodChainOptions options;
+		options.maxLods = 5;
+
+		auto lods = MeshUtil::build_lod_chain(mesh, options);
+		check_chain(mesh, lods, options);
+
+		auto seamVertices = [&](const MeshUtil::MeshLod& lod) {
+			std::set<uint32> found;
+			for (uint32 i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i++) {
+				if (mesh.vertices[mesh.indices[i]].position.x == 0.5f) found.insert(mesh.indices[i]);
+			}
+			return found.size();
+		};
+		CHECK(seamVertices(lods.back()) < seamVertices(lods[0]) / 2);
+
+		for (auto& lod : lods) {
+			float chartAreas[4] = {};
+			bool mixedCharts = false, flipped = false;
+
+			for (uint32 i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i += 3) {
+				const Vertex& a = mesh.vertices[mesh.indices[i]];
+				const Vertex& b = mesh.vertices[mesh.indices[i + 1]];
+				const Vertex& c = mesh.vertices[mesh.indices[i + 2]];
+
+				// Triangles never take vertices from the other side of a seam
+				mixedCharts |= chart_of(a) != chart_of(b) || chart_of(a) != chart_of(c);
+
+				float area = glm::cross(b.position - a.position, c.position - a.position).z * 0.5f;
+				flipped |= area <= 0.0f;
+				chartAreas[chart_of(a)] += area;
+			}
+
+			// Seams and borders only move along themselves, so each chart still covers exactly its quarter
+			CHECK(!mixedCharts);
+			CHECK(!flipped);
+			for (float area : chartAreas) CHECK_NEAR(area, 0.25, 1e-4);
+			CHECK(lod.error < 1e-5f);
+		}
+	}
+
+	void locked_corners() {
+		// Every corner of a box is where three seams meet, there is nothing to simplify without changing its shape
+		Mesh mesh;
+		const glm::vec3 normals[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+		for (auto& normal : normals) {
+			glm::vec3 u(normal.y, normal.z, normal.x), v = glm::cross(normal, u);
+			uint32 first = (uint32)mesh.vertices.size();
+			for (uint32 i = 0; i < 4; i++) {
+				glm::vec3 position = normal + u * (i & 1 ? 1.0f : -1.0f) + v * (i & 2 ? 1.0f : -1.0f);
+				mesh.vertices.push_back({ position, normal, glm::vec2(0) });
+			}
+			mesh.indices.insert(mesh.indices.end(), { first, first + 1, first + 3, first, first + 3, first + 2 });
+		}
+
+		auto lods = MeshUtil::build_lod_chain(mesh);
+		CHECK(lods.size() == 1);
+	}
+
+	void lod_selection() {
+		const MeshUtil::MeshLod lods[] = { { 0, 600, 0.0f }, { 600, 300, 0.001f }, { 900, 150, 0.01f }, { 1050, 75, 0.1f } };
+		BoundingBox bounds = { glm::vec3(-1), glm::vec3(1) };
+		const float viewportHeight = 1000.0f;
+
+		Camera camera(Transform(glm::vec3(0)), glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 1000.0f));
+		float pixelsPerUnit = std::abs(camera.projection[1][1]) * viewportHeight * 0.5f;
+
+		uint32 previous = 0;
+		for (float distance = 2.0f; distance < 2000.0f; distance *= 1.25f) {
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, -distance));
+			uint32 lod = MeshUtil::select_lod(lods, 4, bounds, model, camera, viewportHeight);
+
+			// Coarser with distance, and the chosen level stays below a pixel at the closest point of the bounds
+			CHECK(lod >= previous);
+			float closest = distance - std::sqrt(3.0f);
+			CHECK(lods[lod].error / closest * pixelsPerUnit <= 1.0f + 1e-4f);
+			if (lod + 1 < 4) CHECK(lods[lod + 1].error / closest * pixelsPerUnit > 1.0f - 1e-4f);
+			previous = lod;
+		}
+		CHECK(previous == 3);
+
+		// Inside the bounds only the full mesh will do, scaling the model scales its error
+		CHECK(MeshUtil::select_lod(lods, 4, bounds, glm::mat4(1.0f), camera, viewportHeight) == 0);
+		glm::mat4 far = glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, -100));
+		CHECK(MeshUtil::select_lod(lods, 4, bounds, glm::scale(far, glm::vec3(10)), camera, viewportHeight) < MeshUtil::select_lod(lods, 4, bounds, far, camera, viewportHeight));
+		CHECK(MeshUtil::select_lod(lods, 0, bounds, far, camera, viewportHeight) == 0);
+	}
+}
+
+int main() {
+	smooth_surface();
+	seams();
+	locked_corners();
+	lod_selection();
+	return Check::result();
+}
\ No newline at end of file
@@ -0,0 +1,185 @@
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "Check.h"
+#include <Core/Render/Meshlets.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <set>
+
+/*
+	Builds and culls meshlets of synthetic meshes. Built from Core/Render/Meshlets.cpp and Core/Render/Camera.cpp.
+*/
+
+namespace {
+	bool throws(std::function<void()> call) {
+		try {
+			call();
+		}
+		catch (const std::runtime_error&) {
+			return true;
+		}
+		return false;
+	}
+
+	// Grid of `size` x `size` quads in the xy plane from -extent to extent, facing +z
+	Mesh grid(uint32 size, float extent) {
+		Mesh mesh;
+		for (uint32 y = 0; y <= size; y++) {
+			for (uint32 x = 0; x <= size; x++) {
+				glm::vec3 position(((float)x / size * 2.0f - 1.0f) * extent, ((float)y / size * 2.0f - 1.0f) * extent, 0.0f);
+				mesh.vertices.push_back({ position, glm::vec3(0, 0, 1), glm::vec2((float)x / size, (float)y / size) });
+			}
+		}
+
+		// Quads are emitted in tiles of 7 x 7, which fill a meshlet of 64 vertices, like an optimized index order would
+		const uint32 TILE = 7;
+		for (uint32 tileY = 0; tileY < size; tileY += TILE) {
+			for (uint32 tileX = 0; tileX < size; tileX += TILE) {
+				for (uint32 y = tileY; y < std::min(tileY + TILE, size); y++) {
+					for (uint32 x = tileX; x < std::min(tileX + TILE, size); x++) {
+						uint32 corner = y * (size + 1) + x;
+						mesh.indices.insert(mesh.indices.end(), { corner, corner + 1, corner + size + 2, corner, corner + size + 2, corner + size + 1 });
+					}
+				}
+			}
+		}
+		return mesh;
+	}
+
+	// Closed cube around the origin with outward facing triangles
+	Mesh cube() {
+		Mesh mesh;
+		for (uint32 i = 0; i < 8; i++) {
+			glm::vec3 position(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+			mesh.vertices.push_back({ position, glm::normalize(position), glm::vec2(0) });
+		}
+		mesh.indices = {
+			0, 4, 6, 0, 6, 2,	1, 3, 7, 1, 7, 5,	// -x, +x
+			0, 1, 5, 0, 5, 4,	2, 6, 7, 2, 7, 3,	// -y, +y
+			0, 2, 3, 0, 3, 1,	4, 5, 7, 4, 7, 6	// -z, +z
+		};
+		return mesh;
+	}
+
+	void cluster_limits() {
+		Mesh mesh = grid(40, 10.0f);
+
+		struct Limits { uint32 vertices, triangles; };
+		const Limits limits[] = { { MeshUtil::MAX_MESHLET_VERTICES, MeshUtil::MAX_MESHLET_TRIANGLES }, { 16, 8 }, { 3, 1 }, { 256, 512 } };
+
+		for (auto& limit : limits) {
+			auto meshlets = MeshUtil::build_meshlets(mesh, limit.vertices, limit.triangles);
+			CHECK(!meshlets.empty());
+
+			// Meshlets are consecutive runs covering the whole index buffer
+			uint32 nextIndex = 0;
+			for (auto& meshlet : meshlets) {
+				CHECK(meshlet.firstIndex == nextIndex);
+				CHECK(meshlet.triangleCount >= 1 && meshlet.triangleCount <= limit.triangles);
+				CHECK(meshlet.vertexCount <= limit.vertices);
+
+				std::set<uint32> unique(mesh.indices.begin() + meshlet.firstIndex, mesh.indices.begin() + meshlet.firstIndex + meshlet.triangleCount * 3);
+				CHECK(unique.size() == meshlet.vertexCount);
+
+				nextIndex += meshlet.triangleCount * 3;
+			}
+			CHECK(nextIndex == mesh.indices.size());
+		}
+
+		CHECK(throws([&]() { MeshUtil::build_meshlets(mesh, 2, 10); }));
+		CHECK(throws([&]() { MeshUtil::build_meshlets(mesh, 64, 0); }));
+
+		mesh.indices.back() = (uint32)mesh.vertices.size();
+		CHECK(throws([&]() { MeshUtil::build_meshlets(mesh); }));
+	}
+
+	void bounding_spheres() {
+		Mesh mesh = grid(40, 10.0f);
+		for (auto& vertex : mesh.vertices) vertex.position.z = std::sin(vertex.position.x) * std::cos(vertex.position.y);
+
+		for (auto& meshlet : MeshUtil::build_meshlets(mesh)) {
+			glm::vec3 boundsMin(1e9f), boundsMax(-1e9f);
+			bool contained = true;
+
+			for (uint32 i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.triangleCount * 3; i++) {
+				glm::vec3 position = mesh.vertices[mesh.indices[i]].position;
+				contained &= glm::distance(position, meshlet.center) <= meshlet.radius * (1.0f + 1e-5f);
+				boundsMin = glm::min(boundsMin, position);
+				boundsMax = glm::max(boundsMax, position);
+			}
+
+			CHECK(contained);
+			// Never looser than the sphere around the bounding box of the points
+			CHECK(meshlet.radius <= glm::distance(boundsMin, boundsMax) * 0.5f * (1.0f + 1e-5f));
+		}
+	}
+
+	void cone_culling() {
+		// Every triangle of the grid faces +z, so the cone is as narrow as it gets
+		auto meshlets = MeshUtil::build_meshlets(grid(40, 10.0f));
+		for (auto& meshlet : meshlets) {
+			CHECK_NEAR(meshlet.coneAxis.z, 1.0, 1e-5);
+			CHECK_NEAR(meshlet.coneCutoff, 0.0, 1e-3);
+		}
+
+		MeshUtil::Frustum everything;
+		for (auto& plane : everything.planes) plane = glm::vec4(0, 0, 0, 1);
+
+		CHECK(MeshUtil::cull_meshlets(meshlets, everything, glm::vec3(0, 0, 20)).size() == meshlets.size());
+		CHECK(MeshUtil::cull_meshlets(meshlets, everything, glm::vec3(0, 0, -20)).empty());
+
+		// A meshlet around a closed mesh has normals in every direction and is never culled by its cone
+		auto closed = MeshUtil::build_meshlets(cube());
+		CHECK(closed.size() == 1);
+		CHECK(closed[0].coneCutoff == 1.0f);
+		CHECK(closed[0].vertexCount == 8);
+		for (glm::vec3 viewer : { glm::vec3(5, 0, 0), glm::vec3(0, -5, 0), glm::vec3(0, 0, 5), glm::vec3(3, 3, 3) }) {
+			CHECK(MeshUtil::cull_meshlets(closed, everything, viewer).size() == 1);
+		}
+	}
+
+	void frustum_culling() {
+		auto meshlets = MeshUtil::build_meshlets(grid(140, 20.0f));
+
+		// Looking down -z at the middle of the grid from 10 units away, the grid fills far more than the view
+		Camera camera(Transform(glm::vec3(0, 0, 10)), glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f));
+		camera.yaw = -90.0f;
+
+		auto visible = MeshUtil::cull_meshlets(meshlets, camera, glm::mat4(1.0f));
+		CHECK(!visible.empty());
+		CHECK(visible.size() < meshlets.size() / 4);
+
+		// Half the field of view at 10 units covers about 5.8 units, meshlets further out than that plus their radius are outside
+		for (uint32 m : visible) {
+			auto& meshlet = meshlets[m];
+			CHECK(std::abs(meshlet.center.x) <= 5.8f + meshlet.radius && std::abs(meshlet.center.y) <= 5.8f + meshlet.radius);
+		}
+
+		// Every meshlet overlapping the middle of the view is kept
+		for (uint32 m = 0; m < meshlets.size(); m++) {
+			if (glm::length(glm::vec2(meshlets[m].center.x, meshlets[m].center.y)) < 2.0f) CHECK(std::count(visible.begin(), visible.end(), m) == 1);
+		}
+
+		// Moving the grid with the model matrix moves it out of view
+		CHECK(MeshUtil::cull_meshlets(meshlets, camera, glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, 20))).empty());
+		CHECK(MeshUtil::cull_meshlets(meshlets, camera, glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, -150))).empty());
+
+		// Turned around, the grid is behind the camera
+		camera.yaw = 90.0f;
+		CHECK(MeshUtil::cull_meshlets(meshlets, camera, glm::mat4(1.0f)).empty());
+
+		// Below the grid every meshlet is in view but faces away
+		camera.transform.position = glm::vec3(0, 0, -10);
+		CHECK(MeshUtil::cull_meshlets(meshlets, camera, glm::mat4(1.0f)).empty());
+	}
+}
+
+int main() {
+	cluster_limits();
+	bounding_spheres();
+	cone_culling();
+	frustum_culling();
+	return Check::result();
+}
\ No newline at end of file
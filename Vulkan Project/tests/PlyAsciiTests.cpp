@@ -0,0 +1,227 @@
+#include "Check.h"
+#include <Core/MeshLoaders/Ply.h>
+#include <Core/MeshLoaders/PlySchema.h>
+#include <Core/Util/StringUtil.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <sstream>
+
+/*
+	Compares the parallel ascii .ply parser against the line by line parser it replaced and reports the throughput of both.
+	Built from Core/MeshLoaders/PlyAscii.cpp, Core/MeshLoaders/PlySchema.cpp, Core/Util/StringUtil.cpp and Core/Util/WorkerPool.cpp.
+
+	The bodies are generated, with numbers in every notation the exporters we load from write, so no mesh files are needed.
+*/
+
+namespace {
+	using namespace MeshLoaders::Ply;
+
+	/* The previous ascii loader, kept verbatim as the reference */
+	namespace Reference {
+		void load_ply_vertices(std::stringstream& stream, const Element& element, std::vector<Vertex>& verticesOut) {
+			auto mapping = map_vertex_components(element);
+			uint32 vertexIndex = 0;
+			std::string line;
+
+			while (vertexIndex < element.count && std::getline(stream, line)) {
+				auto tokens = StrUtil::string_split(line, ' ');
+				if (tokens.size() < element.properties.size()) throw std::runtime_error("Loading .ply file failed. Vertex " + std::to_string(vertexIndex) + " is missing properties.");
+
+				float* components = (float*)&verticesOut[vertexIndex];
+				for (int c = 0; c < VertexComponentCount; c++) {
+					if (mapping[c] >= 0) components[c] = std::stof(tokens[mapping[c]]);
+				}
+
+				vertexIndex++;
+			}
+		}
+
+		void load_ply_faces(std::stringstream& stream, const Element& element, std::vector<uint32>& indices) {
+			int32 listIndex = find_face_index_list(element);
+			uint32 faceIndex = 0;
+			std::string line;
+
+			while (faceIndex < element.count && std::getline(stream, line)) {
+				auto tokens = StrUtil::string_split(line, ' ');
+				if (tokens.size() <= listIndex) throw std::runtime_error("Loading .ply file failed. Face " + std::to_string(faceIndex) + " is missing its indices.");
+
+				uint32 vertexCount = std::stoul(tokens[listIndex]);
+				if (tokens.size() <= listIndex + vertexCount) throw std::runtime_error("Loading .ply file failed. Face " + std::to_string(faceIndex) + " is missing indices.");
+
+				if (vertexCount >= 3) {
+					uint32 first = std::stoul(tokens[listIndex + 1]);
+					uint32 previous = std::stoul(tokens[listIndex + 2]);
+
+					for (uint32 v = 2; v < vertexCount; v++) {
+						uint32 current = std::stoul(tokens[listIndex + 1 + v]);
+						indices.insert(indices.end(), { first, previous, current });
+						previous = current;
+					}
+				}
+
+				faceIndex++;
+			}
+		}
+
+		void load_ply_ascii(const Header& header, const uint8* data, size_t size, Mesh& mesh) {
+			std::stringstream stream(std::string((const char*)data + header.dataOffset, size - header.dataOffset));
+
+			for (auto& element : header.elements) {
+				if (element.name == "vertex") {
+					mesh.vertices.assign(element.count, { glm::vec3(0), glm::vec3(0), glm::vec2(0) });
+					load_ply_vertices(stream, element, mesh.vertices);
+				}
+				else if (element.name == "face") {
+					mesh.indices.reserve((size_t)element.count * 3);
+					load_ply_faces(stream, element, mesh.indices);
+				}
+				else {
+					std::string line;
+					for (uint32 i = 0; i < element.count && std::getline(stream, line); i++);
+				}
+			}
+		}
+	}
+
+	// Vertices carry an extra column between position and normal, a skipped element sits between vertices and faces
+	// and faces mix triangles with quads
+	std::string generate_ply(uint32 vertexCount, uint32 faceCount, uint32 seed) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_int_distribution<uint32> vertex(0, vertexCount - 1);
+
+		std::string ply;
+		ply += "ply\nformat ascii 1.0\ncomment generated\n";
+		ply += "element vertex " + std::to_string(vertexCount) + "\n";
+		ply += "property float x\nproperty float y\nproperty float z\nproperty float confidence\n";
+		ply += "property float nx\nproperty float ny\nproperty float nz\nproperty float s\nproperty float t\n";
+		ply += "element material 2\nproperty uchar red\nproperty uchar green\nproperty uchar blue\n";
+		ply += "element face " + std::to_string(faceCount) + "\n";
+		ply += "property uchar flags\nproperty list uchar int vertex_indices\n";
+		ply += "end_header\n";
+
+		const char* formats[] = { "%.9g", "%.6f", "%e", "%.2E", "%g" };
+		char number[64];
+		auto append = [&](float value, uint32 format) {
+			snprintf(number, sizeof(number), formats[format % 5], value);
+			ply += number;
+		};
+
+		for (uint32 v = 0; v < vertexCount; v++) {
+			float values[9] = {
+				coordinate(random), coordinate(random), coordinate(random), unit(random),
+				unit(random), unit(random), unit(random), unit(random) * 0.5f + 0.5f, unit(random) * 0.5f + 0.5f
+			};
+			// Some exporters write whole numbers without a fraction
+			if (v % 7 == 0) values[0] = (float)(int32)values[0];
+
+			for (uint32 i = 0; i < 9; i++) {
+				if (i > 0) ply += ' ';
+				append(values[i], v + i);
+			}
+			ply += '\n';
+		}
+
+		ply += "255 0 0\n0 255 0\n";
+
+		for (uint32 f = 0; f < faceCount; f++) {
+			uint32 corners = f % 3 == 0 ? 4 : 3;
+			ply += std::to_string(f % 2) + " " + std::to_string(corners);
+			for (uint32 c = 0; c < corners; c++) ply += " " + std::to_string(vertex(random));
+			ply += '\n';
+		}
+
+		return ply;
+	}
+
+	template<class Loader>
+	Mesh load(const std::string& ply, Loader loader, MeshLoaders::PlyLoadStatistics& statistics) {
+		auto data = (const uint8*)ply.data();
+		auto start = std::chrono::high_resolution_clock::now();
+
+		Header header = load_ply_header(data, ply.size());
+		Mesh mesh;
+		loader(header, data, ply.size(), mesh);
+
+		statistics.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		statistics.fileSize = ply.size();
+		statistics.vertexCount = mesh.vertices.size();
+		statistics.triangleCount = mesh.indices.size() / 3;
+		return mesh;
+	}
+
+	void check_identical(const Mesh& expected, const Mesh& actual) {
+		CHECK(expected.vertices.size() == actual.vertices.size());
+		CHECK(expected.indices == actual.indices);
+		if (expected.vertices.size() == actual.vertices.size()) {
+			CHECK(memcmp(expected.vertices.data(), actual.vertices.data(), expected.vertices.size() * sizeof(Vertex)) == 0);
+		}
+	}
+
+	void report(const char* name, const MeshLoaders::PlyLoadStatistics& statistics) {
+		printf("%-10s %8.1f MB/s %12.0f vertices/s (%.1fMB, %zu vertices, %zu triangles in %.1fms)\n", name,
+			statistics.megabytesPerSecond(), statistics.verticesPerSecond(),
+			statistics.fileSize / (1024.0 * 1024.0), statistics.vertexCount, statistics.triangleCount, statistics.seconds * 1000);
+	}
+
+	void compare(const char* name, uint32 vertexCount, uint32 faceCount) {
+		std::string ply = generate_ply(vertexCount, faceCount, vertexCount);
+
+		MeshLoaders::PlyLoadStatistics referenceStatistics, statistics;
+		Mesh expected = load(ply, Reference::load_ply_ascii, referenceStatistics);
+		Mesh actual = load(ply, MeshLoaders::Ply::load_ply_ascii, statistics);
+		check_identical(expected, actual);
+
+		printf("%s\n", name);
+		report("previous", referenceStatistics);
+		report("current", statistics);
+	}
+
+	// Whether `loader` rejects the body, the messages of the two parsers differ
+	template<class Loader>
+	bool rejects(const std::string& ply, Loader loader) {
+		try {
+			MeshLoaders::PlyLoadStatistics statistics;
+			load(ply, loader, statistics);
+			return false;
+		}
+		catch (const std::runtime_error&) {
+			return true;
+		}
+	}
+
+	void malformed_bodies() {
+		std::string header = "ply\nformat ascii 1.0\nelement vertex 3\nproperty float x\nproperty float y\nproperty float z\n"
+			"element material 1\nproperty uchar red\nelement face 1\nproperty list uchar int vertex_indices\nend_header\n";
+
+		// Every element instance takes exactly one line, so blank lines inside the body are missing values for both parsers
+		for (auto body : { "0 0 0\n\n1 0 0\n0 1 0\n7\n3 0 1 2\n", "0 0 0\n1 0 0\n0 1 0\n \t\n7\n3 0 1 2\n", "0 0 0\n1 0 0\n0 1 0\n7\n\n3 0 1 2\n" }) {
+			CHECK(rejects(header + body, Reference::load_ply_ascii));
+			CHECK(rejects(header + body, MeshLoaders::Ply::load_ply_ascii));
+		}
+
+		// Lines after the last element are ignored, as are carriage returns
+		for (auto body : { "0 0 0\n1 0 0\n0 1 0\n7\n3 0 1 2\n\n\n", "0 0 0\r\n1 0 0\r\n0 1 0\r\n7\r\n3 0 1 2\r\n" }) {
+			MeshLoaders::PlyLoadStatistics statistics;
+			check_identical(load(header + body, Reference::load_ply_ascii, statistics), load(header + body, MeshLoaders::Ply::load_ply_ascii, statistics));
+		}
+
+		// std::stoul wrapped negative indices around to indices far past the last vertex, they are rejected now
+		std::string negativeIndex = header + "0 0 0\n1 0 0\n0 1 0\n7\n3 0 1 -1\n";
+		MeshLoaders::PlyLoadStatistics statistics;
+		CHECK(load(negativeIndex, Reference::load_ply_ascii, statistics).indices.back() == 0xFFFFFFFFu);
+		CHECK(rejects(negativeIndex, MeshLoaders::Ply::load_ply_ascii));
+	}
+}
+
+int main() {
+	// Below the chunk size the body is parsed on the calling thread, above it chunk boundaries fall inside every element
+	compare("Small body, one chunk", 1000, 800);
+	compare("Large body, one chunk per core", 400000, 300000);
+	malformed_bodies();
+	return Check::result();
+}
\ No newline at end of file
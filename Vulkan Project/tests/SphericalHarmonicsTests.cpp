@@ -0,0 +1,101 @@
+#include "Check.h"
+#include <Core/Render/SphericalHarmonics.h>
+#include <functional>
+#include <vector>
+
+/*
+	Projects environments with known irradiance. Built from Core/Render/SphericalHarmonics.cpp, Core/Render/HalfFloat.cpp and Core/Util/WorkerPool.cpp.
+
+	Radiance that lies in bands 0 to 2 is reproduced exactly, so the irradiance follows from the cosine lobe convolution
+	alone: band 0 is kept, band 1 is scaled by 2/3 and band 2 by 1/4.
+*/
+
+namespace {
+	constexpr double PI = 3.14159265358979323846;
+	constexpr double TOLERANCE = 2e-3;
+
+	using Radiance = std::function<float(glm::vec3)>;
+
+	// Directions as the projection and equi_to_cube.frag compute them
+	std::vector<float> equirect(vk::Extent2D extent, Radiance radiance) {
+		std::vector<float> texels((size_t)extent.width * extent.height * 4);
+		for (uint32 y = 0; y < extent.height; y++) {
+			double latitude = ((y + 0.5) / extent.height - 0.5) * PI;
+			for (uint32 x = 0; x < extent.width; x++) {
+				double longitude = ((x + 0.5) / extent.width - 0.5) * 2.0 * PI;
+				glm::vec3 direction((float)(std::cos(latitude) * std::cos(longitude)), (float)std::sin(latitude), (float)(std::cos(latitude) * std::sin(longitude)));
+
+				float* texel = &texels[((size_t)y * extent.width + x) * 4];
+				texel[0] = texel[1] = texel[2] = radiance(direction);
+				texel[3] = 1.0f;
+			}
+		}
+		return texels;
+	}
+
+	void check_irradiance(const TextureUtil::SHRadiance& projection, std::function<float(glm::vec3)> expected) {
+		auto uniforms = TextureUtil::irradiance_uniforms(projection);
+
+		const glm::vec3 normals[] = {
+			{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+			glm::normalize(glm::vec3(1, 1, 1)), glm::normalize(glm::vec3(-2, 1, 0.5f)), glm::normalize(glm::vec3(0.3f, -1, -0.7f))
+		};
+		for (auto& normal : normals) {
+			glm::vec3 irradiance = TextureUtil::evaluate_irradiance(uniforms, normal);
+			CHECK_NEAR(irradiance.x, expected(normal), TOLERANCE);
+			CHECK_NEAR(irradiance.y, irradiance.x, 1e-6);
+			CHECK_NEAR(irradiance.z, irradiance.x, 1e-6);
+		}
+	}
+
+	void constant_environment() {
+		vk::Extent2D extent = { 256, 128 };
+		auto texels = equirect(extent, [](glm::vec3) { return 2.0f; });
+		auto projection = TextureUtil::project_equirect_sh(texels.data(), extent);
+
+		// Only the constant basis function is covered, 2 * 4 pi / (2 sqrt(pi))
+		CHECK_NEAR(projection.coefficients[0].x, 4.0 * std::sqrt(PI), TOLERANCE);
+		for (uint32 i = 1; i < TextureUtil::SH_COEFFICIENT_COUNT; i++) CHECK_NEAR(projection.coefficients[i].x, 0.0, TOLERANCE);
+
+		check_irradiance(projection, [](glm::vec3) { return 2.0f; });
+	}
+
+	void linear_environment() {
+		const glm::vec3 axis = glm::normalize(glm::vec3(0.5f, -1, 2));
+
+		vk::Extent2D extent = { 256, 128 };
+		auto texels = equirect(extent, [&](glm::vec3 direction) { return 1.0f + glm::dot(axis, direction); });
+		auto projection = TextureUtil::project_equirect_sh(texels.data(), extent);
+
+		check_irradiance(projection, [&](glm::vec3 normal) { return 1.0f + 2.0f / 3.0f * glm::dot(axis, normal); });
+		CHECK_NEAR(TextureUtil::evaluate_sh(projection, axis).x, 2.0, TOLERANCE);
+	}
+
+	void quadratic_environment() {
+		// y^2 is 1/3 in band 0 and y^2 - 1/3 in band 2
+		vk::Extent2D extent = { 256, 128 };
+		auto texels = equirect(extent, [](glm::vec3 direction) { return direction.y * direction.y; });
+		auto projection = TextureUtil::project_equirect_sh(texels.data(), extent);
+
+		check_irradiance(projection, [](glm::vec3 normal) { return 1.0f / 3.0f + 0.25f * (normal.y * normal.y - 1.0f / 3.0f); });
+	}
+
+	void constant_cube() {
+		// Constant radiance only tests that the solid angles of the texels cover the sphere
+		const uint32 faceSize = 32;
+		std::vector<float> face((size_t)faceSize * faceSize * 4, 0.5f);
+		const float* faces[6] = { face.data(), face.data(), face.data(), face.data(), face.data(), face.data() };
+		auto projection = TextureUtil::project_cube_sh(faces, faceSize);
+
+		CHECK_NEAR(projection.coefficients[0].x, 0.5 * 4.0 * PI / (2.0 * std::sqrt(PI)), TOLERANCE);
+		for (uint32 i = 1; i < TextureUtil::SH_COEFFICIENT_COUNT; i++) CHECK_NEAR(projection.coefficients[i].x, 0.0, TOLERANCE);
+	}
+}
+
+int main() {
+	constant_environment();
+	linear_environment();
+	quadratic_environment();
+	constant_cube();
+	return Check::result();
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "Check.h"
+#include <Core/Util/TlsfAllocator.h>
+
+#include <functional>
+#include <iterator>
+#include <map>
+#include <random>
+#include <stdexcept>
+
+/*
+	Exercises the sub-allocator behind MemoryAllocator and GeometryArena without a device.
+	Built from Core/Util/TlsfAllocator.cpp.
+*/
+
+namespace {
+	bool throws(std::function<void()> call) {
+		try {
+			call();
+		}
+		catch (const std::runtime_error&) {
+			return true;
+		}
+		return false;
+	}
+
+	void allocate_and_free() {
+		TlsfAllocator allocator(1024);
+		CHECK(allocator.empty());
+		CHECK(allocator.largestFreeRange() == 1024);
+
+		auto a = allocator.allocate(100);
+		auto b = allocator.allocate(200);
+		CHECK(a.valid() && b.valid());
+		CHECK(a.size == 100 && b.size == 200);
+		CHECK(a.offset + a.size <= b.offset || b.offset + b.size <= a.offset);
+		CHECK(allocator.usedSize() == 300);
+		CHECK(allocator.allocationCount() == 2);
+
+		allocator.free(a);
+		allocator.free(b);
+		CHECK(allocator.empty());
+		CHECK(allocator.usedSize() == 0);
+		CHECK(allocator.freeRangeCount() == 1);
+		CHECK(allocator.largestFreeRange() == 1024);
+
+		// Zero byte requests still get a range of their own
+		auto empty = allocator.allocate(0);
+		CHECK(empty.valid() && empty.size == 1);
+		allocator.free(empty);
+	}
+
+	void exhaustion() {
+		TlsfAllocator allocator(4096);
+
+		// A range of exactly the requested size sits in the class of the request itself
+		auto all = allocator.allocate(4096);
+		CHECK(all.valid() && all.offset == 0);
+		CHECK(allocator.largestFreeRange() == 0);
+		CHECK(!allocator.allocate(1).valid());
+
+		allocator.free(all);
+		CHECK(!allocator.allocate(4097).valid());
+		CHECK(!allocator.allocate(~0ull).valid());
+		CHECK(!allocator.allocate(~0ull - 10, 256).valid());
+		CHECK(allocator.empty());
+
+		TlsfAllocator none(0);
+		CHECK(!none.allocate(1).valid());
+	}
+
+	void alignment() {
+		TlsfAllocator allocator(1 << 20);
+
+		// Misalign the free space first
+		auto odd = allocator.allocate(3);
+		const uint64 alignments[] = { 1, 2, 16, 256, 4096, 65536 };
+		std::vector<TlsfAllocator::Allocation> allocations;
+		for (uint64 alignment : alignments) {
+			auto allocation = allocator.allocate(1000, alignment);
+			CHECK(allocation.valid());
+			CHECK(allocation.offset % alignment == 0);
+			allocations.push_back(allocation);
+		}
+
+		CHECK(throws([&]() { allocator.allocate(16, 3); }));
+		CHECK(throws([&]() { allocator.allocate(16, 0); }));
+
+		// The padding in front of aligned ranges stays usable
+		uint64 used = allocator.usedSize();
+		for (auto& allocation : allocations) allocator.free(allocation);
+		allocator.free(odd);
+		CHECK(used == 3 + 1000 * 6);
+		CHECK(allocator.freeRangeCount() == 1);
+		CHECK(allocator.largestFreeRange() == 1 << 20);
+	}
+
+	void coalescing() {
+		TlsfAllocator allocator(4 * 256);
+		TlsfAllocator::Allocation ranges[4];
+		for (auto& range : ranges) range = allocator.allocate(256);
+		CHECK(allocator.freeRangeCount() == 0);
+
+		// Freed ranges merge with the previous and the next free neighbour, never leaving two free ranges adjacent
+		allocator.free(ranges[0]);
+		allocator.free(ranges[2]);
+		CHECK(allocator.freeRangeCount() == 2);
+		CHECK(allocator.largestFreeRange() == 256);
+
+		allocator.free(ranges[1]);
+		CHECK(allocator.freeRangeCount() == 1);
+		CHECK(allocator.largestFreeRange() == 768);
+
+		auto merged = allocator.allocate(768);
+		CHECK(merged.valid() && merged.offset == 0);
+		allocator.free(merged);
+
+		allocator.free(ranges[3]);
+		CHECK(allocator.freeRangeCount() == 1);
+		CHECK(allocator.largestFreeRange() == 1024);
+	}
+
+	void invalid_free() {
+		TlsfAllocator allocator(1024);
+		auto allocation = allocator.allocate(64);
+		allocator.free(allocation);
+
+		CHECK(throws([&]() { allocator.free(allocation); }));
+		CHECK(throws([&]() { allocator.free(TlsfAllocator::Allocation()); }));
+		CHECK(allocator.empty());
+	}
+
+	// Random allocations and frees against a map of the live ranges, checking that no two ranges overlap
+	void random_workload() {
+		const uint64 size = 64ull << 20;
+		TlsfAllocator allocator(size);
+		std::mt19937 random(17);
+		std::uniform_int_distribution<uint32> smallSize(1, 4096), largeSize(1, 1 << 20), alignmentBits(0, 12), action(0, 2);
+
+		std::map<uint64, TlsfAllocator::Allocation> live;
+		uint64 used = 0;
+		bool overlapping = false, misaligned = false;
+
+		for (uint32 step = 0; step < 100000; step++) {
+			if (action(random) != 0 || live.empty()) {
+				uint64 bytes = step % 10 == 0 ? largeSize(random) : smallSize(random);
+				uint64 alignment = 1ull << alignmentBits(random);
+				auto allocation = allocator.allocate(bytes, alignment);
+				if (!allocation.valid()) continue;
+
+				misaligned |= allocation.offset % alignment != 0 || allocation.offset + allocation.size > size;
+
+				auto next = live.lower_bound(allocation.offset);
+				if (next != live.end()) overlapping |= next->first < allocation.offset + allocation.size;
+				if (next != live.begin()) overlapping |= std::prev(next)->second.offset + std::prev(next)->second.size > allocation.offset;
+
+				live[allocation.offset] = allocation;
+				used += allocation.size;
+			}
+			else {
+				auto it = live.begin();
+				std::advance(it, random() % live.size());
+				used -= it->second.size;
+				allocator.free(it->second);
+				live.erase(it);
+			}
+		}
+
+		CHECK(!overlapping);
+		CHECK(!misaligned);
+		CHECK(allocator.usedSize() == used);
+		CHECK(allocator.allocationCount() == live.size());
+
+		for (auto& entry : live) allocator.free(entry.second);
+		CHECK(allocator.empty());
+		CHECK(allocator.freeRangeCount() == 1);
+		CHECK(allocator.largestFreeRange() == size);
+	}
+}
+
+int main() {
+	allocate_and_free();
+	exhaustion();
+	alignment();
+	coalescing();
+	invalid_free();
+	random_workload();
+	return Check::result();
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+@echo off
+rem Builds every test as its own program from the sources named in its header comment and runs it.
+rem Run from a Visual Studio developer command prompt, glm is taken from the Vulkan SDK like in the main project.
+setlocal
+cd /d "%~dp0"
+if not exist build mkdir build
+
+set FLAGS=/nologo /std:c++17 /EHsc /O2 /W3 /D_SILENCE_EXPERIMENTAL_FILESYSTEM_DEPRECATION_WARNING /I..\source /I"%VULKAN_SDK%\Include" /Fobuild\
+set FAILED=0
+
+call :test TlsfAllocatorTests Core\Util\TlsfAllocator.cpp
+call :test PlyAsciiTests Core\MeshLoaders\PlyAscii.cpp Core\MeshLoaders\PlySchema.cpp Core\Util\StringUtil.cpp Core\Util\WorkerPool.cpp
+call :test SphericalHarmonicsTests Core\Render\SphericalHarmonics.cpp Core\Render\HalfFloat.cpp Core\Util\WorkerPool.cpp
+call :test MeshletTests Core\Render\Meshlets.cpp Core\Render\Camera.cpp
+call :test MeshSimplificationTests Core\Render\MeshSimplification.cpp Core\Render\Camera.cpp Core\Util\FileUtil.cpp
+
+if %FAILED% neq 0 (
+	echo %FAILED% test programs failed.
+	exit /b 1
+)
+echo All test programs passed.
+exit /b 0
+
+rem Usage: call :test <name of the test> <sources relative to source\>...
+:test
+set NAME=%1
+set SOURCES=
+:collect
+shift
+if "%~1"=="" goto build
+set SOURCES=%SOURCES% ..\source\%1
+goto collect
+
+:build
+echo %NAME%
+cl %FLAGS% /Febuild\%NAME%.exe %NAME%.cpp %SOURCES% > build\%NAME%.log || (
+	type build\%NAME%.log
+	set /a FAILED+=1
+	exit /b
+)
+build\%NAME%.exe || set /a FAILED+=1
+exit /b
\ No newline at end of file